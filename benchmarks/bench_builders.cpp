@@ -0,0 +1,324 @@
+#include "bench_common.h"
+
+//std/stl
+#include <map>
+#include <string>
+#include <variant>
+#include <stdexcept>
+
+//arrow/parquet
+#include <arrow/api.h>
+#include <arrow/ipc/json_simple.h> // ArrayFromJSON
+#include <arrow/util/checked_cast.h>
+#include <parquet/exception.h>
+
+//benchmark
+#include <benchmark/benchmark.h>
+
+//
+// Ways of building the Arrow arrays of a column of events, for the columns
+// of bench::kColumns ("schema" argument):
+//
+//      ArrayFromJSON       parsing the events as JSON text, as the first
+//                          generator did (see obs/dataset-gen-struct.cpp)
+//      BuilderAppend       appending the events value by value to the typed
+//                          builders of the column
+//      Fill2               appending variant-typed values value by value to
+//                          builders looked up by node name, the pattern of
+//                          fill2() in write-struct.cpp
+//      TypedAppenders      appending whole columns of values (and list
+//                          offsets) at once to the typed builders, as the
+//                          column-wise buffers of the generator allow
+//
+// All build the same array, whose size gives the bytes/s.
+//
+
+using arrow::internal::checked_cast;
+
+namespace {
+
+std::unique_ptr<arrow::ArrayBuilder> make_builder(const std::shared_ptr<arrow::DataType>& type) {
+    std::unique_ptr<arrow::ArrayBuilder> builder;
+    PARQUET_THROW_NOT_OK(arrow::MakeBuilder(arrow::default_memory_pool(), type, &builder));
+    return builder;
+}
+
+std::shared_ptr<arrow::Array> finish(arrow::ArrayBuilder& builder) {
+    std::shared_ptr<arrow::Array> out;
+    PARQUET_THROW_NOT_OK(builder.Finish(&out));
+    return out;
+}
+
+void set_counters(benchmark::State& state, const arrow::Array& array) {
+    state.SetItemsProcessed(state.iterations() * array.length());
+    state.SetBytesProcessed(state.iterations() * bench::buffer_bytes(*array.data()));
+    state.SetLabel(bench::kColumns.at(state.range(1)));
+}
+
+//
+// value by value
+//
+
+template<typename BuilderType, typename ArrayType>
+void append_numeric(arrow::ArrayBuilder* builder, const arrow::Array& array, int64_t i) {
+    PARQUET_THROW_NOT_OK(checked_cast<BuilderType*>(builder)->Append(checked_cast<const ArrayType&>(array).Value(i)));
+}
+
+void append_value(arrow::ArrayBuilder* builder, const arrow::Array& array, int64_t i) {
+    switch(array.type_id()) {
+        case arrow::Type::STRUCT: {
+            auto struct_builder = checked_cast<arrow::StructBuilder*>(builder);
+            const auto& struct_array = checked_cast<const arrow::StructArray&>(array);
+            PARQUET_THROW_NOT_OK(struct_builder->Append());
+            for(int ifield = 0; ifield < struct_array.num_fields(); ifield++) {
+                append_value(struct_builder->field_builder(ifield), *struct_array.field(ifield), i);
+            }
+            break;
+        }
+        case arrow::Type::LIST: {
+            auto list_builder = checked_cast<arrow::ListBuilder*>(builder);
+            const auto& list_array = checked_cast<const arrow::ListArray&>(array);
+            PARQUET_THROW_NOT_OK(list_builder->Append());
+            for(int64_t j = list_array.value_offset(i); j < list_array.value_offset(i + 1); j++) {
+                append_value(list_builder->value_builder(), *list_array.values(), j);
+            }
+            break;
+        }
+        case arrow::Type::BOOL: append_numeric<arrow::BooleanBuilder, arrow::BooleanArray>(builder, array, i); break;
+        case arrow::Type::INT8: append_numeric<arrow::Int8Builder, arrow::Int8Array>(builder, array, i); break;
+        case arrow::Type::UINT8: append_numeric<arrow::UInt8Builder, arrow::UInt8Array>(builder, array, i); break;
+        case arrow::Type::INT32: append_numeric<arrow::Int32Builder, arrow::Int32Array>(builder, array, i); break;
+        case arrow::Type::UINT64: append_numeric<arrow::UInt64Builder, arrow::UInt64Array>(builder, array, i); break;
+        case arrow::Type::FLOAT: append_numeric<arrow::FloatBuilder, arrow::FloatArray>(builder, array, i); break;
+        case arrow::Type::DOUBLE: append_numeric<arrow::DoubleBuilder, arrow::DoubleArray>(builder, array, i); break;
+        default:
+            throw std::runtime_error("ERROR: Unhandled type \"" + array.type()->ToString() + "\"");
+    }
+}
+
+//
+// whole columns at once
+//
+
+template<typename BuilderType, typename ArrayType>
+void append_numeric_column(arrow::ArrayBuilder* builder, const arrow::Array& array) {
+    const auto& values = checked_cast<const ArrayType&>(array);
+    PARQUET_THROW_NOT_OK(checked_cast<BuilderType*>(builder)->AppendValues(values.raw_values(), values.length()));
+}
+
+void append_column(arrow::ArrayBuilder* builder, const arrow::Array& array) {
+    switch(array.type_id()) {
+        case arrow::Type::STRUCT: {
+            auto struct_builder = checked_cast<arrow::StructBuilder*>(builder);
+            const auto& struct_array = checked_cast<const arrow::StructArray&>(array);
+            PARQUET_THROW_NOT_OK(struct_builder->AppendValues(struct_array.length(), nullptr));
+            for(int ifield = 0; ifield < struct_array.num_fields(); ifield++) {
+                append_column(struct_builder->field_builder(ifield), *struct_array.field(ifield));
+            }
+            break;
+        }
+        case arrow::Type::LIST: {
+            // (the offsets are those of the values appended below, the builders start out empty)
+            auto list_builder = checked_cast<arrow::ListBuilder*>(builder);
+            const auto& list_array = checked_cast<const arrow::ListArray&>(array);
+            PARQUET_THROW_NOT_OK(list_builder->AppendValues(list_array.raw_value_offsets(), list_array.length()));
+            append_column(list_builder->value_builder(), *list_array.values());
+            break;
+        }
+        case arrow::Type::BOOL: {
+            // (bit-packed, so appended with a reserve and unchecked appends)
+            auto bool_builder = checked_cast<arrow::BooleanBuilder*>(builder);
+            const auto& values = checked_cast<const arrow::BooleanArray&>(array);
+            PARQUET_THROW_NOT_OK(bool_builder->Reserve(values.length()));
+            for(int64_t i = 0; i < values.length(); i++) {
+                bool_builder->UnsafeAppend(values.Value(i));
+            }
+            break;
+        }
+        case arrow::Type::INT8: append_numeric_column<arrow::Int8Builder, arrow::Int8Array>(builder, array); break;
+        case arrow::Type::UINT8: append_numeric_column<arrow::UInt8Builder, arrow::UInt8Array>(builder, array); break;
+        case arrow::Type::INT32: append_numeric_column<arrow::Int32Builder, arrow::Int32Array>(builder, array); break;
+        case arrow::Type::UINT64: append_numeric_column<arrow::UInt64Builder, arrow::UInt64Array>(builder, array); break;
+        case arrow::Type::FLOAT: append_numeric_column<arrow::FloatBuilder, arrow::FloatArray>(builder, array); break;
+        case arrow::Type::DOUBLE: append_numeric_column<arrow::DoubleBuilder, arrow::DoubleArray>(builder, array); break;
+        default:
+            throw std::runtime_error("ERROR: Unhandled type \"" + array.type()->ToString() + "\"");
+    }
+}
+
+//
+// fill2(): the events as trees of variants, filled into the builders found by
+// their node name ("jets", "jets/jets", "jets/jets/item", "jets/jets/item/pt", ...),
+// with the type of each builder checked on every value (without the builder
+// map copy and the printout of every call of the original)
+//
+
+struct Node;
+using NodeValue = std::variant<bool, int64_t, uint64_t, double, std::vector<Node>>;
+struct Node {
+    NodeValue value;
+}; // struct Node
+
+Node to_node(const arrow::Array& array, int64_t i) {
+    switch(array.type_id()) {
+        case arrow::Type::STRUCT: {
+            const auto& struct_array = checked_cast<const arrow::StructArray&>(array);
+            std::vector<Node> fields;
+            for(int ifield = 0; ifield < struct_array.num_fields(); ifield++) {
+                fields.push_back(to_node(*struct_array.field(ifield), i));
+            }
+            return {fields};
+        }
+        case arrow::Type::LIST: {
+            const auto& list_array = checked_cast<const arrow::ListArray&>(array);
+            std::vector<Node> elements;
+            for(int64_t j = list_array.value_offset(i); j < list_array.value_offset(i + 1); j++) {
+                elements.push_back(to_node(*list_array.values(), j));
+            }
+            return {elements};
+        }
+        case arrow::Type::BOOL: return {checked_cast<const arrow::BooleanArray&>(array).Value(i)};
+        case arrow::Type::INT8: return {int64_t(checked_cast<const arrow::Int8Array&>(array).Value(i))};
+        case arrow::Type::UINT8: return {int64_t(checked_cast<const arrow::UInt8Array&>(array).Value(i))};
+        case arrow::Type::INT32: return {int64_t(checked_cast<const arrow::Int32Array&>(array).Value(i))};
+        case arrow::Type::UINT64: return {checked_cast<const arrow::UInt64Array&>(array).Value(i)};
+        case arrow::Type::FLOAT: return {double(checked_cast<const arrow::FloatArray&>(array).Value(i))};
+        case arrow::Type::DOUBLE: return {checked_cast<const arrow::DoubleArray&>(array).Value(i)};
+        default:
+            throw std::runtime_error("ERROR: Unhandled type \"" + array.type()->ToString() + "\"");
+    }
+}
+
+void builder_map(arrow::ArrayBuilder* builder, const std::string& node,
+        std::map<std::string, arrow::ArrayBuilder*>& out) {
+    out[node] = builder;
+    if(builder->type()->id() == arrow::Type::STRUCT) {
+        auto struct_builder = checked_cast<arrow::StructBuilder*>(builder);
+        for(int ifield = 0; ifield < struct_builder->num_children(); ifield++) {
+            builder_map(struct_builder->field_builder(ifield), node + "/" + builder->type()->field(ifield)->name(), out);
+        }
+    } else if(builder->type()->id() == arrow::Type::LIST) {
+        builder_map(checked_cast<arrow::ListBuilder*>(builder)->value_builder(), node + "/item", out);
+    }
+}
+
+void fill2(const std::string& node, const std::map<std::string, arrow::ArrayBuilder*>& builders, const Node& data) {
+    auto it = builders.find(node);
+    if(it == builders.end()) {
+        throw std::runtime_error("ERROR: node \"" + node + "\" is not in the builder map");
+    }
+    auto builder = it->second;
+    auto type = builder->type();
+    switch(type->id()) {
+        case arrow::Type::STRUCT: {
+            PARQUET_THROW_NOT_OK(dynamic_cast<arrow::StructBuilder*>(builder)->Append());
+            const auto& fields = std::get<std::vector<Node>>(data.value);
+            for(size_t ifield = 0; ifield < fields.size(); ifield++) {
+                fill2(node + "/" + type->field(ifield)->name(), builders, fields.at(ifield));
+            }
+            break;
+        }
+        case arrow::Type::LIST: {
+            PARQUET_THROW_NOT_OK(dynamic_cast<arrow::ListBuilder*>(builder)->Append());
+            for(const auto& element : std::get<std::vector<Node>>(data.value)) {
+                fill2(node + "/item", builders, element);
+            }
+            break;
+        }
+        case arrow::Type::BOOL:
+            PARQUET_THROW_NOT_OK(dynamic_cast<arrow::BooleanBuilder*>(builder)->Append(std::get<bool>(data.value)));
+            break;
+        case arrow::Type::INT8:
+            PARQUET_THROW_NOT_OK(dynamic_cast<arrow::Int8Builder*>(builder)->Append(std::get<int64_t>(data.value)));
+            break;
+        case arrow::Type::UINT8:
+            PARQUET_THROW_NOT_OK(dynamic_cast<arrow::UInt8Builder*>(builder)->Append(std::get<int64_t>(data.value)));
+            break;
+        case arrow::Type::INT32:
+            PARQUET_THROW_NOT_OK(dynamic_cast<arrow::Int32Builder*>(builder)->Append(std::get<int64_t>(data.value)));
+            break;
+        case arrow::Type::UINT64:
+            PARQUET_THROW_NOT_OK(dynamic_cast<arrow::UInt64Builder*>(builder)->Append(std::get<uint64_t>(data.value)));
+            break;
+        case arrow::Type::FLOAT:
+            PARQUET_THROW_NOT_OK(dynamic_cast<arrow::FloatBuilder*>(builder)->Append(std::get<double>(data.value)));
+            break;
+        case arrow::Type::DOUBLE:
+            PARQUET_THROW_NOT_OK(dynamic_cast<arrow::DoubleBuilder*>(builder)->Append(std::get<double>(data.value)));
+            break;
+        default:
+            throw std::runtime_error("ERROR: Unhandled type \"" + type->ToString() + "\"");
+    }
+}
+
+} // namespace
+
+void BM_ArrayFromJSON(benchmark::State& state) {
+    auto source = bench::column(bench::kColumns.at(state.range(1)), state.range(0));
+    auto text = bench::to_json(*source);
+    std::shared_ptr<arrow::Array> array;
+    for(auto _ : state) {
+        PARQUET_THROW_NOT_OK(arrow::ipc::internal::json::ArrayFromJSON(source->type(), text, &array));
+        benchmark::DoNotOptimize(array);
+    }
+    set_counters(state, *array);
+    state.counters["json_bytes"] = text.size();
+}
+
+void BM_BuilderAppend(benchmark::State& state) {
+    auto source = bench::column(bench::kColumns.at(state.range(1)), state.range(0));
+    std::shared_ptr<arrow::Array> array;
+    for(auto _ : state) {
+        auto builder = make_builder(source->type());
+        for(int64_t i = 0; i < source->length(); i++) {
+            append_value(builder.get(), *source, i);
+        }
+        array = finish(*builder);
+        benchmark::DoNotOptimize(array);
+    }
+    set_counters(state, *array);
+}
+
+void BM_Fill2(benchmark::State& state) {
+    auto source = bench::column(bench::kColumns.at(state.range(1)), state.range(0));
+    std::vector<Node> events;
+    for(int64_t i = 0; i < source->length(); i++) {
+        events.push_back(to_node(*source, i));
+    }
+    const std::string name = bench::kColumns.at(state.range(1));
+    std::shared_ptr<arrow::Array> array;
+    for(auto _ : state) {
+        auto builder = make_builder(source->type());
+        std::map<std::string, arrow::ArrayBuilder*> builders;
+        builder_map(builder.get(), name, builders);
+        for(const auto& event : events) {
+            fill2(name, builders, event);
+        }
+        array = finish(*builder);
+        benchmark::DoNotOptimize(array);
+    }
+    set_counters(state, *array);
+}
+
+void BM_TypedAppenders(benchmark::State& state) {
+    auto source = bench::column(bench::kColumns.at(state.range(1)), state.range(0));
+    std::shared_ptr<arrow::Array> array;
+    for(auto _ : state) {
+        auto builder = make_builder(source->type());
+        append_column(builder.get(), *source);
+        array = finish(*builder);
+        benchmark::DoNotOptimize(array);
+    }
+    if(!array->Equals(*source)) {
+        state.SkipWithError("typed appenders built a different array");
+    }
+    set_counters(state, *array);
+}
+
+// events x schema (the index of the column in bench::kColumns)
+#define BUILDER_ARGS ArgsProduct({{10000, 100000}, {0, 1, 2}})->ArgNames({"events", "schema"})->Unit(benchmark::kMillisecond)
+
+BENCHMARK(BM_ArrayFromJSON)->BUILDER_ARGS;
+BENCHMARK(BM_BuilderAppend)->BUILDER_ARGS;
+BENCHMARK(BM_Fill2)->BUILDER_ARGS;
+BENCHMARK(BM_TypedAppenders)->BUILDER_ARGS;
@@ -0,0 +1,132 @@
+#include "bench_common.h"
+#include "dataset_generator.h"
+#include "dataset_reader.h"
+
+// std/stl
+#include <map>
+#include <filesystem>
+#include <stdexcept>
+
+// arrow/parquet
+#include <parquet/exception.h>
+
+// json
+#include "json.hpp"
+using nlohmann::json;
+
+namespace bench {
+
+namespace {
+
+template<typename ArrayType>
+json numeric_value(const arrow::Array& array, int64_t i) {
+    return static_cast<const ArrayType&>(array).Value(i);
+}
+
+json value_json(const arrow::Array& array, int64_t i) {
+    if(array.IsNull(i)) return nullptr;
+    switch(array.type_id()) {
+        case arrow::Type::STRUCT: {
+            const auto& struct_array = static_cast<const arrow::StructArray&>(array);
+            json out = json::object();
+            for(int ifield = 0; ifield < struct_array.num_fields(); ifield++) {
+                out[array.type()->field(ifield)->name()] = value_json(*struct_array.field(ifield), i);
+            }
+            return out;
+        }
+        case arrow::Type::LIST: {
+            const auto& list_array = static_cast<const arrow::ListArray&>(array);
+            json out = json::array();
+            for(int64_t j = list_array.value_offset(i); j < list_array.value_offset(i + 1); j++) {
+                out.push_back(value_json(*list_array.values(), j));
+            }
+            return out;
+        }
+        case arrow::Type::BOOL: return static_cast<const arrow::BooleanArray&>(array).Value(i);
+        case arrow::Type::INT8: return numeric_value<arrow::Int8Array>(array, i);
+        case arrow::Type::UINT8: return numeric_value<arrow::UInt8Array>(array, i);
+        case arrow::Type::INT16: return numeric_value<arrow::Int16Array>(array, i);
+        case arrow::Type::UINT16: return numeric_value<arrow::UInt16Array>(array, i);
+        case arrow::Type::INT32: return numeric_value<arrow::Int32Array>(array, i);
+        case arrow::Type::UINT32: return numeric_value<arrow::UInt32Array>(array, i);
+        case arrow::Type::INT64: return numeric_value<arrow::Int64Array>(array, i);
+        case arrow::Type::UINT64: return numeric_value<arrow::UInt64Array>(array, i);
+        case arrow::Type::FLOAT: return numeric_value<arrow::FloatArray>(array, i);
+        case arrow::Type::DOUBLE: return numeric_value<arrow::DoubleArray>(array, i);
+        default:
+            throw std::runtime_error("ERROR: Unhandled type \"" + array.type()->ToString() + "\" in to_json");
+    }
+}
+
+} // namespace
+
+std::shared_ptr<arrow::Table> events(Layout layout, int64_t n_events) {
+    static std::map<std::pair<Layout, int64_t>, std::shared_ptr<arrow::Table>> cache;
+    auto key = std::make_pair(layout, n_events);
+    auto it = cache.find(key);
+    if(it != cache.end()) return it->second;
+
+    // generated (uncompressed) to a scratch directory, and read back
+    auto dir = (std::filesystem::temp_directory_path() / "micro-benchmarks"
+            / (helpers::layout_name(layout) + "_" + std::to_string(n_events))).string();
+    std::filesystem::remove_all(dir);
+    {
+        DatasetGenerator generator;
+        generator.set_write_summary(false);
+        generator.init("events", dir, "UNCOMPRESSED", "parquet", helpers::layout_name(layout));
+        generator.generate_events(n_events);
+        generator.finish();
+    }
+    DatasetReader dataset(dir, false);
+    RowGroupReader reader(dataset);
+    std::vector<std::shared_ptr<arrow::Table>> tables;
+    for(const auto& task : dataset.row_groups()) {
+        tables.push_back(reader.read(task, {}));
+    }
+    std::shared_ptr<arrow::Table> table;
+    PARQUET_ASSIGN_OR_THROW(table, arrow::ConcatenateTables(tables));
+    PARQUET_ASSIGN_OR_THROW(table, table->CombineChunks());
+    std::filesystem::remove_all(dir);
+
+    cache[key] = table;
+    return table;
+}
+
+std::shared_ptr<arrow::Array> column(const std::string& name, int64_t n_events) {
+    auto column = events(Layout::NESTED, n_events)->GetColumnByName(name);
+    if(!column || column->num_chunks() != 1) {
+        throw std::runtime_error("ERROR: No column \"" + name + "\" in the nested layout");
+    }
+    return column->chunk(0);
+}
+
+int64_t buffer_bytes(const arrow::ArrayData& data) {
+    int64_t bytes = 0;
+    for(const auto& buffer : data.buffers) {
+        if(buffer) bytes += buffer->size();
+    }
+    for(const auto& child : data.child_data) {
+        bytes += buffer_bytes(*child);
+    }
+    return bytes;
+}
+
+int64_t buffer_bytes(const arrow::Table& table) {
+    int64_t bytes = 0;
+    for(const auto& column : table.columns()) {
+        for(const auto& chunk : column->chunks()) {
+            bytes += buffer_bytes(*chunk->data());
+        }
+    }
+    return bytes;
+}
+
+std::string to_json(const arrow::Array& array) {
+    json out = json::array();
+    for(int64_t i = 0; i < array.length(); i++) {
+        out.push_back(value_json(array, i));
+    }
+    return out.dump();
+}
+
+}; // namespace bench
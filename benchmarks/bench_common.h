@@ -0,0 +1,45 @@
+#pragma once
+
+#include "event_layout.h"
+
+//std/stl
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+//arrow/parquet
+#include <arrow/api.h>
+
+//
+// Shared inputs of the micro-benchmarks: the events of DatasetGenerator (the
+// same events as gen-dataset writes) as in-memory tables, generated once per
+// layout and event count and cached for all benchmarks of the process.
+//
+// The benchmarks take the event count and the schema (a layout, or a column of
+// the nested layout) as arguments, and report items/s (events) and bytes/s
+// (the in-memory size of the Arrow data built, written or read).
+//
+namespace bench {
+
+    // the layouts of the "layout" argument of the benchmarks, by index
+    const std::vector<Layout> kLayouts = {Layout::NESTED, Layout::JAGGED, Layout::PADDED, Layout::FLAT};
+    // the nested layout columns of the "schema" argument, by index: a struct of
+    // scalars, a struct with a list<bool>, and a struct with a list<struct>
+    const std::vector<std::string> kColumns = {"met", "event", "jets"};
+
+    // the first "n_events" events of the generator in "layout", as a table with
+    // a single chunk per column
+    std::shared_ptr<arrow::Table> events(Layout layout, int64_t n_events);
+
+    // a column of the nested layout events as a single array
+    std::shared_ptr<arrow::Array> column(const std::string& name, int64_t n_events);
+
+    // bytes of the buffers of an array (or of all columns of a table), children included
+    int64_t buffer_bytes(const arrow::ArrayData& data);
+    int64_t buffer_bytes(const arrow::Table& table);
+
+    // the values of "array" as a JSON array (struct values as objects), the input of ArrayFromJSON
+    std::string to_json(const arrow::Array& array);
+
+}; // namespace bench
@@ -0,0 +1,154 @@
+#include "bench_common.h"
+#include "table_sink.h"
+#include "output_stream.h"
+#include "uring_file.h"
+
+//std/stl
+#include <filesystem>
+#include <string>
+#include <vector>
+
+//arrow/parquet
+#include <arrow/api.h>
+#include <arrow/io/api.h>
+#include <parquet/exception.h>
+
+//benchmark
+#include <benchmark/benchmark.h>
+
+//
+// Parquet files of the generator events (nested layout, UNCOMPRESSED, written
+// RowGroup by RowGroup through TableSink as gen-dataset does) to a temporary
+// file, through the output streams ("stream" argument):
+//
+//      arrow           Arrow's FileOutputStream, a write(2) per write of the writer
+//      arrow-1M        Arrow's BufferedOutputStream (1 MB) over the former
+//      coalesce-1M     fileio::CoalescingFileStream, 1 MB buffer
+//      coalesce-8M     fileio::CoalescingFileStream, 8 MB buffer
+//      prealloc        as coalesce-8M, preallocating 64 MB at a time
+//      sync-close      as coalesce-8M, with fdatasync(2) on close
+//      sync-range      as coalesce-8M, starting the write-back every 16 MB
+//      uring           fileio::UringOutputStream, 8 writes of 1 MB in flight
+//
+// Bytes/s count the bytes of the file written, and the "syscalls" counter is
+// the number of write(2) (and sync/fallocate) calls per file: counted by the
+// stream for CoalescingFileStream, the io_uring_enter(2) calls for
+// UringOutputStream (the "writes" counter are the writes it queued), and as
+// the writes reaching the FileOutputStream (which makes one write(2) per call)
+// for Arrow's streams. The uring stream is skipped when io_uring is not
+// available.
+//
+
+namespace {
+
+const int64_t kEvents = 200000;
+const std::vector<std::string> kStreams = {"arrow", "arrow-1M", "coalesce-1M", "coalesce-8M", "prealloc", "sync-close", "sync-range", "uring"};
+
+// counts the writes reaching Arrow's FileOutputStream
+class CountingOutputStream : public arrow::io::OutputStream {
+    public:
+        CountingOutputStream(std::shared_ptr<arrow::io::OutputStream> stream) : _stream(stream), _writes(0) {}
+
+        arrow::Status Write(const void* data, int64_t nbytes) override {
+            _writes++;
+            return _stream->Write(data, nbytes);
+        }
+        using arrow::io::OutputStream::Write;
+        arrow::Status Flush() override { return _stream->Flush(); }
+        arrow::Status Close() override { return _stream->Close(); }
+        bool closed() const override { return _stream->closed(); }
+        arrow::Result<int64_t> Tell() const override { return _stream->Tell(); }
+
+        int64_t writes() const { return _writes; }
+
+    private :
+        std::shared_ptr<arrow::io::OutputStream> _stream;
+        int64_t _writes;
+}; // class CountingOutputStream
+
+fileio::OutputOptions stream_options(const std::string& stream) {
+    fileio::OutputOptions options;
+    options.buffer_size = (stream == "coalesce-1M" ? 1 : 8) * 1024 * 1024;
+    if(stream == "prealloc") {
+        options.preallocate = 64 * 1024 * 1024;
+    } else if(stream == "sync-close") {
+        options.sync = fileio::SyncPolicy::CLOSE;
+    } else if(stream == "sync-range") {
+        options.sync = fileio::SyncPolicy::RANGE;
+        options.sync_bytes = 16 * 1024 * 1024;
+    }
+    return options;
+}
+
+} // namespace
+
+void BM_WriteFile(benchmark::State& state) {
+    auto table = bench::events(Layout::NESTED, kEvents);
+    const auto& stream = kStreams.at(state.range(1));
+    auto path = (std::filesystem::temp_directory_path() / "micro-benchmarks-output.parquet").string();
+
+    int64_t written = 0;
+    int64_t syscalls = 0;
+    int64_t writes = 0;
+    if(stream == "uring") {
+        std::string reason;
+        if(!fileio::uring_available(&reason)) {
+            state.SkipWithError(("io_uring is not available: " + reason).c_str());
+            return;
+        }
+    }
+    for(auto _ : state) {
+        std::shared_ptr<arrow::io::OutputStream> outfile;
+        std::shared_ptr<CountingOutputStream> counting;
+        std::shared_ptr<fileio::CoalescingFileStream> coalescing;
+        std::shared_ptr<fileio::UringOutputStream> uring;
+        if(stream == "arrow" || stream == "arrow-1M") {
+            std::shared_ptr<arrow::io::FileOutputStream> file;
+            PARQUET_ASSIGN_OR_THROW(file, arrow::io::FileOutputStream::Open(path));
+            counting = std::make_shared<CountingOutputStream>(file);
+            outfile = counting;
+            if(stream == "arrow-1M") {
+                PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::BufferedOutputStream::Create(1024 * 1024,
+                            arrow::default_memory_pool(), counting));
+            }
+        } else if(stream == "uring") {
+            fileio::UringOptions options;
+            PARQUET_ASSIGN_OR_THROW(uring, fileio::UringOutputStream::Open(path, options));
+            outfile = uring;
+        } else {
+            PARQUET_ASSIGN_OR_THROW(coalescing, fileio::CoalescingFileStream::Open(path, stream_options(stream)));
+            outfile = coalescing;
+        }
+        auto sink = TableSink::make(OutputFormat::PARQUET, outfile, table->schema(), "UNCOMPRESSED");
+        sink->write(*table, state.range(0));
+        sink->close();
+        PARQUET_ASSIGN_OR_THROW(written, outfile->Tell());
+        PARQUET_THROW_NOT_OK(outfile->Close());
+        if(coalescing) {
+            const auto& stats = coalescing->stats();
+            syscalls += stats.writes + stats.syncs + stats.preallocations;
+        } else if(uring) {
+            writes += uring->stats().writes;
+            syscalls += uring->stats().enters + uring->stats().syncs;
+        } else {
+            syscalls += counting->writes();
+        }
+    }
+    std::filesystem::remove(path);
+
+    state.SetItemsProcessed(state.iterations() * table->num_rows());
+    state.SetBytesProcessed(state.iterations() * written);
+    state.counters["file_bytes"] = written;
+    state.counters["syscalls"] = benchmark::Counter(syscalls, benchmark::Counter::kAvgIterations);
+    if(stream == "uring") {
+        state.counters["writes"] = benchmark::Counter(writes, benchmark::Counter::kAvgIterations);
+    }
+    state.SetLabel(stream);
+}
+
+// RowGroup size x stream (the index in kStreams)
+BENCHMARK(BM_WriteFile)
+    ->ArgsProduct({{10000, 100000}, {0, 1, 2, 3, 4, 5, 6, 7}})
+    ->ArgNames({"rg_size", "stream"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
@@ -0,0 +1,100 @@
+#include "bench_common.h"
+#include "memory_pool.h"
+
+//std/stl
+#include <map>
+#include <numeric>
+#include <vector>
+
+//arrow/parquet
+#include <arrow/api.h>
+#include <arrow/io/api.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/exception.h>
+
+//benchmark
+#include <benchmark/benchmark.h>
+
+//
+// Leaf-projected reads (parquet::arrow::FileReader::ReadRowGroups with leaf
+// column indices, as RowGroupReader does) of an in-memory SNAPPY compressed
+// file of the generator events, for the layouts of bench::kLayouts ("schema"
+// argument) and the first 1, 4 or all leaves.
+//
+// Items/s and bytes/s count the events and the bytes of the Arrow table read,
+// the "chunk_bytes" counter is the compressed size of the column chunks read,
+// and "read_allocs"/"decode_allocs" (and the bytes) are the allocations per
+// iteration of the READ and DECODE pools of memory_pool.h, as DatasetReader
+// uses them.
+//
+
+namespace {
+
+const int64_t kRowGroupSize = 10000;
+
+std::shared_ptr<arrow::Buffer> file_buffer(Layout layout, int64_t n_events) {
+    static std::map<std::pair<Layout, int64_t>, std::shared_ptr<arrow::Buffer>> cache;
+    auto key = std::make_pair(layout, n_events);
+    auto it = cache.find(key);
+    if(it != cache.end()) return it->second;
+
+    auto table = bench::events(layout, n_events);
+    auto props = parquet::WriterProperties::Builder().compression(arrow::Compression::SNAPPY)->build();
+    auto sink = arrow::io::BufferOutputStream::Create().ValueOrDie();
+    PARQUET_THROW_NOT_OK(parquet::arrow::WriteTable(*table, arrow::default_memory_pool(), sink, kRowGroupSize, props));
+    std::shared_ptr<arrow::Buffer> buffer;
+    PARQUET_ASSIGN_OR_THROW(buffer, sink->Finish());
+    cache[key] = buffer;
+    return buffer;
+}
+
+} // namespace
+
+void BM_ReadLeaves(benchmark::State& state) {
+    auto buffer = file_buffer(bench::kLayouts.at(state.range(1)), state.range(0));
+    auto metadata = parquet::ReadMetaData(std::make_shared<arrow::io::BufferReader>(buffer));
+    int n_leaves = state.range(2) > 0 ? std::min<int>(state.range(2), metadata->num_columns()) : metadata->num_columns();
+    std::vector<int> leaves(n_leaves);
+    std::iota(leaves.begin(), leaves.end(), 0);
+    std::vector<int> row_groups(metadata->num_row_groups());
+    std::iota(row_groups.begin(), row_groups.end(), 0);
+
+    int64_t chunk_bytes = 0;
+    for(auto irg : row_groups) {
+        for(auto ileaf : leaves) {
+            chunk_bytes += metadata->RowGroup(irg)->ColumnChunk(ileaf)->total_compressed_size();
+        }
+    }
+
+    std::shared_ptr<arrow::Table> table;
+    memory::reset_stats();
+    for(auto _ : state) {
+        // (the footer is parsed anew on every read, as for every RowGroupReader::open)
+        parquet::arrow::FileReaderBuilder builder;
+        PARQUET_THROW_NOT_OK(builder.Open(std::make_shared<arrow::io::BufferReader>(buffer),
+                    parquet::ReaderProperties(memory::pool(memory::Phase::READ))));
+        std::unique_ptr<parquet::arrow::FileReader> reader;
+        PARQUET_THROW_NOT_OK(builder.memory_pool(memory::pool(memory::Phase::DECODE))->Build(&reader));
+        PARQUET_THROW_NOT_OK(reader->ReadRowGroups(row_groups, leaves, &table));
+        benchmark::DoNotOptimize(table);
+    }
+
+    state.SetItemsProcessed(state.iterations() * table->num_rows());
+    state.SetBytesProcessed(state.iterations() * bench::buffer_bytes(*table));
+    state.counters["leaves"] = n_leaves;
+    state.counters["chunk_bytes"] = chunk_bytes;
+    for(auto phase : {memory::Phase::READ, memory::Phase::DECODE}) {
+        auto allocations = memory::stats(phase);
+        auto name = memory::phase_name(phase);
+        state.counters[name + "_allocs"] = benchmark::Counter(allocations.allocations, benchmark::Counter::kAvgIterations);
+        state.counters[name + "_bytes"] = benchmark::Counter(allocations.bytes_allocated, benchmark::Counter::kAvgIterations);
+    }
+    state.SetLabel(helpers::layout_name(bench::kLayouts.at(state.range(1))));
+}
+
+// events x schema (the index of the layout in bench::kLayouts) x leaves (0: all)
+BENCHMARK(BM_ReadLeaves)
+    ->ArgsProduct({{10000, 100000}, {0, 1, 2, 3}, {1, 4, 0}})
+    ->ArgNames({"events", "schema", "leaves"})
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,183 @@
+#include "bench_common.h"
+#include "table_sink.h"
+#include "uring_file.h"
+
+//std/stl
+#include <atomic>
+#include <filesystem>
+#include <numeric>
+#include <string>
+#include <vector>
+
+//arrow/parquet
+#include <arrow/api.h>
+#include <arrow/io/api.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/exception.h>
+
+//benchmark
+#include <benchmark/benchmark.h>
+
+// posix
+#include <fcntl.h> // open, posix_fadvise
+#include <unistd.h> // close
+
+//
+// Reads of all RowGroups of a Parquet file of the generator events (nested
+// layout, UNCOMPRESSED, RowGroups of 100k events, written once to a temporary
+// file) with parquet::arrow::FileReader, as DatasetReader opens it, through
+// the file of the "stream" argument:
+//
+//      arrow           Arrow's ReadableFile, a pread(2) per read of the FileReader
+//      uring-1         fileio::UringReadableFile, reads of 256 kB, 1 in flight
+//      uring-8         as uring-1, 8 reads in flight
+//      uring-32        as uring-1, 32 reads in flight
+//
+// from the page cache ("cold" 0), or with the pages of the file dropped from
+// it before each iteration ("cold" 1, posix_fadvise(2) DONTNEED, which needs
+// the file written back; the drop is not timed).
+//
+// Items/s and bytes/s count the events and the bytes of the file read, the
+// "syscalls" counter is the number of pread(2) (Arrow) or io_uring_enter(2)
+// calls per iteration. The uring streams are skipped when io_uring is not
+// available.
+//
+
+namespace {
+
+const int64_t kEvents = 500000;
+const int64_t kRowGroupSize = 100000;
+const int64_t kBlockSize = 256 * 1024;
+const std::vector<std::string> kStreams = {"arrow", "uring-1", "uring-8", "uring-32"};
+
+// counts the reads reaching Arrow's ReadableFile
+class CountingReadableFile : public arrow::io::RandomAccessFile {
+    public:
+        CountingReadableFile(std::shared_ptr<arrow::io::RandomAccessFile> file) : _file(file), _reads(0) {}
+
+        arrow::Status Close() override { return _file->Close(); }
+        bool closed() const override { return _file->closed(); }
+        arrow::Result<int64_t> Tell() const override { return _file->Tell(); }
+        arrow::Status Seek(int64_t position) override { return _file->Seek(position); }
+        arrow::Result<int64_t> GetSize() override { return _file->GetSize(); }
+        arrow::Result<int64_t> Read(int64_t nbytes, void* out) override {
+            _reads++;
+            return _file->Read(nbytes, out);
+        }
+        arrow::Result<std::shared_ptr<arrow::Buffer>> Read(int64_t nbytes) override {
+            _reads++;
+            return _file->Read(nbytes);
+        }
+        arrow::Result<int64_t> ReadAt(int64_t position, int64_t nbytes, void* out) override {
+            _reads++;
+            return _file->ReadAt(position, nbytes, out);
+        }
+        arrow::Result<std::shared_ptr<arrow::Buffer>> ReadAt(int64_t position, int64_t nbytes) override {
+            _reads++;
+            return _file->ReadAt(position, nbytes);
+        }
+        using arrow::io::RandomAccessFile::ReadAt;
+
+        int64_t reads() const { return _reads; }
+
+    private :
+        std::shared_ptr<arrow::io::RandomAccessFile> _file;
+        std::atomic<int64_t> _reads;
+}; // class CountingReadableFile
+
+// the file of the events, written (and synced) once per process
+const std::string& file_path() {
+    static std::string path;
+    if(!path.empty()) return path;
+    path = (std::filesystem::temp_directory_path() / "micro-benchmarks-input.parquet").string();
+    auto table = bench::events(Layout::NESTED, kEvents);
+    std::shared_ptr<arrow::io::FileOutputStream> outfile;
+    PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(path));
+    auto sink = TableSink::make(OutputFormat::PARQUET, outfile, table->schema(), "UNCOMPRESSED");
+    sink->write(*table, kRowGroupSize);
+    sink->close();
+    PARQUET_THROW_NOT_OK(outfile->Close());
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd >= 0) {
+        fileio::data_sync(fd);
+        ::close(fd);
+    }
+    return path;
+}
+
+void drop_cache(const std::string& path) {
+#ifdef __linux__
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd >= 0) {
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+#endif
+}
+
+} // namespace
+
+void BM_ReadFile(benchmark::State& state) {
+    const auto& stream = kStreams.at(state.range(0));
+    bool cold = state.range(1) != 0;
+    fileio::UringOptions options;
+    options.block_size = kBlockSize;
+    if(stream != "arrow") {
+        std::string reason;
+        if(!fileio::uring_available(&reason)) {
+            state.SkipWithError(("io_uring is not available: " + reason).c_str());
+            return;
+        }
+        options.queue_depth = std::stoul(stream.substr(stream.find('-') + 1));
+    }
+    const auto& path = file_path();
+
+    int64_t file_bytes = 0;
+    int64_t n_events = 0;
+    int64_t syscalls = 0;
+    for(auto _ : state) {
+        if(cold) {
+            state.PauseTiming();
+            drop_cache(path);
+            state.ResumeTiming();
+        }
+        std::shared_ptr<arrow::io::RandomAccessFile> infile;
+        std::shared_ptr<CountingReadableFile> counting;
+        std::shared_ptr<fileio::UringReadableFile> uring;
+        if(stream == "arrow") {
+            std::shared_ptr<arrow::io::ReadableFile> file;
+            PARQUET_ASSIGN_OR_THROW(file, arrow::io::ReadableFile::Open(path));
+            counting = std::make_shared<CountingReadableFile>(file);
+            infile = counting;
+        } else {
+            PARQUET_ASSIGN_OR_THROW(uring, fileio::UringReadableFile::Open(path, options));
+            infile = uring;
+        }
+        PARQUET_ASSIGN_OR_THROW(file_bytes, infile->GetSize());
+
+        parquet::arrow::FileReaderBuilder builder;
+        PARQUET_THROW_NOT_OK(builder.Open(infile));
+        std::unique_ptr<parquet::arrow::FileReader> reader;
+        PARQUET_THROW_NOT_OK(builder.Build(&reader));
+        std::vector<int> row_groups(reader->num_row_groups());
+        std::iota(row_groups.begin(), row_groups.end(), 0);
+        std::shared_ptr<arrow::Table> table;
+        PARQUET_THROW_NOT_OK(reader->ReadRowGroups(row_groups, &table));
+        benchmark::DoNotOptimize(table);
+        n_events = table->num_rows();
+        PARQUET_THROW_NOT_OK(infile->Close());
+        syscalls += uring ? uring->stats().enters : counting->reads();
+    }
+
+    state.SetItemsProcessed(state.iterations() * n_events);
+    state.SetBytesProcessed(state.iterations() * file_bytes);
+    state.counters["syscalls"] = benchmark::Counter(syscalls, benchmark::Counter::kAvgIterations);
+    state.SetLabel(stream + (cold ? " cold" : " warm"));
+}
+
+// stream (the index in kStreams) x cold
+BENCHMARK(BM_ReadFile)
+    ->ArgsProduct({{0, 1, 2, 3}, {0, 1}})
+    ->ArgNames({"stream", "cold"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
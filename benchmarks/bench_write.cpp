@@ -0,0 +1,100 @@
+#include "bench_common.h"
+#include "table_sink.h" // helpers::compression_type
+#include "memory_pool.h"
+
+//std/stl
+#include <string>
+#include <vector>
+
+//arrow/parquet
+#include <arrow/api.h>
+#include <arrow/io/api.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/arrow/schema.h>
+#include <parquet/exception.h>
+
+//benchmark
+#include <benchmark/benchmark.h>
+
+//
+// parquet::arrow::WriteTable of the generator events into memory, for the
+// layouts of bench::kLayouts ("schema" argument), RowGroup sizes, codecs and
+// encodings:
+//
+//      dict        the parquet-cpp default, dictionary encoding falling back
+//                  to PLAIN once the dictionary page gets too large
+//      plain       dictionary encoding disabled
+//      bss         dictionary encoding disabled and BYTE_STREAM_SPLIT for
+//                  the FLOAT and DOUBLE columns
+//
+// Items/s and bytes/s count the events and the bytes of the Arrow table
+// written, the "ratio" counter is the written size over the table size, and
+// "allocs"/"alloc_bytes"/"peak_bytes" are the writer's allocations per
+// iteration (from the WRITE pool of memory_pool.h).
+//
+
+namespace {
+
+const std::vector<std::string> kCodecs = {"UNCOMPRESSED", "SNAPPY", "ZSTD"};
+const std::vector<std::string> kEncodings = {"dict", "plain", "bss"};
+
+std::shared_ptr<parquet::WriterProperties> writer_properties(const arrow::Schema& schema,
+        const std::string& codec, const std::string& encoding) {
+    parquet::WriterProperties::Builder builder;
+    builder.compression(helpers::compression_type(codec));
+    builder.data_pagesize(1024*1024*10); // as in table_sink.cpp
+    builder.memory_pool(memory::pool(memory::Phase::WRITE));
+    if(encoding != "dict") {
+        builder.disable_dictionary();
+    }
+    if(encoding == "bss") {
+        // (encodings are set per leaf path, taken from the Parquet schema of the table)
+        std::shared_ptr<parquet::SchemaDescriptor> descr;
+        PARQUET_THROW_NOT_OK(parquet::arrow::ToParquetSchema(&schema, *builder.build(),
+                    *parquet::default_arrow_writer_properties(), &descr));
+        for(int icol = 0; icol < descr->num_columns(); icol++) {
+            auto column = descr->Column(icol);
+            if(column->physical_type() == parquet::Type::FLOAT || column->physical_type() == parquet::Type::DOUBLE) {
+                builder.encoding(column->path(), parquet::Encoding::BYTE_STREAM_SPLIT);
+            }
+        }
+    }
+    return builder.build();
+}
+
+} // namespace
+
+void BM_WriteTable(benchmark::State& state) {
+    auto table = bench::events(bench::kLayouts.at(state.range(1)), state.range(0));
+    const auto& codec = kCodecs.at(state.range(3));
+    const auto& encoding = kEncodings.at(state.range(4));
+    auto props = writer_properties(*table->schema(), codec, encoding);
+
+    int64_t written = 0;
+    memory::reset_stats();
+    for(auto _ : state) {
+        auto sink = arrow::io::BufferOutputStream::Create().ValueOrDie();
+        PARQUET_THROW_NOT_OK(parquet::arrow::WriteTable(*table, memory::pool(memory::Phase::WRITE), sink,
+                    state.range(2), props));
+        std::shared_ptr<arrow::Buffer> buffer;
+        PARQUET_ASSIGN_OR_THROW(buffer, sink->Finish());
+        written = buffer->size();
+    }
+
+    int64_t table_bytes = bench::buffer_bytes(*table);
+    state.SetItemsProcessed(state.iterations() * table->num_rows());
+    state.SetBytesProcessed(state.iterations() * table_bytes);
+    state.counters["file_bytes"] = written;
+    state.counters["ratio"] = double(written) / table_bytes;
+    auto allocations = memory::stats(memory::Phase::WRITE);
+    state.counters["allocs"] = benchmark::Counter(allocations.allocations, benchmark::Counter::kAvgIterations);
+    state.counters["alloc_bytes"] = benchmark::Counter(allocations.bytes_allocated, benchmark::Counter::kAvgIterations);
+    state.counters["peak_bytes"] = allocations.peak;
+    state.SetLabel(helpers::layout_name(bench::kLayouts.at(state.range(1))) + "/" + codec + "/" + encoding);
+}
+
+// events x schema (the index of the layout in bench::kLayouts) x RowGroup size x codec x encoding
+BENCHMARK(BM_WriteTable)
+    ->ArgsProduct({{10000, 100000}, {0, 1, 2, 3}, {10000, 100000}, {0, 1, 2}, {0, 1, 2}})
+    ->ArgNames({"events", "schema", "rg_size", "codec", "encoding"})
+    ->Unit(benchmark::kMillisecond);
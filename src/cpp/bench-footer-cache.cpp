@@ -0,0 +1,134 @@
+#include "dataset_generator.h"
+#include "dataset_reader.h"
+#include "footer_cache.h"
+
+//std/stl
+#include <iostream>
+#include <iomanip>
+#include <cstring> // strcmp
+#include <chrono>
+#include <filesystem>
+#include <functional>
+
+//
+// Benchmark of the footer cache (see footer_cache.h): a dataset of many files
+// with many (small) RowGroups each is planned, and all of its files opened,
+// over and over, reading the footers from the files each time, from the
+// _metadata summary, from a FooterCache kept in memory across the repeats,
+// and from a cache directory loaded anew for every repeat (as a new process
+// would). The first and the mean of the following repeats are reported, the
+// files being in the page cache throughout.
+//
+
+void print_usage(char* argv[]) {
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+    std::cout << " Compare the time to plan a dataset and open its files with and without a footer cache" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Usage: " << argv[0] << " [OPTIONS]" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Options:" << std::endl;
+    std::cout << "   -i|--input             Dataset to plan [default: one generated with the options below]" << std::endl;
+    std::cout << "   -n|--n-events          Number of events to generate [default: 2000000]" << std::endl;
+    std::cout << "   -r|--row-group-size    Number of events per RowGroup [default: 500]" << std::endl;
+    std::cout << "   -N|--events-per-file   Number of events per file [default: 50000]" << std::endl;
+    std::cout << "   -w|--workdir           Directory for the generated dataset and the cache [default: \"./bench_footer_cache\"]" << std::endl;
+    std::cout << "   --repeat               Number of times each is planned [default: 10]" << std::endl;
+    std::cout << "   -h|--help              Print this help message and exit" << std::endl;
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string input = "";
+    uint64_t n_events = 2000000;
+    int32_t row_group_size = 500;
+    uint64_t events_per_file = 50000;
+    std::string workdir = "./bench_footer_cache";
+    size_t n_repeat = 10;
+
+    for(size_t i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--input") == 0) { input = argv[++i]; }
+        else if (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--n-events") == 0) { n_events = std::stoull(argv[++i]); }
+        else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--row-group-size") == 0) { row_group_size = std::stoi(argv[++i]); }
+        else if (strcmp(argv[i], "-N") == 0 || strcmp(argv[i], "--events-per-file") == 0) { events_per_file = std::stoull(argv[++i]); }
+        else if (strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--workdir") == 0) { workdir = argv[++i]; }
+        else if (strcmp(argv[i], "--repeat") == 0) { n_repeat = std::max<size_t>(2, std::stoul(argv[++i])); }
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { print_usage(argv); return 0; }
+        else {
+            std::cout << argv[0] << " Unknown command line argument provided: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    if(input.empty()) {
+        input = (std::filesystem::path(workdir) / "generated").string();
+        std::filesystem::remove_all(input);
+        DatasetGenerator generator(row_group_size);
+        generator.set_events_per_file(events_per_file);
+        generator.init("dummy", input, "SNAPPY");
+        generator.generate_events(n_events);
+        generator.finish();
+    }
+    auto cache_dir = (std::filesystem::path(workdir) / "footer_cache").string();
+    std::filesystem::remove_all(cache_dir);
+
+    {
+        DatasetReader dataset(input, false);
+        std::cout << "INFO: " << dataset.files().size() << " files, " << dataset.row_groups().size() << " row groups, "
+            << dataset.num_rows() << " events, planned " << n_repeat << " times each" << std::endl;
+    }
+
+    struct Variant {
+        std::string name;
+        bool use_summary;
+        // the cache of a repeat, if any
+        std::function<std::shared_ptr<FooterCache>()> cache;
+    };
+    auto memory_cache = std::make_shared<FooterCache>();
+    std::vector<Variant> variants = {
+        {"footers", false, []() { return nullptr; }},
+        {"summary", true, []() { return nullptr; }},
+        {"memory cache", false, [&]() { return memory_cache; }},
+        {"disk cache", false, [&]() { return std::make_shared<FooterCache>(cache_dir); }}
+    };
+
+    std::cout << std::left << std::setw(16) << "footers from" << std::right
+        << std::setw(18) << "plan [ms] first" << std::setw(12) << "then" << std::setw(18) << "open [ms] first"
+        << std::setw(12) << "then" << std::setw(14) << "cache hits" << std::endl;
+    // (the cache hits are those of the last repeat, for planning and opening)
+    for(const auto& variant : variants) {
+        double plan_first = 0, plan_then = 0, open_first = 0, open_then = 0;
+        size_t hits = 0;
+        for(size_t irepeat = 0; irepeat < n_repeat; irepeat++) {
+            // (loading the cache directory is part of the planning)
+            auto start = std::chrono::steady_clock::now();
+            auto cache = variant.cache();
+            size_t hits_before = cache ? cache->hits() : 0;
+            DatasetReader dataset(input, variant.use_summary, partitioning::Filter(), cache);
+            auto planned = std::chrono::steady_clock::now();
+            for(size_t ifile = 0; ifile < dataset.files().size(); ifile++) {
+                dataset.open(ifile);
+            }
+            auto opened = std::chrono::steady_clock::now();
+            double plan = std::chrono::duration<double, std::milli>(planned - start).count();
+            double open = std::chrono::duration<double, std::milli>(opened - planned).count();
+            if(irepeat == 0) {
+                plan_first = plan;
+                open_first = open;
+            } else {
+                plan_then += plan / (n_repeat - 1);
+                open_then += open / (n_repeat - 1);
+            }
+            if(cache) {
+                hits = cache->hits() - hits_before;
+                // the disk cache is written by its first repeat, and loaded by the others
+                if(variant.name == "disk cache") cache->save();
+            }
+        }
+        std::cout << std::left << std::setw(16) << variant.name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(18) << plan_first << std::setw(12) << plan_then << std::setw(18) << open_first
+            << std::setw(12) << open_then << std::setw(14) << hits << std::defaultfloat << std::endl;
+    }
+
+    return 0;
+}
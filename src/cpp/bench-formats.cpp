@@ -0,0 +1,258 @@
+#include "dataset_reader.h"
+#include "table_sink.h"
+
+//std/stl
+#include <iostream>
+#include <iomanip>
+#include <cstring> // strcmp, memcpy
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <functional>
+#include <filesystem>
+
+//arrow/parquet
+#include <arrow/io/api.h>
+#include <arrow/ipc/api.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/exception.h>
+
+//
+// Benchmark of the output formats of TableSink on the same events: an input
+// dataset is loaded into memory once, written out in each format/compression,
+// and read back (all columns, and a single leaf projection) from a warm page
+// cache. Every buffer of every leaf read is checksummed after each read, so
+// that memory-mapped (zero-copy) IPC data is actually touched, as decoded
+// Parquet data is, and the values of the projected leaf are compared between
+// both reads.
+//
+
+void print_usage(char* argv[]) {
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+    std::cout << " Compare Parquet, Arrow IPC and Feather v2 files of the same events:" << std::endl;
+    std::cout << " file size, write time and (full and projected) read time" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Usage: " << argv[0] << " [OPTIONS] <input dataset (file or directory)>" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Options:" << std::endl;
+    std::cout << "   -w|--workdir           Directory for the benchmark files [default: \"./bench_formats\"]" << std::endl;
+    std::cout << "   -r|--row-group-size    Number of events per RowGroup/record batch [default: mean of the input]" << std::endl;
+    std::cout << "   --repeats              Number of timed repetitions per read [default: 5]" << std::endl;
+    std::cout << "   -h|--help              Print this help message and exit" << std::endl;
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+}
+
+struct Timing {
+    double mean;
+    double std_dev;
+};
+
+Timing time_it(size_t repeats, const std::function<void()>& func) {
+    std::vector<double> times;
+    for(size_t i = 0; i < repeats; i++) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        auto stop = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double>(stop - start).count());
+    }
+    double mean = 0, var = 0;
+    for(auto t : times) mean += t;
+    mean /= times.size();
+    for(auto t : times) var += (t - mean) * (t - mean);
+    return {mean, std::sqrt(var / times.size())};
+}
+
+// sum of the values of a (possibly jagged) float column, to touch every value
+double scan(const std::shared_ptr<arrow::Table>& table, const std::string& path) {
+    auto array = helpers::leaf_array(table, path);
+    if(array->type_id() == arrow::Type::LIST) {
+        array = std::static_pointer_cast<arrow::ListArray>(array)->Flatten().ValueOrDie();
+    }
+    const auto& values = static_cast<const arrow::FloatArray&>(*array);
+    const float* v = values.raw_values();
+    double sum = 0;
+    for(int64_t i = 0; i < values.length(); i++) {
+        sum += v[i];
+    }
+    return sum;
+}
+
+// sum of the 64-bit words of all buffers of an array, children included,
+// to touch every byte read
+uint64_t checksum(const arrow::ArrayData& data) {
+    uint64_t sum = 0;
+    for(const auto& buffer : data.buffers) {
+        if(!buffer) continue;
+        const uint8_t* bytes = buffer->data();
+        int64_t n = buffer->size();
+        int64_t i = 0;
+        for(; i + 8 <= n; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(word));
+            sum += word;
+        }
+        for(; i < n; i++) {
+            sum += bytes[i];
+        }
+    }
+    for(const auto& child : data.child_data) {
+        sum += checksum(*child);
+    }
+    return sum;
+}
+
+uint64_t checksum(const arrow::Table& table) {
+    uint64_t sum = 0;
+    for(const auto& column : table.columns()) {
+        for(const auto& chunk : column->chunks()) {
+            sum += checksum(*chunk->data());
+        }
+    }
+    return sum;
+}
+
+std::shared_ptr<arrow::Table> read_parquet(const std::string& path, const std::vector<int>& leaves) {
+    std::shared_ptr<arrow::io::ReadableFile> infile;
+    PARQUET_ASSIGN_OR_THROW(infile, arrow::io::ReadableFile::Open(path));
+    parquet::arrow::FileReaderBuilder builder;
+    PARQUET_THROW_NOT_OK(builder.Open(infile));
+    std::unique_ptr<parquet::arrow::FileReader> reader;
+    PARQUET_THROW_NOT_OK(builder.Build(&reader));
+    std::shared_ptr<arrow::Table> table;
+    if(leaves.empty()) {
+        PARQUET_THROW_NOT_OK(reader->ReadTable(&table));
+    } else {
+        PARQUET_THROW_NOT_OK(reader->ReadTable(leaves, &table));
+    }
+    return table;
+}
+
+// IPC files are memory-mapped, and can only be projected to top-level columns
+std::shared_ptr<arrow::Table> read_ipc(const std::string& path, const std::vector<int>& fields) {
+    std::shared_ptr<arrow::io::MemoryMappedFile> infile;
+    PARQUET_ASSIGN_OR_THROW(infile, arrow::io::MemoryMappedFile::Open(path, arrow::io::FileMode::READ));
+    auto options = arrow::ipc::IpcReadOptions::Defaults();
+    options.included_fields = fields;
+    options.use_threads = false;
+    std::shared_ptr<arrow::ipc::RecordBatchFileReader> reader;
+    PARQUET_ASSIGN_OR_THROW(reader, arrow::ipc::RecordBatchFileReader::Open(infile, options));
+    std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+    for(int i = 0; i < reader->num_record_batches(); i++) {
+        std::shared_ptr<arrow::RecordBatch> batch;
+        PARQUET_ASSIGN_OR_THROW(batch, reader->ReadRecordBatch(i));
+        batches.push_back(batch);
+    }
+    std::shared_ptr<arrow::Table> table;
+    PARQUET_ASSIGN_OR_THROW(table, arrow::Table::FromRecordBatches(reader->schema(), batches));
+    return table;
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string input = "";
+    std::string workdir = "./bench_formats";
+    int64_t row_group_size = -1;
+    size_t repeats = 5;
+
+    for(size_t i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--workdir") == 0) { workdir = argv[++i]; }
+        else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--row-group-size") == 0) { row_group_size = std::stoll(argv[++i]); }
+        else if (strcmp(argv[i], "--repeats") == 0) { repeats = std::stoul(argv[++i]); }
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { print_usage(argv); return 0; }
+        else if (argv[i][0] != '-' && input.empty()) { input = argv[i]; }
+        else {
+            std::cout << argv[0] << " Unknown command line argument provided: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if(input.empty()) {
+        print_usage(argv);
+        return 1;
+    }
+
+    //
+    // load the input events
+    //
+    DatasetReader dataset(input);
+    RowGroupReader reader(dataset);
+    std::vector<std::shared_ptr<arrow::Table>> tables;
+    for(const auto& task : dataset.row_groups()) {
+        tables.push_back(reader.read(task, {}));
+    }
+    std::shared_ptr<arrow::Table> events;
+    PARQUET_ASSIGN_OR_THROW(events, arrow::ConcatenateTables(tables));
+    PARQUET_ASSIGN_OR_THROW(events, events->CombineChunks());
+    events = events->ReplaceSchemaMetadata(dataset.schema()->metadata());
+    tables.clear();
+    if(row_group_size <= 0) {
+        row_group_size = std::max<int64_t>(1, dataset.num_rows() / std::max<size_t>(1, dataset.row_groups().size()));
+    }
+    const int64_t n_events = events->num_rows();
+
+    // the projection: a single jagged leaf (and, for IPC, its whole top-level column)
+    const std::string projected = "jets.jets.pt";
+    auto projected_leaves = dataset.leaf_indices({projected});
+    std::vector<int> projected_fields = {events->schema()->GetFieldIndex("jets")};
+
+    std::filesystem::create_directories(workdir);
+    std::cout << "INFO: Benchmarking " << n_events << " events (" << row_group_size << " per RowGroup/batch), "
+        << repeats << " repetitions per read" << std::endl;
+    std::cout << std::left << std::setw(10) << "format" << std::setw(14) << "compression" << std::right
+        << std::setw(10) << "size [MB]" << std::setw(12) << "write [s]"
+        << std::setw(22) << "read all [s]" << std::setw(12) << "[Mevt/s]"
+        << std::setw(22) << "read " + projected + " [s]" << std::setw(12) << "[Mevt/s]" << std::endl;
+
+    std::vector<std::pair<OutputFormat, std::string>> configs = {
+        {OutputFormat::PARQUET, "UNCOMPRESSED"},
+        {OutputFormat::PARQUET, "SNAPPY"},
+        {OutputFormat::PARQUET, "ZSTD"},
+        {OutputFormat::IPC, "UNCOMPRESSED"},
+        {OutputFormat::IPC, "LZ4"},
+        {OutputFormat::IPC, "ZSTD"},
+        {OutputFormat::FEATHER, ""}
+    };
+    for(const auto& config : configs) {
+        auto format = config.first;
+        auto compression = config.second;
+        auto path = (std::filesystem::path(workdir) / ("bench_" + helpers::format_name(format) + "_"
+                    + (compression.empty() ? "default" : compression) + helpers::format_extension(format))).string();
+
+        auto write = time_it(1, [&]() {
+            std::shared_ptr<arrow::io::FileOutputStream> outfile;
+            PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(path));
+            auto sink = TableSink::make(format, outfile, events->schema(), compression);
+            sink->write(*events, row_group_size);
+            sink->close();
+            PARQUET_THROW_NOT_OK(outfile->Close());
+        });
+        double size = std::filesystem::file_size(path) / 1024. / 1024.;
+
+        double check_all = 0, check_projected = 0;
+        uint64_t touched = 0;
+        auto read_all = time_it(repeats, [&]() {
+            auto table = format == OutputFormat::PARQUET ? read_parquet(path, {}) : read_ipc(path, {});
+            touched += checksum(*table);
+            check_all = scan(table, projected);
+        });
+        auto read_projected = time_it(repeats, [&]() {
+            auto table = format == OutputFormat::PARQUET ? read_parquet(path, projected_leaves) : read_ipc(path, projected_fields);
+            touched += checksum(*table);
+            check_projected = scan(table, projected);
+        });
+        if(check_all != check_projected || touched == 0) {
+            std::cout << "WARNING: Inconsistent values read back from " << path << std::endl;
+        }
+
+        std::cout << std::left << std::setw(10) << helpers::format_name(format)
+            << std::setw(14) << (compression.empty() ? "default" : compression) << std::right << std::fixed
+            << std::setw(10) << std::setprecision(2) << size
+            << std::setw(12) << std::setprecision(4) << write.mean
+            << std::setw(12) << std::setprecision(4) << read_all.mean << " +/- " << std::setw(5) << read_all.std_dev
+            << std::setw(12) << std::setprecision(2) << n_events / read_all.mean / 1e6
+            << std::setw(12) << std::setprecision(4) << read_projected.mean << " +/- " << std::setw(5) << read_projected.std_dev
+            << std::setw(12) << std::setprecision(2) << n_events / read_projected.mean / 1e6
+            << std::defaultfloat << std::endl;
+    }
+
+    return 0;
+}
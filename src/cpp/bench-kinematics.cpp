@@ -0,0 +1,258 @@
+#include "kinematics.h"
+
+//std/stl
+#include <iostream>
+#include <iomanip>
+#include <cstring> // strcmp
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+// parquet
+#include <parquet/exception.h>
+
+//
+// Benchmark of the kinematics kernels against a plain scalar reference
+// implementation that loops over events and objects with std:: math calls,
+// which is what the per-event Python analysis code effectively does.
+//
+
+void print_usage(char* argv[]) {
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+    std::cout << " Benchmark the vectorized kinematics kernels against a scalar reference" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Usage: " << argv[0] << " [OPTIONS]" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Options:" << std::endl;
+    std::cout << "   -n|--n-events          Number of events per batch [default: 100000]" << std::endl;
+    std::cout << "   --repeats              Number of timed repetitions per kernel [default: 10]" << std::endl;
+    std::cout << "   -h|--help              Print this help message and exit" << std::endl;
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+}
+
+// build a "jets"-like struct column {n, <list_name>: list<struct{pt, eta, phi[, m]}>}
+// with the same distributions as DatasetGenerator
+std::shared_ptr<arrow::Array> make_column(const std::string& list_name, int64_t n_events,
+        int max_objects, bool with_mass, std::default_random_engine& rng) {
+    std::uniform_int_distribution<int> n_dist(0, max_objects);
+    std::uniform_real_distribution<float> pt_dist(0., 100.);
+    std::uniform_real_distribution<float> eta_dist(-2.7, 2.7);
+    std::uniform_real_distribution<float> phi_dist(-3.14, 3.14);
+
+    arrow::UInt8Builder n_builder;
+    arrow::Int32Builder offsets_builder;
+    arrow::FloatBuilder pt_builder, eta_builder, phi_builder, m_builder;
+    int32_t offset = 0;
+    PARQUET_THROW_NOT_OK(offsets_builder.Append(offset));
+    for(int64_t i = 0; i < n_events; i++) {
+        int n = n_dist(rng);
+        PARQUET_THROW_NOT_OK(n_builder.Append(n));
+        for(int j = 0; j < n; j++) {
+            PARQUET_THROW_NOT_OK(pt_builder.Append(pt_dist(rng)));
+            PARQUET_THROW_NOT_OK(eta_builder.Append(eta_dist(rng)));
+            PARQUET_THROW_NOT_OK(phi_builder.Append(phi_dist(rng)));
+            PARQUET_THROW_NOT_OK(m_builder.Append(pt_dist(rng)));
+        } // j
+        offset += n;
+        PARQUET_THROW_NOT_OK(offsets_builder.Append(offset));
+    } // i
+
+    std::shared_ptr<arrow::Array> n_array, offsets, pt, eta, phi, m;
+    PARQUET_THROW_NOT_OK(n_builder.Finish(&n_array));
+    PARQUET_THROW_NOT_OK(offsets_builder.Finish(&offsets));
+    PARQUET_THROW_NOT_OK(pt_builder.Finish(&pt));
+    PARQUET_THROW_NOT_OK(eta_builder.Finish(&eta));
+    PARQUET_THROW_NOT_OK(phi_builder.Finish(&phi));
+    PARQUET_THROW_NOT_OK(m_builder.Finish(&m));
+
+    arrow::ArrayVector children{pt, eta, phi};
+    std::vector<std::string> names{"pt", "eta", "phi"};
+    if(with_mass) {
+        children.push_back(m);
+        names.push_back("m");
+    }
+    std::shared_ptr<arrow::Array> objects, list, column;
+    PARQUET_ASSIGN_OR_THROW(objects, arrow::StructArray::Make(children, names));
+    PARQUET_ASSIGN_OR_THROW(list, arrow::ListArray::FromArrays(*offsets, *objects));
+    PARQUET_ASSIGN_OR_THROW(column, arrow::StructArray::Make(
+                arrow::ArrayVector{n_array, list},
+                std::vector<std::string>{"n", list_name}));
+    return column;
+}
+
+//
+// scalar reference implementations
+//
+
+std::vector<float> ref_ht(const kinematics::JaggedP4& o) {
+    std::vector<float> out(o.n_events);
+    for(int64_t i = 0; i < o.n_events; i++) {
+        float sum = 0;
+        for(int32_t j = o.offsets[i]; j < o.offsets[i+1]; j++) sum += o.pt[j];
+        out[i] = sum;
+    }
+    return out;
+}
+
+void ref_p4(const kinematics::JaggedP4& o, int32_t j, double& px, double& py, double& pz, double& e) {
+    double pt = o.pt[j];
+    double m = o.m ? o.m[j] : 0.;
+    px = pt * std::cos(o.phi[j]);
+    py = pt * std::sin(o.phi[j]);
+    pz = pt * std::sinh(o.eta[j]);
+    double p = pt * std::cosh(o.eta[j]);
+    e = std::sqrt(p * p + m * m);
+}
+
+std::vector<float> ref_leading_pair_mass(const kinematics::JaggedP4& o) {
+    std::vector<float> out(o.n_events);
+    for(int64_t i = 0; i < o.n_events; i++) {
+        std::vector<int32_t> idx;
+        for(int32_t j = o.offsets[i]; j < o.offsets[i+1]; j++) idx.push_back(j);
+        if(idx.size() < 2) {
+            out[i] = std::nanf("");
+            continue;
+        }
+        std::sort(idx.begin(), idx.end(), [&](int32_t a, int32_t b) { return o.pt[a] > o.pt[b]; });
+        double px0, py0, pz0, e0, px1, py1, pz1, e1;
+        ref_p4(o, idx[0], px0, py0, pz0, e0);
+        ref_p4(o, idx[1], px1, py1, pz1, e1);
+        double px = px0 + px1, py = py0 + py1, pz = pz0 + pz1, e = e0 + e1;
+        out[i] = std::sqrt(std::max(0., e * e - px * px - py * py - pz * pz));
+    }
+    return out;
+}
+
+std::vector<float> ref_sum_m(const kinematics::JaggedP4& o) {
+    std::vector<float> out(o.n_events);
+    for(int64_t i = 0; i < o.n_events; i++) {
+        double px = 0, py = 0, pz = 0, e = 0;
+        for(int32_t j = o.offsets[i]; j < o.offsets[i+1]; j++) {
+            double x, y, z, t;
+            ref_p4(o, j, x, y, z, t);
+            px += x; py += y; pz += z; e += t;
+        }
+        out[i] = std::sqrt(std::max(0., e * e - px * px - py * py - pz * pz));
+    }
+    return out;
+}
+
+std::vector<float> ref_min_delta_r(const kinematics::JaggedP4& a, const kinematics::JaggedP4& b) {
+    std::vector<float> out;
+    for(int64_t i = 0; i < a.n_events; i++) {
+        for(int32_t ia = a.offsets[i]; ia < a.offsets[i+1]; ia++) {
+            double best = std::numeric_limits<double>::infinity();
+            for(int32_t ib = b.offsets[i]; ib < b.offsets[i+1]; ib++) {
+                double deta = a.eta[ia] - b.eta[ib];
+                double dphi = std::remainder(a.phi[ia] - b.phi[ib], 2 * M_PI);
+                best = std::min(best, std::sqrt(deta * deta + dphi * dphi));
+            }
+            out.push_back(b.offsets[i] == b.offsets[i+1] ? std::nanf("") : best);
+        }
+    }
+    return out;
+}
+
+//
+// timing and comparison helpers
+//
+
+void time_it(const std::string& name, size_t repeats, int64_t n_items, const std::function<void()>& func) {
+    std::vector<double> times;
+    for(size_t i = 0; i < repeats; i++) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        auto stop = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double>(stop - start).count());
+    }
+    double mean = 0, var = 0;
+    for(auto t : times) mean += t;
+    mean /= times.size();
+    for(auto t : times) var += (t - mean) * (t - mean);
+    double std_dev = std::sqrt(var / times.size());
+    std::cout << "  " << std::left << std::setw(32) << name << std::right
+        << std::fixed << std::setprecision(5) << mean << " +/- " << std_dev << " seconds"
+        << "  (" << std::setprecision(1) << n_items / mean / 1e6 << " M/s)" << std::endl;
+}
+
+double max_rel_diff(const float* a, const std::vector<float>& b) {
+    double worst = 0;
+    for(size_t i = 0; i < b.size(); i++) {
+        if(std::isnan(a[i]) && std::isnan(b[i])) continue;
+        double denom = std::max(1.0, std::fabs(static_cast<double>(b[i])));
+        worst = std::max(worst, std::fabs(static_cast<double>(a[i]) - b[i]) / denom);
+    }
+    return worst;
+}
+
+int main(int argc, char* argv[]) {
+
+    int64_t n_events = 100000;
+    size_t repeats = 10;
+
+    for(size_t i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--n-events") == 0) { n_events = std::stoll(argv[++i]); }
+        else if (strcmp(argv[i], "--repeats") == 0) { repeats = std::stoul(argv[++i]); }
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { print_usage(argv); return 0; }
+        else {
+            std::cout << argv[0] << " Unknown command line argument provided: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    std::default_random_engine rng;
+    auto jet_column = make_column("jets", n_events, 10, true, rng);
+    auto lepton_column = make_column("leptons", n_events, 2, false, rng);
+    auto jets = kinematics::jagged_p4(jet_column, "jets");
+    auto leptons = kinematics::jagged_p4(lepton_column, "leptons");
+    std::cout << "INFO: " << n_events << " events, " << jets.n_objects() << " jets, "
+        << leptons.n_objects() << " leptons" << std::endl;
+
+    //
+    // elementary functions
+    //
+    int64_t n_jets = jets.n_objects();
+    std::vector<float> s(n_jets), c(n_jets), sh(n_jets), ch(n_jets);
+    std::cout << "sin/cos and sinh/cosh over all jets:" << std::endl;
+    time_it("vmath::sincos", repeats, n_jets, [&]() { kinematics::vmath::sincos(jets.phi, s.data(), c.data(), n_jets); });
+    time_it("std::sin + std::cos", repeats, n_jets, [&]() {
+            for(int64_t i = 0; i < n_jets; i++) { s[i] = std::sin(jets.phi[i]); c[i] = std::cos(jets.phi[i]); } });
+    time_it("vmath::sinhcosh", repeats, n_jets, [&]() { kinematics::vmath::sinhcosh(jets.eta, sh.data(), ch.data(), n_jets); });
+    time_it("std::sinh + std::cosh", repeats, n_jets, [&]() {
+            for(int64_t i = 0; i < n_jets; i++) { sh[i] = std::sinh(jets.eta[i]); ch[i] = std::cosh(jets.eta[i]); } });
+
+    //
+    // kernels
+    //
+    std::cout << "kernels (vectorized vs scalar reference):" << std::endl;
+    std::shared_ptr<arrow::FloatArray> ht, mjj;
+    std::shared_ptr<arrow::StructArray> sum;
+    std::shared_ptr<arrow::ListArray> dr;
+    std::vector<float> ref_ht_out, ref_mjj_out, ref_sum_out, ref_dr_out;
+
+    time_it("ht", repeats, n_events, [&]() { ht = kinematics::ht(jets); });
+    time_it("ht (scalar)", repeats, n_events, [&]() { ref_ht_out = ref_ht(jets); });
+    time_it("leading_pair_mass", repeats, n_events, [&]() { mjj = kinematics::leading_pair_mass(jets); });
+    time_it("leading_pair_mass (scalar)", repeats, n_events, [&]() { ref_mjj_out = ref_leading_pair_mass(jets); });
+    time_it("sum_p4", repeats, n_events, [&]() { sum = kinematics::sum_p4(jets); });
+    time_it("sum_p4 (scalar)", repeats, n_events, [&]() { ref_sum_out = ref_sum_m(jets); });
+    time_it("min_delta_r(leptons, jets)", repeats, leptons.n_objects(), [&]() { dr = kinematics::min_delta_r(leptons, jets); });
+    time_it("min_delta_r (scalar)", repeats, leptons.n_objects(), [&]() { ref_dr_out = ref_min_delta_r(leptons, jets); });
+
+    //
+    // agreement with the reference
+    //
+    auto sum_m = std::static_pointer_cast<arrow::FloatArray>(sum->GetFieldByName("m"));
+    auto dr_values = std::static_pointer_cast<arrow::FloatArray>(dr->values());
+    std::cout << "maximum relative difference w.r.t. the scalar reference:" << std::endl;
+    std::cout << std::scientific << std::setprecision(2);
+    std::cout << "  ht                " << max_rel_diff(ht->raw_values(), ref_ht_out) << std::endl;
+    std::cout << "  leading_pair_mass " << max_rel_diff(mjj->raw_values(), ref_mjj_out) << std::endl;
+    std::cout << "  sum_p4.m          " << max_rel_diff(sum_m->raw_values(), ref_sum_out) << std::endl;
+    std::cout << "  min_delta_r       " << max_rel_diff(dr_values->raw_values(), ref_dr_out) << std::endl;
+
+    return 0;
+}
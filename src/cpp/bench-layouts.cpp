@@ -0,0 +1,230 @@
+#include "dataset_generator.h"
+#include "dataset_reader.h"
+#include "table_sink.h"
+#include "memory_pool.h"
+
+//std/stl
+#include <iostream>
+#include <iomanip>
+#include <cstring> // strcmp
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <functional>
+#include <filesystem>
+
+//arrow/parquet
+#include <arrow/io/api.h>
+#include <parquet/exception.h>
+
+//
+// Benchmark of the physical layouts of DatasetGenerator (see Layout) on the
+// same events: for each layout the events are generated and written to
+// Parquet, loaded back into memory and re-written (timing the encoding and
+// writing alone), and read back from a warm page cache, all columns and only
+// the jet pT leaf (or, for the flat layout, the jet0_pt ... jet9_pt leaves).
+// The maximum repetition/definition levels of the jet pT leaf are reported,
+// as that is where the layouts differ, and the allocations of the Arrow memory
+// pool in each phase (see memory_pool.h), summed over all of the above.
+//
+
+void print_usage(char* argv[]) {
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+    std::cout << " Compare the nested, jagged, padded and flat layouts of the generated events:" << std::endl;
+    std::cout << " file size, write time and (full and leaf-projected) read time" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Usage: " << argv[0] << " [OPTIONS]" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Options:" << std::endl;
+    std::cout << "   -n|--n-events          Number of events to generate per layout [default: 200000]" << std::endl;
+    std::cout << "   -w|--workdir           Directory for the benchmark files [default: \"./bench_layouts\"]" << std::endl;
+    std::cout << "   -c|--compression       Compression setting (Options: UNCOMPRESSED, SNAPPY, GZIP, ZSTD, LZ4) [default: UNCOMPRESSED]" << std::endl;
+    std::cout << "   -r|--row-group-size    Number of events per RowGroup [default: generator default]" << std::endl;
+    std::cout << "   --repeats              Number of timed repetitions per read [default: 5]" << std::endl;
+    std::cout << "   --memory-pool          Arrow memory pool backend (Options: default, system, jemalloc, mimalloc) [default: default]" << std::endl;
+    std::cout << "   -h|--help              Print this help message and exit" << std::endl;
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+}
+
+struct Timing {
+    double mean;
+    double std_dev;
+};
+
+Timing time_it(size_t repeats, const std::function<void()>& func) {
+    std::vector<double> times;
+    for(size_t i = 0; i < repeats; i++) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        auto stop = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double>(stop - start).count());
+    }
+    double mean = 0, var = 0;
+    for(auto t : times) mean += t;
+    mean /= times.size();
+    for(auto t : times) var += (t - mean) * (t - mean);
+    return {mean, std::sqrt(var / times.size())};
+}
+
+// the leaf paths of the jet pT in each layout
+std::vector<std::string> jet_pt_paths(Layout layout) {
+    switch(layout) {
+        case Layout::NESTED : return {"jets.jets.pt"};
+        case Layout::JAGGED :
+        case Layout::PADDED : return {"jet_pt"};
+        case Layout::FLAT : {
+            std::vector<std::string> paths;
+            for(int i = 0; i < EventBuffers::kMaxJets; i++) {
+                paths.push_back("jet" + std::to_string(i) + "_pt");
+            }
+            return paths;
+        }
+    }
+    return {};
+}
+
+// sum of the (non-padding) values of (possibly jagged) float columns, to touch every value
+double scan(const std::shared_ptr<arrow::Table>& table, const std::vector<std::string>& paths) {
+    double sum = 0;
+    for(const auto& path : paths) {
+        auto array = helpers::leaf_array(table, path);
+        if(array->type_id() == arrow::Type::LIST) {
+            array = std::static_pointer_cast<arrow::ListArray>(array)->Flatten().ValueOrDie();
+        }
+        const auto& values = static_cast<const arrow::FloatArray&>(*array);
+        const float* v = values.raw_values();
+        for(int64_t i = 0; i < values.length(); i++) {
+            if(!std::isnan(v[i])) sum += v[i];
+        }
+    }
+    return sum;
+}
+
+std::shared_ptr<arrow::Table> read_all(const DatasetReader& dataset, const std::vector<int>& leaves) {
+    RowGroupReader reader(dataset);
+    std::vector<std::shared_ptr<arrow::Table>> tables;
+    for(const auto& task : dataset.row_groups()) {
+        tables.push_back(reader.read(task, leaves));
+    }
+    std::shared_ptr<arrow::Table> table;
+    PARQUET_ASSIGN_OR_THROW(table, arrow::ConcatenateTables(tables));
+    return table;
+}
+
+int main(int argc, char* argv[]) {
+
+    uint64_t n_events = 200000;
+    std::string workdir = "./bench_layouts";
+    std::string compression = "UNCOMPRESSED";
+    int32_t row_group_size = -1;
+    size_t repeats = 5;
+
+    for(size_t i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--n-events") == 0) { n_events = std::stoull(argv[++i]); }
+        else if (strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--workdir") == 0) { workdir = argv[++i]; }
+        else if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--compression") == 0) { compression = argv[++i]; }
+        else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--row-group-size") == 0) { row_group_size = std::stoi(argv[++i]); }
+        else if (strcmp(argv[i], "--repeats") == 0) { repeats = std::stoul(argv[++i]); }
+        else if (strcmp(argv[i], "--memory-pool") == 0) { memory::select_backend(argv[++i]); }
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { print_usage(argv); return 0; }
+        else {
+            std::cout << argv[0] << " Unknown command line argument provided: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "INFO: Benchmarking " << n_events << " events per layout (" << compression << "), "
+        << repeats << " repetitions per read" << std::endl;
+    std::cout << std::left << std::setw(8) << "layout" << std::right << std::setw(9) << "columns"
+        << std::setw(8) << "r/d" << std::setw(11) << "size [MB]"
+        << std::setw(12) << "gen [s]" << std::setw(12) << "write [s]"
+        << std::setw(22) << "read all [s]" << std::setw(12) << "[Mevt/s]"
+        << std::setw(22) << "read jet pt [s]" << std::setw(12) << "[Mevt/s]" << std::endl;
+
+    double reference = 0;
+    std::vector<std::pair<std::string, std::vector<memory::PhaseStats>>> allocations;
+    for(auto layout : {Layout::NESTED, Layout::JAGGED, Layout::PADDED, Layout::FLAT}) {
+        auto name = helpers::layout_name(layout);
+        memory::reset_stats();
+        auto outdir = (std::filesystem::path(workdir) / name).string();
+        std::filesystem::remove_all(outdir);
+
+        // generation (including the writing) of the dataset
+        auto generate = time_it(1, [&]() {
+            DatasetGenerator generator(row_group_size);
+            generator.init(name, outdir, compression, "parquet", name);
+            generator.generate_events(n_events);
+            generator.finish();
+        });
+
+        DatasetReader dataset(outdir);
+        auto leaves = dataset.leaf_indices(jet_pt_paths(layout));
+        auto descr = dataset.footer(0)->schema()->Column(leaves.at(0));
+        double size = 0;
+        for(const auto& file : dataset.files()) {
+            size += std::filesystem::file_size(file) / 1024. / 1024.;
+        }
+
+        // the encoding and writing alone, of the events held in memory
+        auto events = read_all(dataset, {});
+        int64_t row_group_rows = dataset.num_rows() / std::max<size_t>(1, dataset.row_groups().size());
+        auto write = time_it(1, [&]() {
+            std::shared_ptr<arrow::io::FileOutputStream> outfile;
+            PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(
+                        (std::filesystem::path(workdir) / (name + "_rewrite.parquet")).string()));
+            auto sink = TableSink::make(OutputFormat::PARQUET, outfile, events->schema(), compression);
+            sink->write(*events, row_group_rows);
+            sink->close();
+            PARQUET_THROW_NOT_OK(outfile->Close());
+        });
+        events.reset();
+
+        double check_all = 0, check_projected = 0;
+        auto all = time_it(repeats, [&]() {
+            check_all = scan(read_all(dataset, {}), jet_pt_paths(layout));
+        });
+        auto projected = time_it(repeats, [&]() {
+            check_projected = scan(read_all(dataset, leaves), jet_pt_paths(layout));
+        });
+        if(layout == Layout::NESTED) {
+            reference = check_all;
+        }
+        // (the flat layout sums the same values in a different order)
+        if(check_all != check_projected || std::abs(check_all - reference) > 1e-9 * std::abs(reference)) {
+            std::cout << "WARNING: Inconsistent jet pT values read back from the " << name << " layout" << std::endl;
+        }
+
+        std::cout << std::left << std::setw(8) << name << std::right << std::fixed
+            << std::setw(9) << dataset.footer(0)->num_columns()
+            << std::setw(8) << (std::to_string(descr->max_repetition_level()) + "/" + std::to_string(descr->max_definition_level()))
+            << std::setw(11) << std::setprecision(2) << size
+            << std::setw(12) << std::setprecision(4) << generate.mean
+            << std::setw(12) << std::setprecision(4) << write.mean
+            << std::setw(12) << std::setprecision(4) << all.mean << " +/- " << std::setw(5) << all.std_dev
+            << std::setw(12) << std::setprecision(2) << n_events / all.mean / 1e6
+            << std::setw(12) << std::setprecision(4) << projected.mean << " +/- " << std::setw(5) << projected.std_dev
+            << std::setw(12) << std::setprecision(2) << n_events / projected.mean / 1e6
+            << std::defaultfloat << std::endl;
+
+        allocations.push_back({name, {}});
+        for(auto phase : memory::kPhases) {
+            allocations.back().second.push_back(memory::stats(phase));
+        }
+    }
+
+    std::cout << std::endl << "INFO: Allocations of the " << memory::backend_name() << " memory pool" << std::endl;
+    std::cout << std::left << std::setw(8) << "layout" << std::setw(9) << " phase" << std::right
+        << std::setw(14) << "allocations" << std::setw(16) << "allocated [MB]" << std::setw(12) << "peak [MB]" << std::endl;
+    for(const auto& layout : allocations) {
+        for(size_t iphase = 0; iphase < memory::kPhases.size(); iphase++) {
+            const auto& s = layout.second.at(iphase);
+            std::cout << std::left << std::setw(8) << layout.first << " " << std::setw(8) << memory::phase_name(memory::kPhases.at(iphase))
+                << std::right << std::fixed << std::setw(14) << s.allocations
+                << std::setw(16) << std::setprecision(1) << s.bytes_allocated / 1024. / 1024.
+                << std::setw(12) << std::setprecision(1) << s.peak / 1024. / 1024.
+                << std::defaultfloat << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,196 @@
+#include "dataset_generator.h"
+#include "dataset_reader.h"
+#include "event_lookup.h"
+#include "event_index.h"
+#include "table_sink.h"
+
+//std/stl
+#include <iostream>
+#include <iomanip>
+#include <cstring> // strcmp
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <filesystem>
+
+//arrow/parquet
+#include <arrow/io/api.h>
+#include <arrow/compute/api.h>
+#include <parquet/exception.h>
+
+//
+// Benchmark of point lookups of events by event.id (see EventLookup): the
+// events with an even id of a generated dataset are written out twice, once in
+// id order (so that the RowGroup min/max statistics isolate any id) and once
+// shuffled across all RowGroups (so that every RowGroup spans nearly all ids
+// and only the Bloom filters can prune), each with event.id Bloom filters. On
+// each, ids that are present (even) and ids that are absent but within the
+// range of the statistics (odd) are looked up with a full scan of the
+// event.id column, with the statistics alone, with the statistics and the
+// Bloom filters and with the exact _event_index (see EventIndex), reporting
+// the latency (warm page cache) and the bytes read per lookup.
+//
+
+void print_usage(char* argv[]) {
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+    std::cout << " Compare event lookups by id using a full scan, RowGroup statistics, Bloom filters and the event index" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Usage: " << argv[0] << " [OPTIONS]" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Options:" << std::endl;
+    std::cout << "   -n|--n-events          Number of events to generate (half of which are kept) [default: 1000000]" << std::endl;
+    std::cout << "   -w|--workdir           Directory for the benchmark files [default: \"./bench_lookup\"]" << std::endl;
+    std::cout << "   -r|--row-group-size    Number of events per RowGroup [default: 20000]" << std::endl;
+    std::cout << "   --fpp                  False positive probability of the Bloom filters [default: 0.01]" << std::endl;
+    std::cout << "   --lookups              Number of lookups per configuration [default: 20]" << std::endl;
+    std::cout << "   --ids                  Number of ids per lookup [default: 1]" << std::endl;
+    std::cout << "   -h|--help              Print this help message and exit" << std::endl;
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+}
+
+void write_dataset(const std::shared_ptr<arrow::Table>& events, const std::string& outdir, int64_t row_group_size,
+        double fpp) {
+    std::filesystem::remove_all(outdir);
+    std::filesystem::create_directories(outdir);
+    std::shared_ptr<arrow::io::FileOutputStream> outfile;
+    PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(outdir + "/events_0.parquet"));
+    auto sink = TableSink::make(OutputFormat::PARQUET, outfile, events->schema(), "SNAPPY");
+    sink->write(*events, row_group_size);
+    sink->close();
+    PARQUET_THROW_NOT_OK(outfile->Close());
+    DatasetReader dataset(outdir);
+    helpers::write_bloom_filters(dataset, {{"event.id", fpp}});
+    EventIndex::build(dataset);
+}
+
+int main(int argc, char* argv[]) {
+
+    uint64_t n_events = 1000000;
+    std::string workdir = "./bench_lookup";
+    int32_t row_group_size = 20000;
+    double fpp = 0.01;
+    size_t n_lookups = 20;
+    size_t ids_per_lookup = 1;
+
+    for(size_t i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--n-events") == 0) { n_events = std::stoull(argv[++i]); }
+        else if (strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--workdir") == 0) { workdir = argv[++i]; }
+        else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--row-group-size") == 0) { row_group_size = std::stoi(argv[++i]); }
+        else if (strcmp(argv[i], "--fpp") == 0) { fpp = std::stod(argv[++i]); }
+        else if (strcmp(argv[i], "--lookups") == 0) { n_lookups = std::stoul(argv[++i]); }
+        else if (strcmp(argv[i], "--ids") == 0) { ids_per_lookup = std::stoul(argv[++i]); }
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { print_usage(argv); return 0; }
+        else {
+            std::cout << argv[0] << " Unknown command line argument provided: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    // the generated events, of which those with an even id are kept
+    auto generated = (std::filesystem::path(workdir) / "generated").string();
+    std::filesystem::remove_all(generated);
+    DatasetGenerator generator(row_group_size);
+    generator.init("dummy", generated, "UNCOMPRESSED");
+    generator.generate_events(n_events);
+    generator.finish();
+
+    DatasetReader source(generated);
+    RowGroupReader reader(source);
+    std::vector<std::shared_ptr<arrow::Table>> tables;
+    for(const auto& task : source.row_groups()) {
+        tables.push_back(reader.read(task, {}));
+    }
+    std::shared_ptr<arrow::Table> events;
+    PARQUET_ASSIGN_OR_THROW(events, arrow::ConcatenateTables(tables));
+    tables.clear();
+    std::vector<int64_t> rows;
+    for(int64_t i = 0; i < events->num_rows(); i += 2) {
+        rows.push_back(i);
+    }
+    arrow::Int64Builder builder;
+    PARQUET_THROW_NOT_OK(builder.AppendValues(rows));
+    std::shared_ptr<arrow::Array> indices;
+    PARQUET_THROW_NOT_OK(builder.Finish(&indices));
+    arrow::Datum taken;
+    PARQUET_ASSIGN_OR_THROW(taken, arrow::compute::Take(events, indices));
+    auto ordered = taken.table();
+
+    std::mt19937_64 rand(42);
+    std::shuffle(rows.begin(), rows.end(), rand);
+    PARQUET_THROW_NOT_OK(builder.AppendValues(rows));
+    PARQUET_THROW_NOT_OK(builder.Finish(&indices));
+    PARQUET_ASSIGN_OR_THROW(taken, arrow::compute::Take(events, indices));
+    auto shuffled = taken.table();
+    events.reset();
+
+    write_dataset(ordered, (std::filesystem::path(workdir) / "ordered").string(), row_group_size, fpp);
+    write_dataset(shuffled, (std::filesystem::path(workdir) / "shuffled").string(), row_group_size, fpp);
+    ordered.reset();
+    shuffled.reset();
+
+    std::cout << "INFO: " << n_events / 2 << " events in RowGroups of " << row_group_size << ", Bloom filters for fpp "
+        << fpp << ", " << n_lookups << " lookups of " << ids_per_lookup << " id(s) per configuration" << std::endl;
+    std::cout << std::left << std::setw(10) << "dataset" << std::setw(9) << "ids" << std::setw(14) << "pruning"
+        << std::right << std::setw(14) << "latency [ms]" << std::setw(12) << "max [ms]"
+        << std::setw(12) << "RGs read" << std::setw(12) << "false pos." << std::setw(14) << "read [kB]"
+        << std::setw(14) << "filters [kB]" << std::setw(8) << "found" << std::endl;
+
+    for(const auto& name : {"ordered", "shuffled"}) {
+        auto dataset_dir = (std::filesystem::path(workdir) / name).string();
+        DatasetReader dataset(dataset_dir);
+        for(bool present : {true, false}) {
+            // the same ids for each pruning configuration
+            std::vector<std::vector<int64_t>> lookups(n_lookups);
+            std::uniform_int_distribution<int64_t> id_dist(0, n_events / 2 - 1);
+            for(auto& ids : lookups) {
+                for(size_t k = 0; k < ids_per_lookup; k++) {
+                    ids.push_back(2 * id_dist(rand) + (present ? 0 : 1));
+                }
+            }
+
+            for(int mode = 0; mode < 4; mode++) {
+                double total = 0, max = 0;
+                LookupStats sum;
+                for(const auto& ids : lookups) {
+                    // (a new lookup/index each time, so that the Bloom filter indices are read each time)
+                    auto start = std::chrono::steady_clock::now();
+                    LookupStats s;
+                    if(mode < 3) {
+                        EventLookup lookup(dataset);
+                        lookup.set_use_statistics(mode > 0);
+                        lookup.set_use_bloom_filters(mode > 1);
+                        lookup.fetch(ids);
+                        s = lookup.stats();
+                    } else {
+                        EventIndex::FetchStats index_stats;
+                        auto events = EventIndex::open(dataset_dir)->fetch(dataset, ids, {}, &index_stats);
+                        s.row_groups_read = index_stats.row_groups_read;
+                        s.column_bytes = index_stats.column_bytes;
+                        s.rows_found = events ? events->num_rows() : 0;
+                    }
+                    auto stop = std::chrono::steady_clock::now();
+                    double t = std::chrono::duration<double>(stop - start).count() * 1e3;
+                    total += t;
+                    max = std::max(max, t);
+                    sum.row_groups_read += s.row_groups_read;
+                    sum.false_positives += s.false_positives;
+                    sum.column_bytes += s.column_bytes;
+                    sum.bloom_filter_bytes += s.bloom_filter_bytes;
+                    sum.rows_found += s.rows_found;
+                }
+                double n = static_cast<double>(n_lookups);
+                std::cout << std::left << std::setw(10) << name << std::setw(9) << (present ? "present" : "absent")
+                    << std::setw(14) << (mode == 0 ? "scan" : mode == 1 ? "stats" : mode == 2 ? "stats+bloom" : "index")
+                    << std::right << std::fixed << std::setprecision(3)
+                    << std::setw(14) << total / n << std::setw(12) << max
+                    << std::setprecision(1) << std::setw(12) << sum.row_groups_read / n
+                    << std::setw(12) << sum.false_positives / n
+                    << std::setw(14) << sum.bytes_read() / n / 1024.
+                    << std::setw(14) << sum.bloom_filter_bytes / n / 1024.
+                    << std::setw(8) << sum.rows_found << std::defaultfloat << std::endl;
+            } // mode
+        } // present
+    }
+
+    return 0;
+}
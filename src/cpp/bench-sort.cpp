@@ -0,0 +1,164 @@
+#include "dataset_generator.h"
+#include "dataset_reader.h"
+#include "dataset_writer.h"
+#include "selection.h"
+#include "sorting.h"
+
+//std/stl
+#include <iostream>
+#include <iomanip>
+#include <cstring> // strcmp
+#include <chrono>
+#include <filesystem>
+
+//arrow/parquet
+#include <parquet/exception.h>
+
+//
+// Benchmark of clustering the events by a sort key before writing (see
+// sorting.h): the events of a generated dataset are written out unsorted and
+// sorted by "jets.n" and by "jets.n" then "met.met", within windows of one,
+// several and all RowGroups. For each the size of the dataset and of the key
+// columns is reported, and, for a few cuts on the keys, the fraction of the
+// RowGroups that the min/max statistics let the selection skip (sorting
+// within a single RowGroup leaves the RowGroup statistics as they are, only
+// windows of several RowGroups narrow them).
+//
+
+void print_usage(char* argv[]) {
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+    std::cout << " Compare the compression and RowGroup pruning of datasets sorted by a key within windows of RowGroups" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Usage: " << argv[0] << " [OPTIONS]" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Options:" << std::endl;
+    std::cout << "   -n|--n-events          Number of events to generate [default: 1000000]" << std::endl;
+    std::cout << "   -w|--workdir           Directory for the benchmark files [default: \"./bench_sort\"]" << std::endl;
+    std::cout << "   -r|--row-group-size    Number of events per RowGroup [default: 20000]" << std::endl;
+    std::cout << "   -c|--compression       Compression of the datasets written [default: SNAPPY]" << std::endl;
+    std::cout << "   --window               Number of RowGroups of the multi-RowGroup sort window [default: 8]" << std::endl;
+    std::cout << "   -s|--cut               Cut to measure the pruning of, repeat for several" << std::endl;
+    std::cout << "                          [default: \"jets.n>=8\", \"met.met>90\", \"jets.n>=6 && met.met>80\"]" << std::endl;
+    std::cout << "   -h|--help              Print this help message and exit" << std::endl;
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+}
+
+// compressed bytes of the column chunks of the leaves "paths" in all RowGroups
+int64_t column_bytes(const DatasetReader& dataset, const std::vector<std::string>& paths) {
+    auto leaves = dataset.leaf_indices(paths);
+    int64_t bytes = 0;
+    for(const auto& task : dataset.row_groups()) {
+        auto row_group = dataset.row_group_metadata(task);
+        for(int leaf : leaves) {
+            bytes += row_group->ColumnChunk(leaf)->total_compressed_size();
+        }
+    }
+    return bytes;
+}
+
+int main(int argc, char* argv[]) {
+
+    uint64_t n_events = 1000000;
+    std::string workdir = "./bench_sort";
+    int32_t row_group_size = 20000;
+    std::string compression = "SNAPPY";
+    int64_t window = 8;
+    std::vector<std::string> cuts;
+
+    for(size_t i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--n-events") == 0) { n_events = std::stoull(argv[++i]); }
+        else if (strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--workdir") == 0) { workdir = argv[++i]; }
+        else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--row-group-size") == 0) { row_group_size = std::stoi(argv[++i]); }
+        else if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--compression") == 0) { compression = argv[++i]; }
+        else if (strcmp(argv[i], "--window") == 0) { window = std::stoll(argv[++i]); }
+        else if (strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--cut") == 0) { cuts.push_back(argv[++i]); }
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { print_usage(argv); return 0; }
+        else {
+            std::cout << argv[0] << " Unknown command line argument provided: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if(cuts.empty()) {
+        cuts = {"jets.n>=8", "met.met>90", "jets.n>=6 && met.met>80"};
+    }
+    std::vector<std::shared_ptr<selection::Cut>> parsed;
+    for(const auto& cut : cuts) {
+        parsed.push_back(selection::parse_cut(cut));
+    }
+
+    auto generated = (std::filesystem::path(workdir) / "generated").string();
+    std::filesystem::remove_all(generated);
+    DatasetGenerator generator(row_group_size);
+    generator.init("dummy", generated, "UNCOMPRESSED");
+    generator.generate_events(n_events);
+    generator.finish();
+    DatasetReader source(generated);
+
+    struct Variant {
+        std::string name;
+        std::string keys;
+        int64_t window;
+    };
+    std::vector<Variant> variants = {
+        {"unsorted", "", 1},
+        {"jets.n/1", "jets.n", 1},
+        {"jets.n,met.met/1", "jets.n,met.met", 1},
+        {"jets.n,met.met/" + std::to_string(window), "jets.n,met.met", window},
+        {"jets.n,met.met/all", "jets.n,met.met", 0}
+    };
+
+    std::cout << "INFO: " << n_events << " events in RowGroups of " << row_group_size << ", " << compression
+        << " compression, sorted within windows of RowGroups (\"all\": the whole dataset)" << std::endl;
+    std::cout << std::left << std::setw(22) << "sort/window" << std::right << std::setw(12) << "write [s]"
+        << std::setw(12) << "size [MB]" << std::setw(9) << "ratio" << std::setw(15) << "jets.n [kB]"
+        << std::setw(15) << "met.met [kB]";
+    for(const auto& cut : parsed) {
+        std::cout << "  " << cut->name();
+    }
+    std::cout << std::endl;
+
+    int64_t unsorted_bytes = 0;
+    for(size_t ivariant = 0; ivariant < variants.size(); ivariant++) {
+        const auto& variant = variants.at(ivariant);
+        auto outdir = (std::filesystem::path(workdir) / ("sorted_" + std::to_string(ivariant))).string();
+        std::filesystem::remove_all(outdir);
+
+        auto start = std::chrono::steady_clock::now();
+        {
+            DatasetWriter writer(outdir, "sorted", row_group_size, 0, compression, source.schema()->metadata());
+            if(!variant.keys.empty()) {
+                writer.set_sort(sorting::parse_sort_keys(variant.keys), variant.window);
+            }
+            RowGroupReader reader(source);
+            for(const auto& task : source.row_groups()) {
+                writer.write(reader.read(task, {}));
+            }
+            writer.close();
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        DatasetReader dataset(outdir);
+        int64_t bytes = 0;
+        for(const auto& file : dataset.files()) {
+            bytes += std::filesystem::file_size(file);
+        }
+        if(unsorted_bytes == 0) unsorted_bytes = bytes;
+
+        std::cout << std::left << std::setw(22) << variant.name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << elapsed << std::setw(12) << bytes / 1024. / 1024.
+            << std::setprecision(3) << std::setw(9) << static_cast<double>(bytes) / unsorted_bytes
+            << std::setprecision(1) << std::setw(15) << column_bytes(dataset, {"jets.n"}) / 1024.
+            << std::setw(15) << column_bytes(dataset, {"met.met"}) / 1024.;
+        // fraction of the RowGroups skipped by the statistics
+        for(const auto& cut : parsed) {
+            size_t pruned = 0;
+            for(const auto& task : dataset.row_groups()) {
+                if(!cut->may_pass(*dataset.row_group_metadata(task), dataset)) pruned++;
+            }
+            std::cout << "  " << std::setw(cut->name().size() - 1) << 100. * pruned / dataset.row_groups().size() << "%";
+        }
+        std::cout << std::defaultfloat << std::endl;
+    }
+
+    return 0;
+}
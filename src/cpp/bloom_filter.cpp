@@ -0,0 +1,307 @@
+#include "bloom_filter.h"
+
+// std/stl
+#include <cmath>
+#include <cstring> // memcpy
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+// arrow/parquet
+#include <parquet/exception.h>
+
+using nlohmann::json;
+
+namespace bloom {
+
+namespace {
+
+const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+const uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t read64(const uint8_t* p) { uint64_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+inline uint32_t read32(const uint8_t* p) { uint32_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+
+inline uint64_t round(uint64_t acc, uint64_t input) {
+    acc += input * kPrime2;
+    return rotl(acc, 31) * kPrime1;
+}
+
+inline uint64_t merge_round(uint64_t acc, uint64_t val) {
+    acc ^= round(0, val);
+    return acc * kPrime1 + kPrime4;
+}
+
+} // namespace
+
+// (little-endian hosts only, as the rest of the Parquet tooling here)
+uint64_t xxh64(const void* data, size_t length, uint64_t seed) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + length;
+    uint64_t h;
+
+    if(length >= 32) {
+        uint64_t v1 = seed + kPrime1 + kPrime2;
+        uint64_t v2 = seed + kPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kPrime1;
+        for(; p + 32 <= end; p += 32) {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge_round(h, v1);
+        h = merge_round(h, v2);
+        h = merge_round(h, v3);
+        h = merge_round(h, v4);
+    } else {
+        h = seed + kPrime5;
+    }
+    h += static_cast<uint64_t>(length);
+
+    for(; p + 8 <= end; p += 8) {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * kPrime1 + kPrime4;
+    }
+    if(p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read32(p)) * kPrime1;
+        h = rotl(h, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    for(; p < end; p++) {
+        h ^= (*p) * kPrime5;
+        h = rotl(h, 11) * kPrime1;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+}; // namespace bloom
+
+namespace {
+
+// the eight odd constants of the split block Bloom filter, one per word of a block
+const uint32_t kSalt[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                           0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+const char kMagic[4] = {'B', 'L', 'M', '1'};
+
+// the size and modification time of a data file, null if it cannot be read
+json file_stat(const std::string& path) {
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if(ec) return nullptr;
+    auto time = std::filesystem::last_write_time(path, ec);
+    if(ec) return nullptr;
+    return {{"size", static_cast<int64_t>(size)},
+        {"time", static_cast<int64_t>(time.time_since_epoch().count())}};
+}
+
+template<typename ArrayType, typename PhysicalType>
+void insert_values(SplitBlockBloomFilter& filter, const arrow::Array& values) {
+    const auto& array = static_cast<const ArrayType&>(values);
+    const auto* raw = array.raw_values();
+    for(int64_t i = 0; i < array.length(); i++) {
+        if(array.IsNull(i)) continue;
+        filter.insert(SplitBlockBloomFilter::hash(static_cast<PhysicalType>(raw[i])));
+    }
+}
+
+} // namespace
+
+uint32_t SplitBlockBloomFilter::optimal_num_bytes(uint64_t ndv, double fpp) {
+    if(!(fpp > 0 && fpp < 1)) {
+        throw std::runtime_error("ERROR: Bloom filter false positive probability must be in (0, 1), got " + std::to_string(fpp));
+    }
+    // bits per value for "fpp" with eight bits set per value (Putze et al.)
+    double bits = -8.0 * ndv / std::log(1 - std::pow(fpp, 1.0 / 8));
+    uint64_t num_bytes = kMinimumBytes;
+    while(num_bytes < kMaximumBytes && num_bytes * 8 < bits) {
+        num_bytes *= 2;
+    }
+    return static_cast<uint32_t>(num_bytes);
+}
+
+SplitBlockBloomFilter::SplitBlockBloomFilter(uint32_t num_bytes) {
+    if(num_bytes < kMinimumBytes || num_bytes > kMaximumBytes || (num_bytes & (num_bytes - 1)) != 0) {
+        throw std::runtime_error("ERROR: Invalid Bloom filter size of " + std::to_string(num_bytes) + " bytes");
+    }
+    _words.assign(num_bytes / sizeof(uint32_t), 0);
+}
+
+void SplitBlockBloomFilter::insert(uint64_t hash) {
+    uint64_t n_blocks = _words.size() / 8;
+    uint32_t* block = _words.data() + 8 * (((hash >> 32) * n_blocks) >> 32);
+    uint32_t key = static_cast<uint32_t>(hash);
+    for(int i = 0; i < 8; i++) {
+        block[i] |= 1U << ((key * kSalt[i]) >> 27);
+    }
+}
+
+bool SplitBlockBloomFilter::find(uint64_t hash) const {
+    uint64_t n_blocks = _words.size() / 8;
+    const uint32_t* block = _words.data() + 8 * (((hash >> 32) * n_blocks) >> 32);
+    uint32_t key = static_cast<uint32_t>(hash);
+    for(int i = 0; i < 8; i++) {
+        if((block[i] & (1U << ((key * kSalt[i]) >> 27))) == 0) return false;
+    }
+    return true;
+}
+
+void SplitBlockBloomFilter::insert(const arrow::Array& values) {
+    switch(values.type_id()) {
+        case arrow::Type::INT8 : insert_values<arrow::Int8Array, int32_t>(*this, values); break;
+        case arrow::Type::INT16 : insert_values<arrow::Int16Array, int32_t>(*this, values); break;
+        case arrow::Type::INT32 : insert_values<arrow::Int32Array, int32_t>(*this, values); break;
+        case arrow::Type::INT64 : insert_values<arrow::Int64Array, int64_t>(*this, values); break;
+        case arrow::Type::UINT8 : insert_values<arrow::UInt8Array, int32_t>(*this, values); break;
+        case arrow::Type::UINT16 : insert_values<arrow::UInt16Array, int32_t>(*this, values); break;
+        case arrow::Type::UINT32 : insert_values<arrow::UInt32Array, int32_t>(*this, values); break;
+        case arrow::Type::UINT64 : insert_values<arrow::UInt64Array, int64_t>(*this, values); break;
+        case arrow::Type::FLOAT : insert_values<arrow::FloatArray, float>(*this, values); break;
+        case arrow::Type::DOUBLE : insert_values<arrow::DoubleArray, double>(*this, values); break;
+        default :
+            throw std::runtime_error("ERROR: Bloom filters are not supported for columns of type " + values.type()->ToString());
+    }
+}
+
+namespace helpers {
+
+std::string bloom_filter_path(const std::string& data_file) {
+    return std::filesystem::path(data_file).replace_extension(".bloom").string();
+}
+
+std::pair<std::string, double> bloom_filter_option(const std::string& option, double default_fpp) {
+    auto pos = option.find(':');
+    if(pos == std::string::npos) {
+        return {option, default_fpp};
+    }
+    return {option.substr(0, pos), std::stod(option.substr(pos + 1))};
+}
+
+}; // namespace helpers
+
+BloomFilterWriter::BloomFilterWriter(const std::shared_ptr<arrow::io::OutputStream>& outfile,
+        const std::map<std::string, double>& columns) :
+    _outfile(outfile),
+    _columns(columns),
+    _filters(json::array()),
+    _position(0)
+{
+    PARQUET_THROW_NOT_OK(_outfile->Write(kMagic, sizeof(kMagic)));
+    _position += sizeof(kMagic);
+}
+
+void BloomFilterWriter::write(int row_group, const std::string& column, const arrow::Array& values) {
+    auto it = _columns.find(column);
+    if(it == _columns.end()) {
+        throw std::runtime_error("ERROR: No Bloom filter configured for column \"" + column + "\"");
+    }
+    // (the number of values bounds the number of distinct values)
+    int64_t n_values = values.length() - values.null_count();
+    SplitBlockBloomFilter filter(SplitBlockBloomFilter::optimal_num_bytes(n_values, it->second));
+    filter.insert(values);
+
+    PARQUET_THROW_NOT_OK(_outfile->Write(filter.data(), filter.num_bytes()));
+    _filters.push_back({{"row_group", row_group}, {"column", column}, {"values", n_values},
+            {"offset", _position}, {"bytes", filter.num_bytes()}});
+    _position += filter.num_bytes();
+}
+
+void BloomFilterWriter::close(const std::string& data_file) {
+    json j_index;
+    j_index["algorithm"] = "split_block";
+    j_index["hash"] = "xxh64";
+    j_index["data_file"] = file_stat(data_file);
+    j_index["columns"] = _columns;
+    j_index["filters"] = _filters;
+    auto index = j_index.dump();
+    uint32_t length = static_cast<uint32_t>(index.size());
+    PARQUET_THROW_NOT_OK(_outfile->Write(index.data(), index.size()));
+    PARQUET_THROW_NOT_OK(_outfile->Write(&length, sizeof(length)));
+    PARQUET_THROW_NOT_OK(_outfile->Write(kMagic, sizeof(kMagic)));
+    PARQUET_THROW_NOT_OK(_outfile->Close());
+}
+
+BloomFilterReader::BloomFilterReader(const std::shared_ptr<arrow::io::RandomAccessFile>& infile) :
+    _infile(infile),
+    _bytes_read(0)
+{
+}
+
+std::unique_ptr<BloomFilterReader> BloomFilterReader::open(const std::string& path, const std::string& data_file) {
+    if(!std::filesystem::is_regular_file(path)) {
+        return nullptr;
+    }
+    std::shared_ptr<arrow::io::ReadableFile> infile;
+    PARQUET_ASSIGN_OR_THROW(infile, arrow::io::ReadableFile::Open(path));
+    std::unique_ptr<BloomFilterReader> reader(new BloomFilterReader(infile));
+
+    // the footer (index length and magic), then the index
+    int64_t size;
+    PARQUET_ASSIGN_OR_THROW(size, infile->GetSize());
+    char footer[8];
+    if(size < 2 * static_cast<int64_t>(sizeof(kMagic)) + 4) {
+        throw std::runtime_error("ERROR: Bloom filter file \"" + path + "\" is truncated");
+    }
+    int64_t n;
+    PARQUET_ASSIGN_OR_THROW(n, infile->ReadAt(size - sizeof(footer), sizeof(footer), footer));
+    uint32_t length;
+    std::memcpy(&length, footer, sizeof(length));
+    if(n != sizeof(footer) || std::memcmp(footer + 4, kMagic, sizeof(kMagic)) != 0
+            || length > size - sizeof(footer) - sizeof(kMagic)) {
+        throw std::runtime_error("ERROR: Bloom filter file \"" + path + "\" is corrupt");
+    }
+    std::string index(length, '\0');
+    PARQUET_ASSIGN_OR_THROW(n, infile->ReadAt(size - sizeof(footer) - length, length, &index[0]));
+    reader->_bytes_read = sizeof(footer) + length;
+
+    auto j_index = json::parse(index);
+    if(j_index.value("algorithm", "") != "split_block" || j_index.value("hash", "") != "xxh64") {
+        throw std::runtime_error("ERROR: Unsupported Bloom filter file \"" + path + "\"");
+    }
+    // (also ignored if it does not say which data file it was built from)
+    if(!j_index.contains("data_file") || j_index.at("data_file") != file_stat(data_file)) {
+        std::cout << "WARNING: Bloom filter file \"" << path << "\" is out of date with \"" << data_file
+            << "\", ignoring it" << std::endl;
+        return nullptr;
+    }
+    reader->_columns = j_index.at("columns").get<std::map<std::string, double>>();
+    for(const auto& j : j_index.at("filters")) {
+        reader->_entries[{j.at("row_group").get<int>(), j.at("column").get<std::string>()}] =
+            Entry{j.at("offset").get<int64_t>(), j.at("bytes").get<uint32_t>()};
+    }
+    return reader;
+}
+
+double BloomFilterReader::fpp(const std::string& column) const {
+    auto it = _columns.find(column);
+    return it == _columns.end() ? 0. : it->second;
+}
+
+std::unique_ptr<SplitBlockBloomFilter> BloomFilterReader::read(int row_group, const std::string& column) {
+    auto it = _entries.find({row_group, column});
+    if(it == _entries.end()) {
+        return nullptr;
+    }
+    std::unique_ptr<SplitBlockBloomFilter> filter(new SplitBlockBloomFilter(it->second.num_bytes));
+    int64_t n;
+    PARQUET_ASSIGN_OR_THROW(n, _infile->ReadAt(it->second.offset, it->second.num_bytes, filter->mutable_data()));
+    if(n != it->second.num_bytes) {
+        throw std::runtime_error("ERROR: Short read of a Bloom filter");
+    }
+    _bytes_read += n;
+    return filter;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+//std/stl
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <stdint.h>
+
+//arrow/parquet
+#include <arrow/api.h>
+#include <arrow/io/api.h>
+
+//nlohmann
+#include "json.hpp"
+
+//
+// Split block Bloom filters as specified for Parquet (the Parquet format's
+// BloomFilter.md): the filter is an array of 256 bit blocks, a value's 64 bit
+// XXH64 hash (of its plain encoding, e.g. the 8 little-endian bytes of an
+// INT64) selects one block with its upper 32 bits and sets one bit in each of
+// the block's eight 32 bit words from its lower 32 bits. With "ndv" distinct
+// values in a filter of optimal_num_bytes(ndv, fpp) bytes the probability of a
+// false positive is at most "fpp"; there are no false negatives.
+//
+// Arrow 5's Parquet writer cannot store Bloom filters in the data files, so
+// they are kept in a sidecar file next to each data file (see
+// BloomFilterWriter), one filter per (RowGroup, column).
+//
+namespace bloom {
+
+    // XXH64 of "length" bytes (the hash function of the Parquet Bloom filters)
+    uint64_t xxh64(const void* data, size_t length, uint64_t seed = 0);
+}; // namespace bloom
+
+class SplitBlockBloomFilter {
+    public:
+        static constexpr uint32_t kBytesPerBlock = 32;
+        static constexpr uint32_t kMinimumBytes = kBytesPerBlock;
+        static constexpr uint32_t kMaximumBytes = 128 * 1024 * 1024;
+
+        // size (a power of 2, in bytes) for a false positive probability of "fpp" with "ndv" distinct values
+        static uint32_t optimal_num_bytes(uint64_t ndv, double fpp);
+
+        // an empty filter of "num_bytes" (a power of 2) bytes
+        explicit SplitBlockBloomFilter(uint32_t num_bytes);
+
+        // hash of a value of the Parquet physical types INT32, INT64, FLOAT and DOUBLE
+        static uint64_t hash(int32_t value) { return bloom::xxh64(&value, sizeof(value)); }
+        static uint64_t hash(int64_t value) { return bloom::xxh64(&value, sizeof(value)); }
+        static uint64_t hash(float value) { return bloom::xxh64(&value, sizeof(value)); }
+        static uint64_t hash(double value) { return bloom::xxh64(&value, sizeof(value)); }
+
+        void insert(uint64_t hash);
+        bool find(uint64_t hash) const;
+
+        // insert all non-null values of an integer or floating point array, hashed
+        // as their Parquet physical type (8, 16 and 32 bit integers as INT32)
+        void insert(const arrow::Array& values);
+
+        uint32_t num_bytes() const { return static_cast<uint32_t>(_words.size() * sizeof(uint32_t)); }
+        const uint8_t* data() const { return reinterpret_cast<const uint8_t*>(_words.data()); }
+        uint8_t* mutable_data() { return reinterpret_cast<uint8_t*>(_words.data()); }
+
+    private :
+        std::vector<uint32_t> _words;
+}; // class SplitBlockBloomFilter
+
+namespace helpers {
+
+    // the Bloom filter sidecar of a data file: "dir/dummy_0.parquet" -> "dir/dummy_0.bloom"
+    std::string bloom_filter_path(const std::string& data_file);
+
+    // "event.id" or "event.id:0.001" -> (column, false positive probability)
+    std::pair<std::string, double> bloom_filter_option(const std::string& option, double default_fpp = 0.01);
+}; // namespace helpers
+
+//
+// Bloom filter sidecar file, laid out like a Parquet file:
+//
+//      "BLM1" <filter bytes>... <JSON index> <4 byte index length> "BLM1"
+//
+// where the index lists the columns (with their false positive probability)
+// and, for each filter, its RowGroup, column, number of values and byte range,
+// so that a reader only reads the filters it needs. The index also records the
+// size and modification time of the data file the filters were built from: a
+// sidecar left next to a data file that was rewritten since is ignored, as its
+// filters would prune the RowGroups of values it does not know of.
+//
+class BloomFilterWriter {
+    public:
+        BloomFilterWriter(const std::shared_ptr<arrow::io::OutputStream>& outfile,
+                const std::map<std::string, double>& columns);
+        ~BloomFilterWriter() = default;
+
+        // build and write the filter of the leaf column "column" ("values") of RowGroup "row_group"
+        void write(int row_group, const std::string& column, const arrow::Array& values);
+        // write the index and close the file; "data_file" is the (closed) data
+        // file of the filters, whose size and modification time are recorded
+        void close(const std::string& data_file);
+
+    private :
+        std::shared_ptr<arrow::io::OutputStream> _outfile;
+        std::map<std::string, double> _columns;
+        nlohmann::json _filters;
+        int64_t _position;
+}; // class BloomFilterWriter
+
+class BloomFilterReader {
+    public:
+        // the sidecar at "path" (reading its index only) of the data file "data_file",
+        // nullptr if there is none, or (with a warning) if it was built from
+        // another version of the data file
+        static std::unique_ptr<BloomFilterReader> open(const std::string& path, const std::string& data_file);
+        ~BloomFilterReader() = default;
+
+        // false positive probability the filters of "column" were built for, 0 if it has none
+        double fpp(const std::string& column) const;
+        // the filter of "column" in RowGroup "row_group", nullptr if there is none
+        std::unique_ptr<SplitBlockBloomFilter> read(int row_group, const std::string& column);
+        // bytes read from the file so far (index and filters)
+        int64_t bytes_read() const { return _bytes_read; }
+
+    private :
+        struct Entry {
+            int64_t offset;
+            uint32_t num_bytes;
+        };
+        std::shared_ptr<arrow::io::RandomAccessFile> _infile;
+        std::map<std::string, double> _columns;
+        std::map<std::pair<int, std::string>, Entry> _entries;
+        int64_t _bytes_read;
+
+        BloomFilterReader(const std::shared_ptr<arrow::io::RandomAccessFile>& infile);
+}; // class BloomFilterReader
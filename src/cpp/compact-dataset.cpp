@@ -0,0 +1,289 @@
+#include "dataset_reader.h"
+#include "memory_pool.h"
+#include "dataset_writer.h"
+#include "summary_metadata.h"
+#include "table_sink.h"
+
+//std/stl
+#include <iostream>
+#include <cstring> // strcmp
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <map>
+#include <algorithm>
+
+//arrow/parquet
+#include <arrow/util/compression.h>
+#include <parquet/exception.h>
+#include <parquet/properties.h>
+
+//
+// Rewrites a dataset of many small files and/or small RowGroups (e.g. from
+// gen-dataset with a small -r) into files of whole RowGroups of a target
+// size, keeping the event order, the schema metadata and the partition
+// directories (see partitioning.h). Each output file is written by its own
+// worker, which reads the (slices of the) input RowGroups it is made of.
+//
+// An input file that already is exactly one output file (same rows, RowGroups
+// of the target size, the same codec and written by this Parquet version,
+// i.e. with the same encodings) is copied as is, without decoding it. (Arrow 5
+// cannot copy single column chunks into a new file, so this is done for whole
+// files only.)
+//
+
+void print_usage(char* argv[]) {
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+    std::cout << " Compact a dataset into files of RowGroups of a target size, in parallel" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Usage: " << argv[0] << " [OPTIONS] <input dataset directory>" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Options:" << std::endl;
+    std::cout << "   --name                 Name of output dataset [default: \"compact\"]" << std::endl;
+    std::cout << "   -o|--outdir            Output directory to store files in [default: \"./dataset_compact\"]" << std::endl;
+    std::cout << "   -r|--row-group-size    Number of events per output RowGroup [default: 62500]" << std::endl;
+    std::cout << "   -f|--file-size         Number of events per output file, rounded up to whole RowGroups" << std::endl;
+    std::cout << "                          [default: 0, a single file per partition]" << std::endl;
+    std::cout << "   -c|--compression       Compression setting (Options: UNCOMPRESSED, SNAPPY, GZIP, ZSTD, LZ4)" << std::endl;
+    std::cout << "                          [default: that of the input]" << std::endl;
+    std::cout << "   -t|--threads           Number of output files written in parallel [default: # of hardware threads]" << std::endl;
+    std::cout << "   --no-copy              Re-encode all files, even those that could be copied as they are" << std::endl;
+    std::cout << "   --memory-pool          Arrow memory pool backend (Options: default, system, jemalloc, mimalloc);" << std::endl;
+    std::cout << "                          the allocations of each phase are reported at the end [default: default]" << std::endl;
+    std::cout << "   -h|--help              Print this help message and exit" << std::endl;
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+}
+
+// rows [offset, offset + length) of an input RowGroup
+struct Slice {
+    RowGroupTask task;
+    int64_t offset;
+    int64_t length;
+};
+
+struct OutputFile {
+    size_t partition;           // index into the partition directories
+    size_t index;               // file number within the partition
+    std::vector<Slice> slices;
+    int64_t num_rows = 0;
+    int64_t copy_of = -1;       // input file copied as is, -1 if re-encoded
+};
+
+// the setting of helpers::compression_type for a codec
+std::string compression_name(arrow::Compression::type codec) {
+    for(const auto& name : {"UNCOMPRESSED", "SNAPPY", "GZIP", "ZSTD", "LZ4"}) {
+        if(helpers::compression_type(name) == codec) return name;
+    }
+    throw std::runtime_error("ERROR: Unsupported input compression \"" + arrow::util::Codec::GetCodecAsString(codec) + "\"");
+}
+
+// true if the input file "ifile" can be copied as the output file "out"
+bool can_copy(const DatasetReader& dataset, size_t ifile, const OutputFile& out, int64_t row_group_size,
+        arrow::Compression::type codec) {
+    auto footer = dataset.footer(ifile);
+    if(footer->num_rows() != out.num_rows || footer->num_row_groups() != static_cast<int>(out.slices.size())) {
+        return false;
+    }
+    if(footer->created_by() != parquet::DEFAULT_CREATED_BY) return false;
+    for(int irg = 0; irg < footer->num_row_groups(); irg++) {
+        const auto& slice = out.slices.at(irg);
+        if(slice.task.file_index != ifile || slice.offset != 0 || slice.length != slice.task.num_rows) return false;
+        // (only the last RowGroup of the file may be shorter)
+        if(slice.length != row_group_size && irg + 1 < footer->num_row_groups()) return false;
+        auto row_group = footer->RowGroup(irg);
+        for(int icol = 0; icol < row_group->num_columns(); icol++) {
+            if(row_group->ColumnChunk(icol)->compression() != codec) return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string input = "";
+    std::string outdir = "./dataset_compact";
+    std::string dataset_name = "compact";
+    std::string compression = "";
+    int64_t row_group_size = 62500;
+    int64_t file_size = 0;
+    size_t n_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    bool allow_copy = true;
+
+    for(size_t i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "--name") == 0) { dataset_name = argv[++i]; }
+        else if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--outdir") == 0) { outdir = argv[++i]; }
+        else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--row-group-size") == 0) { row_group_size = std::stoll(argv[++i]); }
+        else if (strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--file-size") == 0) { file_size = std::stoll(argv[++i]); }
+        else if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--compression") == 0) { compression = argv[++i]; }
+        else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--threads") == 0) { n_threads = std::stoul(argv[++i]); }
+        else if (strcmp(argv[i], "--no-copy") == 0) { allow_copy = false; }
+        else if (strcmp(argv[i], "--memory-pool") == 0) { memory::select_backend(argv[++i]); }
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { print_usage(argv); return 0; }
+        else if (argv[i][0] != '-' && input.empty()) { input = argv[i]; }
+        else {
+            std::cout << argv[0] << " Unknown command line argument provided: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if(input.empty() || row_group_size <= 0) {
+        print_usage(argv);
+        return 1;
+    }
+    if(!std::filesystem::is_directory(input)) {
+        std::cout << argv[0] << " ERROR: Input \"" << input << "\" is not a directory" << std::endl;
+        return 1;
+    }
+    if(std::filesystem::exists(outdir) && std::filesystem::equivalent(input, outdir)) {
+        std::cout << argv[0] << " ERROR: The output directory must differ from the input directory" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    DatasetReader dataset(input);
+    const auto& tasks = dataset.row_groups();
+    if(tasks.empty()) {
+        std::cout << "WARNING: Input dataset has no RowGroups, nothing to do" << std::endl;
+        return 0;
+    }
+    auto codec = compression.empty() ? dataset.row_group_metadata(tasks.at(0))->ColumnChunk(0)->compression()
+        : helpers::compression_type(compression);
+    compression = compression_name(codec);
+    // whole RowGroups per output file
+    if(file_size > 0) {
+        file_size = (file_size + row_group_size - 1) / row_group_size * row_group_size;
+    }
+
+    //
+    // plan the output files: the RowGroups of each partition directory, in
+    // order, are cut into files of file_size rows
+    //
+    std::vector<std::string> partitions;
+    std::vector<OutputFile> outputs;
+    std::map<std::string, size_t> partition_index;
+    std::vector<size_t> partition_files;
+    for(const auto& task : tasks) {
+        auto partition = std::filesystem::path(dataset.relative_path(task.file_index)).parent_path().generic_string();
+        auto it = partition_index.find(partition);
+        if(it == partition_index.end()) {
+            it = partition_index.insert({partition, partitions.size()}).first;
+            partitions.push_back(partition);
+            partition_files.push_back(0);
+        }
+        size_t ipartition = it->second;
+        int64_t offset = 0;
+        while(offset < task.num_rows) {
+            bool new_partition = outputs.empty() || outputs.back().partition != ipartition;
+            if(new_partition || (file_size > 0 && outputs.back().num_rows >= file_size)) {
+                OutputFile out;
+                out.partition = ipartition;
+                out.index = partition_files.at(ipartition)++;
+                outputs.push_back(out);
+            }
+            auto& out = outputs.back();
+            int64_t length = task.num_rows - offset;
+            if(file_size > 0) {
+                length = std::min(length, file_size - out.num_rows);
+            }
+            out.slices.push_back({task, offset, length});
+            out.num_rows += length;
+            offset += length;
+        }
+    }
+    size_t n_copied = 0;
+    if(allow_copy) {
+        for(auto& out : outputs) {
+            size_t ifile = out.slices.at(0).task.file_index;
+            if(can_copy(dataset, ifile, out, row_group_size, codec)) {
+                out.copy_of = ifile;
+                n_copied++;
+            }
+        }
+    }
+
+    //
+    // write the output files, one per worker at a time
+    //
+    n_threads = std::max<size_t>(1, std::min(n_threads, outputs.size()));
+    std::vector<std::shared_ptr<parquet::FileMetaData>> footers(outputs.size());
+    std::vector<std::string> paths(outputs.size());
+    std::atomic<size_t> next_output(0);
+    std::vector<std::exception_ptr> errors(n_threads);
+    std::vector<std::thread> workers;
+    for(size_t ithread = 0; ithread < n_threads; ithread++) {
+        workers.emplace_back([&, ithread]() {
+            try {
+                RowGroupReader reader(dataset);
+                size_t iout;
+                while((iout = next_output.fetch_add(1)) < outputs.size()) {
+                    const auto& out = outputs.at(iout);
+                    auto dir = std::filesystem::path(outdir) / partitions.at(out.partition);
+                    if(out.copy_of >= 0) {
+                        std::filesystem::create_directories(dir);
+                        auto path = dir / (dataset_name + "_" + std::to_string(out.index) + ".parquet");
+                        std::filesystem::copy_file(dataset.files().at(out.copy_of), path,
+                                std::filesystem::copy_options::overwrite_existing);
+                        paths.at(iout) = path.string();
+                        footers.at(iout) = dataset.footer(out.copy_of);
+                        continue;
+                    }
+                    DatasetWriter writer(dir.string(), dataset_name, row_group_size, 0, compression,
+                            dataset.schema()->metadata());
+                    writer.set_first_file(out.index);
+                    writer.set_write_summary(false);
+                    for(const auto& slice : out.slices) {
+                        auto table = reader.read(slice.task, {});
+                        writer.write(slice.offset == 0 && slice.length == table->num_rows() ? table
+                                : table->Slice(slice.offset, slice.length));
+                    }
+                    writer.close();
+                    paths.at(iout) = writer.files().at(0);
+                    footers.at(iout) = writer.footers().at(0);
+                }
+            } catch(...) {
+                errors.at(ithread) = std::current_exception();
+            }
+        });
+    }
+    for(auto& w : workers) {
+        w.join();
+    }
+    for(auto& e : errors) {
+        if(e) std::rethrow_exception(e);
+    }
+
+    // the summary of each partition, and of the whole dataset if partitioned
+    for(size_t ipartition = 0; ipartition < partitions.size(); ipartition++) {
+        std::vector<std::string> relative_paths;
+        std::vector<std::shared_ptr<parquet::FileMetaData>> partition_footers;
+        for(size_t iout = 0; iout < outputs.size(); iout++) {
+            if(outputs.at(iout).partition != ipartition) continue;
+            relative_paths.push_back(std::filesystem::path(paths.at(iout)).filename().string());
+            partition_footers.push_back(footers.at(iout));
+        }
+        helpers::write_summary_metadata((std::filesystem::path(outdir) / partitions.at(ipartition)).string(),
+                relative_paths, partition_footers);
+    }
+    if(partitions.size() > 1 || !partitions.at(0).empty()) {
+        helpers::merge_summary_metadata(outdir, partitions);
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(stop - start).count();
+
+    int64_t n_row_groups = 0;
+    for(const auto& footer : footers) {
+        n_row_groups += footer->num_row_groups();
+    }
+    std::cout << "INFO: Compacted " << dataset.num_rows() << " events (" << tasks.size() << " row groups, "
+        << dataset.files().size() << " files) to " << n_row_groups << " row groups in " << outputs.size()
+        << " files (" << n_copied << " copied as they were, " << compression << ") in " << elapsed << " seconds" << std::endl;
+    std::cout << "INFO: " << dataset.num_rows() / elapsed << " events/s (" << n_threads << " threads)" << std::endl;
+    std::cout << "INFO: Output dataset written to " << outdir << std::endl;
+
+    std::cout << memory::report();
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "counter_rng.h"
+
+// std/stl
+#include <cmath>
+#include <limits>
+
+//
+// Runtime selection of AVX-512, AVX2 and baseline versions of the kernels
+// (function multi-versioning, which relies on ifuncs and so on Linux/ELF).
+// The results do not depend on the version: Philox is integer arithmetic and
+// the transforms are made of correctly rounded operations (and built without
+// fused multiply-adds).
+//
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__)
+#define RNG_TARGET_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define RNG_TARGET_CLONES
+#endif
+
+namespace rng {
+
+RNG_TARGET_CLONES
+void uniform_ints(const CounterRng& r, const uint64_t* events, const uint32_t* indices, int64_t n,
+        uint32_t field, int a, int b, int32_t* out) {
+    const uint32_t k0 = static_cast<uint32_t>(r.seed());
+    const uint32_t k1 = static_cast<uint32_t>(r.seed() >> 32);
+    const uint32_t range = b - a + 1;
+    #pragma omp simd
+    for(int64_t j = 0; j < n; j++) {
+        uint32_t x0 = static_cast<uint32_t>(events[j]), x1 = static_cast<uint32_t>(events[j] >> 32), x2 = field, x3 = indices[j];
+        philox4x32(x0, x1, x2, x3, k0, k1);
+        out[j] = a + CounterRng::multiply_shift(x0, range);
+    }
+}
+
+RNG_TARGET_CLONES
+void uniform_floats(const CounterRng& r, const uint64_t* events, const uint32_t* indices, int64_t n,
+        uint32_t field, double a, double b, float* out) {
+    const uint32_t k0 = static_cast<uint32_t>(r.seed());
+    const uint32_t k1 = static_cast<uint32_t>(r.seed() >> 32);
+    #pragma omp simd
+    for(int64_t j = 0; j < n; j++) {
+        uint32_t x0 = static_cast<uint32_t>(events[j]), x1 = static_cast<uint32_t>(events[j] >> 32), x2 = field, x3 = indices[j];
+        philox4x32(x0, x1, x2, x3, k0, k1);
+        out[j] = a + (b - a) * unit(x0, x1);
+    }
+}
+
+RNG_TARGET_CLONES
+void normal_doubles(const CounterRng& r, const uint64_t* events, const uint32_t* indices, int64_t n,
+        uint32_t field, double mean, double sigma, double* out) {
+    const uint32_t k0 = static_cast<uint32_t>(r.seed());
+    const uint32_t k1 = static_cast<uint32_t>(r.seed() >> 32);
+
+    // the first attempt of the polar method for all values at once (accepted
+    // with probability pi/4), the rejected ones are marked with a NaN
+    #pragma omp simd
+    for(int64_t j = 0; j < n; j++) {
+        uint32_t x0 = static_cast<uint32_t>(events[j]), x1 = static_cast<uint32_t>(events[j] >> 32), x2 = field, x3 = indices[j];
+        philox4x32(x0, x1, x2, x3, k0, k1);
+        double u = 2 * unit(x0, x1) - 1;
+        double v = 2 * unit(x2, x3) - 1;
+        double s = u * u + v * v;
+        bool accept = s > 0 && s < 1;
+        double t = accept ? s : 0.5;
+        double z = mean + sigma * u * std::sqrt(-2 * rng::log(t) / t);
+        out[j] = accept ? z : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // and the rest one by one, continuing with the second attempt
+    for(int64_t j = 0; j < n; j++) {
+        if(!std::isnan(out[j])) continue;
+        for(uint32_t attempt = 1; ; attempt++) {
+            auto x = r.bits(events[j], field | (attempt << 16), indices[j]);
+            double u = 2 * unit(x[0], x[1]) - 1;
+            double v = 2 * unit(x[2], x[3]) - 1;
+            double s = u * u + v * v;
+            if(s > 0 && s < 1) {
+                out[j] = mean + sigma * u * std::sqrt(-2 * rng::log(s) / s);
+                break;
+            }
+        }
+    }
+}
+
+}; // namespace rng
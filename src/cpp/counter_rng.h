@@ -0,0 +1,185 @@
+#pragma once
+
+//std/stl
+#include <array>
+#include <cmath> // sqrt
+#include <cstring> // memcpy
+#include <stdint.h>
+
+//
+// Counter-based random numbers: every random value is a pure function of
+// (seed, event id, field, index), computed with the Philox4x32-10 bijection of
+// Salmon et al., "Parallel random numbers: as easy as 1, 2, 3" (SC11), so that
+// any event (or range of events) can be generated independently of all others
+// and in any order.
+//
+// The transforms to uniform and normal deviates below only use IEEE-754 basic
+// operations (+ - * / and sqrt, which are correctly rounded) rather than the
+// implementation-defined std::*_distribution or libm's log/cos, so the values
+// are bit-identical with any standard library. This requires that the compiler
+// does not contract a*b+c into fused multiply-adds (-ffp-contract=off), which
+// is set for the targets that use it.
+//
+namespace rng {
+
+    using Counter = std::array<uint32_t, 4>;
+    using Key = std::array<uint32_t, 2>;
+
+    // in place on the four counter words (the form used in vectorized loops)
+    inline void philox4x32(uint32_t& c0, uint32_t& c1, uint32_t& c2, uint32_t& c3, uint32_t k0, uint32_t k1) {
+        const uint32_t M0 = 0xD2511F53;
+        const uint32_t M1 = 0xCD9E8D57;
+        const uint32_t W0 = 0x9E3779B9;
+        const uint32_t W1 = 0xBB67AE85;
+        #pragma GCC unroll 10
+        for(int round = 0; round < 10; round++) {
+            if(round > 0) {
+                k0 += W0;
+                k1 += W1;
+            }
+            uint64_t p0 = static_cast<uint64_t>(M0) * c0;
+            uint64_t p1 = static_cast<uint64_t>(M1) * c2;
+            uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+            uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+            c1 = static_cast<uint32_t>(p1);
+            c3 = static_cast<uint32_t>(p0);
+            c0 = n0;
+            c2 = n2;
+        }
+    }
+
+    inline Counter philox4x32(Counter ctr, Key key) {
+        philox4x32(ctr[0], ctr[1], ctr[2], ctr[3], key[0], key[1]);
+        return ctr;
+    }
+
+    // 52 random bits -> [0, 1), as the mantissa of a double in [1, 2) (rather
+    // than a 64 bit integer to double conversion, which AVX2 does not have)
+    inline double unit(uint32_t hi, uint32_t lo) {
+        uint64_t bits = (static_cast<uint64_t>(hi) << 32 | lo) >> 12 | 0x3ff0000000000000ULL;
+        double x;
+        std::memcpy(&x, &bits, sizeof(x));
+        return x - 1;
+    }
+
+    //
+    // natural logarithm of a positive normal x from basic operations only:
+    // x = m * 2^e with m in [sqrt(1/2), sqrt(2)), log(m) = 2 atanh(z) with
+    // z = (m-1)/(m+1) and |z| < 0.172, summed as a fixed-length series
+    // (relative error ~1e-16); branch-free so that it vectorizes
+    //
+    inline double log(double x) {
+        // exact split into m in [0.5, 1) and e (as std::frexp)
+        uint64_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        int e = static_cast<int>((bits >> 52) & 0x7ff) - 1022;
+        bits = (bits & 0x800fffffffffffffULL) | 0x3fe0000000000000ULL;
+        double m;
+        std::memcpy(&m, &bits, sizeof(m));
+        if(m < 0.70710678118654752440) {
+            m *= 2;
+            e -= 1;
+        }
+        double z = (m - 1) / (m + 1);
+        double z2 = z * z;
+        double sum = 0;
+        #pragma GCC unroll 11
+        for(int k = 21; k >= 1; k -= 2) {
+            sum = sum * z2 + 1.0 / k;
+        }
+        return 2 * z * sum + e * 0.69314718055994530942;
+    }
+
+    //
+    // The random stream of one seed. A value is addressed by the event id, a
+    // "field" (the quantity being generated, < 2^16) and an "index" (e.g. the
+    // object within the event); the upper 16 bits of the field word are used
+    // for the retries of the rejection sampling in normal().
+    //
+    class CounterRng {
+        public :
+            CounterRng(uint64_t seed = 0) :
+                _key({static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)}) {}
+
+            uint64_t seed() const { return static_cast<uint64_t>(_key[1]) << 32 | _key[0]; }
+
+            Counter bits(uint64_t event, uint32_t field, uint32_t index) const {
+                return philox4x32({static_cast<uint32_t>(event), static_cast<uint32_t>(event >> 32), field, index}, _key);
+            }
+
+            // uniform in [a, b)
+            double uniform(uint64_t event, uint32_t field, uint32_t index, double a, double b) const {
+                auto r = bits(event, field, index);
+                return a + (b - a) * unit(r[0], r[1]);
+            }
+
+            // uniform integer in [a, b] (multiply-shift, the bias is < (b-a+1)/2^32)
+            int uniform_int(uint64_t event, uint32_t field, uint32_t index, int a, int b) const {
+                auto r = bits(event, field, index);
+                return a + multiply_shift(r[0], b - a + 1);
+            }
+
+            // x * range / 2^32, uniform in [0, range)
+            static int multiply_shift(uint32_t x, uint32_t range) {
+                return static_cast<int>((static_cast<uint64_t>(x) * range) >> 32);
+            }
+
+            // normal with "mean" and "sigma" (Marsaglia's polar method)
+            double normal(uint64_t event, uint32_t field, uint32_t index, double mean, double sigma) const {
+                for(uint32_t attempt = 0; ; attempt++) {
+                    auto r = bits(event, field | (attempt << 16), index);
+                    double u = 2 * unit(r[0], r[1]) - 1;
+                    double v = 2 * unit(r[2], r[3]) - 1;
+                    double s = u * u + v * v;
+                    if(s > 0 && s < 1) {
+                        return mean + sigma * u * std::sqrt(-2 * rng::log(s) / s);
+                    }
+                }
+            }
+
+        private :
+            Key _key;
+    }; // class CounterRng
+
+    //
+    // Distributions, in the spirit of the std:: ones but drawing from a given
+    // position of a CounterRng stream
+    //
+    struct UniformInt {
+        int a;
+        int b;
+        int operator()(const CounterRng& r, uint64_t event, uint32_t field, uint32_t index = 0) const {
+            return r.uniform_int(event, field, index, a, b);
+        }
+    }; // struct UniformInt
+
+    struct UniformReal {
+        double a;
+        double b;
+        double operator()(const CounterRng& r, uint64_t event, uint32_t field, uint32_t index = 0) const {
+            return r.uniform(event, field, index, a, b);
+        }
+    }; // struct UniformReal
+
+    struct Normal {
+        double mean;
+        double sigma;
+        double operator()(const CounterRng& r, uint64_t event, uint32_t field, uint32_t index = 0) const {
+            return r.normal(event, field, index, mean, sigma);
+        }
+    }; // struct Normal
+
+    //
+    // Batch versions of the above: out[j] is the value at the (events[j],
+    // field, indices[j]) position of the stream, the same as the scalar
+    // versions but in vectorized loops (with AVX-512 or AVX2 versions selected
+    // at runtime where supported)
+    //
+    void uniform_ints(const CounterRng& r, const uint64_t* events, const uint32_t* indices, int64_t n,
+            uint32_t field, int a, int b, int32_t* out);
+    void uniform_floats(const CounterRng& r, const uint64_t* events, const uint32_t* indices, int64_t n,
+            uint32_t field, double a, double b, float* out);
+    void normal_doubles(const CounterRng& r, const uint64_t* events, const uint32_t* indices, int64_t n,
+            uint32_t field, double mean, double sigma, double* out);
+
+}; // namespace rng
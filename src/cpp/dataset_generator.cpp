@@ -1,4 +1,8 @@
 #include "dataset_generator.h"
+#include "summary_metadata.h"
+#include "dataset_reader.h" // leaf_paths, leaf_array
+#include "partitioning.h"
+#include "metrics.h"
 
 // std/stl
 #include <iostream>
@@ -7,398 +11,593 @@
 #include <cmath>
 #include <filesystem> // absolute
 #include <sstream>
+#include <algorithm> // min, find
+#include <stdexcept>
+
+// arrow/parquet
+#include <parquet/statistics.h>
 
 // json
 using nlohmann::json;
 
+namespace {
+
+// the generator metrics, shared by all the generators of the process (e.g. one per sample)
+struct GeneratorMetrics {
+    metrics::Counter& events = metrics::counter("gen_events_total", "Events generated");
+    metrics::Counter& bytes = metrics::counter("gen_bytes_written_total", "Bytes written to the output files");
+    metrics::Counter& row_groups = metrics::counter("gen_row_groups_total", "RowGroups written");
+    metrics::Counter& files = metrics::counter("gen_files_total", "Output files started");
+    metrics::Counter& write_ns = metrics::counter("gen_write_stall_seconds_total",
+            "Time spent blocked encoding, compressing and writing RowGroups", 1e-9);
+}; // struct GeneratorMetrics
+
+GeneratorMetrics& generator_metrics() {
+    static GeneratorMetrics* m = new GeneratorMetrics();
+    return *m;
+}
+
+} // namespace
+
 namespace helpers {
 
-std::shared_ptr<arrow::Array> ArrayFromJSON(
-        const std::shared_ptr<arrow::DataType>& type,
-        const std::string& json) {
-    std::shared_ptr<arrow::Array> out;
-    PARQUET_THROW_NOT_OK(arrow::ipc::internal::json::ArrayFromJSON(type, json, &out));
-    return out;
+bool contains_parquet_files(const std::string& dir) {
+    if(!std::filesystem::is_directory(dir)) return false;
+    for(const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+        if(entry.is_regular_file() && entry.path().extension() == ".parquet") return true;
+    }
+    return false;
 }
 
-};
+uint64_t next_event_id(const DatasetReader& dataset) {
+    auto leaf_paths = helpers::leaf_paths(dataset.schema());
+    auto it = std::find(leaf_paths.begin(), leaf_paths.end(), "event.id");
+    if(it == leaf_paths.end()) it = std::find(leaf_paths.begin(), leaf_paths.end(), "event_id");
+    if(it == leaf_paths.end()) {
+        throw std::runtime_error("ERROR: No event id column in \"" + dataset.path() + "\"");
+    }
+    int leaf = static_cast<int>(it - leaf_paths.begin());
+
+    // (the ids are uint64, stored as INT64 with an unsigned sort order)
+    uint64_t next = 0;
+    for(const auto& task : dataset.row_groups()) {
+        if(task.num_rows == 0) continue;
+        auto column = dataset.row_group_metadata(task)->ColumnChunk(leaf);
+        auto stats = column->is_stats_set() ? std::static_pointer_cast<parquet::Int64Statistics>(column->statistics()) : nullptr;
+        if(!stats || !stats->HasMinMax()) {
+            throw std::runtime_error("ERROR: No statistics of the event ids in \"" + dataset.files().at(task.file_index) + "\"");
+        }
+        next = std::max(next, static_cast<uint64_t>(stats->max()) + 1);
+    }
+    return next;
+}
+
+}; // namespace helpers
 
 DatasetGenerator::DatasetGenerator(int32_t n_rows_per_group) :
-    _n_rows_in_group(n_rows_per_group),
+    _format(OutputFormat::PARQUET),
+    _layout(Layout::NESTED),
     _outdir("./dataset_gen"),
     _dataset_name("dummy"),
+    _file_count(0),
+    _first_file(0),
+    _append(false),
+    _events_per_file(0),
+    _events_in_file(0),
+    _write_summary(true),
+    _discard_output(false),
+    _bytes_written(0),
+    _file_position(0),
+    _row_groups_in_file(0),
+    _campaign("mc16d"),
+    _dsid(410472),
+    _sample_name("mc16d.410472.foobar.ttbar"),
+    _partitioned(false),
+    _n_rows_in_group(n_rows_per_group),
     _event_count(0),
-    _file_count(0)
+    _first_event(0)
 {
-    _lep_eff_dist = std::uniform_int_distribution<int>(0,2);
-    _jet_eff_dist = std::uniform_int_distribution<int>(0, 10);
-    _pt_dist = std::uniform_real_distribution<double>(0., 100.);
-    _eta_dist = std::uniform_real_distribution<double>(-2.7, 2.7);
-    _phi_dist = std::uniform_real_distribution<double>(-3.14, 3.14);
-    _weight_dist = std::normal_distribution<double>(1.0, 0.3);
+    _lep_eff_dist = rng::UniformInt{0, EventBuffers::kMaxLeptons};
+    _jet_eff_dist = rng::UniformInt{0, EventBuffers::kMaxJets};
+    _pt_dist = rng::UniformReal{0., 100.};
+    _eta_dist = rng::UniformReal{-2.7, 2.7};
+    _phi_dist = rng::UniformReal{-3.14, 3.14};
+    _weight_dist = rng::Normal{1.0, 0.3};
 }
 
 void DatasetGenerator::init(const std::string& dataset_name,
         const std::string& output_dir,
-        const std::string& select_compression) {
+        const std::string& select_compression,
+        const std::string& format,
+        const std::string& layout) {
     //
     // setup the output file and it's path
     //
-    _outdir = output_dir;
+    _outdir = _partitioned ? (std::filesystem::path(output_dir) / partition_directory()).string() : output_dir;
     _dataset_name = dataset_name;
-    std::string internalpath;
-    auto fs = arrow::fs::FileSystemFromUriOrPath(std::filesystem::absolute(_outdir),
-            &internalpath).ValueOrDie();
-    PARQUET_THROW_NOT_OK(fs->CreateDir(internalpath));
-    auto internal_fs = std::make_shared<arrow::fs::SubTreeFileSystem>(internalpath, fs);
-
-    //
-    // initialize the output Parquet file writer
-    //
-    std::stringstream outfilename;
-    outfilename << dataset_name << "_" << _file_count << ".parquet";
-    PARQUET_ASSIGN_OR_THROW(
-                _outfile,
-                internal_fs->OpenOutputStream(outfilename.str())
-            );
-    _file_count++;
-
-    // setup the dataset columns and structure
-    create_fields();
+    _format = helpers::output_format(format);
+    _layout = helpers::layout(layout);
+    _compression = select_compression;
+    // (Bloom filters are only written next to Parquet files)
+    if(!_bloom_filter_columns.empty() && _format != OutputFormat::PARQUET) {
+        std::cout << "WARNING: Bloom filters are only written for Parquet output, ignoring them" << std::endl;
+        _bloom_filter_columns.clear();
+    }
+    if(!_discard_output) {
+        std::string internalpath;
+        auto fs = arrow::fs::FileSystemFromUriOrPath(std::filesystem::absolute(_outdir),
+                &internalpath).ValueOrDie();
+        PARQUET_THROW_NOT_OK(fs->CreateDir(internalpath));
+        _fs = std::make_shared<arrow::fs::SubTreeFileSystem>(internalpath, fs);
+    }
 
     // metadata to attach to the output file
     json j_metadata;
-    j_metadata["dsid"] = 410472;
-    j_metadata["campaign"] = "mc16d";
-    j_metadata["sample_name"] = "mc16d.410472.foobar.ttbar";
+    j_metadata["dsid"] = _dsid;
+    j_metadata["campaign"] = _campaign;
+    j_metadata["sample_name"] = _sample_name;
     j_metadata["tag"] = "v0.1.0";
     j_metadata["creation_date"] = "2021-08-18";
+    j_metadata["layout"] = helpers::layout_name(_layout);
+    j_metadata["generator"] = {{"rng", "philox4x32-10"}, {"seed", _rng.seed()}};
+    if(!_bloom_filter_columns.empty()) {
+        j_metadata["bloom_filters"] = _bloom_filter_columns;
+    }
     std::unordered_map<std::string, std::string> metadata_map;
     metadata_map["metadata"] = j_metadata.dump();
     arrow::KeyValueMetadata keyval_metadata(metadata_map);
 
-    // setup the file schema
-    _schema = arrow::schema(_fields);
+    // setup the file schema, the columns and structure of which depend on the layout
+    _schema = helpers::layout_schema(_layout);
     _schema = _schema->WithMetadata(keyval_metadata.Copy());
 
+    // Bloom filters of leaf columns of this layout
+    auto leaf_paths = helpers::leaf_paths(_schema);
+    for(const auto& column : _bloom_filter_columns) {
+        if(std::find(leaf_paths.begin(), leaf_paths.end(), column.first) == leaf_paths.end()) {
+            throw std::runtime_error("ERROR: Bloom filter column \"" + column.first + "\" is not a leaf column of the "
+                    + helpers::layout_name(_layout) + " layout");
+        }
+    }
+
+    // (the default is based on the four columns of the nested layout, so that
+    // all layouts have the same RowGroups)
     if(_n_rows_in_group < 0) {
-        _n_rows_in_group = 250000 / _fields.size();
+        _n_rows_in_group = 250000 / helpers::layout_schema(Layout::NESTED)->num_fields();
+    }
+
+    // events sorted within each RowGroup, recorded in the metadata
+    if(!_sort_keys.empty()) {
+        sorting::check_sort_keys(_schema, _sort_keys);
+        _schema = _schema->WithMetadata(sorting::with_sort_metadata(_schema->metadata(), _sort_keys, _n_rows_in_group));
+    }
+
+    if(_append) {
+        init_append();
     }
 
-    initialize_writer(select_compression);
+    // the first output file is created right away, the following ones (if
+    // files are rolled over) only once there are events to write to them
+    open_file();
 }
 
-void DatasetGenerator::initialize_writer(const std::string& select_compression) {
+void DatasetGenerator::set_events_per_file(uint64_t n_events) {
+    _events_per_file = n_events;
+}
 
-    auto compression = arrow::Compression::UNCOMPRESSED;
-    if(select_compression == "SNAPPY") {
-        compression = arrow::Compression::SNAPPY;
-    } else if(select_compression == "GZIP") {
-        compression = arrow::Compression::GZIP;
-    } else if(select_compression == "UNCOMPRESSED") {
-        compression = arrow::Compression::UNCOMPRESSED;
-    } else {
-        std::cout << "WARNING: Unhandled compression type \"" << select_compression << "\" specified, falling back to Compression::UNCOMPRESSED" << std::endl;
-        compression = arrow::Compression::UNCOMPRESSED;
-    }
-
-    // setup the output writers
-    auto writer_props = parquet::WriterProperties::Builder()
-        .compression(compression)
-        ->data_pagesize(1024*1024*10)
-        ->build();
-
-    // we must call "store_schema" in order for the KeyvalueMetadata to be persistifed in the output Parquet file
-    auto arrow_props = parquet::ArrowWriterProperties::Builder().store_schema()->build();
-    PARQUET_THROW_NOT_OK(parquet::arrow::FileWriter::Open(*_schema,
-                arrow::default_memory_pool(),
-                _outfile,
-                writer_props,
-                arrow_props,
-                &_writer
-    ));
+void DatasetGenerator::set_write_summary(bool write_summary) {
+    _write_summary = write_summary;
+}
 
+void DatasetGenerator::set_discard_output(bool discard) {
+    _discard_output = discard;
 }
 
-void DatasetGenerator::create_fields() {
+void DatasetGenerator::set_bloom_filter(const std::string& column, double fpp) {
+    // (checks the value of "fpp" right away)
+    SplitBlockBloomFilter::optimal_num_bytes(1, fpp);
+    _bloom_filter_columns[column] = fpp;
+}
 
-    _fields.clear();
+void DatasetGenerator::set_sort(const std::vector<sorting::SortKey>& keys) {
+    _sort_keys = keys;
+}
 
-    //
-    // leptons
-    //
+void DatasetGenerator::set_output_options(const fileio::OutputOptions& options) {
+    _output_options = options;
+}
 
-    // lepton struct to represent each lepton object
-    auto lepton_struct = arrow::struct_(
-                {
-                    arrow::field("pt", arrow::float32()),
-                    arrow::field("eta", arrow::float32()),
-                    arrow::field("phi", arrow::float32()),
-                    arrow::field("flavor", arrow::int8()),
-                    arrow::field("isLoose", arrow::boolean()),
-                    arrow::field("isMedium", arrow::boolean()),
-                    arrow::field("isTight", arrow::boolean()),
-                    arrow::field("isTrigMatched", arrow::list(arrow::boolean()))
-                }
-            );
-    // the lepton column will be composed of some top-level fields/metadata
-    // associated with the event's leptons in addition to the actual list
-    // of leptons
-    _lepton_field = arrow::struct_(
-                {
-                    arrow::field("n", arrow::uint8()),
-                    arrow::field("leptons", arrow::list(lepton_struct))
-                }
-            );
+void DatasetGenerator::set_sample(const std::string& campaign, int dsid, const std::string& sample_name) {
+    if(campaign.empty() || campaign.find_first_of("/=") != std::string::npos) {
+        throw std::runtime_error("ERROR: Invalid campaign name \"" + campaign + "\"");
+    }
+    _campaign = campaign;
+    _dsid = dsid;
+    _sample_name = sample_name.empty() ? campaign + "." + std::to_string(dsid) + ".foobar.ttbar" : sample_name;
+}
 
-    //
-    // jets
-    //
+void DatasetGenerator::set_partitioned(bool partitioned) {
+    _partitioned = partitioned;
+}
 
-    // jet struct to represent each jet object
-    auto jet_struct = arrow::struct_(
-                {
-                    arrow::field("pt", arrow::float32()),
-                    arrow::field("eta", arrow::float32()),
-                    arrow::field("phi", arrow::float32()),
-                    arrow::field("m", arrow::float32()),
-                    arrow::field("truthHadronPt", arrow::float32()),
-                    arrow::field("truthHadronId", arrow::float32()),
-                    arrow::field("nTrk", arrow::uint8()),
-                    arrow::field("isBjet", arrow::boolean()),
-                    arrow::field("bTagScore", arrow::float32())
-                }
-            );
-    // the jet column will be composed of some top-level fields/metadata
-    // associated with the event's jets in addition to the actual list
-    // of jets
-    _jet_field = arrow::struct_(
-                {
-                    arrow::field("n", arrow::uint8()),
-                    arrow::field("jets", arrow::list(jet_struct))
-                }
-            );
+void DatasetGenerator::set_append(bool append) {
+    _append = append;
+}
 
-    //
-    // met
-    //
+void DatasetGenerator::init_append() {
+    if(_format != OutputFormat::PARQUET) {
+        throw std::runtime_error("ERROR: Appending is only supported for Parquet output");
+    }
+    if(!helpers::contains_parquet_files(_outdir)) {
+        std::cout << "INFO: No dataset to append to in \"" << _outdir << "\", starting a new one" << std::endl;
+        return;
+    }
+    DatasetReader existing(_outdir);
+    if(!existing.schema()->Equals(*_schema, /*check_metadata*/ false)) {
+        throw std::runtime_error("ERROR: Cannot append to \"" + _outdir + "\", the schema of its files is not that of the "
+                + helpers::layout_name(_layout) + " layout:\n" + existing.schema()->ToString(false));
+    }
 
-    // the met field is a per-event quantity, so there is no additional metadata
-    _met_field = arrow::struct_(
-                {
-                    arrow::field("sumEt", arrow::float32()),
-                    arrow::field("met", arrow::float32()),
-                    arrow::field("metPhi", arrow::float32()),
-                    arrow::field("electronTerm", arrow::float32()),
-                    arrow::field("muonTerm", arrow::float32()),
-                    arrow::field("jetTerm", arrow::float32()),
-                    arrow::field("softTerm", arrow::float32())
-                }
-            );
+    // continue the numbering of the "<name>_<N>.parquet" files
+    std::string prefix = _dataset_name + "_";
+    std::string extension = helpers::format_extension(_format);
+    for(size_t ifile = 0; ifile < existing.files().size(); ifile++) {
+        std::filesystem::path path(existing.relative_path(ifile));
+        auto name = path.filename().string();
+        if(path.has_parent_path() || name.size() <= prefix.size() + extension.size()
+                || name.compare(0, prefix.size(), prefix) != 0
+                || name.compare(name.size() - extension.size(), extension.size(), extension) != 0) continue;
+        auto number = name.substr(prefix.size(), name.size() - prefix.size() - extension.size());
+        if(number.find_first_not_of("0123456789") != std::string::npos) continue;
+        _first_file = std::max<uint32_t>(_first_file, std::stoul(number) + 1);
+    }
 
-    //
-    // event
-    //
+    // the existing files stay as they are, and are part of the new summary
+    if(_write_summary) {
+        for(size_t ifile = 0; ifile < existing.files().size(); ifile++) {
+            _file_names.push_back(existing.relative_path(ifile));
+            _footers.push_back(existing.footer(ifile));
+        }
+    }
+
+    _first_event = std::max(_first_event, helpers::next_event_id(existing));
+    std::cout << "INFO: Appending to " << existing.num_rows() << " events in " << existing.files().size()
+        << " files in \"" << _outdir << "\", starting at file " << _first_file << " and event id " << _first_event << std::endl;
+}
+
+std::string DatasetGenerator::partition_directory() const {
+    return partitioning::directory({{"campaign", _campaign}, {"dsid", std::to_string(_dsid)}});
+}
 
-    // event wide information: event weights, event trigger masks, etc...
-    _event_field = arrow::struct_(
-                {
-                    arrow::field("w", arrow::float64()),
-                    arrow::field("sumw2", arrow::float64()),
-                    arrow::field("id", arrow::uint64()),
-                    arrow::field("trigMask", arrow::list(arrow::boolean()))
-                }
-            );
+void DatasetGenerator::set_seed(uint64_t seed) {
+    _rng = rng::CounterRng(seed);
+}
 
+void DatasetGenerator::set_first_event(uint64_t event_id) {
+    _first_event = event_id;
+}
 
+void DatasetGenerator::open_file() {
     //
-    // store
+    // initialize the output file writer
     //
-    _fields.push_back(arrow::field("leptons", _lepton_field));
-    _fields.push_back(arrow::field("jets", _jet_field));
-    _fields.push_back(arrow::field("met", _met_field));
-    _fields.push_back(arrow::field("event", _event_field));
+    if(_discard_output) {
+        // encoded and compressed as usual, but only the number of bytes is kept
+        _outfile = std::make_shared<arrow::io::MockOutputStream>();
+    } else {
+        std::stringstream outfilename;
+        outfilename << _dataset_name << "_" << _first_file + _file_count << helpers::format_extension(_format);
+        PARQUET_ASSIGN_OR_THROW(
+                    _outfile,
+                    fileio::open_output_stream((std::filesystem::path(_outdir) / outfilename.str()).string(),
+                        _output_options)
+                );
+        _file_names.push_back(outfilename.str());
+
+        if(!_bloom_filter_columns.empty()) {
+            std::shared_ptr<arrow::io::OutputStream> bloomfile;
+            PARQUET_ASSIGN_OR_THROW(bloomfile, _fs->OpenOutputStream(helpers::bloom_filter_path(outfilename.str())));
+            _bloom_filter_writer = std::make_unique<BloomFilterWriter>(bloomfile, _bloom_filter_columns);
+        } else {
+            // (the sidecar of an earlier file of the same name no longer matches it)
+            std::error_code ec;
+            std::filesystem::remove(helpers::bloom_filter_path(
+                        (std::filesystem::path(_outdir) / outfilename.str()).string()), ec);
+        }
+    }
+    _file_count++;
+    _events_in_file = 0;
+    _row_groups_in_file = 0;
+    _file_position = 0;
+    generator_metrics().files.add();
+    initialize_writer(_compression);
+}
+
+void DatasetGenerator::close_file() {
+    if(!_sink) return;
+    _sink->close();
+    int64_t position;
+    PARQUET_ASSIGN_OR_THROW(position, _outfile->Tell());
+    _bytes_written += position;
+    generator_metrics().bytes.add(position - _file_position);
+    {
+        // (the last buffered writes, and the sync of the file if one is asked for)
+        metrics::ScopedTimer timer(generator_metrics().write_ns);
+        PARQUET_THROW_NOT_OK(_outfile->Close());
+    }
+    if(_bloom_filter_writer) {
+        _bloom_filter_writer->close((std::filesystem::path(_outdir) / _file_names.back()).string());
+        _bloom_filter_writer.reset();
+    }
 
+    // the footers are only kept for the summary metadata, as they grow with the number of RowGroups
+    if(_format == OutputFormat::PARQUET && _write_summary && !_discard_output) {
+        _footers.push_back(_sink->parquet_metadata());
+    }
+    _sink.reset();
+    _outfile.reset();
+}
+
+void DatasetGenerator::initialize_writer(const std::string& select_compression) {
+    _sink = TableSink::make(_format, _outfile, _schema, select_compression);
 }
 
+namespace {
+
+// the quantities drawn for each event, the "field" of the random stream
+enum Field : uint32_t {
+    kNLeptons,
+    kLeptonPt,
+    kLeptonEta,
+    kLeptonPhi,
+    kLeptonFlavor,
+    kNJets,
+    kJetPt,
+    kJetEta,
+    kJetPhi,
+    kJetM,
+    kJetTruthHadronScale,
+    kJetBTagScore,
+    kMetSumEt,
+    kMet,
+    kMetPhi,
+    kEventWeight
+};
+
+}; // namespace
+
 void DatasetGenerator::generate_event() {
+    generate_events(1);
+}
 
-    //
-    // generate leptons with random values for their attributes
-    //
-    int n_leptons = _lep_eff_dist(_rng);
-    std::vector<json> lepton_field_array;
-    for(size_t i = 0; i < n_leptons; i++) {
-        json p;
-        p["pt"] = _pt_dist(_rng);
-        p["eta"] = _eta_dist(_rng);
-        p["phi"] = _phi_dist(_rng);
-        p["flavor"] = _lep_eff_dist(_rng);
-        p["isLoose"] = i*2;
-        p["isMedium"] = i*3;
-        p["isTight"] = i*4;
-        std::vector<bool> trigMatched;
-        for(size_t itrig = 0; itrig < 8; itrig++) {
-            trigMatched.push_back(itrig%2 == 0);
-        } // itrig
-        p["isTrigMatched"] = trigMatched;
-        lepton_field_array.push_back(p);
-    } // i
-    json lepton_field = {{"n", n_leptons}, {"leptons", lepton_field_array}};
+void DatasetGenerator::generate_events(uint64_t n_events) {
+    while(n_events > 0) {
+        // up to the end of the current RowGroup
+        uint64_t n_batch = std::min<uint64_t>(n_events, _n_rows_in_group - _buffers.n_events());
+        generate_batch(n_batch);
+        n_events -= n_batch;
+        if(_buffers.n_events() >= _n_rows_in_group) {
+            fill();
+        }
+    }
+}
 
-    //
-    // generate jets with random values for their attributes
-    //
-    int n_jets = _jet_eff_dist(_rng);
-    std::vector<json> jet_field_array;
-    for(size_t i = 0; i < n_jets; i++) {
-        json p;
-        p["pt"] = _pt_dist(_rng);
-        p["eta"] = _eta_dist(_rng);
-        p["phi"] = _phi_dist(_rng);
-        p["m"] = _pt_dist(_rng);
-        p["truthHadronPt"] = _weight_dist(_rng) * p["pt"].get<float>();;
-        p["truthHadronId"] = i*4;
-        p["nTrk"] = i*3;
-        p["isBjet"] = i%2 == 0;
-        p["bTagScore"] = _pt_dist(_rng);
-        jet_field_array.push_back(p);
-    } // i
-    json jet_field = {{"n", n_jets}, {"jets", jet_field_array}};
+namespace {
+
+// the positions (event id, object index) of the objects of "n_events" events,
+// of which the i-th has id "first_id" + i and "counts[i]" objects
+void object_positions(uint64_t first_id, const uint8_t* counts, int64_t n_events,
+        std::vector<uint64_t>& events, std::vector<uint32_t>& indices) {
+    events.clear();
+    indices.clear();
+    for(int64_t i = 0; i < n_events; i++) {
+        for(uint32_t k = 0; k < counts[i]; k++) {
+            events.push_back(first_id + i);
+            indices.push_back(k);
+        }
+    }
+}
+
+// grow "column" by n and return a pointer to the new entries
+template<typename T>
+T* extend(std::vector<T>& column, size_t n) {
+    size_t size = column.size();
+    column.resize(size + n);
+    return column.data() + size;
+}
+
+}; // namespace
+
+//
+// Generate "n" events at once, appended to the column buffers: first the
+// multiplicities of all events, and then each quantity as one contiguous,
+// vectorized draw over all events/objects followed by the quantities derived
+// from it, computed column-wise
+//
+void DatasetGenerator::generate_batch(uint64_t n) {
+    const uint64_t first_id = _first_event + _event_count;
+    const int64_t n_events = static_cast<int64_t>(n);
+
+    // per-event positions: the event ids, object index 0
+    _event_positions.resize(n);
+    for(int64_t i = 0; i < n_events; i++) {
+        _event_positions[i] = first_id + i;
+    }
+    _zero_indices.assign(n, 0);
+    const uint64_t* events = _event_positions.data();
+    const uint32_t* zeros = _zero_indices.data();
 
     //
-    // generate random met
+    // leptons
     //
-    json met_field;
-    met_field["sumEt"] = _pt_dist(_rng);
-    met_field["met"] = _pt_dist(_rng);
-    met_field["metPhi"] = _phi_dist(_rng);
-    met_field["electronTerm"] = 0.3 * met_field["met"].get<float>();
-    met_field["muonTerm"] = 0.05 * met_field["met"].get<float>();
-    met_field["jetTerm"] = 0.6 * met_field["met"].get<float>();
-    met_field["softTerm"] = 0.05 * met_field["met"].get<float>();
+    _ints.resize(n);
+    rng::uniform_ints(_rng, events, zeros, n_events, kNLeptons, _lep_eff_dist.a, _lep_eff_dist.b, _ints.data());
+    uint8_t* lep_n = extend(_buffers.lep_n, n);
+    for(int64_t i = 0; i < n_events; i++) {
+        lep_n[i] = static_cast<uint8_t>(_ints[i]);
+        _buffers.lep_offsets.push_back(_buffers.lep_offsets.back() + lep_n[i]);
+    }
+    object_positions(first_id, lep_n, n_events, _object_events, _object_indices);
+    int64_t n_leptons = _object_events.size();
+    const uint64_t* lep_events = _object_events.data();
+    const uint32_t* lep_indices = _object_indices.data();
+
+    rng::uniform_floats(_rng, lep_events, lep_indices, n_leptons, kLeptonPt, _pt_dist.a, _pt_dist.b, extend(_buffers.lep_pt, n_leptons));
+    rng::uniform_floats(_rng, lep_events, lep_indices, n_leptons, kLeptonEta, _eta_dist.a, _eta_dist.b, extend(_buffers.lep_eta, n_leptons));
+    rng::uniform_floats(_rng, lep_events, lep_indices, n_leptons, kLeptonPhi, _phi_dist.a, _phi_dist.b, extend(_buffers.lep_phi, n_leptons));
+    _ints.resize(n_leptons);
+    rng::uniform_ints(_rng, lep_events, lep_indices, n_leptons, kLeptonFlavor, _lep_eff_dist.a, _lep_eff_dist.b, _ints.data());
+    int8_t* flavor = extend(_buffers.lep_flavor, n_leptons);
+    uint8_t* is_loose = extend(_buffers.lep_isLoose, n_leptons);
+    uint8_t* is_medium = extend(_buffers.lep_isMedium, n_leptons);
+    uint8_t* is_tight = extend(_buffers.lep_isTight, n_leptons);
+    uint8_t* trig_matched = extend(_buffers.lep_isTrigMatched, n_leptons * EventBuffers::kLeptonTrigBits);
+    for(int64_t j = 0; j < n_leptons; j++) {
+        uint32_t i = lep_indices[j];
+        flavor[j] = static_cast<int8_t>(_ints[j]);
+        is_loose[j] = i*2 != 0;
+        is_medium[j] = i*3 != 0;
+        is_tight[j] = i*4 != 0;
+        for(size_t itrig = 0; itrig < EventBuffers::kLeptonTrigBits; itrig++) {
+            trig_matched[j * EventBuffers::kLeptonTrigBits + itrig] = itrig%2 == 0;
+        } // itrig
+    } // j
 
     //
-    // event fields
+    // jets
     //
-    json event_field;
-    event_field["w"] = _weight_dist(_rng);
-    event_field["sumw2"] = event_field["w"].get<float>() * event_field["w"].get<float>();
-    event_field["id"] = _event_count;
-    std::vector<bool> eventTrigMatch;
-    for(size_t i = 0; i < 15; i++) {
-        eventTrigMatch.push_back(i%2==0);
+    _ints.resize(n);
+    rng::uniform_ints(_rng, events, zeros, n_events, kNJets, _jet_eff_dist.a, _jet_eff_dist.b, _ints.data());
+    uint8_t* jet_n = extend(_buffers.jet_n, n);
+    for(int64_t i = 0; i < n_events; i++) {
+        jet_n[i] = static_cast<uint8_t>(_ints[i]);
+        _buffers.jet_offsets.push_back(_buffers.jet_offsets.back() + jet_n[i]);
     }
-    event_field["trigMask"] = eventTrigMatch;
+    object_positions(first_id, jet_n, n_events, _object_events, _object_indices);
+    int64_t n_jets = _object_events.size();
+    const uint64_t* jet_events = _object_events.data();
+    const uint32_t* jet_indices = _object_indices.data();
+
+    float* pt = extend(_buffers.jet_pt, n_jets);
+    rng::uniform_floats(_rng, jet_events, jet_indices, n_jets, kJetPt, _pt_dist.a, _pt_dist.b, pt);
+    rng::uniform_floats(_rng, jet_events, jet_indices, n_jets, kJetEta, _eta_dist.a, _eta_dist.b, extend(_buffers.jet_eta, n_jets));
+    rng::uniform_floats(_rng, jet_events, jet_indices, n_jets, kJetPhi, _phi_dist.a, _phi_dist.b, extend(_buffers.jet_phi, n_jets));
+    rng::uniform_floats(_rng, jet_events, jet_indices, n_jets, kJetM, _pt_dist.a, _pt_dist.b, extend(_buffers.jet_m, n_jets));
+    rng::uniform_floats(_rng, jet_events, jet_indices, n_jets, kJetBTagScore, _pt_dist.a, _pt_dist.b, extend(_buffers.jet_bTagScore, n_jets));
+    _doubles.resize(n_jets);
+    rng::normal_doubles(_rng, jet_events, jet_indices, n_jets, kJetTruthHadronScale, _weight_dist.mean, _weight_dist.sigma, _doubles.data());
+    float* truth_pt = extend(_buffers.jet_truthHadronPt, n_jets);
+    float* truth_id = extend(_buffers.jet_truthHadronId, n_jets);
+    uint8_t* n_trk = extend(_buffers.jet_nTrk, n_jets);
+    uint8_t* is_bjet = extend(_buffers.jet_isBjet, n_jets);
+    for(int64_t j = 0; j < n_jets; j++) {
+        uint32_t i = jet_indices[j];
+        truth_pt[j] = _doubles[j] * pt[j];
+        truth_id[j] = i*4;
+        n_trk[j] = i*3;
+        is_bjet[j] = i%2 == 0;
+    } // j
 
     //
-    // now store the event's quantities in the buffers, to be writen
-    // out in the next RowGroup
+    // met
     //
-    _lepton_buffer.push_back(lepton_field);
-    _jet_buffer.push_back(jet_field);
-    _met_buffer.push_back(met_field);
-    _event_buffer.push_back(event_field);
+    rng::uniform_floats(_rng, events, zeros, n_events, kMetSumEt, _pt_dist.a, _pt_dist.b, extend(_buffers.met_sumEt, n));
+    float* met = extend(_buffers.met_met, n);
+    rng::uniform_floats(_rng, events, zeros, n_events, kMet, _pt_dist.a, _pt_dist.b, met);
+    rng::uniform_floats(_rng, events, zeros, n_events, kMetPhi, _phi_dist.a, _phi_dist.b, extend(_buffers.met_metPhi, n));
+    float* electron_term = extend(_buffers.met_electronTerm, n);
+    float* muon_term = extend(_buffers.met_muonTerm, n);
+    float* jet_term = extend(_buffers.met_jetTerm, n);
+    float* soft_term = extend(_buffers.met_softTerm, n);
+    for(int64_t i = 0; i < n_events; i++) {
+        electron_term[i] = 0.3 * met[i];
+        muon_term[i] = 0.05 * met[i];
+        jet_term[i] = 0.6 * met[i];
+        soft_term[i] = 0.05 * met[i];
+    }
 
     //
-    // increment the event counter and flush buffers if needed
+    // event fields
     //
-    _event_count++;
-    if(_event_count % _n_rows_in_group == 0) {
-        fill();
+    double* w = extend(_buffers.event_w, n);
+    rng::normal_doubles(_rng, events, zeros, n_events, kEventWeight, _weight_dist.mean, _weight_dist.sigma, w);
+    double* sumw2 = extend(_buffers.event_sumw2, n);
+    uint64_t* id = extend(_buffers.event_id, n);
+    uint8_t* trig_mask = extend(_buffers.event_trigMask, n * EventBuffers::kEventTrigBits);
+    for(int64_t i = 0; i < n_events; i++) {
+        sumw2[i] = static_cast<float>(w[i]) * static_cast<float>(w[i]);
+        id[i] = first_id + i;
+        for(size_t itrig = 0; itrig < EventBuffers::kEventTrigBits; itrig++) {
+            trig_mask[i * EventBuffers::kEventTrigBits + itrig] = itrig%2 == 0;
+        }
     }
+
+    _event_count += n;
+    generator_metrics().events.add(n);
 }
 
 void DatasetGenerator::finish() {
     fill();
-    PARQUET_THROW_NOT_OK(_writer->Close());
+    close_file();
+
+    // dataset-level _metadata/_common_metadata, so that readers need not open every footer
+    if(_format == OutputFormat::PARQUET && _write_summary && !_discard_output) {
+        helpers::write_summary_metadata(_outdir, _file_names, _footers);
+    } else if(helpers::remove_summary_metadata(_outdir)) {
+        // (readers would otherwise plan from the summary of an earlier run)
+        std::cout << "INFO: Removed the summary metadata of an earlier run from " << _outdir << std::endl;
+    }
 }
 
 void DatasetGenerator::fill() {
-    _arrays.clear();
-
-    fill_leptons();
-    fill_jets();
-    fill_met();
-    fill_event();
+    int64_t n_events = _buffers.n_events();
+    if(n_events == 0) return;
+    if(!_sink) {
+        open_file();
+    }
 
-    auto table = arrow::Table::Make(_schema, _arrays);
-    PARQUET_THROW_NOT_OK(_writer->WriteTable(*table, _event_buffer.size()));
+    // the table references the buffers, which are only cleared once it is written
+    auto table = helpers::layout_table(_layout, _buffers)->ReplaceSchemaMetadata(_schema->metadata());
+    if(!_sort_keys.empty()) {
+        table = sorting::sort_table(table, _sort_keys);
+    }
+    auto& m = generator_metrics();
+    {
+        metrics::ScopedTimer timer(m.write_ns);
+        _sink->write(*table, n_events);
+    }
+    _events_in_file += n_events;
+
+    // the Bloom filters of the RowGroup just written, over the values of all objects for list columns
+    if(_bloom_filter_writer) {
+        for(const auto& column : _bloom_filter_columns) {
+            auto values = helpers::leaf_array(table, column.first);
+            while(values->type_id() == arrow::Type::LIST) {
+                values = std::static_pointer_cast<arrow::ListArray>(values)->Flatten().ValueOrDie();
+            }
+            _bloom_filter_writer->write(_row_groups_in_file, column.first, *values);
+        }
+    }
+    _row_groups_in_file++;
 
     // flush
     flush();
+    m.row_groups.add();
+    int64_t position;
+    PARQUET_ASSIGN_OR_THROW(position, _outfile->Tell());
+    m.bytes.add(position - _file_position);
+    _file_position = position;
+
+    // roll over to a new file, at RowGroup boundaries
+    if(_events_per_file > 0 && _events_in_file >= _events_per_file) {
+        close_file();
+    }
 }
 
 void DatasetGenerator::flush() {
-    PARQUET_THROW_NOT_OK(_outfile->Flush());
-    clear_buffers();
-}
-
-void DatasetGenerator::clear_buffers() {
-    _arrays.clear();
-    _lepton_buffer.clear();
-    _jet_buffer.clear();
-    _met_buffer.clear();
-    _event_buffer.clear();
-}
-
-void DatasetGenerator::fill_leptons() {
-    size_t n_events = _event_buffer.size();
-
-    std::string jstr;
-    for(size_t i = 0; i < n_events; i++) {
-        if(i>0) {
-            jstr += ",";
-        }
-        jstr += _lepton_buffer.at(i).dump();
-    } // i
-    jstr = "[" + jstr + "]";
-    auto lepton_array = helpers::ArrayFromJSON(_lepton_field, jstr);
-    _arrays.push_back(lepton_array);
-}
-
-void DatasetGenerator::fill_jets() {
-    size_t n_events = _event_buffer.size();
-
-    std::string jstr;
-    for(size_t i = 0; i < n_events; i++) {
-        if(i>0) {
-            jstr += ",";
-        }
-        jstr += _jet_buffer.at(i).dump();
-    } // i
-    jstr = "[" + jstr + "]";
-    auto jet_array = helpers::ArrayFromJSON(_jet_field, jstr);
-    _arrays.push_back(jet_array);
-}
-
-void DatasetGenerator::fill_met() {
-    size_t n_events = _event_buffer.size();
-
-    std::string jstr;
-    for(size_t i = 0; i < n_events; i++) {
-        if(i>0) {
-            jstr += ",";
-        }
-        jstr += _met_buffer.at(i).dump();
-    } // i
-    jstr = "[" + jstr + "]";
-    auto met_array = helpers::ArrayFromJSON(_met_field, jstr);
-    _arrays.push_back(met_array);
-}
-
-void DatasetGenerator::fill_event() {
-    size_t n_events = _event_buffer.size();
-
-    std::string jstr;
-    for(size_t i = 0; i < n_events; i++) {
-        if(i>0) {
-            jstr += ",";
-        }
-        jstr += _event_buffer.at(i).dump();
-    } // i
-    jstr = "[" + jstr + "]";
-    auto event_array = helpers::ArrayFromJSON(_event_field, jstr);
-    _arrays.push_back(event_array);
+    // the output stream is not flushed here, so that its writes are coalesced
+    // across RowGroups (see output_stream.h)
+    // (clear() keeps the capacity of the buffers, so they are allocated only
+    // for the first RowGroup and the memory used stays the same from then on)
+    _buffers.clear();
 }
-
@@ -1,10 +1,17 @@
 //#pragma once
 
+#include "table_sink.h"
+#include "event_layout.h"
+#include "counter_rng.h"
+#include "bloom_filter.h"
+#include "sorting.h"
+#include "output_stream.h"
+
 //std/stl
 #include <string>
 #include <vector>
 #include <memory>
-#include <random>
+#include <map>
 
 //arrow/parquet
 #include <arrow/api.h>
@@ -12,8 +19,6 @@
 #include <parquet/arrow/writer.h>
 #include <parquet/exception.h>
 #include <arrow/filesystem/filesystem.h>
-#include <arrow/type.h> // struct_
-#include <arrow/ipc/json_simple.h> // ArrayFromJSON
 namespace parquet {
     namespace arrow {
         class FileWriter;
@@ -23,12 +28,14 @@ namespace parquet {
 //nlohmann
 #include "json.hpp"
 
-namespace helpers {
+class DatasetReader;
 
-    std::shared_ptr<arrow::Array> ArrayFromJSON(
-            const std::shared_ptr<arrow::DataType>& type,
-            const std::string& json
-    );
+namespace helpers {
+    // true if there are Parquet files in (the subdirectories of) "dir"
+    bool contains_parquet_files(const std::string& dir);
+    // one past the largest event id of a generated dataset, from the
+    // "event.id" (or "event_id") RowGroup statistics of its footers
+    uint64_t next_event_id(const DatasetReader& dataset);
 }; // namespace helpers
 
 class DatasetGenerator {
@@ -36,29 +43,120 @@ class DatasetGenerator {
         DatasetGenerator(int32_t n_rows_per_group = -1);
         ~DatasetGenerator() = default;
 
+        // "format" is one of "parquet", "ipc" or "feather" (see TableSink), an
+        // empty "select_compression" selects the default compression of the format
+        // and "layout" is one of "nested", "jagged", "padded" or "flat" (see Layout)
         void init(const std::string& dataset_name, const std::string& output_dir,
-                const std::string& select_compression = "UNCOMPRESSED");
+                const std::string& select_compression = "UNCOMPRESSED",
+                const std::string& format = "parquet",
+                const std::string& layout = "nested");
         void generate_event();
+        // generate "n_events" events, in batches of up to a RowGroup
+        void generate_events(uint64_t n_events);
         void finish();
 
+        //
+        // options for (very) large datasets, to be set before init()
+        //
+
+        // start a new file once a file has at least this many events (rounded
+        // up to whole RowGroups), 0 for a single file [default: 0]
+        void set_events_per_file(uint64_t n_events);
+        // write the _metadata/_common_metadata summary on finish() [default: true];
+        // the footers of all files are held in memory until then, so this is
+        // the one thing that grows with the number of events
+        void set_write_summary(bool write_summary);
+        // encode and compress the events but do not store them [default: false]
+        void set_discard_output(bool discard);
+        // write a Bloom filter of the leaf column "column" (e.g. "event.id") for
+        // each RowGroup, sized for a false positive probability of "fpp", to a
+        // sidecar file next to each Parquet file (see BloomFilterWriter)
+        void set_bloom_filter(const std::string& column, double fpp = 0.01);
+        // sort the events of each RowGroup by "keys" (leaf columns with one
+        // value per event, e.g. "jets.n" then "met.met") before they are
+        // written; the generator sorts within single RowGroups only, use
+        // DatasetWriter::set_sort() (e.g. skim-dataset --sort) for larger windows
+        void set_sort(const std::vector<sorting::SortKey>& keys);
+        // how the output files are written: the size of the buffer their
+        // writes are gathered in, preallocation and sync policy (see
+        // output_stream.h) [default: an 8 MB buffer, no preallocation or sync]
+        void set_output_options(const fileio::OutputOptions& options);
+
+        // the sample the events are recorded as, in the metadata (and the
+        // partition directory); an empty "sample_name" is derived from the
+        // campaign and DSID [default: mc16d, 410472]
+        void set_sample(const std::string& campaign, int dsid, const std::string& sample_name = "");
+        // write the files into the Hive-style "campaign=<campaign>/dsid=<dsid>"
+        // subdirectory of the output directory, so that readers can select
+        // samples from the paths alone (see partitioning.h) [default: false]
+        void set_partitioned(bool partitioned);
+        // the partition subdirectory of the sample, e.g. "campaign=mc16d/dsid=410472"
+        std::string partition_directory() const;
+
+        //
+        // add files to the (Parquet) dataset already in the output directory
+        // instead of overwriting it [default: false]: its schema must be that
+        // of the layout generated, the new files continue the numbering of its
+        // files of the same name and the event ids start after its largest one
+        // (or at the first event set, if that is larger), and the summary
+        // metadata covers both the existing and the new files
+        //
+        void set_append(bool append);
+
+        //
+        // the events generated are a function of the seed and of their id
+        // alone: the events [k, k+n) of a dataset can be generated on their
+        // own (e.g. as one of several shards, in parallel) by starting at
+        // event id k, and are bit-identical to those of a single job
+        //
+        void set_seed(uint64_t seed); // [default: 0]
+        void set_first_event(uint64_t event_id); // [default: 0]
+
+        uint64_t event_count() const { return _event_count; }
+        uint32_t file_count() const { return _file_count; }
+        // bytes written to the files closed so far
+        int64_t bytes_written() const { return _bytes_written; }
+
     private :
 
         //
         // output
         //
-        std::unique_ptr<parquet::arrow::FileWriter> _writer;
+        OutputFormat _format;
+        Layout _layout;
+        std::unique_ptr<TableSink> _sink;
         std::shared_ptr<arrow::io::OutputStream> _outfile;
+        std::shared_ptr<arrow::fs::FileSystem> _fs;
         std::string _outdir;
         std::string _dataset_name;
-        uint32_t _file_count; // in case we want to partition the dataset
+        uint32_t _file_count; // number of output files started so far
+        uint32_t _first_file; // number of the first output file
+        bool _append;
+        // names and (Parquet) footers of the files written, for the summary metadata
+        std::vector<std::string> _file_names;
+        std::vector<std::shared_ptr<parquet::FileMetaData>> _footers;
+        std::string _compression;
+        uint64_t _events_per_file;
+        uint64_t _events_in_file;
+        bool _write_summary;
+        bool _discard_output;
+        int64_t _bytes_written;
+        int64_t _file_position; // bytes of the current file counted in the metrics so far
+        fileio::OutputOptions _output_options;
+        std::map<std::string, double> _bloom_filter_columns;
+        std::unique_ptr<BloomFilterWriter> _bloom_filter_writer;
+        int _row_groups_in_file;
+        std::vector<sorting::SortKey> _sort_keys;
+        std::string _campaign;
+        int _dsid;
+        std::string _sample_name;
+        bool _partitioned;
 
         //
         // parquet file properties
         //
 
         std::shared_ptr<arrow::Schema> _schema;
-        std::vector<std::shared_ptr<arrow::Field>> _fields;
-        std::vector<std::shared_ptr<arrow::Array>> _arrays;
 
         // number of rows (events) per RowGroup in the output Parquet file
         int32_t _n_rows_in_group;
@@ -67,37 +165,38 @@ class DatasetGenerator {
         // event quantities
         //
 
-        std::default_random_engine _rng;
-        std::uniform_int_distribution<int> _lep_eff_dist;
-        std::uniform_int_distribution<int> _jet_eff_dist;
-        std::uniform_real_distribution<double> _pt_dist;
-        std::uniform_real_distribution<double> _eta_dist;
-        std::uniform_real_distribution<double> _phi_dist;
-        std::normal_distribution<double> _weight_dist;
-
-        // number of events processed so far
-        uint32_t _event_count;
-
-        // per-event containers for our data fields (one per column in the output Parquet file)
-        std::shared_ptr<arrow::DataType> _lepton_field;
-        std::shared_ptr<arrow::DataType> _jet_field;
-        std::shared_ptr<arrow::DataType> _met_field;
-        std::shared_ptr<arrow::DataType> _event_field;
-
-        // buffers for stored rows for each of the columns, will be flushed
-        // to the output file every _n_rows_in_group events
-        std::vector<nlohmann::json> _lepton_buffer;
-        std::vector<nlohmann::json> _jet_buffer;
-        std::vector<nlohmann::json> _met_buffer;
-        std::vector<nlohmann::json> _event_buffer;
-
-        void create_fields();
+        // every value is drawn from the (event id, quantity, object index)
+        // position of the counter-based stream, so an event does not depend
+        // on any of the others
+        rng::CounterRng _rng;
+        rng::UniformInt _lep_eff_dist;
+        rng::UniformInt _jet_eff_dist;
+        rng::UniformReal _pt_dist;
+        rng::UniformReal _eta_dist;
+        rng::UniformReal _phi_dist;
+        rng::Normal _weight_dist;
+
+        // number of events processed so far, and the id of the first one
+        uint64_t _event_count;
+        uint64_t _first_event;
+
+        // column-wise buffers of the generated events, written out as a
+        // RowGroup in the selected layout every _n_rows_in_group events
+        EventBuffers _buffers;
+
+        // scratch space of generate_batch(), at most a RowGroup's worth
+        std::vector<uint64_t> _event_positions;
+        std::vector<uint32_t> _zero_indices;
+        std::vector<uint64_t> _object_events;
+        std::vector<uint32_t> _object_indices;
+        std::vector<int32_t> _ints;
+        std::vector<double> _doubles;
+
+        void generate_batch(uint64_t n_events);
+        void init_append();
+        void open_file();
+        void close_file();
         void initialize_writer(const std::string& compression = "UNCOMPRESSED");
         void fill();
-        void fill_leptons();
-        void fill_jets();
-        void fill_met();
-        void fill_event();
         void flush();
-        void clear_buffers();
 }; // class DatasetGenerator
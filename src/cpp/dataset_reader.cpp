@@ -0,0 +1,465 @@
+#include "dataset_reader.h"
+#include "summary_metadata.h"
+#include "memory_pool.h"
+
+// std/stl
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cctype> // isdigit
+#include <filesystem>
+#include <stdexcept>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <exception>
+
+// arrow/parquet
+#include <arrow/io/api.h>
+#include <arrow/array/concatenate.h>
+#include <parquet/file_reader.h>
+#include <parquet/statistics.h>
+#include <parquet/exception.h>
+#include <parquet/arrow/schema.h>
+
+namespace helpers {
+
+namespace {
+
+void collect_leaf_paths(const std::shared_ptr<arrow::DataType>& type, const std::string& prefix,
+        std::vector<std::string>& out) {
+    if(type->id() == arrow::Type::STRUCT) {
+        for(const auto& child : type->fields()) {
+            collect_leaf_paths(child->type(), prefix + "." + child->name(), out);
+        }
+    } else if(type->id() == arrow::Type::LIST) {
+        // list levels do not appear in the dotted paths
+        auto list_type = std::static_pointer_cast<arrow::ListType>(type);
+        collect_leaf_paths(list_type->value_type(), prefix, out);
+    } else {
+        out.push_back(prefix);
+    }
+}
+
+std::vector<std::string> split_path(const std::string& path) {
+    std::vector<std::string> out;
+    std::stringstream ss(path);
+    std::string item;
+    while(std::getline(ss, item, '.')) {
+        out.push_back(item);
+    }
+    return out;
+}
+
+} // namespace
+
+std::vector<std::string> leaf_paths(const std::shared_ptr<arrow::Schema>& schema) {
+    std::vector<std::string> out;
+    for(const auto& field : schema->fields()) {
+        if(field->type()->id() == arrow::Type::STRUCT || field->type()->id() == arrow::Type::LIST) {
+            std::vector<std::string> children;
+            collect_leaf_paths(field->type(), "", children);
+            for(const auto& child : children) {
+                out.push_back(field->name() + child);
+            }
+        } else {
+            out.push_back(field->name());
+        }
+    }
+    return out;
+}
+
+std::shared_ptr<arrow::Array> leaf_array(const std::shared_ptr<arrow::Table>& table,
+        const std::string& path) {
+    auto segments = split_path(path);
+    if(segments.empty()) {
+        throw std::runtime_error("ERROR: Empty column path provided");
+    }
+    auto column = table->GetColumnByName(segments.at(0));
+    if(!column) {
+        throw std::runtime_error("ERROR: Column \"" + segments.at(0) + "\" not found in table");
+    }
+
+    std::shared_ptr<arrow::Array> current;
+    if(column->num_chunks() == 1) {
+        current = column->chunk(0);
+    } else {
+        PARQUET_ASSIGN_OR_THROW(current, arrow::Concatenate(column->chunks()));
+    }
+
+    // walk down the struct fields, stepping through (and remembering) any lists
+    std::vector<std::shared_ptr<arrow::ListArray>> lists;
+    for(size_t i = 1; i < segments.size(); i++) {
+        if(current->type_id() == arrow::Type::LIST) {
+            auto list = std::static_pointer_cast<arrow::ListArray>(current);
+            lists.push_back(list);
+            current = list->values();
+        }
+        if(current->type_id() != arrow::Type::STRUCT) {
+            throw std::runtime_error("ERROR: Cannot resolve \"" + segments.at(i) + "\" in column path \"" + path + "\"");
+        }
+        current = std::static_pointer_cast<arrow::StructArray>(current)->GetFieldByName(segments.at(i));
+        if(!current) {
+            throw std::runtime_error("ERROR: Field \"" + segments.at(i) + "\" of column path \"" + path + "\" not found");
+        }
+    } // i
+
+    // re-apply the list offsets, innermost first, so that the leaf stays jagged
+    for(auto it = lists.rbegin(); it != lists.rend(); ++it) {
+        const auto& list = *it;
+        current = std::make_shared<arrow::ListArray>(arrow::list(current->type()), list->length(),
+                list->value_offsets(), current, list->null_bitmap(), list->null_count(), list->offset());
+    }
+    return current;
+}
+
+bool leaf_min_max(const parquet::RowGroupMetaData& row_group, int leaf, double& min, double& max) {
+    auto column = row_group.ColumnChunk(leaf);
+    if(!column->is_stats_set()) return false;
+    auto stats = column->statistics();
+    if(!stats || !stats->HasMinMax()) return false;
+
+    // unsigned integers are stored (and ordered) as their unsigned bit patterns
+    bool is_unsigned = stats->descr()->sort_order() == parquet::SortOrder::UNSIGNED;
+    switch(stats->physical_type()) {
+        case parquet::Type::BOOLEAN: {
+            auto s = std::static_pointer_cast<parquet::BoolStatistics>(stats);
+            min = s->min() ? 1. : 0.;
+            max = s->max() ? 1. : 0.;
+            return true;
+        }
+        case parquet::Type::FLOAT: {
+            auto s = std::static_pointer_cast<parquet::FloatStatistics>(stats);
+            min = s->min();
+            max = s->max();
+            return true;
+        }
+        case parquet::Type::DOUBLE: {
+            auto s = std::static_pointer_cast<parquet::DoubleStatistics>(stats);
+            min = s->min();
+            max = s->max();
+            return true;
+        }
+        case parquet::Type::INT32: {
+            auto s = std::static_pointer_cast<parquet::Int32Statistics>(stats);
+            min = is_unsigned ? static_cast<double>(static_cast<uint32_t>(s->min())) : s->min();
+            max = is_unsigned ? static_cast<double>(static_cast<uint32_t>(s->max())) : s->max();
+            return true;
+        }
+        case parquet::Type::INT64: {
+            auto s = std::static_pointer_cast<parquet::Int64Statistics>(stats);
+            min = is_unsigned ? static_cast<double>(static_cast<uint64_t>(s->min())) : s->min();
+            max = is_unsigned ? static_cast<double>(static_cast<uint64_t>(s->max())) : s->max();
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+}; // namespace helpers
+
+namespace {
+
+// order "dummy_2.parquet" before "dummy_10.parquet"
+bool natural_less(const std::string& lhs, const std::string& rhs) {
+    size_t i = 0, j = 0;
+    while(i < lhs.size() && j < rhs.size()) {
+        if(std::isdigit(lhs[i]) && std::isdigit(rhs[j])) {
+            size_t ie = i, je = j;
+            while(ie < lhs.size() && std::isdigit(lhs[ie])) ie++;
+            while(je < rhs.size() && std::isdigit(rhs[je])) je++;
+            auto a = lhs.substr(i, ie - i);
+            auto b = rhs.substr(j, je - j);
+            a.erase(0, std::min(a.find_first_not_of('0'), a.size()));
+            b.erase(0, std::min(b.find_first_not_of('0'), b.size()));
+            if(a.size() != b.size()) return a.size() < b.size();
+            if(a != b) return a < b;
+            i = ie;
+            j = je;
+        } else {
+            if(lhs[i] != rhs[j]) return lhs[i] < rhs[j];
+            i++;
+            j++;
+        }
+    }
+    return lhs.size() - i < rhs.size() - j;
+}
+
+// the Parquet files in "dir" (at "relative" to the dataset directory) and in
+// the "key=value" subdirectories below it that "filter" does not prune
+void find_parquet_files(const std::filesystem::path& dir, const std::filesystem::path& relative,
+        const partitioning::Filter& filter, std::vector<std::string>& files, size_t& n_pruned) {
+    for(const auto& entry : std::filesystem::directory_iterator(dir)) {
+        auto name = entry.path().filename().string();
+        // skip summary/hidden files (e.g. "_metadata", ".crc")
+        if(name.empty() || name[0] == '_' || name[0] == '.') continue;
+        if(entry.is_directory()) {
+            if(name.find('=') == std::string::npos) continue;
+            if(!filter.may_match(partitioning::values((relative / name).string()))) {
+                n_pruned++;
+                continue;
+            }
+            find_parquet_files(entry.path(), relative / name, filter, files, n_pruned);
+            continue;
+        }
+        if(!entry.is_regular_file()) continue;
+        if(entry.path().extension() != ".parquet") continue;
+        files.push_back((relative / name).generic_string());
+    }
+}
+
+} // namespace
+
+DatasetReader::DatasetReader(const std::string& path, bool use_summary, const partitioning::Filter& partition_filter,
+        std::shared_ptr<FooterCache> footer_cache) :
+    _path(path),
+    _use_summary(use_summary),
+    _partition_filter(partition_filter),
+    _footer_cache(footer_cache),
+    _n_pruned_partitions(0),
+    _from_summary(false),
+    _num_rows(0)
+{
+    find_files();
+    plan();
+}
+
+void DatasetReader::find_files() {
+    _files.clear();
+    std::filesystem::path p(_path);
+    if(!std::filesystem::exists(p)) {
+        throw std::runtime_error("ERROR: Input dataset \"" + _path + "\" not found");
+    }
+
+    _relative_paths.clear();
+    _n_pruned_partitions = 0;
+    if(std::filesystem::is_regular_file(p)) {
+        _files.push_back(p.string());
+        _relative_paths.push_back(p.filename().string());
+    } else {
+        find_parquet_files(p, "", _partition_filter, _relative_paths, _n_pruned_partitions);
+        std::sort(_relative_paths.begin(), _relative_paths.end(), natural_less);
+        for(const auto& relative : _relative_paths) {
+            _files.push_back((p / relative).string());
+        }
+    }
+
+    if(_files.empty()) {
+        throw std::runtime_error("ERROR: No Parquet files found in \"" + _path + "\""
+                + (_partition_filter.empty() ? "" : " passing the partition filter \"" + _partition_filter.expression() + "\""));
+    }
+}
+
+void DatasetReader::plan() {
+    _row_groups.clear();
+    _footers.clear();
+    _num_rows = 0;
+
+    if(_use_summary && std::filesystem::is_directory(_path) && plan_from_summary()) {
+        return;
+    }
+
+    // the footer reads are latency bound, so read them on a few threads
+    _footers.resize(_files.size());
+    size_t n_threads = std::min<size_t>({_files.size(), 16, std::max(1u, std::thread::hardware_concurrency())});
+    std::atomic<size_t> next_file(0);
+    std::vector<std::exception_ptr> errors(n_threads);
+    std::vector<std::thread> threads;
+    for(size_t ithread = 0; ithread < n_threads; ithread++) {
+        threads.emplace_back([&, ithread]() {
+            try {
+                size_t ifile;
+                while((ifile = next_file.fetch_add(1)) < _files.size()) {
+                    _footers.at(ifile) = _footer_cache ? _footer_cache->footer(_files.at(ifile))
+                        : parquet::ParquetFileReader::OpenFile(_files.at(ifile))->metadata();
+                }
+            } catch(...) {
+                errors.at(ithread) = std::current_exception();
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+    for(auto& e : errors) {
+        if(e) std::rethrow_exception(e);
+    }
+
+    for(size_t ifile = 0; ifile < _files.size(); ifile++) {
+        const auto& metadata = _footers.at(ifile);
+        for(int irg = 0; irg < metadata->num_row_groups(); irg++) {
+            int64_t n = metadata->RowGroup(irg)->num_rows();
+            _row_groups.push_back({ifile, irg, n});
+            _num_rows += n;
+        } // irg
+    } // ifile
+
+    // the arrow schema (including the key-value metadata stored by the generator),
+    // from the footer rather than by opening the file again
+    const auto& footer = _footers.at(0);
+    PARQUET_THROW_NOT_OK(parquet::arrow::FromParquetSchema(footer->schema(),
+                parquet::ArrowReaderProperties(), footer->key_value_metadata(), &_schema));
+    _leaf_paths = helpers::leaf_paths(_schema);
+}
+
+bool DatasetReader::plan_from_summary() {
+    std::shared_ptr<parquet::FileMetaData> summary;
+    auto summary_path = std::filesystem::path(_path) / helpers::kSummaryMetadataFile;
+    if(_footer_cache && std::filesystem::is_regular_file(summary_path)) {
+        summary = _footer_cache->footer(summary_path.string());
+    } else {
+        summary = helpers::read_summary_metadata(_path);
+    }
+    if(!summary) return false;
+
+    // the RowGroups of each file, by the file paths recorded in the summary
+    std::map<std::string, size_t> file_index;
+    for(size_t ifile = 0; ifile < _files.size(); ifile++) {
+        file_index[_relative_paths.at(ifile)] = ifile;
+    }
+    std::vector<std::vector<int>> file_row_groups(_files.size());
+    for(int irg = 0; irg < summary->num_row_groups(); irg++) {
+        auto row_group = summary->RowGroup(irg);
+        auto path = row_group->num_columns() ? row_group->ColumnChunk(0)->file_path() : "";
+        auto it = file_index.find(path);
+        if(it == file_index.end() && !_partition_filter.may_match(partitioning::values(path))) {
+            // (a file of a pruned partition)
+            continue;
+        }
+        if(it == file_index.end()) {
+            std::cout << "WARNING: Summary file of \"" << _path << "\" refers to missing file \"" << path
+                << "\", ignoring it" << std::endl;
+            return false;
+        }
+        file_row_groups.at(it->second).push_back(irg);
+    } // irg
+    for(size_t ifile = 0; ifile < _files.size(); ifile++) {
+        if(file_row_groups.at(ifile).empty()) {
+            std::cout << "WARNING: Summary file of \"" << _path << "\" does not include \"" << _files.at(ifile)
+                << "\", ignoring it" << std::endl;
+            return false;
+        }
+    }
+
+    // the summary is written after the files it describes: a file modified since
+    // (e.g. regenerated without a summary), or shorter than the column chunks
+    // the summary has of it, means that the summary is stale
+    std::error_code ec;
+    auto summary_time = std::filesystem::last_write_time(summary_path, ec);
+    for(size_t ifile = 0; ifile < _files.size(); ifile++) {
+        int64_t data_end = 0;
+        for(auto irg : file_row_groups.at(ifile)) {
+            auto row_group = summary->RowGroup(irg);
+            for(int icol = 0; icol < row_group->num_columns(); icol++) {
+                auto column = row_group->ColumnChunk(icol);
+                int64_t start = column->has_dictionary_page() ? column->dictionary_page_offset() : column->data_page_offset();
+                data_end = std::max(data_end, start + column->total_compressed_size());
+            }
+        } // irg
+        // (a file ends with the footer, its length and the "PAR1" magic)
+        auto size = std::filesystem::file_size(_files.at(ifile), ec);
+        bool stale = ec || static_cast<int64_t>(size) < data_end + 8;
+        if(!stale) {
+            auto file_time = std::filesystem::last_write_time(_files.at(ifile), ec);
+            stale = ec || file_time > summary_time;
+        }
+        if(stale) {
+            std::cout << "WARNING: Summary file of \"" << _path << "\" is out of date with \"" << _files.at(ifile)
+                << "\", ignoring it" << std::endl;
+            return false;
+        }
+    } // ifile
+
+    for(size_t ifile = 0; ifile < _files.size(); ifile++) {
+        const auto& row_groups = file_row_groups.at(ifile);
+        for(size_t irg = 0; irg < row_groups.size(); irg++) {
+            int64_t n = summary->RowGroup(row_groups.at(irg))->num_rows();
+            _row_groups.push_back({ifile, static_cast<int>(irg), n});
+            _num_rows += n;
+        } // irg
+        _footers.push_back(summary->Subset(row_groups));
+    } // ifile
+
+    // the arrow schema is restored from the one stored by the writer (with its KeyValueMetadata)
+    PARQUET_THROW_NOT_OK(parquet::arrow::FromParquetSchema(summary->schema(),
+                parquet::ArrowReaderProperties(), summary->key_value_metadata(), &_schema));
+    _leaf_paths = helpers::leaf_paths(_schema);
+    _from_summary = true;
+    return true;
+}
+
+std::unique_ptr<parquet::RowGroupMetaData> DatasetReader::row_group_metadata(const RowGroupTask& task) const {
+    return _footers.at(task.file_index)->RowGroup(task.row_group);
+}
+
+std::vector<int> DatasetReader::leaf_indices(const std::vector<std::string>& paths) const {
+    std::vector<int> out;
+    for(const auto& path : paths) {
+        size_t n_found = 0;
+        for(size_t i = 0; i < _leaf_paths.size(); i++) {
+            const auto& leaf = _leaf_paths.at(i);
+            if(leaf == path || leaf.rfind(path + ".", 0) == 0) {
+                if(std::find(out.begin(), out.end(), i) == out.end()) {
+                    out.push_back(i);
+                }
+                n_found++;
+            }
+        } // i
+        if(n_found == 0) {
+            throw std::runtime_error("ERROR: Column path \"" + path + "\" not found in dataset schema");
+        }
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+void DatasetReader::set_uring(const fileio::UringOptions& options) {
+    _uring = std::make_unique<fileio::UringOptions>(options);
+}
+
+std::unique_ptr<parquet::arrow::FileReader> DatasetReader::open(size_t file_index) const {
+    std::shared_ptr<arrow::io::RandomAccessFile> infile;
+    PARQUET_ASSIGN_OR_THROW(infile, fileio::open_readable_file(_files.at(file_index),
+                memory::pool(memory::Phase::READ), _uring.get()));
+
+    // (the footer of a FooterCache is checked against the file, unlike those of a summary)
+    // the pages are read and decompressed with the READ pool, the Arrow arrays
+    // are built with the DECODE pool
+    parquet::arrow::FileReaderBuilder builder;
+    PARQUET_THROW_NOT_OK(builder.Open(infile, parquet::ReaderProperties(memory::pool(memory::Phase::READ)),
+                _footer_cache ? _footer_cache->footer(_files.at(file_index)) : nullptr));
+    std::unique_ptr<parquet::arrow::FileReader> reader;
+    PARQUET_THROW_NOT_OK(builder.memory_pool(memory::pool(memory::Phase::DECODE))->Build(&reader));
+    return reader;
+}
+
+RowGroupReader::RowGroupReader(const DatasetReader& dataset) :
+    _dataset(dataset),
+    _file_index(0)
+{
+}
+
+void RowGroupReader::open(size_t file_index) {
+    if(!_reader || _file_index != file_index) {
+        _reader = _dataset.open(file_index);
+        _file_index = file_index;
+    }
+}
+
+std::shared_ptr<parquet::FileMetaData> RowGroupReader::metadata(const RowGroupTask& task) {
+    open(task.file_index);
+    return _reader->parquet_reader()->metadata();
+}
+
+std::shared_ptr<arrow::Table> RowGroupReader::read(const RowGroupTask& task, const std::vector<int>& leaves) {
+    open(task.file_index);
+
+    std::shared_ptr<arrow::Table> table;
+    if(leaves.empty()) {
+        PARQUET_THROW_NOT_OK(_reader->ReadRowGroup(task.row_group, &table));
+    } else {
+        PARQUET_THROW_NOT_OK(_reader->ReadRowGroup(task.row_group, leaves, &table));
+    }
+    return table;
+}
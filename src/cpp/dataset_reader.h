@@ -0,0 +1,127 @@
+#pragma once
+
+//std/stl
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+//arrow/parquet
+#include <arrow/api.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/metadata.h>
+
+#include "partitioning.h"
+#include "footer_cache.h"
+#include "uring_file.h"
+
+namespace helpers {
+
+    // dotted paths of all leaf columns in "schema", in Parquet column order,
+    // with list levels elided (e.g. "jets.jets.pt", "event.trigMask")
+    std::vector<std::string> leaf_paths(const std::shared_ptr<arrow::Schema>& schema);
+
+    // the array at the dotted "path" of a table read from a dataset, e.g.
+    // "event.w" (float64) or "jets.jets.pt" (list<float>, keeping the jet
+    // list offsets), concatenating the column chunks if needed
+    std::shared_ptr<arrow::Array> leaf_array(const std::shared_ptr<arrow::Table>& table,
+            const std::string& path);
+
+    // the min/max statistics of a leaf column chunk in a RowGroup as doubles,
+    // returns false if the chunk has no (numeric) min/max statistics
+    bool leaf_min_max(const parquet::RowGroupMetaData& row_group, int leaf, double& min, double& max);
+}; // namespace helpers
+
+// a single RowGroup of a single file in the dataset, the unit of work for readers
+struct RowGroupTask {
+    size_t file_index;
+    int row_group;
+    int64_t num_rows;
+};
+
+class DatasetReader {
+    public:
+        // "path" is either a single Parquet file or a directory of them; a directory
+        // with an up-to-date _metadata summary file (listing all of its files, none of
+        // them modified after it) is planned from that file alone.
+        // The files of Hive-style "key=value" subdirectories are part of the dataset
+        // (see partitioning.h), except for those of the partitions that
+        // "partition_filter" prunes, which are neither listed nor opened. With a
+        // "footer_cache" the footers (and the summary) are taken from the cache
+        // when planning and when opening the files (see FooterCache)
+        DatasetReader(const std::string& path, bool use_summary = true,
+                const partitioning::Filter& partition_filter = partitioning::Filter(),
+                std::shared_ptr<FooterCache> footer_cache = nullptr);
+        ~DatasetReader() = default;
+
+        // the dataset directory (or single file)
+        const std::string& path() const { return _path; }
+        const std::vector<std::string>& files() const { return _files; }
+        // path of a file relative to the dataset directory, e.g. "campaign=mc16d/dsid=410472/dummy_0.parquet"
+        const std::string& relative_path(size_t file_index) const { return _relative_paths.at(file_index); }
+        // number of partition directories skipped by the partition filter
+        size_t pruned_partitions() const { return _n_pruned_partitions; }
+        // true if the dataset was planned from its _metadata summary file
+        bool from_summary() const { return _from_summary; }
+        std::shared_ptr<arrow::Schema> schema() const { return _schema; }
+        const std::vector<RowGroupTask>& row_groups() const { return _row_groups; }
+        int64_t num_rows() const { return _num_rows; }
+
+        // leaf column indices for the dotted "paths", a path naming a struct
+        // or list selects all of the leaves below it
+        std::vector<int> leaf_indices(const std::vector<std::string>& paths) const;
+
+        // the footer of the file at "file_index", and the metadata (including the
+        // column chunk statistics) of a RowGroup, without opening any data file
+        std::shared_ptr<parquet::FileMetaData> footer(size_t file_index) const { return _footers.at(file_index); }
+        std::unique_ptr<parquet::RowGroupMetaData> row_group_metadata(const RowGroupTask& task) const;
+
+        // open a new FileReader for the file at "file_index"; FileReaders are
+        // not thread safe, so each thread should open its own
+        std::unique_ptr<parquet::arrow::FileReader> open(size_t file_index) const;
+
+        // read the files opened from now on through io_uring, with several reads
+        // of each column chunk in flight (see uring_file.h), or with Arrow's
+        // ReadableFile if io_uring is not available [default: ReadableFile]
+        void set_uring(const fileio::UringOptions& options);
+
+    private :
+        std::string _path;
+        bool _use_summary;
+        partitioning::Filter _partition_filter;
+        std::shared_ptr<FooterCache> _footer_cache;
+        std::unique_ptr<fileio::UringOptions> _uring;
+        std::vector<std::string> _files;
+        std::vector<std::string> _relative_paths;
+        size_t _n_pruned_partitions;
+        std::vector<std::shared_ptr<parquet::FileMetaData>> _footers;
+        bool _from_summary;
+        std::shared_ptr<arrow::Schema> _schema;
+        std::vector<std::string> _leaf_paths;
+        std::vector<RowGroupTask> _row_groups;
+        int64_t _num_rows;
+
+        void find_files();
+        void plan();
+        bool plan_from_summary();
+}; // class DatasetReader
+
+// per-thread reader over a DatasetReader that keeps the most recently used file open,
+// so that consecutive RowGroups of the same file do not re-open and re-parse its footer
+class RowGroupReader {
+    public:
+        RowGroupReader(const DatasetReader& dataset);
+        RowGroupReader(RowGroupReader&&) = default;
+        ~RowGroupReader() = default;
+
+        std::shared_ptr<arrow::Table> read(const RowGroupTask& task, const std::vector<int>& leaves);
+        // the footer of the file containing "task"
+        std::shared_ptr<parquet::FileMetaData> metadata(const RowGroupTask& task);
+
+    private :
+        const DatasetReader& _dataset;
+        size_t _file_index;
+        std::unique_ptr<parquet::arrow::FileReader> _reader;
+
+        void open(size_t file_index);
+}; // class RowGroupReader
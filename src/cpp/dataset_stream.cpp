@@ -0,0 +1,112 @@
+#include "dataset_stream.h"
+
+// std/stl
+#include <algorithm>
+
+// arrow/parquet
+#include <arrow/c/abi.h>
+#include <arrow/c/bridge.h>
+#include <parquet/exception.h>
+
+DatasetBatchReader::DatasetBatchReader(std::shared_ptr<DatasetReader> dataset, const std::vector<int>& leaves,
+        size_t n_threads, size_t queue_size) :
+    _dataset(dataset),
+    _leaves(leaves),
+    _queue(queue_size > 0 ? queue_size : 2 * std::max<size_t>(1, n_threads)),
+    _next_read(0),
+    _next_task(0)
+{
+    const auto& tasks = _dataset->row_groups();
+    if(tasks.empty()) {
+        _schema = _dataset->schema();
+        return;
+    }
+
+    // the RowGroups are read by the workers in any order, and handed out in dataset order
+    n_threads = std::max<size_t>(1, std::min(n_threads, tasks.size()));
+    _errors.resize(n_threads);
+    for(size_t ithread = 0; ithread < n_threads; ithread++) {
+        _workers.emplace_back([this, ithread]() {
+            try {
+                RowGroupReader reader(*_dataset);
+                const auto& tasks = _dataset->row_groups();
+                size_t itask;
+                while((itask = _next_read.fetch_add(1)) < tasks.size()) {
+                    if(!_queue.wait_for_slot(itask)) return;
+                    _queue.push(itask, reader.read(tasks.at(itask), _leaves));
+                }
+            } catch(...) {
+                _errors.at(ithread) = std::current_exception();
+                _queue.abort();
+            }
+        });
+    }
+
+    // the schema of the (projected) columns is that of the RowGroups read
+    if(!_queue.pop(_first)) {
+        stop();
+        PARQUET_THROW_NOT_OK(error());
+    }
+    _schema = _first->schema();
+}
+
+DatasetBatchReader::~DatasetBatchReader() {
+    stop();
+}
+
+void DatasetBatchReader::stop() {
+    _queue.abort();
+    for(auto& w : _workers) {
+        if(w.joinable()) w.join();
+    }
+}
+
+arrow::Status DatasetBatchReader::error() const {
+    for(const auto& e : _errors) {
+        if(!e) continue;
+        try {
+            std::rethrow_exception(e);
+        } catch(const std::exception& ex) {
+            return arrow::Status::IOError(ex.what());
+        } catch(...) {
+            return arrow::Status::UnknownError("Unknown error reading \"" + _dataset->path() + "\"");
+        }
+    }
+    return arrow::Status::Cancelled("Reading of \"" + _dataset->path() + "\" was stopped");
+}
+
+arrow::Status DatasetBatchReader::ReadNext(std::shared_ptr<arrow::RecordBatch>* batch) {
+    *batch = nullptr;
+    const auto& tasks = _dataset->row_groups();
+    while(true) {
+        // the batches left of the current RowGroup come first
+        if(_batches) {
+            ARROW_RETURN_NOT_OK(_batches->ReadNext(batch));
+            if(*batch) return arrow::Status::OK();
+            _batches.reset();
+            _table.reset();
+        }
+        if(_next_task >= tasks.size()) return arrow::Status::OK();
+
+        std::shared_ptr<arrow::Table> table = std::move(_first);
+        if(!table && !_queue.pop(table)) {
+            stop();
+            return error();
+        }
+        _next_task++;
+        if(table->num_rows() == 0) continue;
+
+        // (a RowGroup is read as a single chunk per column, unless a column
+        // does not fit in one array, so this is usually a single batch)
+        ARROW_ASSIGN_OR_RAISE(_table, table->CombineChunks());
+        _batches = std::make_unique<arrow::TableBatchReader>(*_table);
+    }
+}
+
+namespace helpers {
+
+void export_stream(std::shared_ptr<arrow::RecordBatchReader> reader, ArrowArrayStream* out) {
+    PARQUET_THROW_NOT_OK(arrow::ExportRecordBatchReader(reader, out));
+}
+
+}; // namespace helpers
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "dataset_reader.h"
+#include "pipeline.h"
+
+//std/stl
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <exception>
+
+//arrow/parquet
+#include <arrow/api.h>
+
+struct ArrowArrayStream;
+
+//
+// The RowGroups of a dataset as a stream of RecordBatches (one per RowGroup,
+// or more if a column of the RowGroup does not fit in one array, in dataset order), read ahead on a few threads: a RecordBatchReader over a
+// DatasetReader, so that the batches read by the C++ reader can be handed to
+// any Arrow consumer, e.g. to Python through the Arrow C stream interface
+// (see export_stream()) without copying or serializing them.
+//
+class DatasetBatchReader : public arrow::RecordBatchReader {
+    public:
+        // "leaves" selects the leaf columns read (see DatasetReader::leaf_indices),
+        // all of them if empty; at most "queue_size" RowGroups are read ahead
+        // (0: twice the number of threads)
+        DatasetBatchReader(std::shared_ptr<DatasetReader> dataset, const std::vector<int>& leaves = {},
+                size_t n_threads = 1, size_t queue_size = 0);
+        ~DatasetBatchReader() override;
+
+        std::shared_ptr<arrow::Schema> schema() const override { return _schema; }
+        arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch>* batch) override;
+
+    private :
+        std::shared_ptr<DatasetReader> _dataset;
+        std::vector<int> _leaves;
+        std::shared_ptr<arrow::Schema> _schema;
+        pipeline::OrderedQueue<std::shared_ptr<arrow::Table>> _queue;
+        std::atomic<size_t> _next_read;
+        size_t _next_task;
+        // the first RowGroup, read to know the schema of the (projected) columns
+        std::shared_ptr<arrow::Table> _first;
+        // the RowGroup being handed out, and the batches of it left
+        std::shared_ptr<arrow::Table> _table;
+        std::unique_ptr<arrow::TableBatchReader> _batches;
+        std::vector<std::thread> _workers;
+        std::vector<std::exception_ptr> _errors;
+
+        // stop (and join) the readers, e.g. after an error or when the consumer is done early
+        void stop();
+        arrow::Status error() const;
+}; // class DatasetBatchReader
+
+namespace helpers {
+
+    //
+    // export the RecordBatches of "reader" to the (caller-allocated) C stream
+    // "out": the consumer owns the stream, and each batch it takes keeps the
+    // buffers read (and the reader, until the stream is released) alive
+    //
+    void export_stream(std::shared_ptr<arrow::RecordBatchReader> reader, ArrowArrayStream* out);
+
+}; // namespace helpers
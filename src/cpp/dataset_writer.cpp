@@ -0,0 +1,167 @@
+#include "dataset_writer.h"
+#include "summary_metadata.h"
+
+// std/stl
+#include <sstream>
+#include <filesystem>
+#include <stdexcept>
+
+// arrow/parquet
+#include <parquet/exception.h>
+
+DatasetWriter::DatasetWriter(const std::string& output_dir, const std::string& dataset_name,
+        int64_t rows_per_group, int64_t rows_per_file, const std::string& compression,
+        std::shared_ptr<const arrow::KeyValueMetadata> metadata,
+        std::shared_ptr<arrow::Schema> schema) :
+    _outdir(output_dir),
+    _dataset_name(dataset_name),
+    _rows_per_group(rows_per_group),
+    _rows_per_file(rows_per_file),
+    _compression(compression),
+    _metadata(metadata),
+    _sort_window(0),
+    _first_file(0),
+    _write_summary(true),
+    _rows_in_file(0),
+    _n_rows(0),
+    _n_row_groups(0),
+    _n_pending(0)
+{
+    if(_rows_per_group <= 0) {
+        throw std::runtime_error("ERROR: Invalid number of rows per RowGroup (" + std::to_string(_rows_per_group) + ")");
+    }
+    if(schema) {
+        _schema = _metadata ? schema->WithMetadata(_metadata) : schema;
+    }
+    std::filesystem::create_directories(_outdir);
+}
+
+void DatasetWriter::set_sort(const std::vector<sorting::SortKey>& keys, int64_t window_row_groups) {
+    if(_n_rows > 0 || _n_pending > 0) {
+        throw std::runtime_error("ERROR: The sort order must be set before writing to the dataset");
+    }
+    if(window_row_groups < 0) {
+        throw std::runtime_error("ERROR: Invalid sort window (" + std::to_string(window_row_groups) + " RowGroups)");
+    }
+    if(_schema) {
+        sorting::check_sort_keys(_schema, keys);
+    }
+    _sort_keys = keys;
+    _sort_window = window_row_groups;
+    _metadata = sorting::with_sort_metadata(_metadata, _sort_keys, _sort_window * _rows_per_group);
+    if(_schema) {
+        _schema = _schema->WithMetadata(_metadata);
+    }
+}
+
+void DatasetWriter::set_first_file(size_t index) {
+    if(!_files.empty()) {
+        throw std::runtime_error("ERROR: The first file index must be set before writing to the dataset");
+    }
+    _first_file = index;
+}
+
+void DatasetWriter::set_write_summary(bool write_summary) {
+    _write_summary = write_summary;
+}
+
+void DatasetWriter::write(const std::shared_ptr<arrow::Table>& table) {
+    if(!_schema) {
+        _schema = _metadata ? table->schema()->WithMetadata(_metadata) : table->schema();
+        sorting::check_sort_keys(_schema, _sort_keys);
+    }
+    if(!table->schema()->Equals(*_schema, false)) {
+        throw std::runtime_error("ERROR: Table schema does not match the output dataset schema:\n"
+                + table->schema()->ToString() + "\nvs.\n" + _schema->ToString());
+    }
+    if(table->num_rows() == 0) return;
+
+    _pending.push_back(table);
+    _n_pending += table->num_rows();
+    if(_sort_keys.empty()) {
+        while(_n_pending >= _rows_per_group) {
+            write_row_group(take_pending(_rows_per_group));
+        }
+    } else if(_sort_window > 0) {
+        int64_t window = _sort_window * _rows_per_group;
+        while(_n_pending >= window) {
+            write_sorted(take_pending(window));
+        }
+    }
+}
+
+void DatasetWriter::close() {
+    if(_n_pending > 0) {
+        if(_sort_keys.empty()) {
+            write_row_group(take_pending(_n_pending));
+        } else {
+            write_sorted(take_pending(_n_pending));
+        }
+    }
+    close_file();
+
+    if(_write_summary && !_files.empty()) {
+        std::vector<std::string> relative_paths;
+        for(const auto& file : _files) {
+            relative_paths.push_back(std::filesystem::path(file).filename().string());
+        }
+        helpers::write_summary_metadata(_outdir, relative_paths, _footers);
+    }
+}
+
+void DatasetWriter::open_file() {
+    std::stringstream outfilename;
+    outfilename << _dataset_name << "_" << _first_file + _files.size() << ".parquet";
+    auto path = (std::filesystem::path(_outdir) / outfilename.str()).string();
+    PARQUET_ASSIGN_OR_THROW(_outfile, arrow::io::FileOutputStream::Open(path));
+    _files.push_back(path);
+    _rows_in_file = 0;
+
+    _writer = TableSink::make(OutputFormat::PARQUET, _outfile, _schema, _compression);
+}
+
+void DatasetWriter::close_file() {
+    if(!_writer) return;
+    _writer->close();
+    PARQUET_THROW_NOT_OK(_outfile->Close());
+    _footers.push_back(_writer->parquet_metadata());
+    _writer.reset();
+    _outfile.reset();
+}
+
+std::shared_ptr<arrow::Table> DatasetWriter::take_pending(int64_t n_rows) {
+    std::shared_ptr<arrow::Table> pending;
+    if(_pending.size() == 1) {
+        pending = _pending.at(0);
+    } else {
+        PARQUET_ASSIGN_OR_THROW(pending, arrow::ConcatenateTables(_pending));
+    }
+    _pending.clear();
+    _n_pending -= n_rows;
+    if(_n_pending > 0) {
+        _pending.push_back(pending->Slice(n_rows));
+    }
+    return pending->Slice(0, n_rows);
+}
+
+void DatasetWriter::write_sorted(const std::shared_ptr<arrow::Table>& table) {
+    auto sorted = sorting::sort_table(table, _sort_keys);
+    for(int64_t offset = 0; offset < sorted->num_rows(); offset += _rows_per_group) {
+        write_row_group(sorted->Slice(offset, _rows_per_group));
+    }
+}
+
+void DatasetWriter::write_row_group(const std::shared_ptr<arrow::Table>& table) {
+    if(_writer && _rows_per_file > 0 && _rows_in_file >= _rows_per_file) {
+        close_file();
+    }
+    if(!_writer) {
+        open_file();
+    }
+
+    int64_t n_rows = table->num_rows();
+    _writer->write(*table, n_rows);
+    _rows_in_file += n_rows;
+    _n_rows += n_rows;
+    _n_row_groups++;
+}
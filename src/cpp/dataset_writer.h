@@ -0,0 +1,94 @@
+#pragma once
+
+//std/stl
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+//arrow/parquet
+#include <arrow/api.h>
+#include <arrow/io/api.h>
+#include <parquet/metadata.h>
+
+#include "table_sink.h"
+#include "sorting.h"
+
+//
+// Writes tables of arbitrary length as a dataset of "<name>_<i>.parquet" files
+// (the same layout as produced by DatasetGenerator) with RowGroups of a fixed
+// number of rows: incoming tables are buffered (without copying) until a full
+// RowGroup is available, so that the output is independent of how the input
+// happened to be batched. A new file is started every "rows_per_file" rows.
+// On close() the _metadata/_common_metadata summary of the files is written.
+//
+// With set_sort() the rows are sorted by a key within windows of a number of
+// RowGroups before they are written (see sorting.h), the window being held in
+// memory; a window of 0 sorts the whole dataset, which is then held in memory
+// until close().
+//
+class DatasetWriter {
+    public:
+        // "metadata" is attached to the schema of every file, e.g. the
+        // KeyValueMetadata written by the generator; if "schema" is null the
+        // schema of the first table written is used
+        DatasetWriter(const std::string& output_dir, const std::string& dataset_name,
+                int64_t rows_per_group, int64_t rows_per_file = 0,
+                const std::string& compression = "UNCOMPRESSED",
+                std::shared_ptr<const arrow::KeyValueMetadata> metadata = nullptr,
+                std::shared_ptr<arrow::Schema> schema = nullptr);
+        ~DatasetWriter() = default;
+
+        // sort the rows by "keys" within windows of "window_row_groups" RowGroups
+        // (0 for the whole dataset), must be called before the first write()
+        void set_sort(const std::vector<sorting::SortKey>& keys, int64_t window_row_groups = 1);
+
+        // number the files from "index" on, e.g. for several writers each writing
+        // some of the files of a dataset [default: 0]
+        void set_first_file(size_t index);
+        // write the _metadata/_common_metadata summary on close() [default: true]
+        void set_write_summary(bool write_summary);
+
+        void write(const std::shared_ptr<arrow::Table>& table);
+        // write out any buffered rows as a last (shorter) RowGroup and close the current file
+        void close();
+
+        std::shared_ptr<arrow::Schema> schema() const { return _schema; }
+        const std::vector<std::string>& files() const { return _files; }
+        // the footers of the files closed so far
+        const std::vector<std::shared_ptr<parquet::FileMetaData>>& footers() const { return _footers; }
+        int64_t num_rows() const { return _n_rows; }
+        int64_t num_row_groups() const { return _n_row_groups; }
+
+    private :
+        std::string _outdir;
+        std::string _dataset_name;
+        int64_t _rows_per_group;
+        int64_t _rows_per_file;
+        std::string _compression;
+        std::shared_ptr<const arrow::KeyValueMetadata> _metadata;
+        std::shared_ptr<arrow::Schema> _schema;
+        std::vector<sorting::SortKey> _sort_keys;
+        int64_t _sort_window;
+
+        std::unique_ptr<TableSink> _writer;
+        std::shared_ptr<arrow::io::OutputStream> _outfile;
+        std::vector<std::string> _files;
+        size_t _first_file;
+        bool _write_summary;
+        std::vector<std::shared_ptr<parquet::FileMetaData>> _footers;
+        int64_t _rows_in_file;
+        int64_t _n_rows;
+        int64_t _n_row_groups;
+
+        // rows waiting to fill up the next RowGroup (or sort window)
+        std::vector<std::shared_ptr<arrow::Table>> _pending;
+        int64_t _n_pending;
+
+        void open_file();
+        void close_file();
+        // the first "n_rows" pending rows, as one (chunked, not copied) table
+        std::shared_ptr<arrow::Table> take_pending(int64_t n_rows);
+        void write_sorted(const std::shared_ptr<arrow::Table>& table);
+        void write_row_group(const std::shared_ptr<arrow::Table>& table);
+}; // class DatasetWriter
@@ -0,0 +1,137 @@
+#include "dataset_reader.h"
+#include "event_index.h"
+#include "table_sink.h"
+
+//std/stl
+#include <iostream>
+#include <sstream>
+#include <cstring> // strcmp
+#include <chrono>
+#include <algorithm> // max
+
+//arrow/parquet
+#include <arrow/io/api.h>
+#include <parquet/exception.h>
+
+void print_usage(char* argv[]) {
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+    std::cout << " Build, update or check the _event_index of a dataset directory (event id -> file," << std::endl;
+    std::cout << " RowGroup and row), or fetch events by id with it" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Usage: " << argv[0] << " [OPTIONS] <input dataset directory>" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Options:" << std::endl;
+    std::cout << "   --key                  Integer leaf column to index [default: \"event.id\"]" << std::endl;
+    std::cout << "   --rebuild              Rebuild the index from scratch rather than updating it for new or modified files" << std::endl;
+    std::cout << "   --check                Only check that the index is up to date (exit code 1 if not)" << std::endl;
+    std::cout << "   -i|--id                Fetch the events with this id, repeat (or separate by commas) for several" << std::endl;
+    std::cout << "   -k|--keep              Column (leaf path or prefix) to fetch, repeat for several [default: all columns]" << std::endl;
+    std::cout << "   -o|--output            Write the events fetched to this Parquet file rather than printing them" << std::endl;
+    std::cout << "   --no-summary           Read the footers of all files rather than the _metadata summary" << std::endl;
+    std::cout << "   -h|--help              Print this help message and exit" << std::endl;
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+}
+
+void print_status(const EventIndex::Status& status) {
+    for(const auto& file : status.added) std::cout << "INFO:   added:    " << file << std::endl;
+    for(const auto& file : status.modified) std::cout << "INFO:   modified: " << file << std::endl;
+    for(const auto& file : status.removed) std::cout << "INFO:   removed:  " << file << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string input = "";
+    std::string key = "event.id";
+    std::string output = "";
+    std::vector<int64_t> ids;
+    std::vector<std::string> keep;
+    bool rebuild = false;
+    bool check = false;
+    bool use_summary = true;
+
+    for(size_t i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "--key") == 0) { key = argv[++i]; }
+        else if (strcmp(argv[i], "--rebuild") == 0) { rebuild = true; }
+        else if (strcmp(argv[i], "--check") == 0) { check = true; }
+        else if (strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--id") == 0) {
+            std::stringstream ss(argv[++i]);
+            std::string item;
+            while(std::getline(ss, item, ',')) {
+                if(!item.empty()) ids.push_back(std::stoll(item));
+            }
+        }
+        else if (strcmp(argv[i], "-k") == 0 || strcmp(argv[i], "--keep") == 0) { keep.push_back(argv[++i]); }
+        else if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--output") == 0) { output = argv[++i]; }
+        else if (strcmp(argv[i], "--no-summary") == 0) { use_summary = false; }
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { print_usage(argv); return 0; }
+        else if (argv[i][0] != '-' && input.empty()) { input = argv[i]; }
+        else {
+            std::cout << argv[0] << " Unknown command line argument provided: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if(input.empty()) {
+        print_usage(argv);
+        return 1;
+    }
+
+    DatasetReader dataset(input, use_summary);
+
+    if(check || !ids.empty()) {
+        auto start = std::chrono::steady_clock::now();
+        auto index = EventIndex::open(input);
+        auto stop = std::chrono::steady_clock::now();
+        if(!index) {
+            std::cout << "ERROR: No " << EventIndex::kIndexFile << " in \"" << input << "\", build it first" << std::endl;
+            return 1;
+        }
+        auto status = index->validate(dataset);
+        if(!status.up_to_date()) {
+            std::cout << "WARNING: The index of \"" << input << "\" is out of date:" << std::endl;
+            print_status(status);
+            if(!check) std::cout << "ERROR: Not fetching events from an out of date index, update it first (run without -i)" << std::endl;
+            return 1;
+        } else {
+            std::cout << "INFO: Index of " << index->size() << " \"" << index->key() << "\" values in "
+                << index->files().size() << " files is up to date (opened in "
+                << std::chrono::duration<double>(stop - start).count() * 1e3 << " ms)" << std::endl;
+        }
+        if(check) return 0;
+
+        std::vector<int> leaves;
+        if(!keep.empty()) {
+            leaves = dataset.leaf_indices(keep);
+        }
+        EventIndex::FetchStats stats;
+        start = std::chrono::steady_clock::now();
+        auto events = index->fetch(dataset, ids, leaves, &stats);
+        stop = std::chrono::steady_clock::now();
+        std::cout << "INFO: Found " << stats.ids_found << " of " << ids.size() << " ids in "
+            << std::chrono::duration<double>(stop - start).count() * 1e3 << " ms, reading " << stats.row_groups_read
+            << " RowGroups (" << stats.column_bytes << " bytes of column chunks)" << std::endl;
+
+        if(!events) return 0;
+        if(!output.empty()) {
+            std::shared_ptr<arrow::io::FileOutputStream> outfile;
+            PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(output));
+            auto sink = TableSink::make(OutputFormat::PARQUET, outfile, events->schema()->WithMetadata(dataset.schema()->metadata()));
+            sink->write(*events, std::max<int64_t>(1, events->num_rows()));
+            sink->close();
+            PARQUET_THROW_NOT_OK(outfile->Close());
+            std::cout << "INFO: Events written to " << output << std::endl;
+        } else {
+            std::cout << events->ToString() << std::endl;
+        }
+        return 0;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto status = EventIndex::build(dataset, key, rebuild);
+    auto stop = std::chrono::steady_clock::now();
+    std::cout << "INFO: Wrote the " << EventIndex::kIndexFile << " of \"" << input << "\" in "
+        << std::chrono::duration<double>(stop - start).count() << " seconds, scanning "
+        << status.added.size() + status.modified.size() << " of " << dataset.files().size() << " files" << std::endl;
+    print_status(status);
+
+    return 0;
+}
@@ -0,0 +1,364 @@
+#include "event_index.h"
+
+// std/stl
+#include <iostream>
+#include <algorithm>
+#include <iterator> // back_inserter
+#include <filesystem>
+#include <map>
+#include <stdexcept>
+#include <cstring> // memcmp
+
+// arrow/parquet
+#include <arrow/compute/api.h>
+#include <parquet/exception.h>
+#include <parquet/schema.h>
+
+//nlohmann
+#include "json.hpp"
+using nlohmann::json;
+
+const std::string EventIndex::kIndexFile = "_event_index";
+
+namespace {
+
+const char kMagic[8] = {'E', 'V', 'T', 'I', 'D', 'X', '0', '1'};
+
+struct Header {
+    char magic[8];
+    uint64_t n_entries;
+    uint64_t keys_offset;
+    uint64_t locations_offset;
+    uint64_t files_offset;
+    uint64_t files_length;
+    uint64_t reserved[2];
+}; // struct Header
+static_assert(sizeof(Header) == 64, "unexpected padding of the index header");
+static_assert(sizeof(EventIndex::Location) == 12, "unexpected padding of the index locations");
+
+struct Entry {
+    int64_t key;
+    EventIndex::Location location;
+
+    bool operator<(const Entry& other) const {
+        if(key != other.key) return key < other.key;
+        if(location.file != other.location.file) return location.file < other.location.file;
+        if(location.row_group != other.location.row_group) return location.row_group < other.location.row_group;
+        return location.row < other.location.row;
+    }
+}; // struct Entry
+
+struct FileInfo {
+    std::string path;
+    int64_t size;
+    int64_t time;
+    int64_t rows;
+}; // struct FileInfo
+
+// the files of "dataset" as recorded in the index
+std::vector<FileInfo> file_infos(const DatasetReader& dataset) {
+    std::vector<FileInfo> out;
+    for(size_t ifile = 0; ifile < dataset.files().size(); ifile++) {
+        std::filesystem::path path(dataset.files().at(ifile));
+        out.push_back({dataset.relative_path(ifile),
+                static_cast<int64_t>(std::filesystem::file_size(path)),
+                static_cast<int64_t>(std::filesystem::last_write_time(path).time_since_epoch().count()),
+                dataset.footer(ifile)->num_rows()});
+    }
+    return out;
+}
+
+std::string dataset_dir(const DatasetReader& dataset) {
+    if(std::filesystem::is_directory(dataset.path())) return dataset.path();
+    return std::filesystem::path(dataset.path()).parent_path().string();
+}
+
+// the keys of "key_leaf" in a RowGroup, as int64
+std::shared_ptr<arrow::Int64Array> read_keys(RowGroupReader& reader, const RowGroupTask& task, int key_leaf,
+        const std::string& key) {
+    auto keys = helpers::leaf_array(reader.read(task, {key_leaf}), key);
+    std::shared_ptr<arrow::Array> values;
+    PARQUET_ASSIGN_OR_THROW(values, arrow::compute::Cast(*keys, arrow::int64(), arrow::compute::CastOptions::Unsafe()));
+    return std::static_pointer_cast<arrow::Int64Array>(values);
+}
+
+} // namespace
+
+EventIndex::Status EventIndex::build(const DatasetReader& dataset, const std::string& key, bool rebuild) {
+    auto leaves = dataset.leaf_indices({key});
+    auto descr = dataset.footer(0)->schema()->Column(leaves.at(0));
+    if(leaves.size() != 1 || descr->max_repetition_level() != 0
+            || (descr->physical_type() != parquet::Type::INT32 && descr->physical_type() != parquet::Type::INT64)) {
+        throw std::runtime_error("ERROR: Index key \"" + key + "\" is not a per-row integer leaf column");
+    }
+    int key_leaf = leaves.at(0);
+
+    auto dir = dataset_dir(dataset);
+    auto files = file_infos(dataset);
+    auto existing = rebuild ? nullptr : EventIndex::open(dir);
+    if(existing && existing->key() != key) {
+        std::cout << "WARNING: Existing index of \"" << dir << "\" is for \"" << existing->key()
+            << "\", rebuilding it for \"" << key << "\"" << std::endl;
+        existing.reset();
+    }
+
+    // the entries of the files that have not changed are kept (with the file numbers of the dataset)
+    Status status;
+    std::vector<bool> scan(files.size(), true);
+    std::vector<Entry> kept;
+    if(existing) {
+        status = existing->validate(dataset);
+        std::map<std::string, uint32_t> dataset_file;
+        for(size_t ifile = 0; ifile < files.size(); ifile++) {
+            dataset_file[files.at(ifile).path] = ifile;
+        }
+        std::vector<int64_t> remap(existing->files().size(), -1);
+        for(size_t ifile = 0; ifile < existing->files().size(); ifile++) {
+            const auto& name = existing->files().at(ifile);
+            if(std::find(status.modified.begin(), status.modified.end(), name) != status.modified.end()) continue;
+            auto it = dataset_file.find(name);
+            if(it == dataset_file.end()) continue;
+            remap.at(ifile) = it->second;
+            scan.at(it->second) = false;
+        }
+        for(int64_t i = 0; i < existing->size(); i++) {
+            auto location = existing->_locations[i];
+            if(remap.at(location.file) < 0) continue;
+            location.file = static_cast<uint32_t>(remap.at(location.file));
+            kept.push_back({existing->_keys[i], location});
+        }
+        existing.reset();
+    } else {
+        for(const auto& file : files) {
+            status.added.push_back(file.path);
+        }
+    }
+
+    // the keys of the new and modified files, from their key column alone
+    std::vector<Entry> scanned;
+    RowGroupReader reader(dataset);
+    for(const auto& task : dataset.row_groups()) {
+        if(!scan.at(task.file_index)) continue;
+        auto keys = read_keys(reader, task, key_leaf, key);
+        for(int64_t row = 0; row < keys->length(); row++) {
+            if(keys->IsNull(row)) continue;
+            scanned.push_back({keys->Value(row), {static_cast<uint32_t>(task.file_index),
+                    static_cast<uint32_t>(task.row_group), static_cast<uint32_t>(row)}});
+        }
+    }
+    std::sort(scanned.begin(), scanned.end());
+    // (re-numbering the files may have re-ordered entries with the same key)
+    std::sort(kept.begin(), kept.end());
+    std::vector<Entry> entries;
+    entries.reserve(kept.size() + scanned.size());
+    std::merge(kept.begin(), kept.end(), scanned.begin(), scanned.end(), std::back_inserter(entries));
+    kept = std::vector<Entry>();
+    scanned = std::vector<Entry>();
+
+    // written next to the final file and then moved over it, so that readers
+    // (which may have the old index mapped) never see a partial file
+    json j_files;
+    j_files["key"] = key;
+    j_files["files"] = json::array();
+    for(const auto& file : files) {
+        j_files["files"].push_back({{"path", file.path}, {"size", file.size}, {"time", file.time}, {"rows", file.rows}});
+    }
+    auto files_json = j_files.dump();
+
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.n_entries = entries.size();
+    header.keys_offset = sizeof(Header);
+    header.locations_offset = header.keys_offset + entries.size() * sizeof(int64_t);
+    header.files_offset = header.locations_offset + entries.size() * sizeof(Location);
+    header.files_length = files_json.size();
+    header.reserved[0] = header.reserved[1] = 0;
+
+    auto path = std::filesystem::path(dir) / kIndexFile;
+    auto tmp_path = std::filesystem::path(dir) / (kIndexFile + ".tmp");
+    std::shared_ptr<arrow::io::FileOutputStream> outfile;
+    PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(tmp_path.string()));
+    PARQUET_THROW_NOT_OK(outfile->Write(&header, sizeof(header)));
+    std::vector<int64_t> keys;
+    std::vector<Location> locations;
+    const size_t chunk = 1 << 16;
+    for(size_t start = 0; start < entries.size(); start += chunk) {
+        keys.clear();
+        for(size_t i = start; i < std::min(entries.size(), start + chunk); i++) keys.push_back(entries[i].key);
+        PARQUET_THROW_NOT_OK(outfile->Write(keys.data(), keys.size() * sizeof(int64_t)));
+    }
+    for(size_t start = 0; start < entries.size(); start += chunk) {
+        locations.clear();
+        for(size_t i = start; i < std::min(entries.size(), start + chunk); i++) locations.push_back(entries[i].location);
+        PARQUET_THROW_NOT_OK(outfile->Write(locations.data(), locations.size() * sizeof(Location)));
+    }
+    PARQUET_THROW_NOT_OK(outfile->Write(files_json.data(), files_json.size()));
+    PARQUET_THROW_NOT_OK(outfile->Close());
+    std::filesystem::rename(tmp_path, path);
+    return status;
+}
+
+std::unique_ptr<EventIndex> EventIndex::open(const std::string& dataset_dir) {
+    auto path = std::filesystem::path(dataset_dir) / kIndexFile;
+    if(!std::filesystem::is_regular_file(path)) {
+        return nullptr;
+    }
+    std::unique_ptr<EventIndex> index(new EventIndex());
+    PARQUET_ASSIGN_OR_THROW(index->_mapped, arrow::io::MemoryMappedFile::Open(path.string(), arrow::io::FileMode::READ));
+    int64_t file_size;
+    PARQUET_ASSIGN_OR_THROW(file_size, index->_mapped->GetSize());
+
+    std::shared_ptr<arrow::Buffer> buffer;
+    PARQUET_ASSIGN_OR_THROW(buffer, index->_mapped->ReadAt(0, sizeof(Header)));
+    Header header;
+    if(buffer->size() != sizeof(Header)) {
+        throw std::runtime_error("ERROR: Event index \"" + path.string() + "\" is truncated");
+    }
+    std::memcpy(&header, buffer->data(), sizeof(Header));
+    if(std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0
+            || header.locations_offset != header.keys_offset + header.n_entries * sizeof(int64_t)
+            || header.files_offset != header.locations_offset + header.n_entries * sizeof(Location)
+            || static_cast<int64_t>(header.files_offset + header.files_length) != file_size) {
+        throw std::runtime_error("ERROR: Event index \"" + path.string() + "\" is corrupt");
+    }
+
+    // the keys and locations are used in place, from the mapped memory
+    index->_size = static_cast<int64_t>(header.n_entries);
+    PARQUET_ASSIGN_OR_THROW(index->_keys_buffer, index->_mapped->ReadAt(header.keys_offset, header.n_entries * sizeof(int64_t)));
+    PARQUET_ASSIGN_OR_THROW(index->_locations_buffer, index->_mapped->ReadAt(header.locations_offset, header.n_entries * sizeof(Location)));
+    index->_keys = reinterpret_cast<const int64_t*>(index->_keys_buffer->data());
+    index->_locations = reinterpret_cast<const Location*>(index->_locations_buffer->data());
+
+    PARQUET_ASSIGN_OR_THROW(buffer, index->_mapped->ReadAt(header.files_offset, header.files_length));
+    auto j_files = json::parse(buffer->data(), buffer->data() + buffer->size());
+    index->_key = j_files.at("key").get<std::string>();
+    for(const auto& j : j_files.at("files")) {
+        index->_files.push_back(j.at("path").get<std::string>());
+        index->_file_sizes.push_back(j.at("size").get<int64_t>());
+        index->_file_times.push_back(j.at("time").get<int64_t>());
+        index->_file_rows.push_back(j.at("rows").get<int64_t>());
+    }
+    return index;
+}
+
+EventIndex::Status EventIndex::validate(const DatasetReader& dataset) const {
+    Status status;
+    std::map<std::string, size_t> indexed;
+    for(size_t ifile = 0; ifile < _files.size(); ifile++) {
+        indexed[_files.at(ifile)] = ifile;
+    }
+    for(const auto& file : file_infos(dataset)) {
+        auto it = indexed.find(file.path);
+        if(it == indexed.end()) {
+            status.added.push_back(file.path);
+            continue;
+        }
+        size_t i = it->second;
+        if(file.size != _file_sizes.at(i) || file.time != _file_times.at(i) || file.rows != _file_rows.at(i)) {
+            status.modified.push_back(file.path);
+        }
+        indexed.erase(it);
+    }
+    for(const auto& file : indexed) {
+        status.removed.push_back(file.first);
+    }
+    return status;
+}
+
+std::vector<EventIndex::Location> EventIndex::find(int64_t id) const {
+    auto range = std::equal_range(_keys, _keys + _size, id);
+    return std::vector<Location>(_locations + (range.first - _keys), _locations + (range.second - _keys));
+}
+
+std::shared_ptr<arrow::Table> EventIndex::fetch(const DatasetReader& dataset, const std::vector<int64_t>& ids,
+        const std::vector<int>& leaves, FetchStats* stats) const {
+    FetchStats local_stats;
+    if(!stats) stats = &local_stats;
+
+    // the files of the index as files of "dataset", unchanged since it was
+    // written (a file rewritten with as many rows holds other events)
+    auto infos = file_infos(dataset);
+    std::map<std::string, size_t> dataset_file;
+    for(size_t ifile = 0; ifile < infos.size(); ifile++) {
+        dataset_file[infos.at(ifile).path] = ifile;
+    }
+    std::vector<size_t> file_index;
+    for(size_t ifile = 0; ifile < _files.size(); ifile++) {
+        auto it = dataset_file.find(_files.at(ifile));
+        if(it == dataset_file.end() || infos.at(it->second).size != _file_sizes.at(ifile)
+                || infos.at(it->second).time != _file_times.at(ifile) || infos.at(it->second).rows != _file_rows.at(ifile)) {
+            throw std::runtime_error("ERROR: Event index is out of date (\"" + _files.at(ifile)
+                    + "\" is missing or has changed), rebuild it");
+        }
+        file_index.push_back(it->second);
+    }
+
+    // the rows to fetch, ordered by their position in the dataset
+    struct Request {
+        size_t file;
+        uint32_t row_group;
+        uint32_t row;
+        size_t position;    // in the output
+    };
+    std::vector<Request> requests;
+    for(const auto& id : ids) {
+        auto locations = find(id);
+        if(!locations.empty()) stats->ids_found++;
+        for(const auto& location : locations) {
+            requests.push_back({file_index.at(location.file), location.row_group, location.row, requests.size()});
+        }
+    }
+    if(requests.empty()) {
+        return nullptr;
+    }
+    std::sort(requests.begin(), requests.end(), [](const Request& a, const Request& b) {
+        if(a.file != b.file) return a.file < b.file;
+        if(a.row_group != b.row_group) return a.row_group < b.row_group;
+        return a.row < b.row;
+    });
+
+    // each RowGroup is read once, for all of its requested rows
+    RowGroupReader reader(dataset);
+    std::vector<std::shared_ptr<arrow::Table>> tables;
+    std::vector<int64_t> positions;
+    for(size_t begin = 0; begin < requests.size(); ) {
+        size_t end = begin;
+        arrow::Int64Builder rows;
+        while(end < requests.size() && requests[end].file == requests[begin].file
+                && requests[end].row_group == requests[begin].row_group) {
+            PARQUET_THROW_NOT_OK(rows.Append(requests[end].row));
+            positions.push_back(requests[end].position);
+            end++;
+        }
+        RowGroupTask task{requests[begin].file, static_cast<int>(requests[begin].row_group), 0};
+        auto row_group = dataset.row_group_metadata(task);
+        for(int leaf = 0; leaf < row_group->num_columns(); leaf++) {
+            if(leaves.empty() || std::find(leaves.begin(), leaves.end(), leaf) != leaves.end()) {
+                stats->column_bytes += row_group->ColumnChunk(leaf)->total_compressed_size();
+            }
+        }
+        stats->row_groups_read++;
+
+        std::shared_ptr<arrow::Array> indices;
+        PARQUET_THROW_NOT_OK(rows.Finish(&indices));
+        arrow::Datum taken;
+        PARQUET_ASSIGN_OR_THROW(taken, arrow::compute::Take(reader.read(task, leaves), indices));
+        tables.push_back(taken.table());
+        begin = end;
+    }
+    std::shared_ptr<arrow::Table> table;
+    PARQUET_ASSIGN_OR_THROW(table, arrow::ConcatenateTables(tables));
+
+    // back into the order requested
+    std::vector<int64_t> order(positions.size());
+    for(size_t i = 0; i < positions.size(); i++) {
+        order[positions[i]] = static_cast<int64_t>(i);
+    }
+    arrow::Int64Builder builder;
+    PARQUET_THROW_NOT_OK(builder.AppendValues(order));
+    std::shared_ptr<arrow::Array> indices;
+    PARQUET_THROW_NOT_OK(builder.Finish(&indices));
+    arrow::Datum taken;
+    PARQUET_ASSIGN_OR_THROW(taken, arrow::compute::Take(table, indices));
+    return taken.table();
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "dataset_reader.h"
+
+//std/stl
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+//arrow/parquet
+#include <arrow/api.h>
+#include <arrow/io/api.h>
+
+//
+// Exact random access to the events of a dataset directory by their id (or
+// another per-row integer "key" column): the _event_index sidecar holds all
+// keys of the dataset sorted, each with the file, RowGroup and row it is in,
+// so that an id is found with a binary search and only the RowGroups holding
+// the requested events are read. The file is laid out to be memory-mapped as
+// is (so opening it costs nothing however large it is):
+//
+//      header      "EVTIDX01", the number of entries and the offsets below
+//      keys        n x int64, sorted
+//      locations   n x (uint32 file, uint32 RowGroup, uint32 row), in key order
+//      files       JSON: the key column and, per file, its path (relative to
+//                  the dataset directory), size, modification time and rows
+//
+// The files are recorded so that the index can be validated against the
+// dataset and updated incrementally, re-scanning only new or modified files.
+//
+class EventIndex {
+    public:
+        struct Location {
+            uint32_t file;          // index into files()
+            uint32_t row_group;
+            uint32_t row;           // row within the RowGroup
+        };
+
+        // the differences between the files of a dataset and those of its index
+        struct Status {
+            std::vector<std::string> added;
+            std::vector<std::string> removed;
+            std::vector<std::string> modified;
+            bool up_to_date() const { return added.empty() && removed.empty() && modified.empty(); }
+        };
+
+        // what a fetch() touched
+        struct FetchStats {
+            size_t ids_found = 0;
+            size_t row_groups_read = 0;
+            int64_t column_bytes = 0;       // compressed bytes of the column chunks read
+        };
+
+        static const std::string kIndexFile;
+
+        //
+        // write the index of the directory of "dataset"; unless "rebuild" an
+        // existing index of the same key is updated, scanning (the key column
+        // of) only the files that are new or have changed since it was written
+        //
+        static Status build(const DatasetReader& dataset, const std::string& key = "event.id", bool rebuild = false);
+
+        // memory-map the index of "dataset_dir", nullptr if there is none
+        static std::unique_ptr<EventIndex> open(const std::string& dataset_dir);
+        ~EventIndex() = default;
+
+        const std::string& key() const { return _key; }
+        int64_t size() const { return _size; }
+        const std::vector<std::string>& files() const { return _files; }
+
+        // the files added, removed or modified since the index was written
+        Status validate(const DatasetReader& dataset) const;
+
+        // the locations of the events with key "id" (none if it is not in the dataset)
+        std::vector<Location> find(int64_t id) const;
+
+        //
+        // the events with the keys "ids" (those not in the index are skipped),
+        // in the order requested, with the "leaves" (all if empty); each
+        // RowGroup holding any of them is read once; throws if any file of the
+        // index is missing from "dataset" or has changed since it was written
+        //
+        std::shared_ptr<arrow::Table> fetch(const DatasetReader& dataset, const std::vector<int64_t>& ids,
+                const std::vector<int>& leaves = {}, FetchStats* stats = nullptr) const;
+
+    private :
+        std::string _key;
+        int64_t _size;
+        std::vector<std::string> _files;
+        std::vector<int64_t> _file_sizes;
+        std::vector<int64_t> _file_times;
+        std::vector<int64_t> _file_rows;
+        // views into the memory-mapped file
+        std::shared_ptr<arrow::io::MemoryMappedFile> _mapped;
+        std::shared_ptr<arrow::Buffer> _keys_buffer;
+        std::shared_ptr<arrow::Buffer> _locations_buffer;
+        const int64_t* _keys;
+        const Location* _locations;
+
+        EventIndex() = default;
+}; // class EventIndex
@@ -0,0 +1,373 @@
+#include "event_layout.h"
+#include "memory_pool.h"
+
+// std/stl
+#include <algorithm>
+#include <cstring> // memcpy
+#include <limits>
+#include <stdexcept>
+
+// arrow/parquet
+#include <parquet/exception.h>
+
+namespace helpers {
+
+Layout layout(const std::string& name) {
+    if(name == "nested") return Layout::NESTED;
+    if(name == "jagged") return Layout::JAGGED;
+    if(name == "padded") return Layout::PADDED;
+    if(name == "flat") return Layout::FLAT;
+    throw std::runtime_error("ERROR: Invalid layout \"" + name + "\" (options: nested, jagged, padded, flat)");
+}
+
+std::string layout_name(Layout layout) {
+    switch(layout) {
+        case Layout::NESTED : return "nested";
+        case Layout::JAGGED : return "jagged";
+        case Layout::PADDED : return "padded";
+        case Layout::FLAT : return "flat";
+    }
+    return "";
+}
+
+}; // namespace helpers
+
+void EventBuffers::clear() {
+    lep_n.clear();
+    lep_offsets.assign(1, 0);
+    lep_pt.clear();
+    lep_eta.clear();
+    lep_phi.clear();
+    lep_flavor.clear();
+    lep_isLoose.clear();
+    lep_isMedium.clear();
+    lep_isTight.clear();
+    lep_isTrigMatched.clear();
+
+    jet_n.clear();
+    jet_offsets.assign(1, 0);
+    jet_pt.clear();
+    jet_eta.clear();
+    jet_phi.clear();
+    jet_m.clear();
+    jet_truthHadronPt.clear();
+    jet_truthHadronId.clear();
+    jet_nTrk.clear();
+    jet_isBjet.clear();
+    jet_bTagScore.clear();
+
+    met_sumEt.clear();
+    met_met.clear();
+    met_metPhi.clear();
+    met_electronTerm.clear();
+    met_muonTerm.clear();
+    met_jetTerm.clear();
+    met_softTerm.clear();
+
+    event_w.clear();
+    event_sumw2.clear();
+    event_id.clear();
+    event_trigMask.clear();
+}
+
+namespace {
+
+//
+// A per-object or per-event quantity of EventBuffers: "length" entries of one
+// value each or, if list_width > 0, of a fixed-length list of values each
+//
+struct Leaf {
+    std::string name;
+    std::shared_ptr<arrow::DataType> type; // of the values, booleans are stored as bytes
+    const uint8_t* data;
+    int64_t length;
+    int list_width;
+
+    size_t value_bytes() const {
+        if(type->id() == arrow::Type::BOOL) return 1;
+        return static_cast<const arrow::FixedWidthType&>(*type).bit_width() / 8;
+    }
+    size_t entry_bytes() const { return value_bytes() * std::max(1, list_width); }
+};
+
+template<typename T>
+Leaf make_leaf(const std::string& name, const std::shared_ptr<arrow::DataType>& type,
+        const std::vector<T>& values, int list_width = 0) {
+    int64_t length = list_width > 0 ? values.size() / list_width : values.size();
+    return {name, type, reinterpret_cast<const uint8_t*>(values.data()), length, list_width};
+}
+
+// the objects of one collection
+struct Collection {
+    std::string name;   // of the NESTED struct column and its list field
+    std::string prefix; // of the JAGGED/PADDED/FLAT columns
+    int max_objects;
+    const std::vector<uint8_t>& n;
+    const std::vector<int32_t>& offsets;
+    std::vector<Leaf> leaves;
+};
+
+Collection leptons(const EventBuffers& b) {
+    return {"leptons", "lep", EventBuffers::kMaxLeptons, b.lep_n, b.lep_offsets, {
+        make_leaf("pt", arrow::float32(), b.lep_pt),
+        make_leaf("eta", arrow::float32(), b.lep_eta),
+        make_leaf("phi", arrow::float32(), b.lep_phi),
+        make_leaf("flavor", arrow::int8(), b.lep_flavor),
+        make_leaf("isLoose", arrow::boolean(), b.lep_isLoose),
+        make_leaf("isMedium", arrow::boolean(), b.lep_isMedium),
+        make_leaf("isTight", arrow::boolean(), b.lep_isTight),
+        make_leaf("isTrigMatched", arrow::boolean(), b.lep_isTrigMatched, EventBuffers::kLeptonTrigBits)
+    }};
+}
+
+Collection jets(const EventBuffers& b) {
+    return {"jets", "jet", EventBuffers::kMaxJets, b.jet_n, b.jet_offsets, {
+        make_leaf("pt", arrow::float32(), b.jet_pt),
+        make_leaf("eta", arrow::float32(), b.jet_eta),
+        make_leaf("phi", arrow::float32(), b.jet_phi),
+        make_leaf("m", arrow::float32(), b.jet_m),
+        make_leaf("truthHadronPt", arrow::float32(), b.jet_truthHadronPt),
+        make_leaf("truthHadronId", arrow::float32(), b.jet_truthHadronId),
+        make_leaf("nTrk", arrow::uint8(), b.jet_nTrk),
+        make_leaf("isBjet", arrow::boolean(), b.jet_isBjet),
+        make_leaf("bTagScore", arrow::float32(), b.jet_bTagScore)
+    }};
+}
+
+std::vector<Leaf> met_leaves(const EventBuffers& b) {
+    return {
+        make_leaf("sumEt", arrow::float32(), b.met_sumEt),
+        make_leaf("met", arrow::float32(), b.met_met),
+        make_leaf("metPhi", arrow::float32(), b.met_metPhi),
+        make_leaf("electronTerm", arrow::float32(), b.met_electronTerm),
+        make_leaf("muonTerm", arrow::float32(), b.met_muonTerm),
+        make_leaf("jetTerm", arrow::float32(), b.met_jetTerm),
+        make_leaf("softTerm", arrow::float32(), b.met_softTerm)
+    };
+}
+
+std::vector<Leaf> event_leaves(const EventBuffers& b) {
+    return {
+        make_leaf("w", arrow::float64(), b.event_w),
+        make_leaf("sumw2", arrow::float64(), b.event_sumw2),
+        make_leaf("id", arrow::uint64(), b.event_id),
+        make_leaf("trigMask", arrow::boolean(), b.event_trigMask, EventBuffers::kEventTrigBits)
+    };
+}
+
+// a non-owning view of (buffered) memory
+std::shared_ptr<arrow::Buffer> wrap(const void* data, int64_t size) {
+    return std::make_shared<arrow::Buffer>(reinterpret_cast<const uint8_t*>(data), size);
+}
+
+std::shared_ptr<arrow::Buffer> allocate(int64_t size) {
+    std::shared_ptr<arrow::Buffer> buffer;
+    PARQUET_ASSIGN_OR_THROW(buffer, arrow::AllocateBuffer(size, memory::pool(memory::Phase::CONVERT)));
+    return buffer;
+}
+
+// one byte per boolean -> Arrow validity-style bitmap (LSB first)
+std::shared_ptr<arrow::Buffer> pack_bits(const uint8_t* bytes, int64_t n) {
+    auto bits = allocate((n + 7) / 8);
+    uint8_t* out = bits->mutable_data();
+    std::memset(out, 0, bits->size());
+    for(int64_t i = 0; i < n; i++) {
+        out[i / 8] |= static_cast<uint8_t>((bytes[i] != 0) << (i % 8));
+    }
+    return bits;
+}
+
+std::shared_ptr<arrow::Array> values_array(const std::shared_ptr<arrow::DataType>& type,
+        std::shared_ptr<arrow::Buffer> data, int64_t length) {
+    if(type->id() == arrow::Type::BOOL) {
+        data = pack_bits(data->data(), length);
+    }
+    return arrow::MakeArray(arrow::ArrayData::Make(type, length, {nullptr, data}, 0));
+}
+
+std::shared_ptr<arrow::Array> list_array(const std::shared_ptr<arrow::Array>& values,
+        std::shared_ptr<arrow::Buffer> offsets, int64_t length) {
+    return std::make_shared<arrow::ListArray>(arrow::list(values->type()), length, offsets, values);
+}
+
+// offsets of "length" lists of "width" values each
+std::shared_ptr<arrow::Buffer> fixed_offsets(int64_t length, int width) {
+    auto offsets = allocate((length + 1) * sizeof(int32_t));
+    auto* out = reinterpret_cast<int32_t*>(offsets->mutable_data());
+    for(int64_t i = 0; i <= length; i++) {
+        out[i] = static_cast<int32_t>(i * width);
+    }
+    return offsets;
+}
+
+// "n_entries" entries of "leaf" (stored in "data") as an array
+std::shared_ptr<arrow::Array> entry_array(const Leaf& leaf, std::shared_ptr<arrow::Buffer> data, int64_t n_entries) {
+    if(leaf.list_width == 0) {
+        return values_array(leaf.type, data, n_entries);
+    }
+    auto values = values_array(leaf.type, data, n_entries * leaf.list_width);
+    return list_array(values, fixed_offsets(n_entries, leaf.list_width), n_entries);
+}
+
+std::shared_ptr<arrow::Array> entry_array(const Leaf& leaf) {
+    return entry_array(leaf, wrap(leaf.data, leaf.length * leaf.entry_bytes()), leaf.length);
+}
+
+//
+// For each event, the entries of its objects in slots [first, first + width)
+// placed in "width" consecutive entries of the output, missing objects padded
+// with NaN (floating point) or 0/false (anything else)
+//
+std::shared_ptr<arrow::Buffer> gather(const Leaf& leaf, const std::vector<int32_t>& offsets,
+        int64_t n_events, int first, int width) {
+    const size_t entry_bytes = leaf.entry_bytes();
+    auto out = allocate(n_events * width * entry_bytes);
+    uint8_t* dst = out->mutable_data();
+    const int64_t n_values = n_events * width * std::max(1, leaf.list_width);
+    if(leaf.type->id() == arrow::Type::FLOAT) {
+        std::fill_n(reinterpret_cast<float*>(dst), n_values, std::numeric_limits<float>::quiet_NaN());
+    } else if(leaf.type->id() == arrow::Type::DOUBLE) {
+        std::fill_n(reinterpret_cast<double*>(dst), n_values, std::numeric_limits<double>::quiet_NaN());
+    } else {
+        std::memset(dst, 0, out->size());
+    }
+    for(int64_t i = 0; i < n_events; i++) {
+        int64_t begin = offsets[i] + first;
+        int64_t end = std::min<int64_t>(offsets[i + 1], begin + width);
+        if(end > begin) {
+            std::memcpy(dst + i * width * entry_bytes, leaf.data + begin * entry_bytes, (end - begin) * entry_bytes);
+        }
+    }
+    return out;
+}
+
+// fixed-length bit lists (one byte per bit) packed into one unsigned integer per entry
+std::shared_ptr<arrow::Array> bits_array(const Leaf& leaf, const std::shared_ptr<arrow::Buffer>& data, int64_t n_entries) {
+    const int width = leaf.list_width;
+    std::shared_ptr<arrow::DataType> type = width <= 8 ? arrow::uint8() : width <= 16 ? arrow::uint16()
+                                            : width <= 32 ? arrow::uint32() : arrow::uint64();
+    const int value_bytes = static_cast<const arrow::FixedWidthType&>(*type).bit_width() / 8;
+    auto out = allocate(n_entries * value_bytes);
+    const uint8_t* src = data->data();
+    for(int64_t i = 0; i < n_entries; i++) {
+        uint64_t value = 0;
+        for(int j = 0; j < width; j++) {
+            value |= static_cast<uint64_t>(src[i * width + j] != 0) << j;
+        }
+        // little-endian: the low bytes of the 64 bit value
+        std::memcpy(out->mutable_data() + i * value_bytes, &value, value_bytes);
+    }
+    return values_array(type, out, n_entries);
+}
+
+// per-event "is a real object" flags of a collection, padded to its maximum multiplicity
+std::shared_ptr<arrow::Array> mask_array(const Collection& c, int64_t n_events) {
+    auto mask = allocate(n_events * c.max_objects);
+    uint8_t* out = mask->mutable_data();
+    for(int64_t i = 0; i < n_events; i++) {
+        for(int j = 0; j < c.max_objects; j++) {
+            out[i * c.max_objects + j] = j < c.n[i];
+        }
+    }
+    return list_array(values_array(arrow::boolean(), mask, n_events * c.max_objects),
+            fixed_offsets(n_events, c.max_objects), n_events);
+}
+
+std::shared_ptr<arrow::Array> struct_array(const std::vector<std::string>& names,
+        const std::vector<std::shared_ptr<arrow::Array>>& children, int64_t length) {
+    std::vector<std::shared_ptr<arrow::Field>> fields;
+    for(size_t i = 0; i < names.size(); i++) {
+        fields.push_back(arrow::field(names.at(i), children.at(i)->type()));
+    }
+    return std::make_shared<arrow::StructArray>(arrow::struct_(fields), length, children);
+}
+
+std::shared_ptr<arrow::Array> struct_array(const std::vector<Leaf>& leaves, int64_t length) {
+    std::vector<std::string> names;
+    std::vector<std::shared_ptr<arrow::Array>> children;
+    for(const auto& leaf : leaves) {
+        names.push_back(leaf.name);
+        children.push_back(entry_array(leaf));
+    }
+    return struct_array(names, children, length);
+}
+
+struct Columns {
+    std::vector<std::shared_ptr<arrow::Field>> fields;
+    std::vector<std::shared_ptr<arrow::Array>> arrays;
+
+    void add(const std::string& name, const std::shared_ptr<arrow::Array>& array) {
+        fields.push_back(arrow::field(name, array->type()));
+        arrays.push_back(array);
+    }
+}; // struct Columns
+
+void add_collection(Columns& columns, Layout layout, const Collection& c, int64_t n_events) {
+    const int64_t n_objects = c.offsets.back();
+    auto n = values_array(arrow::uint8(), wrap(c.n.data(), n_events), n_events);
+    auto offsets = wrap(c.offsets.data(), (n_events + 1) * sizeof(int32_t));
+
+    if(layout == Layout::NESTED) {
+        auto objects = list_array(struct_array(c.leaves, n_objects), offsets, n_events);
+        columns.add(c.name, struct_array({"n", c.name}, {n, objects}, n_events));
+        return;
+    }
+
+    columns.add(c.prefix + "_n", n);
+    if(layout == Layout::JAGGED) {
+        for(const auto& leaf : c.leaves) {
+            columns.add(c.prefix + "_" + leaf.name, list_array(entry_array(leaf), offsets, n_events));
+        }
+    } else if(layout == Layout::PADDED) {
+        columns.add(c.prefix + "_mask", mask_array(c, n_events));
+        auto padded_offsets = fixed_offsets(n_events, c.max_objects);
+        for(const auto& leaf : c.leaves) {
+            auto padded = gather(leaf, c.offsets, n_events, 0, c.max_objects);
+            columns.add(c.prefix + "_" + leaf.name,
+                    list_array(entry_array(leaf, padded, n_events * c.max_objects), padded_offsets, n_events));
+        }
+    } else {
+        for(int slot = 0; slot < c.max_objects; slot++) {
+            for(const auto& leaf : c.leaves) {
+                auto column = gather(leaf, c.offsets, n_events, slot, 1);
+                columns.add(c.prefix + std::to_string(slot) + "_" + leaf.name,
+                        leaf.list_width > 0 ? bits_array(leaf, column, n_events) : entry_array(leaf, column, n_events));
+            }
+        }
+    }
+}
+
+void add_per_event(Columns& columns, Layout layout, const std::string& name, const std::vector<Leaf>& leaves, int64_t n_events) {
+    if(layout == Layout::NESTED) {
+        columns.add(name, struct_array(leaves, n_events));
+        return;
+    }
+    for(const auto& leaf : leaves) {
+        if(layout == Layout::FLAT && leaf.list_width > 0) {
+            columns.add(name + "_" + leaf.name, bits_array(leaf, wrap(leaf.data, leaf.length * leaf.entry_bytes()), n_events));
+        } else {
+            columns.add(name + "_" + leaf.name, entry_array(leaf));
+        }
+    }
+}
+
+}; // namespace
+
+namespace helpers {
+
+std::shared_ptr<arrow::Schema> layout_schema(Layout layout) {
+    EventBuffers empty;
+    return layout_table(layout, empty)->schema();
+}
+
+std::shared_ptr<arrow::Table> layout_table(Layout layout, const EventBuffers& buffers) {
+    const int64_t n_events = buffers.n_events();
+    Columns columns;
+    add_collection(columns, layout, leptons(buffers), n_events);
+    add_collection(columns, layout, jets(buffers), n_events);
+    add_per_event(columns, layout, "met", met_leaves(buffers), n_events);
+    add_per_event(columns, layout, "event", event_leaves(buffers), n_events);
+    return arrow::Table::Make(arrow::schema(columns.fields), columns.arrays, n_events);
+}
+
+}; // namespace helpers
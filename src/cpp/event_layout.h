@@ -0,0 +1,115 @@
+#pragma once
+
+//std/stl
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+//arrow/parquet
+#include <arrow/api.h>
+
+//
+// Physical layouts in which the events of DatasetGenerator can be stored. The
+// content is the same in all of them, only the shape of the columns (and with
+// it the Parquet repetition/definition levels) differs:
+//
+//      NESTED      one struct column per collection, objects as list<struct>:
+//                      leptons: struct<n, leptons: list<struct<pt, eta, ...>>>
+//                      jets, met, event likewise (leaf paths "jets.jets.pt", ...)
+//      JAGGED      one top-level column per attribute, variable length lists:
+//                      jet_n: uint8, jet_pt: list<float>, ..., met_met: float,
+//                      event_w: double, ...
+//      PADDED      as JAGGED, but every list is padded to the maximum
+//                  multiplicity of its collection (floats with NaN, other
+//                  types with 0/false), with a jet_mask/lep_mask list<bool>
+//                  flagging the real objects
+//      FLAT        no lists at all: one scalar column per object slot
+//                  (jet0_pt ... jet9_pt, lep0_pt, lep1_pt, ...) padded as for
+//                  PADDED, and fixed-length bit lists (trigger masks) packed
+//                  into unsigned integers (bit i = entry i)
+//
+enum class Layout {
+    NESTED,
+    JAGGED,
+    PADDED,
+    FLAT
+};
+
+namespace helpers {
+
+    // "nested", "jagged", "padded" or "flat"
+    Layout layout(const std::string& name);
+    std::string layout_name(Layout layout);
+}; // namespace helpers
+
+//
+// Column-wise (structure of arrays) storage of the generated events waiting
+// to be written out: per-event quantities have one entry per event, per-object
+// quantities one entry per object, with the objects of event i in the range
+// [offsets[i], offsets[i+1]). Booleans are stored one byte per value, and the
+// fixed-length bit lists (isTrigMatched, trigMask) as kLeptonTrigBits and
+// kEventTrigBits consecutive bytes per object/event.
+//
+struct EventBuffers {
+    static constexpr int kMaxLeptons = 2;
+    static constexpr int kMaxJets = 10;
+    static constexpr int kLeptonTrigBits = 8;
+    static constexpr int kEventTrigBits = 15;
+
+    EventBuffers() { clear(); }
+
+    // leptons
+    std::vector<uint8_t> lep_n;
+    std::vector<int32_t> lep_offsets;
+    std::vector<float> lep_pt;
+    std::vector<float> lep_eta;
+    std::vector<float> lep_phi;
+    std::vector<int8_t> lep_flavor;
+    std::vector<uint8_t> lep_isLoose;
+    std::vector<uint8_t> lep_isMedium;
+    std::vector<uint8_t> lep_isTight;
+    std::vector<uint8_t> lep_isTrigMatched;
+
+    // jets
+    std::vector<uint8_t> jet_n;
+    std::vector<int32_t> jet_offsets;
+    std::vector<float> jet_pt;
+    std::vector<float> jet_eta;
+    std::vector<float> jet_phi;
+    std::vector<float> jet_m;
+    std::vector<float> jet_truthHadronPt;
+    std::vector<float> jet_truthHadronId;
+    std::vector<uint8_t> jet_nTrk;
+    std::vector<uint8_t> jet_isBjet;
+    std::vector<float> jet_bTagScore;
+
+    // met
+    std::vector<float> met_sumEt;
+    std::vector<float> met_met;
+    std::vector<float> met_metPhi;
+    std::vector<float> met_electronTerm;
+    std::vector<float> met_muonTerm;
+    std::vector<float> met_jetTerm;
+    std::vector<float> met_softTerm;
+
+    // event
+    std::vector<double> event_w;
+    std::vector<double> event_sumw2;
+    std::vector<uint64_t> event_id;
+    std::vector<uint8_t> event_trigMask;
+
+    int64_t n_events() const { return static_cast<int64_t>(event_id.size()); }
+    void clear();
+}; // struct EventBuffers
+
+namespace helpers {
+
+    // the schema (without metadata) of the events stored in "layout"
+    std::shared_ptr<arrow::Schema> layout_schema(Layout layout);
+
+    // the buffered events as a table in "layout"; where possible the arrays
+    // reference the memory of "buffers" rather than copying it, so the table
+    // must be consumed (written) before the buffers are modified or cleared
+    std::shared_ptr<arrow::Table> layout_table(Layout layout, const EventBuffers& buffers);
+}; // namespace helpers
@@ -0,0 +1,179 @@
+#include "event_lookup.h"
+
+// std/stl
+#include <algorithm>
+#include <stdexcept>
+
+// arrow/parquet
+#include <arrow/compute/api.h>
+#include <parquet/exception.h>
+#include <parquet/schema.h>
+
+EventLookup::EventLookup(const DatasetReader& dataset, const std::string& key) :
+    _dataset(dataset),
+    _key(key),
+    _use_statistics(true),
+    _use_bloom_filters(true)
+{
+    auto leaves = _dataset.leaf_indices({_key});
+    auto descr = _dataset.footer(0)->schema()->Column(leaves.at(0));
+    if(leaves.size() != 1 || descr->max_repetition_level() != 0
+            || (descr->physical_type() != parquet::Type::INT32 && descr->physical_type() != parquet::Type::INT64)) {
+        throw std::runtime_error("ERROR: Lookup key \"" + _key + "\" is not a per-row integer leaf column");
+    }
+    _key_leaf = leaves.at(0);
+    _key_is_64bit = descr->physical_type() == parquet::Type::INT64;
+}
+
+BloomFilterReader* EventLookup::bloom_filters(size_t file_index) {
+    auto it = _bloom_filters.find(file_index);
+    if(it == _bloom_filters.end()) {
+        auto reader = BloomFilterReader::open(helpers::bloom_filter_path(_dataset.files().at(file_index)),
+                _dataset.files().at(file_index));
+        if(reader) {
+            _stats.bloom_filter_bytes += reader->bytes_read();
+        }
+        it = _bloom_filters.emplace(file_index, std::move(reader)).first;
+    }
+    return it->second.get();
+}
+
+std::vector<std::pair<RowGroupTask, std::vector<int64_t>>> EventLookup::candidates(const std::vector<int64_t>& values) {
+    std::vector<std::pair<RowGroupTask, std::vector<int64_t>>> out;
+    for(const auto& task : _dataset.row_groups()) {
+        _stats.row_groups++;
+        std::vector<int64_t> remaining;
+
+        // the values within the min/max of the key column chunk
+        double min, max;
+        if(_use_statistics && helpers::leaf_min_max(*_dataset.row_group_metadata(task), _key_leaf, min, max)) {
+            // (the conversion to double is monotonic, so no value in the range is lost)
+            for(auto value : values) {
+                double v = static_cast<double>(value);
+                if(v >= min && v <= max) remaining.push_back(value);
+            }
+            if(remaining.empty()) {
+                _stats.pruned_by_statistics++;
+                continue;
+            }
+        } else {
+            remaining = values;
+        }
+
+        // the values the Bloom filter of the column chunk may contain
+        BloomFilterReader* reader = _use_bloom_filters ? bloom_filters(task.file_index) : nullptr;
+        if(reader) {
+            int64_t bytes_before = reader->bytes_read();
+            auto filter = reader->read(task.row_group, _key);
+            _stats.bloom_filter_bytes += reader->bytes_read() - bytes_before;
+            if(filter) {
+                std::vector<int64_t> found;
+                for(auto value : remaining) {
+                    uint64_t hash = _key_is_64bit ? SplitBlockBloomFilter::hash(value)
+                        : SplitBlockBloomFilter::hash(static_cast<int32_t>(value));
+                    if(filter->find(hash)) found.push_back(value);
+                }
+                remaining.swap(found);
+                if(remaining.empty()) {
+                    _stats.pruned_by_bloom_filter++;
+                    continue;
+                }
+            }
+        }
+        out.emplace_back(task, std::move(remaining));
+    } // task
+    return out;
+}
+
+std::shared_ptr<arrow::Table> EventLookup::fetch(const std::vector<int64_t>& values, const std::vector<int>& leaves) {
+    std::vector<int64_t> sorted(values);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    RowGroupReader reader(_dataset);
+    std::vector<std::shared_ptr<arrow::Table>> tables;
+    for(const auto& candidate : candidates(sorted)) {
+        const auto& task = candidate.first;
+        const auto& remaining = candidate.second;
+        auto row_group = _dataset.row_group_metadata(task);
+
+        // the rows of the RowGroup with one of the values, from its key column alone
+        _stats.row_groups_read++;
+        _stats.column_bytes += row_group->ColumnChunk(_key_leaf)->total_compressed_size();
+        auto keys = helpers::leaf_array(reader.read(task, {_key_leaf}), _key);
+        std::shared_ptr<arrow::Array> key_values;
+        PARQUET_ASSIGN_OR_THROW(key_values, arrow::compute::Cast(*keys, arrow::int64(), arrow::compute::CastOptions::Unsafe()));
+        const auto& k = static_cast<const arrow::Int64Array&>(*key_values);
+        arrow::Int64Builder rows;
+        for(int64_t i = 0; i < k.length(); i++) {
+            if(k.IsValid(i) && std::binary_search(remaining.begin(), remaining.end(), k.Value(i))) {
+                PARQUET_THROW_NOT_OK(rows.Append(i));
+            }
+        }
+        if(rows.length() == 0) {
+            _stats.false_positives++;
+            continue;
+        }
+        _stats.rows_found += rows.length();
+
+        // and only then the requested columns, of which only the matching rows are kept
+        for(int leaf = 0; leaf < row_group->num_columns(); leaf++) {
+            bool selected = leaves.empty() || std::find(leaves.begin(), leaves.end(), leaf) != leaves.end();
+            if(selected && leaf != _key_leaf) {
+                _stats.column_bytes += row_group->ColumnChunk(leaf)->total_compressed_size();
+            }
+        }
+        std::shared_ptr<arrow::Array> indices;
+        PARQUET_THROW_NOT_OK(rows.Finish(&indices));
+        arrow::Datum taken;
+        PARQUET_ASSIGN_OR_THROW(taken, arrow::compute::Take(reader.read(task, leaves), indices));
+        tables.push_back(taken.table());
+    }
+
+    if(tables.empty()) {
+        return nullptr;
+    }
+    std::shared_ptr<arrow::Table> table;
+    PARQUET_ASSIGN_OR_THROW(table, arrow::ConcatenateTables(tables));
+    return table;
+}
+
+namespace helpers {
+
+void write_bloom_filters(const DatasetReader& dataset, const std::map<std::string, double>& columns) {
+    std::vector<std::string> names;
+    for(const auto& column : columns) {
+        names.push_back(column.first);
+    }
+    auto leaves = dataset.leaf_indices(names);
+    if(leaves.size() != names.size()) {
+        throw std::runtime_error("ERROR: Bloom filters can only be built for leaf columns");
+    }
+
+    RowGroupReader reader(dataset);
+    std::unique_ptr<BloomFilterWriter> writer;
+    for(size_t i = 0; i < dataset.row_groups().size(); i++) {
+        const auto& task = dataset.row_groups().at(i);
+        if(task.row_group == 0) {
+            std::shared_ptr<arrow::io::FileOutputStream> outfile;
+            PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(
+                        helpers::bloom_filter_path(dataset.files().at(task.file_index))));
+            writer = std::make_unique<BloomFilterWriter>(outfile, columns);
+        }
+        auto table = reader.read(task, leaves);
+        for(const auto& name : names) {
+            auto values = helpers::leaf_array(table, name);
+            while(values->type_id() == arrow::Type::LIST) {
+                values = std::static_pointer_cast<arrow::ListArray>(values)->Flatten().ValueOrDie();
+            }
+            writer->write(task.row_group, name, *values);
+        }
+        // the last RowGroup of the file
+        if(i + 1 == dataset.row_groups().size() || dataset.row_groups().at(i + 1).file_index != task.file_index) {
+            writer->close(dataset.files().at(task.file_index));
+            writer.reset();
+        }
+    } // i
+}
+
+}; // namespace helpers
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "dataset_reader.h"
+#include "bloom_filter.h"
+
+//std/stl
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <stdint.h>
+
+//arrow/parquet
+#include <arrow/api.h>
+
+// what a lookup touched
+struct LookupStats {
+    size_t row_groups = 0;              // RowGroups in the dataset
+    size_t pruned_by_statistics = 0;    // RowGroups whose min/max exclude all values
+    size_t pruned_by_bloom_filter = 0;  // remaining RowGroups whose Bloom filter excludes all values
+    size_t row_groups_read = 0;         // RowGroups whose key column was read
+    size_t false_positives = 0;         // RowGroups read without any of the values
+    int64_t rows_found = 0;
+    int64_t bloom_filter_bytes = 0;     // bytes of Bloom filters (and their indices) read
+    int64_t column_bytes = 0;           // compressed bytes of the column chunks read
+
+    int64_t bytes_read() const { return bloom_filter_bytes + column_bytes; }
+}; // struct LookupStats
+
+//
+// Point lookups of rows (e.g. events) by the values of an integer leaf column
+// (the "key", e.g. "event.id"): a RowGroup is only read if its min/max
+// statistics and the Bloom filter of its sidecar (see BloomFilterWriter),
+// where there is one, allow it to contain one of the requested values; only
+// the key column of a candidate RowGroup is read to find the matching rows,
+// and the other columns only if there are any. With both the statistics and
+// the Bloom filters switched off this is a full scan of the key column.
+//
+class EventLookup {
+    public:
+        // "key" must be a per-row (not list) integer leaf column of "dataset"
+        EventLookup(const DatasetReader& dataset, const std::string& key = "event.id");
+        ~EventLookup() = default;
+
+        void set_use_statistics(bool use) { _use_statistics = use; }
+        void set_use_bloom_filters(bool use) { _use_bloom_filters = use; }
+
+        // the RowGroups that may contain any of "values" (sorted), and the values each may contain
+        std::vector<std::pair<RowGroupTask, std::vector<int64_t>>> candidates(const std::vector<int64_t>& values);
+
+        // the rows with a key in "values", with the "leaves" (all if empty), in dataset order
+        std::shared_ptr<arrow::Table> fetch(const std::vector<int64_t>& values, const std::vector<int>& leaves = {});
+
+        const LookupStats& stats() const { return _stats; }
+        void reset_stats() { _stats = LookupStats(); }
+
+    private :
+        const DatasetReader& _dataset;
+        std::string _key;
+        int _key_leaf;
+        bool _key_is_64bit;
+        bool _use_statistics;
+        bool _use_bloom_filters;
+        LookupStats _stats;
+        // the Bloom filter sidecars opened so far (nullptr for files without one)
+        std::map<size_t, std::unique_ptr<BloomFilterReader>> _bloom_filters;
+
+        BloomFilterReader* bloom_filters(size_t file_index);
+}; // class EventLookup
+
+namespace helpers {
+
+    // (re-)build the Bloom filter sidecars of all files of "dataset" for the
+    // leaf "columns" (with their false positive probability), e.g. for a
+    // dataset written without them or with other RowGroups
+    void write_bloom_filters(const DatasetReader& dataset, const std::map<std::string, double>& columns);
+}; // namespace helpers
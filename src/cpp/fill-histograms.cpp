@@ -0,0 +1,195 @@
+#include "dataset_reader.h"
+#include "memory_pool.h"
+#include "histogram.h"
+#include "kinematics.h"
+#include "selection.h"
+
+//std/stl
+#include <iostream>
+#include <cstring> // strcmp
+#include <chrono>
+
+void print_usage(char* argv[]) {
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+    std::cout << " Fill a standard set of event.w-weighted histograms from a generated dataset" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Usage: " << argv[0] << " [OPTIONS] <input dataset (file or directory)>" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Options:" << std::endl;
+    std::cout << "   -o|--output            Output JSON file for the histograms [default: \"histograms.json\"]" << std::endl;
+    std::cout << "   -t|--threads           Number of filling threads [default: # of hardware threads]" << std::endl;
+    std::cout << "   -s|--cut               Cut to apply before filling, repeat for a cutflow" << std::endl;
+    std::cout << "                          (e.g. -s \"jets.n>=2\" -s \"met.met>50 || event.trigMask[0|3]\")" << std::endl;
+    std::cout << "   -p|--partitions        Read only the partitions (\"key=value\" subdirectories) passing this filter," << std::endl;
+    std::cout << "                          e.g. \"campaign==mc16d && dsid>=410000\" or \"dsid=410472|410473\"" << std::endl;
+    std::cout << "   --footer-cache         Directory of a cache of the file footers, reused by later runs while the files" << std::endl;
+    std::cout << "                          are unchanged (see FooterCache)" << std::endl;
+    std::cout << "   --uring                Read the files through io_uring, with --queue-depth reads of each column chunk in" << std::endl;
+    std::cout << "                          flight (Linux; the standard streams are used if io_uring is not available)" << std::endl;
+    std::cout << "   --queue-depth          Number of io_uring reads in flight per thread with --uring [default: 8]" << std::endl;
+    std::cout << "   --memory-pool          Arrow memory pool backend (Options: default, system, jemalloc, mimalloc);" << std::endl;
+    std::cout << "                          the allocations of each phase are reported at the end [default: default]" << std::endl;
+    std::cout << "   -h|--help              Print this help message and exit" << std::endl;
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+}
+
+hist::HistogramBook book_histograms() {
+    hist::HistogramBook book;
+    book.book_1d("leptons_n", hist::Axis(5, 0, 5), "number of leptons");
+    book.book_1d("lepton_pt", hist::Axis(50, 0, 100), "lepton p_{T}");
+    book.book_1d("jets_n", hist::Axis(12, 0, 12), "number of jets");
+    book.book_1d("jet_pt", hist::Axis(50, 0, 100), "jet p_{T}");
+    book.book_1d("jet_bTagScore", hist::Axis(50, 0, 100), "jet b-tag score");
+    book.book_1d("met", hist::Axis(50, 0, 100), "E_{T}^{miss}");
+    book.book_1d("met_phi", hist::Axis(32, -3.2, 3.2), "E_{T}^{miss} #phi");
+    book.book_1d("ht", hist::Axis({0, 50, 100, 150, 200, 300, 400, 600, 1000}), "H_{T}");
+    book.book_1d("mjj", hist::Axis(50, 0, 500), "leading di-jet mass");
+    book.book_1d("lepton_min_dr_jet", hist::Axis(50, 0, 5), "lepton-jet minimum #DeltaR");
+    book.book_2d("met_vs_ht", hist::Axis(20, 0, 1000), hist::Axis(20, 0, 100), "E_{T}^{miss} vs H_{T}");
+    book.book_profile("met_vs_jets_n", hist::Axis(12, 0, 12), "mean E_{T}^{miss} vs number of jets");
+    return book;
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string input = "";
+    std::string partitions = "";
+    std::string footer_cache_dir = "";
+    std::string output = "histograms.json";
+    size_t n_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    std::vector<std::string> cuts;
+    bool uring = false;
+    fileio::UringOptions uring_options;
+
+    for(size_t i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--output") == 0) { output = argv[++i]; }
+        else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--threads") == 0) { n_threads = std::stoul(argv[++i]); }
+        else if (strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--cut") == 0) { cuts.push_back(argv[++i]); }
+        else if (strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--partitions") == 0) { partitions = argv[++i]; }
+        else if (strcmp(argv[i], "--footer-cache") == 0) { footer_cache_dir = argv[++i]; }
+        else if (strcmp(argv[i], "--uring") == 0) { uring = true; }
+        else if (strcmp(argv[i], "--queue-depth") == 0) { uring_options.queue_depth = std::stoul(argv[++i]); }
+        else if (strcmp(argv[i], "--memory-pool") == 0) { memory::select_backend(argv[++i]); }
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { print_usage(argv); return 0; }
+        else if (argv[i][0] != '-' && input.empty()) { input = argv[i]; }
+        else {
+            std::cout << argv[0] << " Unknown command line argument provided: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if(input.empty()) {
+        print_usage(argv);
+        return 1;
+    }
+
+    selection::Selection cutflow;
+    for(const auto& cut : cuts) {
+        cutflow.add(selection::parse_cut(cut));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::shared_ptr<FooterCache> footer_cache;
+    if(!footer_cache_dir.empty()) {
+        footer_cache = std::make_shared<FooterCache>(footer_cache_dir);
+    }
+    DatasetReader dataset(input, true, partitioning::Filter(partitions), footer_cache);
+    if(uring) {
+        dataset.set_uring(uring_options);
+    }
+    double planning = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "INFO: Planned " << dataset.row_groups().size() << " row groups in " << dataset.files().size()
+        << " files from " << (dataset.from_summary() ? "the _metadata summary" : "the file footers")
+        << " in " << planning << " seconds";
+    if(footer_cache) {
+        std::cout << " (" << footer_cache->hits() << " footers from the cache, " << footer_cache->misses() << " read)";
+    }
+    std::cout << std::endl;
+    if(dataset.pruned_partitions() > 0) {
+        std::cout << "INFO: Skipped " << dataset.pruned_partitions() << " partition directories failing \""
+            << partitions << "\"" << std::endl;
+    }
+    auto leaves = dataset.leaf_indices({
+            "leptons.n", "leptons.leptons.pt", "leptons.leptons.eta", "leptons.leptons.phi",
+            "jets.n", "jets.jets.pt", "jets.jets.eta", "jets.jets.phi", "jets.jets.m", "jets.jets.bTagScore",
+            "met.met", "met.metPhi",
+            "event.w"
+    });
+    const auto& tasks = dataset.row_groups();
+    n_threads = std::max<size_t>(1, std::min(n_threads, tasks.size()));
+
+    // one reader and one cutflow per thread, each reader keeps its current file open
+    std::vector<RowGroupReader> readers;
+    std::vector<selection::Selection> selections;
+    readers.reserve(n_threads);
+    for(size_t i = 0; i < n_threads; i++) {
+        readers.emplace_back(dataset);
+        selections.push_back(cutflow.clone_empty());
+    }
+
+    auto prototype = book_histograms();
+    auto book = hist::fill_parallel(prototype, tasks.size(), n_threads,
+            [&](hist::HistogramBook& h, size_t itask, size_t ithread) {
+        const auto& task = tasks.at(itask);
+        auto& reader = readers.at(ithread);
+
+        // the histograms take the selection bitmap directly, and the payload
+        // columns are not read at all for RowGroups in which nothing passes
+        const uint8_t* mask = nullptr;
+        selection::EventMask selected;
+        if(!cutflow.empty()) {
+            selected = selections.at(ithread).apply(reader, dataset, task);
+            if(selected.none()) return;
+            mask = selected.data();
+        }
+
+        auto table = reader.read(task, leaves);
+        auto weights = helpers::leaf_array(table, "event.w");
+        const auto* w = weights.get();
+
+        auto jets = kinematics::jagged_p4(helpers::leaf_array(table, "jets"), "jets");
+        auto leptons = kinematics::jagged_p4(helpers::leaf_array(table, "leptons"), "leptons");
+        auto ht = kinematics::ht(jets);
+        auto met = helpers::leaf_array(table, "met.met");
+        auto jets_n = helpers::leaf_array(table, "jets.n");
+
+        static_cast<hist::Histogram1D&>(h.at("leptons_n")).fill(*helpers::leaf_array(table, "leptons.n"), w, mask);
+        static_cast<hist::Histogram1D&>(h.at("lepton_pt")).fill(*helpers::leaf_array(table, "leptons.leptons.pt"), w, mask);
+        static_cast<hist::Histogram1D&>(h.at("jets_n")).fill(*jets_n, w, mask);
+        static_cast<hist::Histogram1D&>(h.at("jet_pt")).fill(*helpers::leaf_array(table, "jets.jets.pt"), w, mask);
+        static_cast<hist::Histogram1D&>(h.at("jet_bTagScore")).fill(*helpers::leaf_array(table, "jets.jets.bTagScore"), w, mask);
+        static_cast<hist::Histogram1D&>(h.at("met")).fill(*met, w, mask);
+        static_cast<hist::Histogram1D&>(h.at("met_phi")).fill(*helpers::leaf_array(table, "met.metPhi"), w, mask);
+        static_cast<hist::Histogram1D&>(h.at("ht")).fill(*ht, w, mask);
+        static_cast<hist::Histogram1D&>(h.at("mjj")).fill(*kinematics::leading_pair_mass(jets), w, mask);
+        static_cast<hist::Histogram1D&>(h.at("lepton_min_dr_jet")).fill(*kinematics::min_delta_r(leptons, jets), w, mask);
+        static_cast<hist::Histogram2D&>(h.at("met_vs_ht")).fill(*ht, *met, w, mask);
+        static_cast<hist::Profile1D&>(h.at("met_vs_jets_n")).fill(*jets_n, *met, w, mask);
+    });
+
+    book.write_json(output);
+    if(footer_cache) {
+        footer_cache->save();
+    }
+    for(const auto& s : selections) {
+        cutflow.merge(s);
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(stop - start).count();
+    int64_t n_entries = 0;
+    for(size_t i = 0; i < book.size(); i++) {
+        n_entries += book.at(i).entries();
+    }
+    std::cout << "INFO: Filled " << book.size() << " histograms from " << dataset.num_rows() << " events ("
+        << tasks.size() << " row groups, " << n_threads << " threads) in " << elapsed << " seconds" << std::endl;
+    std::cout << "INFO: " << dataset.num_rows() / elapsed << " events/s, " << n_entries / elapsed << " entries/s" << std::endl;
+    std::cout << "INFO: Histograms written to " << output << std::endl;
+    if(!cutflow.empty()) {
+        cutflow.print(std::cout);
+    }
+
+    std::cout << memory::report();
+
+    return 0;
+}
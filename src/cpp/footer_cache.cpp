@@ -0,0 +1,171 @@
+#include "footer_cache.h"
+
+// std/stl
+#include <iostream>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <cstring> // memcpy, memcmp
+
+// arrow/parquet
+#include <arrow/io/api.h>
+#include <parquet/file_reader.h>
+#include <parquet/exception.h>
+
+namespace {
+
+const char kMagic[8] = {'P', 'Q', 'F', 'T', 'R', 'C', '0', '1'};
+const std::string kCacheFile = "footers.cache";
+
+// the cache key of a file, and its current size and modification time
+std::string cache_key(const std::string& path) {
+    return std::filesystem::absolute(path).lexically_normal().string();
+}
+
+void file_stat(const std::string& path, uint64_t& size, int64_t& mtime) {
+    size = std::filesystem::file_size(path);
+    mtime = static_cast<int64_t>(std::filesystem::last_write_time(path).time_since_epoch().count());
+}
+
+template<typename T>
+bool read_value(const std::string& data, size_t& pos, T& value) {
+    if(pos + sizeof(T) > data.size()) return false;
+    std::memcpy(&value, data.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+template<typename T>
+void write_value(arrow::io::OutputStream& out, const T& value) {
+    PARQUET_THROW_NOT_OK(out.Write(&value, sizeof(T)));
+}
+
+} // namespace
+
+FooterCache::FooterCache(const std::string& cache_dir) :
+    _cache_dir(cache_dir),
+    _modified(false),
+    _hits(0),
+    _misses(0)
+{
+    load();
+}
+
+std::string FooterCache::cache_file() const {
+    return (std::filesystem::path(_cache_dir) / kCacheFile).string();
+}
+
+void FooterCache::load() {
+    if(_cache_dir.empty() || !std::filesystem::is_regular_file(cache_file())) return;
+
+    // the whole cache file in one read: the magic, then for each file its
+    // path, size, modification time and serialized footer
+    std::ifstream infile(cache_file(), std::ios::binary);
+    std::stringstream buffer;
+    buffer << infile.rdbuf();
+    std::string data = buffer.str();
+
+    size_t pos = sizeof(kMagic);
+    bool valid = data.size() >= sizeof(kMagic) && std::memcmp(data.data(), kMagic, sizeof(kMagic)) == 0;
+    std::map<std::string, Entry> entries;
+    while(valid && pos < data.size()) {
+        uint32_t path_length, footer_length;
+        Entry entry;
+        valid = read_value(data, pos, path_length) && pos + path_length <= data.size();
+        if(!valid) break;
+        std::string path = data.substr(pos, path_length);
+        pos += path_length;
+        valid = read_value(data, pos, entry.size) && read_value(data, pos, entry.mtime)
+            && read_value(data, pos, footer_length) && pos + footer_length <= data.size();
+        if(!valid) break;
+        entry.serialized = std::make_shared<const std::string>(data.substr(pos, footer_length));
+        pos += footer_length;
+        entries[path] = entry;
+    }
+    if(!valid) {
+        std::cout << "WARNING: Footer cache file \"" << cache_file() << "\" is corrupt, ignoring it" << std::endl;
+        return;
+    }
+    _entries = std::move(entries);
+}
+
+std::shared_ptr<parquet::FileMetaData> FooterCache::footer(const std::string& path) {
+    auto key = cache_key(path);
+    uint64_t size;
+    int64_t mtime;
+    file_stat(path, size, mtime);
+
+    std::shared_ptr<const std::string> serialized;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _entries.find(key);
+        if(it != _entries.end() && it->second.size == size && it->second.mtime == mtime) {
+            if(it->second.footer) {
+                _hits++;
+                return it->second.footer;
+            }
+            serialized = it->second.serialized;
+        }
+    }
+
+    // decoded (from the cache file) or read (from the Parquet file) outside of the lock
+    std::shared_ptr<parquet::FileMetaData> metadata;
+    if(serialized) {
+        uint32_t length = static_cast<uint32_t>(serialized->size());
+        metadata = parquet::FileMetaData::Make(serialized->data(), &length);
+        _hits++;
+    } else {
+        metadata = parquet::ParquetFileReader::OpenFile(path)->metadata();
+        _misses++;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto& entry = _entries[key];
+    if(!serialized) {
+        entry.serialized.reset();
+        _modified = true;
+    }
+    entry.size = size;
+    entry.mtime = mtime;
+    entry.footer = metadata;
+    return metadata;
+}
+
+void FooterCache::save() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(_cache_dir.empty() || !_modified) return;
+    std::filesystem::create_directories(_cache_dir);
+
+    // written next to the cache file and renamed over it, so that readers see either one or the other
+    auto tmp_path = cache_file() + ".tmp";
+    std::shared_ptr<arrow::io::FileOutputStream> outfile;
+    PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(tmp_path));
+    PARQUET_THROW_NOT_OK(outfile->Write(kMagic, sizeof(kMagic)));
+    for(auto& [path, entry] : _entries) {
+        // (the footers of files that are gone or changed are dropped)
+        uint64_t size;
+        int64_t mtime;
+        std::error_code ec;
+        if(!std::filesystem::is_regular_file(path, ec)) continue;
+        file_stat(path, size, mtime);
+        if(size != entry.size || mtime != entry.mtime) continue;
+
+        if(!entry.serialized) {
+            std::shared_ptr<arrow::io::BufferOutputStream> buffer;
+            PARQUET_ASSIGN_OR_THROW(buffer, arrow::io::BufferOutputStream::Create());
+            entry.footer->WriteTo(buffer.get());
+            std::shared_ptr<arrow::Buffer> serialized;
+            PARQUET_ASSIGN_OR_THROW(serialized, buffer->Finish());
+            entry.serialized = std::make_shared<const std::string>(serialized->ToString());
+        }
+        write_value(*outfile, static_cast<uint32_t>(path.size()));
+        PARQUET_THROW_NOT_OK(outfile->Write(path.data(), path.size()));
+        write_value(*outfile, entry.size);
+        write_value(*outfile, entry.mtime);
+        write_value(*outfile, static_cast<uint32_t>(entry.serialized->size()));
+        PARQUET_THROW_NOT_OK(outfile->Write(entry.serialized->data(), entry.serialized->size()));
+    }
+    PARQUET_THROW_NOT_OK(outfile->Close());
+    std::filesystem::rename(tmp_path, cache_file());
+    _modified = false;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+//std/stl
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+
+//arrow/parquet
+#include <parquet/metadata.h>
+
+//
+// Cache of the footers of Parquet files, so that a dataset that is planned and
+// opened over and over (an analysis job looping over it, a benchmark repeating
+// its reads) does not read and Thrift-decode the footer of every file each
+// time. A cached footer is used for as long as the size and the modification
+// time of its file are those it was read at.
+//
+// The footers are held in memory, decoded once and shared by all readers, and
+// optionally in a cache directory: its single cache file holds the serialized
+// footers of all files seen, and is read in one go by the next process, which
+// then plans a dataset without opening any of its files (decoding each footer
+// once, when it is first used).
+//
+class FooterCache {
+    public:
+        // an empty "cache_dir" keeps the footers in memory only
+        explicit FooterCache(const std::string& cache_dir = "");
+        ~FooterCache() = default;
+
+        // the footer of the Parquet file (or _metadata summary) at "path", read
+        // if it is not cached or its file changed since; safe to call from
+        // several threads
+        std::shared_ptr<parquet::FileMetaData> footer(const std::string& path);
+
+        // write the footers to the cache directory, if any were read since it was loaded
+        void save();
+
+        const std::string& cache_dir() const { return _cache_dir; }
+        // number of footers taken from the cache, and read from their files
+        size_t hits() const { return _hits; }
+        size_t misses() const { return _misses; }
+
+    private :
+        struct Entry {
+            uint64_t size;
+            int64_t mtime;
+            // the Thrift-encoded footer, as loaded from the cache file
+            std::shared_ptr<const std::string> serialized;
+            std::shared_ptr<parquet::FileMetaData> footer;
+        };
+        std::string _cache_dir;
+        std::map<std::string, Entry> _entries;
+        std::mutex _mutex;
+        bool _modified;
+        std::atomic<size_t> _hits;
+        std::atomic<size_t> _misses;
+
+        std::string cache_file() const;
+        void load();
+}; // class FooterCache
@@ -1,8 +1,20 @@
 #include "dataset_generator.h"
+#include "memory_pool.h"
+#include "resource_usage.h"
+#include "summary_metadata.h"
+#include "dataset_reader.h"
+#include "metrics.h"
 
 //std/stl
 #include <iostream>
 #include <sstream>
+#include <iomanip>
+#include <cstring> // strcmp
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <exception>
 
 void print_usage(char* argv[]) {
     std::cout << "---------------------------------------------------------------------------" << std::endl;
@@ -14,50 +26,305 @@ void print_usage(char* argv[]) {
     std::cout << "   --name                 Name of output dataset [default: \"dummy\"]" << std::endl;
     std::cout << "   -o|--outdir            Output directory to store files in [default: \"./dataset_gen\"]" << std::endl;
     std::cout << "   -n|--n-events          Number of events to generate [default: 5000]" << std::endl;
-    std::cout << "   -c|--compression       Compression setting (Options: UNCOMPRESSED, SNAPPY, GZIP) [default: UNCOMPRESSED]" << std::endl;
+    std::cout << "   -f|--format            Output file format (Options: parquet, ipc, feather) [default: parquet]" << std::endl;
+    std::cout << "   -c|--compression       Compression setting (Options: UNCOMPRESSED, SNAPPY, GZIP, ZSTD, LZ4;" << std::endl;
+    std::cout << "                          ipc/feather support only ZSTD and LZ4) [default: UNCOMPRESSED, LZ4 for feather]" << std::endl;
+    std::cout << "   -l|--layout            Physical layout of the events (Options: nested, jagged, padded, flat) [default: nested]" << std::endl;
     std::cout << "   -r|--row-group-size    Number of events per Parquet RowGroup [default: 250000/# of fields]" << std::endl;
+    std::cout << "   --seed                 Seed of the (counter-based) random numbers [default: 0]" << std::endl;
+    std::cout << "   --first-event          Id of the first event generated, e.g. to generate the shard [k, k+n) of a" << std::endl;
+    std::cout << "                          dataset independently (the events only depend on the seed and their id) [default: 0]" << std::endl;
+    std::cout << "   -N|--events-per-file   Start a new file once a file has this many events [default: 0, a single file]" << std::endl;
+    std::cout << "   --no-summary           Do not write the _metadata/_common_metadata summary (which holds the footers" << std::endl;
+    std::cout << "                          of all files in memory until the end)" << std::endl;
+    std::cout << "   --discard              Encode and compress the events, but do not store them (implies --no-summary)" << std::endl;
+    std::cout << "   --bloom-filter         Write Bloom filters of a leaf column (e.g. \"event.id\") to a sidecar file next" << std::endl;
+    std::cout << "                          to each Parquet file, as \"column\" or \"column:fpp\" with fpp the false positive" << std::endl;
+    std::cout << "                          probability [default: 0.01], repeat for several columns" << std::endl;
+    std::cout << "   --sort                 Sort the events of each RowGroup by these comma-separated leaf columns, each" << std::endl;
+    std::cout << "                          prefixed by '-' for a descending order (e.g. \"jets.n,met.met\")" << std::endl;
+    std::cout << "   --campaign             Campaign of the sample generated, recorded in the metadata [default: mc16d]" << std::endl;
+    std::cout << "   --dsid                 DSID of the sample generated, recorded in the metadata [default: 410472]" << std::endl;
+    std::cout << "   --partition            Write the files into the Hive-style \"campaign=<campaign>/dsid=<dsid>\" subdirectory" << std::endl;
+    std::cout << "                          of the output directory, and a _metadata summary of all partitions into the latter" << std::endl;
+    std::cout << "   --sample               Generate -n events of this sample, as \"campaign:dsid\" (implies --partition);" << std::endl;
+    std::cout << "                          repeat for several, which are written in parallel, the event ids of each sample" << std::endl;
+    std::cout << "                          following those of the previous one" << std::endl;
+    std::cout << "   --append               Add the files to the Parquet dataset in the output directory (or partition), with" << std::endl;
+    std::cout << "                          the same schema, continuing its file numbering and event ids" << std::endl;
+    std::cout << "   -j|--jobs              Maximum number of samples written in parallel [default: # of hardware threads]" << std::endl;
+    std::cout << "   --soak                 Check that the peak resident memory stays flat: it is recorded once the first" << std::endl;
+    std::cout << "                          10% of the events (and at least one file) are written, and the run fails if it" << std::endl;
+    std::cout << "                          grows by more than --soak-tolerance afterwards" << std::endl;
+    std::cout << "   --soak-tolerance       Allowed growth of the peak resident memory in MB [default: 32]" << std::endl;
+    std::cout << "   --memory-pool          Arrow memory pool backend (Options: default, system, jemalloc, mimalloc);" << std::endl;
+    std::cout << "                          the allocations of each phase are reported at the end [default: default]" << std::endl;
+    std::cout << "   --write-buffer         Size in MB of the buffer the writes to each output file are gathered in, written" << std::endl;
+    std::cout << "                          out in aligned writes of that size (0 for Arrow's unbuffered stream) [default: 8]" << std::endl;
+    std::cout << "   --preallocate          Preallocate the space of the output files this many MB at a time (Linux) [default: 0]" << std::endl;
+    std::cout << "   --sync                 When the output is forced to the device (Options: none, close (fdatasync on close)," << std::endl;
+    std::cout << "                          range (start the write-back every --sync-interval MB, Linux)) [default: none]" << std::endl;
+    std::cout << "   --sync-interval        MB written between two write-backs of --sync range [default: 64]" << std::endl;
+    std::cout << "   --uring                Write the output files through io_uring, with --queue-depth writes of --write-buffer" << std::endl;
+    std::cout << "                          MB in flight (Linux; the standard streams are used if io_uring is not available)" << std::endl;
+    std::cout << "   --queue-depth          Number of io_uring writes in flight with --uring [default: 8]" << std::endl;
+    std::cout << "   --status-interval      Seconds between the one-line progress reports (events, rates, ETA, bytes" << std::endl;
+    std::cout << "                          written, time spent writing, RSS) [default: 10]" << std::endl;
+    std::cout << "   --metrics-file         Also write the counters and gauges to this file in the Prometheus text format" << std::endl;
+    std::cout << "                          at every progress report (e.g. for the node_exporter textfile collector)" << std::endl;
     std::cout << "   -h|--help              Print this help message and exit" << std::endl;
     std::cout << "---------------------------------------------------------------------------" << std::endl;
 
 }
 
+// the "key=value" subdirectories of "dir" with a _metadata summary, relative to "dir"
+void find_partitions(const std::filesystem::path& dir, const std::filesystem::path& relative,
+        std::vector<std::string>& partitions) {
+    for(const auto& entry : std::filesystem::directory_iterator(dir)) {
+        auto name = entry.path().filename().string();
+        if(!entry.is_directory() || name.find('=') == std::string::npos) continue;
+        if(std::filesystem::is_regular_file(entry.path() / helpers::kSummaryMetadataFile)) {
+            partitions.push_back((relative / name).generic_string());
+        }
+        find_partitions(entry.path(), relative / name, partitions);
+    }
+}
+
+// the one-line progress report of a metrics::Reporter
+std::string status_line(const metrics::Snapshot& s) {
+    double events = s.value("gen_events_total");
+    double target = s.value("gen_events_target");
+    double rate = s.final ? s.average_rate("gen_events_total") : s.rate("gen_events_total");
+    std::stringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << "STATUS: " << metrics::duration(s.elapsed)
+        << " | " << metrics::si(events) << " / " << metrics::si(target) << " events ("
+        << (target > 0 ? events / target * 100. : 0.) << " %)"
+        << " | " << metrics::si(rate) << " evt/s"
+        << " | ETA " << (s.final ? "done" : metrics::duration(rate > 0 ? (target - events) / rate : -1.))
+        << " | " << s.value("gen_bytes_written_total") / 1024. / 1024. << " MB, "
+        << (s.final ? s.average_rate("gen_bytes_written_total") : s.rate("gen_bytes_written_total")) / 1024. / 1024. << " MB/s"
+        << " | " << static_cast<uint64_t>(s.value("gen_row_groups_total")) << " RGs, "
+        << static_cast<uint64_t>(s.value("gen_files_total")) << " files"
+        << " | writing " << (s.final ? s.average_rate("gen_write_stall_seconds_total") : s.rate("gen_write_stall_seconds_total")) * 100. << " %"
+        << " | RSS " << s.value("process_resident_memory_bytes") / 1024. / 1024. << " MB";
+    return out.str();
+}
+
 int main(int argc, char* argv[]) {
 
     uint64_t n_events = 5000;
     std::string outdir = "./dataset_gen";
     std::string dataset_name = "dummy";
-    std::string compression = "UNCOMPRESSED";
+    std::string compression = "";
+    std::string format = "parquet";
+    std::string layout = "nested";
     int32_t row_group_size = -1;
+    uint64_t seed = 0;
+    uint64_t first_event = 0;
+    uint64_t events_per_file = 0;
+    bool write_summary = true;
+    bool discard = false;
+    std::vector<std::pair<std::string, double>> bloom_filters;
+    std::vector<sorting::SortKey> sort_keys;
+    bool soak = false;
+    double soak_tolerance = 32;
+    std::string campaign = "mc16d";
+    int dsid = 410472;
+    bool partition = false;
+    std::vector<std::pair<std::string, int>> samples;
+    bool append = false;
+    size_t n_jobs = std::max<size_t>(1, std::thread::hardware_concurrency());
+    double status_interval = 10;
+    std::string metrics_file = "";
+    fileio::OutputOptions output_options;
 
     for(size_t i = 1; i < argc; i++) {
         if      (strcmp(argv[i], "--name") == 0) { dataset_name = argv[++i]; }
         else if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--outdir") == 0) { outdir = argv[++i]; }
-        else if (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--n-events") == 0) { n_events = std::stoi(argv[++i]); }
+        else if (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--n-events") == 0) { n_events = std::stoull(argv[++i]); }
         else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { print_usage(argv); return 0; }
         else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--row-group-size") == 0) { row_group_size = std::stoi(argv[++i]); }
         else if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--compression") == 0) { compression = argv[++i]; }
+        else if (strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--format") == 0) { format = argv[++i]; }
+        else if (strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--layout") == 0) { layout = argv[++i]; }
+        else if (strcmp(argv[i], "--seed") == 0) { seed = std::stoull(argv[++i]); }
+        else if (strcmp(argv[i], "--first-event") == 0) { first_event = std::stoull(argv[++i]); }
+        else if (strcmp(argv[i], "-N") == 0 || strcmp(argv[i], "--events-per-file") == 0) { events_per_file = std::stoull(argv[++i]); }
+        else if (strcmp(argv[i], "--no-summary") == 0) { write_summary = false; }
+        else if (strcmp(argv[i], "--discard") == 0) { discard = true; write_summary = false; }
+        else if (strcmp(argv[i], "--bloom-filter") == 0) { bloom_filters.push_back(helpers::bloom_filter_option(argv[++i])); }
+        else if (strcmp(argv[i], "--sort") == 0) { sort_keys = sorting::parse_sort_keys(argv[++i]); }
+        else if (strcmp(argv[i], "--soak") == 0) { soak = true; }
+        else if (strcmp(argv[i], "--soak-tolerance") == 0) { soak_tolerance = std::stod(argv[++i]); }
+        else if (strcmp(argv[i], "--campaign") == 0) { campaign = argv[++i]; }
+        else if (strcmp(argv[i], "--dsid") == 0) { dsid = std::stoi(argv[++i]); }
+        else if (strcmp(argv[i], "--partition") == 0) { partition = true; }
+        else if (strcmp(argv[i], "--sample") == 0) {
+            std::string sample = argv[++i];
+            auto colon = sample.find(':');
+            if(colon == std::string::npos) {
+                std::cout << argv[0] << " Invalid sample (expected \"campaign:dsid\"): " << sample << std::endl;
+                return 1;
+            }
+            std::pair<std::string, int> s(sample.substr(0, colon), std::stoi(sample.substr(colon + 1)));
+            // (two jobs would write the same files of the same partition)
+            if(std::find(samples.begin(), samples.end(), s) != samples.end()) {
+                std::cout << argv[0] << " Sample given more than once: " << sample << std::endl;
+                return 1;
+            }
+            samples.push_back(s);
+            partition = true;
+        }
+        else if (strcmp(argv[i], "--append") == 0) { append = true; }
+        else if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) { n_jobs = std::stoul(argv[++i]); }
+        else if (strcmp(argv[i], "--memory-pool") == 0) { memory::select_backend(argv[++i]); }
+        else if (strcmp(argv[i], "--write-buffer") == 0) { output_options.buffer_size = std::stod(argv[++i]) * 1024 * 1024; }
+        else if (strcmp(argv[i], "--preallocate") == 0) { output_options.preallocate = std::stod(argv[++i]) * 1024 * 1024; }
+        else if (strcmp(argv[i], "--sync") == 0) { output_options.sync = fileio::sync_policy(argv[++i]); }
+        else if (strcmp(argv[i], "--sync-interval") == 0) { output_options.sync_bytes = std::stod(argv[++i]) * 1024 * 1024; }
+        else if (strcmp(argv[i], "--uring") == 0) { output_options.uring = true; }
+        else if (strcmp(argv[i], "--queue-depth") == 0) { output_options.queue_depth = std::stoul(argv[++i]); }
+        else if (strcmp(argv[i], "--status-interval") == 0) { status_interval = std::stod(argv[++i]); }
+        else if (strcmp(argv[i], "--metrics-file") == 0) { metrics_file = argv[++i]; }
         else {
             std::cout << argv[0] << " Unknown command line argument provided: " << argv[i] << std::endl;
             return 1;
         }
     }
 
-    uint32_t count_rate = 100;
-    if(n_events >= 500000) {
-        count_rate = 50000;
-    } else if(n_events >= 100000) {
-        count_rate = 10000;
-    } else if(n_events >= 5000) {
-        count_rate = 1000;
+    // the peak resident memory is taken as reference once the buffers have
+    // reached their final size and at least one file has been rolled over
+    uint64_t soak_warmup = std::max(n_events / 10, events_per_file);
+    if(soak && soak_warmup >= n_events) {
+        std::cout << "WARNING: Too few events for the soak check (the first " << soak_warmup
+            << " events are used as reference), generate more events or fewer events per file" << std::endl;
+    }
+    int64_t soak_reference = 0;
+
+    if(samples.empty()) {
+        samples.push_back({campaign, dsid});
+    }
+    if(soak && samples.size() > 1) {
+        std::cout << "WARNING: The soak check needs a single sample, ignoring it" << std::endl;
+        soak = false;
+    }
+
+    // when appending to a partitioned dataset, the event ids of the new samples
+    // follow the largest one of all partitions (each generator only sees its own)
+    if(append && partition && helpers::contains_parquet_files(outdir)) {
+        first_event = std::max(first_event, helpers::next_event_id(DatasetReader(outdir)));
+    }
+
+    // the generator of a sample, whose event ids follow those of the previous samples
+    auto make_generator = [&](size_t isample) {
+        auto ds = std::make_unique<DatasetGenerator>(row_group_size);
+        ds->set_seed(seed);
+        ds->set_first_event(first_event + isample * n_events);
+        ds->set_events_per_file(events_per_file);
+        ds->set_write_summary(write_summary);
+        ds->set_discard_output(discard);
+        for(const auto& bloom_filter : bloom_filters) {
+            ds->set_bloom_filter(bloom_filter.first, bloom_filter.second);
+        }
+        ds->set_sort(sort_keys);
+        ds->set_output_options(output_options);
+        ds->set_sample(samples.at(isample).first, samples.at(isample).second);
+        ds->set_partitioned(partition);
+        ds->set_append(append);
+        ds->init(dataset_name, outdir, compression, format, layout);
+        return ds;
+    };
+
+    // progress is reported from the metrics (see metrics.h), which the
+    // generators update once per batch and RowGroup, on a thread of its own
+    metrics::gauge("gen_events_target", "Events to generate").set(n_events * samples.size());
+    auto& rss = metrics::gauge("process_resident_memory_bytes", "Resident memory of the process");
+    auto& peak_rss = metrics::gauge("process_peak_resident_memory_bytes", "Largest resident memory of the process so far");
+    auto& pool_bytes = metrics::gauge("arrow_memory_pool_peak_bytes", "Largest number of bytes held by the Arrow memory pools so far");
+    metrics::Reporter reporter(metrics_file, status_interval, status_line, [&]() {
+        rss.set(helpers::current_rss());
+        peak_rss.set(helpers::peak_rss());
+        pool_bytes.set(memory::peak());
+    });
+
+    if(samples.size() == 1) {
+        auto ds = make_generator(0);
+        if(soak && soak_warmup < n_events) {
+            ds->generate_events(soak_warmup);
+            soak_reference = helpers::peak_rss();
+            ds->generate_events(n_events - soak_warmup);
+        } else {
+            ds->generate_events(n_events);
+        }
+        ds->finish();
+        reporter.stop();
+
+        std::cout << "INFO: Generated " << ds->event_count() << " events in " << ds->file_count() << " files ("
+            << ds->bytes_written() / 1024. / 1024. << " MB" << (discard ? ", discarded" : "") << "), peak RSS "
+            << helpers::peak_rss() / 1024. / 1024. << " MB" << std::endl;
+    } else {
+        // one writer per sample, each writing its own partition, on up to n_jobs threads
+        n_jobs = std::max<size_t>(1, std::min(n_jobs, samples.size()));
+        std::atomic<size_t> next_sample(0);
+        std::vector<std::exception_ptr> errors(n_jobs);
+        std::vector<std::thread> workers;
+        for(size_t ijob = 0; ijob < n_jobs; ijob++) {
+            workers.emplace_back([&, ijob]() {
+                try {
+                    size_t isample;
+                    while((isample = next_sample.fetch_add(1)) < samples.size()) {
+                        auto ds = make_generator(isample);
+                        ds->generate_events(n_events);
+                        ds->finish();
+                        std::stringstream msg;
+                        msg << "INFO: Generated " << ds->event_count() << " events of " << ds->partition_directory()
+                            << " in " << ds->file_count() << " files (" << ds->bytes_written() / 1024. / 1024. << " MB"
+                            << (discard ? ", discarded" : "") << ")" << std::endl;
+                        std::cout << msg.str();
+                    }
+                } catch(...) {
+                    errors.at(ijob) = std::current_exception();
+                }
+            });
+        }
+        for(auto& w : workers) {
+            w.join();
+        }
+        reporter.stop();
+        for(auto& e : errors) {
+            if(e) std::rethrow_exception(e);
+        }
+        std::cout << "INFO: Generated " << samples.size() << " samples on " << n_jobs << " threads, peak RSS "
+            << helpers::peak_rss() / 1024. / 1024. << " MB" << std::endl;
+    }
+
+    // the summary of all partitions in the output directory (including those
+    // of earlier runs), merged from their own summaries
+    if(partition && write_summary) {
+        std::vector<std::string> partitions;
+        find_partitions(outdir, "", partitions);
+        if(!partitions.empty()) {
+            helpers::merge_summary_metadata(outdir, partitions);
+            std::cout << "INFO: Summary of " << partitions.size() << " partitions written to "
+                << (std::filesystem::path(outdir) / helpers::kSummaryMetadataFile).string() << std::endl;
+        }
+    } else if(partition && helpers::remove_summary_metadata(outdir)) {
+        std::cout << "INFO: Removed the summary metadata of an earlier run from " << outdir << std::endl;
     }
-    DatasetGenerator ds(row_group_size);
-    ds.init(dataset_name, outdir, compression);
-    for(size_t i = 0; i < n_events; i++) {
-        if(i%count_rate ==0) {
-            std::cout << "INFO: *** Generating event " << i << " / " << n_events << " (" << static_cast<float>(i)/n_events * 100. << " %) ***" << std::endl;
+
+    std::cout << memory::report();
+
+    if(soak && soak_reference > 0) {
+        double growth = (helpers::peak_rss() - soak_reference) / 1024. / 1024.;
+        std::cout << "INFO: Peak RSS after the first " << soak_warmup << " events: " << soak_reference / 1024. / 1024.
+            << " MB, growth since: " << growth << " MB (tolerance: " << soak_tolerance << " MB)" << std::endl;
+        if(growth > soak_tolerance) {
+            std::cout << "ERROR: Soak check failed, the peak resident memory grew during generation" << std::endl;
+            return 1;
         }
-        ds.generate_event();
+        std::cout << "INFO: Soak check passed" << std::endl;
     }
-    ds.finish();
 
+    return 0;
 }
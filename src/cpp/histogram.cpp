@@ -0,0 +1,472 @@
+#include "histogram.h"
+
+// std/stl
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+using nlohmann::json;
+
+namespace hist {
+
+namespace {
+
+// entries are processed in chunks of this size, small enough for the
+// per-chunk scratch buffers to live on the stack and stay in L1
+constexpr int64_t kChunk = 1024;
+
+inline bool bit_is_set(const uint8_t* bits, int64_t i) {
+    return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+template<typename ArrowType>
+void convert(const arrow::Array& array, int64_t start, int64_t n, double* out) {
+    const auto* values = static_cast<const arrow::NumericArray<ArrowType>&>(array).raw_values() + start;
+    for(int64_t i = 0; i < n; i++) {
+        out[i] = static_cast<double>(values[i]);
+    }
+}
+
+// copy elements [start, start + n) of a numeric array into "out" as doubles
+void to_double(const arrow::Array& array, int64_t start, int64_t n, double* out) {
+    switch(array.type_id()) {
+        case arrow::Type::FLOAT: convert<arrow::FloatType>(array, start, n, out); break;
+        case arrow::Type::DOUBLE: convert<arrow::DoubleType>(array, start, n, out); break;
+        case arrow::Type::UINT8: convert<arrow::UInt8Type>(array, start, n, out); break;
+        case arrow::Type::INT8: convert<arrow::Int8Type>(array, start, n, out); break;
+        case arrow::Type::UINT16: convert<arrow::UInt16Type>(array, start, n, out); break;
+        case arrow::Type::INT16: convert<arrow::Int16Type>(array, start, n, out); break;
+        case arrow::Type::UINT32: convert<arrow::UInt32Type>(array, start, n, out); break;
+        case arrow::Type::INT32: convert<arrow::Int32Type>(array, start, n, out); break;
+        case arrow::Type::UINT64: convert<arrow::UInt64Type>(array, start, n, out); break;
+        case arrow::Type::INT64: convert<arrow::Int64Type>(array, start, n, out); break;
+        case arrow::Type::BOOL: {
+            const auto& b = static_cast<const arrow::BooleanArray&>(array);
+            for(int64_t i = 0; i < n; i++) {
+                out[i] = b.Value(start + i) ? 1. : 0.;
+            }
+            break;
+        }
+        default:
+            throw std::runtime_error("ERROR: Cannot fill histogram from array of type " + array.type()->ToString());
+    }
+}
+
+void bin_indices(const Axis& axis, const double* x, int64_t n, int* idx) {
+    for(int64_t i = 0; i < n; i++) {
+        idx[i] = axis.index(x[i]);
+    }
+}
+
+void check_length(const arrow::Array* weights, int64_t n_events) {
+    if(weights && weights->length() != n_events) {
+        throw std::runtime_error("ERROR: Weight array length (" + std::to_string(weights->length())
+                + ") does not match the number of events (" + std::to_string(n_events) + ")");
+    }
+}
+
+//
+// Walk the selected entries of "x" (and optionally "y", with the same layout)
+// in chunks, calling cb(x, y, w, n) with contiguous doubles for the values and
+// the weights. Entries of events that fail the mask are dropped before the
+// callback so the histograms only ever scatter selected entries.
+//
+template<typename Callback>
+void for_each_chunk(const arrow::Array& x, const arrow::Array* y, const arrow::Array* weights,
+        const uint8_t* mask, Callback cb) {
+
+    double xbuf[kChunk], ybuf[kChunk], wbuf[kChunk];
+
+    if(x.type_id() != arrow::Type::LIST) {
+        const int64_t n = x.length();
+        check_length(weights, n);
+        if(y && y->length() != n) {
+            throw std::runtime_error("ERROR: x and y arrays have different lengths");
+        }
+        for(int64_t start = 0; start < n; start += kChunk) {
+            int64_t m = std::min(kChunk, n - start);
+            to_double(x, start, m, xbuf);
+            if(y) to_double(*y, start, m, ybuf);
+            if(weights) {
+                to_double(*weights, start, m, wbuf);
+            } else {
+                std::fill(wbuf, wbuf + m, 1.);
+            }
+            if(mask) {
+                // branch-free in-place compaction of the selected entries
+                int64_t c = 0;
+                for(int64_t k = 0; k < m; k++) {
+                    xbuf[c] = xbuf[k];
+                    wbuf[c] = wbuf[k];
+                    if(y) ybuf[c] = ybuf[k];
+                    c += bit_is_set(mask, start + k);
+                }
+                m = c;
+            }
+            cb(xbuf, y ? ybuf : nullptr, wbuf, m);
+        } // start
+        return;
+    }
+
+    //
+    // jagged: one entry per object, with the weight and mask of its event
+    //
+    const auto& xlist = static_cast<const arrow::ListArray&>(x);
+    const int64_t n_events = xlist.length();
+    check_length(weights, n_events);
+    if(n_events == 0) return;
+    const int32_t* offsets = xlist.raw_value_offsets();
+    const int32_t first = offsets[0];
+    const int64_t n_objects = offsets[n_events] - first;
+
+    const int32_t* yoffsets = nullptr;
+    if(y) {
+        if(y->type_id() != arrow::Type::LIST || y->length() != n_events) {
+            throw std::runtime_error("ERROR: x and y arrays must both be jagged with the same number of events");
+        }
+        yoffsets = static_cast<const arrow::ListArray&>(*y).raw_value_offsets();
+        for(int64_t i = 0; i <= n_events; i++) {
+            if(yoffsets[i] - yoffsets[0] != offsets[i] - first) {
+                throw std::runtime_error("ERROR: x and y arrays have different list offsets");
+            }
+        }
+    }
+
+    std::vector<double> xvalues(n_objects), yvalues(y ? n_objects : 0), event_w(n_events, 1.);
+    to_double(*xlist.values(), first, n_objects, xvalues.data());
+    if(y) to_double(*static_cast<const arrow::ListArray&>(*y).values(), yoffsets[0], n_objects, yvalues.data());
+    if(weights) to_double(*weights, 0, n_events, event_w.data());
+
+    int64_t m = 0;
+    for(int64_t i = 0; i < n_events; i++) {
+        if(mask && !bit_is_set(mask, i)) continue;
+        const double w = event_w[i];
+        for(int32_t j = offsets[i] - first; j < offsets[i+1] - first; j++) {
+            xbuf[m] = xvalues[j];
+            if(y) ybuf[m] = yvalues[j];
+            wbuf[m] = w;
+            if(++m == kChunk) {
+                cb(xbuf, y ? ybuf : nullptr, wbuf, m);
+                m = 0;
+            }
+        } // j
+    } // i
+    if(m > 0) {
+        cb(xbuf, y ? ybuf : nullptr, wbuf, m);
+    }
+}
+
+void check_binning(const Axis& lhs, const Axis& rhs, const std::string& name) {
+    if(lhs != rhs) {
+        throw std::runtime_error("ERROR: Cannot merge histograms \"" + name + "\" with different binning");
+    }
+}
+
+void add_to(std::vector<double>& lhs, const std::vector<double>& rhs) {
+    for(size_t i = 0; i < lhs.size(); i++) {
+        lhs[i] += rhs[i];
+    }
+}
+
+} // namespace
+
+//
+// Axis
+//
+
+Axis::Axis(int n_bins, double lo, double hi) :
+    _n_bins(n_bins),
+    _fixed(true),
+    _lo(lo),
+    _hi(hi)
+{
+    if(n_bins <= 0 || !(hi > lo)) {
+        throw std::runtime_error("ERROR: Invalid fixed binning (" + std::to_string(n_bins) + ", "
+                + std::to_string(lo) + ", " + std::to_string(hi) + ")");
+    }
+    _inv_width = n_bins / (hi - lo);
+    for(int i = 0; i <= n_bins; i++) {
+        _edges.push_back(lo + i * (hi - lo) / n_bins);
+    }
+}
+
+Axis::Axis(const std::vector<double>& edges) :
+    _n_bins(static_cast<int>(edges.size()) - 1),
+    _fixed(false),
+    _edges(edges)
+{
+    if(edges.size() < 2 || !std::is_sorted(edges.begin(), edges.end())
+            || std::adjacent_find(edges.begin(), edges.end()) != edges.end()) {
+        throw std::runtime_error("ERROR: Variable binning requires at least two strictly increasing edges");
+    }
+    _lo = edges.front();
+    _hi = edges.back();
+}
+
+int Axis::index_variable(double x) const {
+    if(!(x >= _lo)) return 0;
+    return static_cast<int>(std::upper_bound(_edges.begin(), _edges.end(), x) - _edges.begin());
+}
+
+json Axis::to_json() const {
+    json j;
+    j["n_bins"] = _n_bins;
+    j["fixed"] = _fixed;
+    j["edges"] = _edges;
+    return j;
+}
+
+//
+// Histogram1D
+//
+
+Histogram1D::Histogram1D(const std::string& name, const Axis& axis, const std::string& title) :
+    Histogram(name, title),
+    _axis(axis),
+    _sumw(axis.n_bins() + 2, 0.),
+    _sumw2(axis.n_bins() + 2, 0.)
+{
+}
+
+void Histogram1D::fill(const arrow::Array& values, const arrow::Array* weights, const uint8_t* mask) {
+    for_each_chunk(values, nullptr, weights, mask,
+            [this](const double* x, const double*, const double* w, int64_t n) {
+        int idx[kChunk];
+        bin_indices(_axis, x, n, idx);
+        for(int64_t k = 0; k < n; k++) {
+            _sumw[idx[k]] += w[k];
+            _sumw2[idx[k]] += w[k] * w[k];
+        }
+        _entries += n;
+    });
+}
+
+std::unique_ptr<Histogram> Histogram1D::clone_empty() const {
+    return std::make_unique<Histogram1D>(_name, _axis, _title);
+}
+
+void Histogram1D::merge(const Histogram& other) {
+    const auto& o = dynamic_cast<const Histogram1D&>(other);
+    check_binning(_axis, o._axis, _name);
+    add_to(_sumw, o._sumw);
+    add_to(_sumw2, o._sumw2);
+    _entries += o._entries;
+}
+
+json Histogram1D::to_json() const {
+    json j;
+    j["type"] = "hist1d";
+    j["name"] = _name;
+    j["title"] = _title;
+    j["entries"] = _entries;
+    j["axis"] = _axis.to_json();
+    j["sumw"] = _sumw;
+    j["sumw2"] = _sumw2;
+    return j;
+}
+
+//
+// Histogram2D
+//
+
+Histogram2D::Histogram2D(const std::string& name, const Axis& x_axis, const Axis& y_axis,
+        const std::string& title) :
+    Histogram(name, title),
+    _x_axis(x_axis),
+    _y_axis(y_axis),
+    _stride(x_axis.n_bins() + 2),
+    _sumw((x_axis.n_bins() + 2) * (y_axis.n_bins() + 2), 0.),
+    _sumw2((x_axis.n_bins() + 2) * (y_axis.n_bins() + 2), 0.)
+{
+}
+
+void Histogram2D::fill(const arrow::Array& x, const arrow::Array& y, const arrow::Array* weights,
+        const uint8_t* mask) {
+    for_each_chunk(x, &y, weights, mask,
+            [this](const double* xv, const double* yv, const double* w, int64_t n) {
+        int ix[kChunk], iy[kChunk];
+        bin_indices(_x_axis, xv, n, ix);
+        bin_indices(_y_axis, yv, n, iy);
+        for(int64_t k = 0; k < n; k++) {
+            const int i = ix[k] + _stride * iy[k];
+            _sumw[i] += w[k];
+            _sumw2[i] += w[k] * w[k];
+        }
+        _entries += n;
+    });
+}
+
+std::unique_ptr<Histogram> Histogram2D::clone_empty() const {
+    return std::make_unique<Histogram2D>(_name, _x_axis, _y_axis, _title);
+}
+
+void Histogram2D::merge(const Histogram& other) {
+    const auto& o = dynamic_cast<const Histogram2D&>(other);
+    check_binning(_x_axis, o._x_axis, _name);
+    check_binning(_y_axis, o._y_axis, _name);
+    add_to(_sumw, o._sumw);
+    add_to(_sumw2, o._sumw2);
+    _entries += o._entries;
+}
+
+json Histogram2D::to_json() const {
+    json j;
+    j["type"] = "hist2d";
+    j["name"] = _name;
+    j["title"] = _title;
+    j["entries"] = _entries;
+    j["x_axis"] = _x_axis.to_json();
+    j["y_axis"] = _y_axis.to_json();
+    // row-major in y, i.e. index = ix + (n_x_bins + 2) * iy
+    j["sumw"] = _sumw;
+    j["sumw2"] = _sumw2;
+    return j;
+}
+
+//
+// Profile1D
+//
+
+Profile1D::Profile1D(const std::string& name, const Axis& axis, const std::string& title) :
+    Histogram(name, title),
+    _axis(axis),
+    _sumw(axis.n_bins() + 2, 0.),
+    _sumw2(axis.n_bins() + 2, 0.),
+    _sumwy(axis.n_bins() + 2, 0.),
+    _sumwy2(axis.n_bins() + 2, 0.)
+{
+}
+
+void Profile1D::fill(const arrow::Array& x, const arrow::Array& y, const arrow::Array* weights,
+        const uint8_t* mask) {
+    for_each_chunk(x, &y, weights, mask,
+            [this](const double* xv, const double* yv, const double* w, int64_t n) {
+        int idx[kChunk];
+        bin_indices(_axis, xv, n, idx);
+        for(int64_t k = 0; k < n; k++) {
+            const int i = idx[k];
+            const double wy = w[k] * yv[k];
+            _sumw[i] += w[k];
+            _sumw2[i] += w[k] * w[k];
+            _sumwy[i] += wy;
+            _sumwy2[i] += wy * yv[k];
+        }
+        _entries += n;
+    });
+}
+
+std::unique_ptr<Histogram> Profile1D::clone_empty() const {
+    return std::make_unique<Profile1D>(_name, _axis, _title);
+}
+
+void Profile1D::merge(const Histogram& other) {
+    const auto& o = dynamic_cast<const Profile1D&>(other);
+    check_binning(_axis, o._axis, _name);
+    add_to(_sumw, o._sumw);
+    add_to(_sumw2, o._sumw2);
+    add_to(_sumwy, o._sumwy);
+    add_to(_sumwy2, o._sumwy2);
+    _entries += o._entries;
+}
+
+json Profile1D::to_json() const {
+    json j;
+    j["type"] = "profile1d";
+    j["name"] = _name;
+    j["title"] = _title;
+    j["entries"] = _entries;
+    j["axis"] = _axis.to_json();
+    j["sumw"] = _sumw;
+    j["sumw2"] = _sumw2;
+    j["sumwy"] = _sumwy;
+    j["sumwy2"] = _sumwy2;
+    std::vector<double> means;
+    for(size_t i = 0; i < _sumw.size(); i++) {
+        means.push_back(mean(i));
+    }
+    j["mean"] = means;
+    return j;
+}
+
+//
+// HistogramBook
+//
+
+void HistogramBook::add(std::unique_ptr<Histogram> histogram) {
+    const auto& name = histogram->name();
+    if(_index.count(name)) {
+        throw std::runtime_error("ERROR: Histogram \"" + name + "\" booked twice");
+    }
+    _index[name] = _histograms.size();
+    _histograms.push_back(std::move(histogram));
+}
+
+Histogram1D& HistogramBook::book_1d(const std::string& name, const Axis& axis, const std::string& title) {
+    auto h = std::make_unique<Histogram1D>(name, axis, title);
+    auto& out = *h;
+    add(std::move(h));
+    return out;
+}
+
+Histogram2D& HistogramBook::book_2d(const std::string& name, const Axis& x_axis, const Axis& y_axis,
+        const std::string& title) {
+    auto h = std::make_unique<Histogram2D>(name, x_axis, y_axis, title);
+    auto& out = *h;
+    add(std::move(h));
+    return out;
+}
+
+Profile1D& HistogramBook::book_profile(const std::string& name, const Axis& axis, const std::string& title) {
+    auto h = std::make_unique<Profile1D>(name, axis, title);
+    auto& out = *h;
+    add(std::move(h));
+    return out;
+}
+
+Histogram& HistogramBook::at(const std::string& name) {
+    auto it = _index.find(name);
+    if(it == _index.end()) {
+        throw std::runtime_error("ERROR: Histogram \"" + name + "\" not booked");
+    }
+    return *_histograms.at(it->second);
+}
+
+HistogramBook HistogramBook::clone_empty() const {
+    HistogramBook out;
+    for(const auto& h : _histograms) {
+        out.add(h->clone_empty());
+    }
+    return out;
+}
+
+void HistogramBook::merge(const HistogramBook& other) {
+    if(other._histograms.size() != _histograms.size()) {
+        throw std::runtime_error("ERROR: Cannot merge histogram books of different sizes");
+    }
+    for(size_t i = 0; i < _histograms.size(); i++) {
+        if(_histograms.at(i)->name() != other._histograms.at(i)->name()) {
+            throw std::runtime_error("ERROR: Cannot merge histogram books with different contents");
+        }
+        _histograms.at(i)->merge(*other._histograms.at(i));
+    }
+}
+
+json HistogramBook::to_json() const {
+    json j;
+    j["histograms"] = json::array();
+    for(const auto& h : _histograms) {
+        j["histograms"].push_back(h->to_json());
+    }
+    return j;
+}
+
+void HistogramBook::write_json(const std::string& filename) const {
+    std::ofstream ofs(filename);
+    if(!ofs.good()) {
+        throw std::runtime_error("ERROR: Unable to open output file \"" + filename + "\"");
+    }
+    ofs << std::setw(2) << to_json() << std::endl;
+}
+
+}; // namespace hist
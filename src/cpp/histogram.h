@@ -0,0 +1,269 @@
+#pragma once
+
+//std/stl
+#include <string>
+#include <vector>
+#include <memory>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <exception>
+#include <stdint.h>
+
+//arrow
+#include <arrow/api.h>
+
+//nlohmann
+#include "json.hpp"
+
+//
+// Weighted histograms (1D, 2D and 1D profiles) with fixed or variable binning,
+// filled in batches directly from Arrow arrays.
+//
+// Filling is not thread safe by design: each thread fills its own copy of the
+// histograms (see HistogramBook::clone_empty and fill_parallel) and the copies
+// are merged once at the end, so that the fill path has no atomics or locks.
+//
+// Batch fills take an optional selection mask, which is an Arrow-style
+// (LSB-first) packed bitmap with one bit per event. For jagged (list<>) value
+// arrays the per-event weight and mask are broadcast to each object.
+//
+namespace hist {
+
+    class Axis {
+        public:
+            // n_bins equal-width bins in [lo, hi)
+            Axis(int n_bins, double lo, double hi);
+            // variable-width bins with the given (increasing) edges
+            Axis(const std::vector<double>& edges);
+            Axis() = default;
+
+            int n_bins() const { return _n_bins; }
+            bool is_fixed() const { return _fixed; }
+            const std::vector<double>& edges() const { return _edges; }
+
+            // bin index including under/overflow: 0 is the underflow bin,
+            // n_bins() + 1 the overflow bin; NaN goes to the underflow bin
+            inline int index(double x) const {
+                if(_fixed) {
+                    const double t = (x - _lo) * _inv_width;
+                    if(!(t >= 0.)) return 0;
+                    if(t >= _n_bins) return _n_bins + 1;
+                    return static_cast<int>(t) + 1;
+                }
+                return index_variable(x);
+            }
+
+            bool operator==(const Axis& other) const { return _edges == other._edges; }
+            bool operator!=(const Axis& other) const { return !(*this == other); }
+            nlohmann::json to_json() const;
+
+        private :
+            int _n_bins = 0;
+            bool _fixed = true;
+            double _lo = 0;
+            double _hi = 0;
+            double _inv_width = 0;
+            std::vector<double> _edges;
+
+            int index_variable(double x) const;
+    }; // class Axis
+
+    class Histogram {
+        public:
+            Histogram(const std::string& name, const std::string& title = "") :
+                _name(name), _title(title), _entries(0) {}
+            virtual ~Histogram() = default;
+
+            const std::string& name() const { return _name; }
+            const std::string& title() const { return _title; }
+            int64_t entries() const { return _entries; }
+
+            // a copy with the same binning and zeroed contents
+            virtual std::unique_ptr<Histogram> clone_empty() const = 0;
+            // add the contents of "other", which must have identical binning
+            virtual void merge(const Histogram& other) = 0;
+            virtual nlohmann::json to_json() const = 0;
+
+        protected :
+            std::string _name;
+            std::string _title;
+            int64_t _entries;
+    }; // class Histogram
+
+    class Histogram1D : public Histogram {
+        public:
+            Histogram1D(const std::string& name, const Axis& axis, const std::string& title = "");
+
+            inline void fill(double x, double w = 1.) {
+                const int i = _axis.index(x);
+                _sumw[i] += w;
+                _sumw2[i] += w * w;
+                _entries++;
+            }
+
+            // one entry per element of "values" (numeric, or list<numeric> with
+            // per-event "weights" and "mask")
+            void fill(const arrow::Array& values, const arrow::Array* weights = nullptr,
+                    const uint8_t* mask = nullptr);
+
+            const Axis& axis() const { return _axis; }
+            const std::vector<double>& sumw() const { return _sumw; }
+            const std::vector<double>& sumw2() const { return _sumw2; }
+
+            std::unique_ptr<Histogram> clone_empty() const override;
+            void merge(const Histogram& other) override;
+            nlohmann::json to_json() const override;
+
+        private :
+            Axis _axis;
+            std::vector<double> _sumw;
+            std::vector<double> _sumw2;
+    }; // class Histogram1D
+
+    class Histogram2D : public Histogram {
+        public:
+            Histogram2D(const std::string& name, const Axis& x_axis, const Axis& y_axis,
+                    const std::string& title = "");
+
+            inline void fill(double x, double y, double w = 1.) {
+                const int i = _x_axis.index(x) + _stride * _y_axis.index(y);
+                _sumw[i] += w;
+                _sumw2[i] += w * w;
+                _entries++;
+            }
+
+            // x and y must have the same layout (both flat, or both jagged with equal offsets)
+            void fill(const arrow::Array& x, const arrow::Array& y, const arrow::Array* weights = nullptr,
+                    const uint8_t* mask = nullptr);
+
+            const Axis& x_axis() const { return _x_axis; }
+            const Axis& y_axis() const { return _y_axis; }
+            const std::vector<double>& sumw() const { return _sumw; }
+            const std::vector<double>& sumw2() const { return _sumw2; }
+
+            std::unique_ptr<Histogram> clone_empty() const override;
+            void merge(const Histogram& other) override;
+            nlohmann::json to_json() const override;
+
+        private :
+            Axis _x_axis;
+            Axis _y_axis;
+            int _stride;
+            std::vector<double> _sumw;
+            std::vector<double> _sumw2;
+    }; // class Histogram2D
+
+    // weighted mean (and spread) of y in bins of x
+    class Profile1D : public Histogram {
+        public:
+            Profile1D(const std::string& name, const Axis& axis, const std::string& title = "");
+
+            inline void fill(double x, double y, double w = 1.) {
+                const int i = _axis.index(x);
+                _sumw[i] += w;
+                _sumw2[i] += w * w;
+                _sumwy[i] += w * y;
+                _sumwy2[i] += w * y * y;
+                _entries++;
+            }
+
+            void fill(const arrow::Array& x, const arrow::Array& y, const arrow::Array* weights = nullptr,
+                    const uint8_t* mask = nullptr);
+
+            const Axis& axis() const { return _axis; }
+            // weighted mean of y in bin i
+            double mean(int i) const { return _sumw[i] != 0. ? _sumwy[i] / _sumw[i] : 0.; }
+
+            std::unique_ptr<Histogram> clone_empty() const override;
+            void merge(const Histogram& other) override;
+            nlohmann::json to_json() const override;
+
+        private :
+            Axis _axis;
+            std::vector<double> _sumw;
+            std::vector<double> _sumw2;
+            std::vector<double> _sumwy;
+            std::vector<double> _sumwy2;
+    }; // class Profile1D
+
+    // a named collection of histograms that is filled together, e.g. by one thread
+    class HistogramBook {
+        public:
+            HistogramBook() = default;
+            HistogramBook(HistogramBook&&) = default;
+            HistogramBook& operator=(HistogramBook&&) = default;
+
+            Histogram1D& book_1d(const std::string& name, const Axis& axis, const std::string& title = "");
+            Histogram2D& book_2d(const std::string& name, const Axis& x_axis, const Axis& y_axis,
+                    const std::string& title = "");
+            Profile1D& book_profile(const std::string& name, const Axis& axis, const std::string& title = "");
+
+            size_t size() const { return _histograms.size(); }
+            Histogram& at(size_t i) { return *_histograms.at(i); }
+            const Histogram& at(size_t i) const { return *_histograms.at(i); }
+            Histogram& at(const std::string& name);
+
+            // a book with the same histograms (and the same order), all empty
+            HistogramBook clone_empty() const;
+            // add "other" histogram-by-histogram, the books must have been cloned from one another
+            void merge(const HistogramBook& other);
+
+            nlohmann::json to_json() const;
+            void write_json(const std::string& filename) const;
+
+        private :
+            std::vector<std::unique_ptr<Histogram>> _histograms;
+            std::map<std::string, size_t> _index;
+
+            void add(std::unique_ptr<Histogram> histogram);
+    }; // class HistogramBook
+
+    // Run "fill(book, task, thread)" for each task in [0, n_tasks) on n_threads threads,
+    // each thread filling its own empty clone of "prototype", and return the merged book.
+    // Tasks are handed out dynamically; the per-thread books are merged in thread order.
+    // The thread index (< n_threads) lets callers keep per-thread state such as readers.
+    template<typename FillFunc>
+    HistogramBook fill_parallel(const HistogramBook& prototype, size_t n_tasks, size_t n_threads,
+            FillFunc fill) {
+        if(n_threads == 0) {
+            n_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+        }
+        n_threads = std::max<size_t>(1, std::min(n_threads, n_tasks));
+
+        std::vector<HistogramBook> books;
+        for(size_t i = 0; i < n_threads; i++) {
+            books.push_back(prototype.clone_empty());
+        }
+
+        std::atomic<size_t> next_task(0);
+        std::vector<std::exception_ptr> errors(n_threads);
+        std::vector<std::thread> threads;
+        for(size_t ithread = 0; ithread < n_threads; ithread++) {
+            threads.emplace_back([&, ithread]() {
+                try {
+                    size_t task;
+                    while((task = next_task.fetch_add(1)) < n_tasks) {
+                        fill(books.at(ithread), task, ithread);
+                    }
+                } catch(...) {
+                    errors.at(ithread) = std::current_exception();
+                }
+            });
+        }
+        for(auto& t : threads) {
+            t.join();
+        }
+        for(auto& e : errors) {
+            if(e) std::rethrow_exception(e);
+        }
+
+        HistogramBook out = prototype.clone_empty();
+        for(const auto& book : books) {
+            out.merge(book);
+        }
+        return out;
+    }
+
+}; // namespace hist
@@ -0,0 +1,363 @@
+#include "kinematics.h"
+
+// std/stl
+#include <cmath>
+#include <cstring> // memcpy
+#include <limits>
+#include <vector>
+#include <stdexcept>
+
+// parquet
+#include <parquet/exception.h>
+
+namespace kinematics {
+
+namespace {
+
+//
+// branch-free single precision approximations (cephes coefficients), written
+// so that they inline into "omp simd" loops and vectorize; the arguments we
+// care about are bounded (|phi| <= pi, |eta| < ~5)
+//
+
+inline float round_nearest(float x) {
+    // round-to-nearest via the 1.5 * 2^23 trick, valid for |x| < 2^22
+    const float magic = 12582912.f;
+    return (x + magic) - magic;
+}
+
+inline void sincos_kernel(float x, float& s, float& c) {
+    // reduce to r in [-pi/4, pi/4] with a three-part (Cody-Waite) pi/2
+    const float j = round_nearest(x * 0.636619772367581343f);
+    const float r = ((x - j * 1.5703125f) - j * 4.837512969970703125e-4f) - j * 7.54978995489188216e-8f;
+    const float z = r * r;
+    const float sp = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * r + r;
+    const float cp = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z
+                        - 0.5f * z + 1.f;
+    const int q = static_cast<int>(j) & 3;
+    const float s_abs = (q & 1) ? cp : sp;
+    const float c_abs = (q & 1) ? sp : cp;
+    s = (q & 2) ? -s_abs : s_abs;
+    c = ((q + 1) & 2) ? -c_abs : c_abs;
+}
+
+inline float exp_kernel(float x) {
+    x = x > 88.f ? 88.f : x;
+    x = x < -87.f ? -87.f : x;
+    const float n = round_nearest(x * 1.44269504088896341f);
+    const float r = (x - n * 0.693359375f) + n * 2.12194440e-4f;
+    float p = ((((1.9875691500e-4f * r + 1.3981999507e-3f) * r + 8.3334519073e-3f) * r
+                + 4.1665795894e-2f) * r + 1.6666665459e-1f) * r + 5.0000001201e-1f;
+    p = p * r * r + r + 1.f;
+    // scale by 2^n by building the exponent bits directly
+    const int32_t bits = (static_cast<int32_t>(n) + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(float));
+    return p * scale;
+}
+
+inline void sinhcosh_kernel(float x, float& sh, float& ch) {
+    const float e = exp_kernel(x);
+    const float ie = 1.f / e;
+    ch = 0.5f * (e + ie);
+    // the exponential form cancels badly near zero, use the series there
+    const float z = x * x;
+    const float series = x + x * z * (1.f / 6.f + z * (1.f / 120.f + z * (1.f / 5040.f)));
+    const float ax = x < 0.f ? -x : x;
+    sh = ax < 0.5f ? series : 0.5f * (e - ie);
+}
+
+inline float wrap_phi(float dphi) {
+    const float two_pi = 6.28318530717958648f;
+    return dphi - two_pi * round_nearest(dphi * (1.f / two_pi));
+}
+
+// cartesian four-vectors of every object in a batch, stored contiguously and
+// indexed relative to the first object of the batch
+struct Cartesian {
+    std::vector<float> px;
+    std::vector<float> py;
+    std::vector<float> pz;
+    std::vector<float> e;
+};
+
+template<bool HasMass>
+void fill_cartesian(const float* pt, const float* eta, const float* phi, const float* m,
+        float* px, float* py, float* pz, float* e, int64_t n) {
+#pragma omp simd
+    for(int64_t i = 0; i < n; i++) {
+        float s, c, sh, ch;
+        sincos_kernel(phi[i], s, c);
+        sinhcosh_kernel(eta[i], sh, ch);
+        const float p = pt[i];
+        const float p_tot = p * ch;
+        const float mass = HasMass ? m[i] : 0.f;
+        px[i] = p * c;
+        py[i] = p * s;
+        pz[i] = p * sh;
+        e[i] = std::sqrt(p_tot * p_tot + mass * mass);
+    } // i
+}
+
+Cartesian to_cartesian(const JaggedP4& objects) {
+    Cartesian out;
+    const int64_t n = objects.n_objects();
+    out.px.resize(n);
+    out.py.resize(n);
+    out.pz.resize(n);
+    out.e.resize(n);
+    if(n == 0) {
+        return out;
+    }
+
+    const int64_t first = objects.offsets[0];
+    if(objects.m) {
+        fill_cartesian<true>(objects.pt + first, objects.eta + first, objects.phi + first, objects.m + first,
+                out.px.data(), out.py.data(), out.pz.data(), out.e.data(), n);
+    } else {
+        fill_cartesian<false>(objects.pt + first, objects.eta + first, objects.phi + first, nullptr,
+                out.px.data(), out.py.data(), out.pz.data(), out.e.data(), n);
+    }
+    return out;
+}
+
+std::shared_ptr<arrow::Buffer> allocate(int64_t n_bytes, arrow::MemoryPool* pool) {
+    std::shared_ptr<arrow::Buffer> out;
+    PARQUET_ASSIGN_OR_THROW(out, arrow::AllocateBuffer(n_bytes, pool));
+    return out;
+}
+
+float* float_data(const std::shared_ptr<arrow::Buffer>& buffer) {
+    return reinterpret_cast<float*>(buffer->mutable_data());
+}
+
+void check_aligned(const JaggedP4& a, const JaggedP4& b) {
+    if(a.n_events != b.n_events) {
+        throw std::runtime_error("ERROR: Object collections have different numbers of events ("
+                + std::to_string(a.n_events) + " vs " + std::to_string(b.n_events) + ")");
+    }
+}
+
+} // namespace
+
+namespace vmath {
+
+void sincos(const float* x, float* s, float* c, int64_t n) {
+#pragma omp simd
+    for(int64_t i = 0; i < n; i++) {
+        sincos_kernel(x[i], s[i], c[i]);
+    }
+}
+
+void sinhcosh(const float* x, float* sh, float* ch, int64_t n) {
+#pragma omp simd
+    for(int64_t i = 0; i < n; i++) {
+        sinhcosh_kernel(x[i], sh[i], ch[i]);
+    }
+}
+
+} // namespace vmath
+
+JaggedP4 jagged_p4(const std::shared_ptr<arrow::Array>& column,
+        const std::string& list_name,
+        const std::string& mass_name) {
+
+    if(column->type_id() != arrow::Type::STRUCT) {
+        throw std::runtime_error("ERROR: jagged_p4 expects a struct column, got: " + column->type()->ToString());
+    }
+    auto list_array = std::static_pointer_cast<arrow::StructArray>(column)->GetFieldByName(list_name);
+    if(!list_array || list_array->type_id() != arrow::Type::LIST) {
+        throw std::runtime_error("ERROR: jagged_p4 could not find list field \"" + list_name + "\"");
+    }
+    auto list = std::static_pointer_cast<arrow::ListArray>(list_array);
+    if(list->values()->type_id() != arrow::Type::STRUCT) {
+        throw std::runtime_error("ERROR: jagged_p4 expects a list of structs for field \"" + list_name + "\"");
+    }
+    auto objects = std::static_pointer_cast<arrow::StructArray>(list->values());
+
+    auto child = [&](const std::string& name, bool required) -> const float* {
+        auto field = objects->GetFieldByName(name);
+        if(!field) {
+            if(required) {
+                throw std::runtime_error("ERROR: jagged_p4 could not find field \"" + list_name + "." + name + "\"");
+            }
+            return nullptr;
+        }
+        if(field->type_id() != arrow::Type::FLOAT) {
+            throw std::runtime_error("ERROR: jagged_p4 expects field \"" + list_name + "." + name + "\" to be float32");
+        }
+        return std::static_pointer_cast<arrow::FloatArray>(field)->raw_values();
+    };
+
+    JaggedP4 out;
+    out.n_events = list->length();
+    out.offsets = list->raw_value_offsets();
+    out.pt = child("pt", true);
+    out.eta = child("eta", true);
+    out.phi = child("phi", true);
+    out.m = child(mass_name, false);
+    out.list = list;
+    return out;
+}
+
+std::shared_ptr<arrow::FloatArray> ht(const JaggedP4& objects, arrow::MemoryPool* pool) {
+    const int64_t n_events = objects.n_events;
+    auto values = allocate(n_events * sizeof(float), pool);
+    float* out = float_data(values);
+
+    const int32_t* offsets = objects.offsets;
+    const float* pt = objects.pt;
+    for(int64_t i = 0; i < n_events; i++) {
+        float sum = 0.f;
+#pragma omp simd reduction(+:sum)
+        for(int32_t j = offsets[i]; j < offsets[i+1]; j++) {
+            sum += pt[j];
+        }
+        out[i] = sum;
+    } // i
+    return std::make_shared<arrow::FloatArray>(n_events, values);
+}
+
+std::shared_ptr<arrow::FloatArray> leading_pair_mass(const JaggedP4& objects, arrow::MemoryPool* pool) {
+    const int64_t n_events = objects.n_events;
+    auto values = allocate(n_events * sizeof(float), pool);
+    float* out = float_data(values);
+    if(n_events == 0) {
+        return std::make_shared<arrow::FloatArray>(n_events, values);
+    }
+
+    const auto p4 = to_cartesian(objects);
+    const int32_t* offsets = objects.offsets;
+    const int32_t first = offsets[0];
+    for(int64_t i = 0; i < n_events; i++) {
+        const int32_t begin = offsets[i] - first;
+        const int32_t end = offsets[i+1] - first;
+        if(end - begin < 2) {
+            out[i] = std::numeric_limits<float>::quiet_NaN();
+            continue;
+        }
+
+        // indices of the two highest-pt objects
+        int32_t i0 = begin;
+        int32_t i1 = begin + 1;
+        const float* pt = objects.pt + first;
+        if(pt[i1] > pt[i0]) {
+            std::swap(i0, i1);
+        }
+        for(int32_t j = begin + 2; j < end; j++) {
+            if(pt[j] > pt[i0]) {
+                i1 = i0;
+                i0 = j;
+            } else if(pt[j] > pt[i1]) {
+                i1 = j;
+            }
+        } // j
+
+        // the mass is a small difference of large numbers, form it in double
+        const double px = static_cast<double>(p4.px[i0]) + p4.px[i1];
+        const double py = static_cast<double>(p4.py[i0]) + p4.py[i1];
+        const double pz = static_cast<double>(p4.pz[i0]) + p4.pz[i1];
+        const double e = static_cast<double>(p4.e[i0]) + p4.e[i1];
+        const double m2 = e * e - px * px - py * py - pz * pz;
+        out[i] = m2 > 0. ? std::sqrt(m2) : 0.f;
+    } // i
+    return std::make_shared<arrow::FloatArray>(n_events, values);
+}
+
+std::shared_ptr<arrow::StructArray> sum_p4(const JaggedP4& objects, arrow::MemoryPool* pool) {
+    const int64_t n_events = objects.n_events;
+    auto pt_values = allocate(n_events * sizeof(float), pool);
+    auto eta_values = allocate(n_events * sizeof(float), pool);
+    auto phi_values = allocate(n_events * sizeof(float), pool);
+    auto m_values = allocate(n_events * sizeof(float), pool);
+    float* out_pt = float_data(pt_values);
+    float* out_eta = float_data(eta_values);
+    float* out_phi = float_data(phi_values);
+    float* out_m = float_data(m_values);
+
+    if(n_events > 0) {
+        const auto p4 = to_cartesian(objects);
+        const int32_t* offsets = objects.offsets;
+        const int32_t first = offsets[0];
+        for(int64_t i = 0; i < n_events; i++) {
+            double px = 0., py = 0., pz = 0., e = 0.;
+#pragma omp simd reduction(+:px,py,pz,e)
+            for(int32_t j = offsets[i] - first; j < offsets[i+1] - first; j++) {
+                px += p4.px[j];
+                py += p4.py[j];
+                pz += p4.pz[j];
+                e += p4.e[j];
+            } // j
+            const double pt = std::sqrt(px * px + py * py);
+            const double m2 = e * e - px * px - py * py - pz * pz;
+            out_pt[i] = pt;
+            out_eta[i] = pt > 0. ? std::asinh(pz / pt) : 0.;
+            out_phi[i] = std::atan2(py, px);
+            out_m[i] = m2 > 0. ? std::sqrt(m2) : 0.;
+        } // i
+    }
+
+    std::shared_ptr<arrow::StructArray> out;
+    PARQUET_ASSIGN_OR_THROW(out, arrow::StructArray::Make(
+                {
+                    std::make_shared<arrow::FloatArray>(n_events, pt_values),
+                    std::make_shared<arrow::FloatArray>(n_events, eta_values),
+                    std::make_shared<arrow::FloatArray>(n_events, phi_values),
+                    std::make_shared<arrow::FloatArray>(n_events, m_values)
+                },
+                std::vector<std::string>{"pt", "eta", "phi", "m"}
+            ));
+    return out;
+}
+
+std::shared_ptr<arrow::ListArray> min_delta_r(const JaggedP4& a, const JaggedP4& b, arrow::MemoryPool* pool) {
+    check_aligned(a, b);
+    const int64_t n_events = a.n_events;
+    const int64_t n_objects = a.n_objects();
+
+    // the output list is rebased so that its first offset is zero
+    auto offsets_buffer = allocate((n_events + 1) * sizeof(int32_t), pool);
+    auto values = allocate(n_objects * sizeof(float), pool);
+    int32_t* out_offsets = reinterpret_cast<int32_t*>(offsets_buffer->mutable_data());
+    float* out = float_data(values);
+
+    const int32_t a_first = n_events ? a.offsets[0] : 0;
+    for(int64_t i = 0; i <= n_events; i++) {
+        out_offsets[i] = a.offsets[i] - a_first;
+    }
+
+    // minimum Delta R^2 for each object in a, the square root is taken in one
+    // vectorized pass at the end
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for(int64_t i = 0; i < n_events; i++) {
+        const int32_t b_begin = b.offsets[i];
+        const int32_t b_end = b.offsets[i+1];
+        for(int32_t ia = a.offsets[i]; ia < a.offsets[i+1]; ia++) {
+            if(b_begin == b_end) {
+                out[ia - a_first] = nan;
+                continue;
+            }
+            const float eta = a.eta[ia];
+            const float phi = a.phi[ia];
+            float best = std::numeric_limits<float>::infinity();
+#pragma omp simd reduction(min:best)
+            for(int32_t ib = b_begin; ib < b_end; ib++) {
+                const float deta = eta - b.eta[ib];
+                const float dphi = wrap_phi(phi - b.phi[ib]);
+                const float dr2 = deta * deta + dphi * dphi;
+                best = dr2 < best ? dr2 : best;
+            } // ib
+            out[ia - a_first] = best;
+        } // ia
+    } // i
+
+#pragma omp simd
+    for(int64_t j = 0; j < n_objects; j++) {
+        out[j] = std::sqrt(out[j]);
+    }
+
+    return std::make_shared<arrow::ListArray>(arrow::list(arrow::float32()), n_events, offsets_buffer,
+            std::make_shared<arrow::FloatArray>(n_objects, values));
+}
+
+}; // namespace kinematics
@@ -0,0 +1,84 @@
+#pragma once
+
+//std/stl
+#include <string>
+#include <memory>
+#include <stdint.h>
+
+//arrow
+#include <arrow/api.h>
+
+//
+// Kernels for derived kinematic quantities computed directly on the
+// flattened child arrays of the jagged list<struct> columns written by
+// DatasetGenerator (e.g. "jets.jets.{pt,eta,phi,m}" and "leptons.leptons.*").
+//
+// The object attributes are first converted to cartesian four-vectors in one
+// contiguous, vectorized pass over all objects in the batch, after which the
+// per-event quantities are formed with segmented loops over the list offsets.
+// Nothing is materialized per event and no object is ever visited through
+// the nested arrow::Array accessors.
+//
+// The input columns are expected to have no null entries, which is the case
+// for everything produced by gen-dataset.
+//
+namespace kinematics {
+
+    // Non-owning view of a list<struct{pt, eta, phi[, m]}> column as flat,
+    // contiguous child buffers plus the list offsets. The view keeps
+    // a reference to the list array so that the buffers stay valid.
+    struct JaggedP4 {
+        int64_t n_events = 0;
+        const int32_t* offsets = nullptr; // n_events + 1 entries
+        const float* pt = nullptr;
+        const float* eta = nullptr;
+        const float* phi = nullptr;
+        const float* m = nullptr; // nullptr for massless objects (e.g. leptons)
+        std::shared_ptr<arrow::ListArray> list;
+
+        int64_t n_objects() const { return n_events ? offsets[n_events] - offsets[0] : 0; }
+    };
+
+    // Build a JaggedP4 view for the list field "list_name" of the top-level
+    // struct column "column", e.g. jagged_p4(table->column(1)->chunk(0), "jets").
+    // The mass child is optional and is looked up by "mass_name".
+    JaggedP4 jagged_p4(const std::shared_ptr<arrow::Array>& column,
+            const std::string& list_name,
+            const std::string& mass_name = "m");
+
+    //
+    // per-event quantities, aligned to the event offsets (one entry per event)
+    //
+
+    // scalar sum of the object pt
+    std::shared_ptr<arrow::FloatArray> ht(const JaggedP4& objects,
+            arrow::MemoryPool* pool = arrow::default_memory_pool());
+
+    // invariant mass of the two highest-pt objects, NaN for events with fewer than two
+    std::shared_ptr<arrow::FloatArray> leading_pair_mass(const JaggedP4& objects,
+            arrow::MemoryPool* pool = arrow::default_memory_pool());
+
+    // four-vector sum of all objects in the event, as struct{pt, eta, phi, m}
+    std::shared_ptr<arrow::StructArray> sum_p4(const JaggedP4& objects,
+            arrow::MemoryPool* pool = arrow::default_memory_pool());
+
+    //
+    // per-object quantities, aligned to the object offsets of the first argument
+    //
+
+    // for each object in "a", the minimum Delta R to any object of "b" in the
+    // same event (NaN if the event has no objects in "b")
+    std::shared_ptr<arrow::ListArray> min_delta_r(const JaggedP4& a, const JaggedP4& b,
+            arrow::MemoryPool* pool = arrow::default_memory_pool());
+
+    //
+    // vectorized elementary functions used by the kernels, exposed so that the
+    // scalar reference in bench-kinematics can be checked against them
+    //
+    namespace vmath {
+        // n-element loops over contiguous buffers
+        void sincos(const float* x, float* s, float* c, int64_t n);
+        void sinhcosh(const float* x, float* sh, float* ch, int64_t n);
+    } // namespace vmath
+
+}; // namespace kinematics
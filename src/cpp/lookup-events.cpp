@@ -0,0 +1,137 @@
+#include "dataset_reader.h"
+#include "event_lookup.h"
+#include "table_sink.h"
+
+//std/stl
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring> // strcmp
+#include <chrono>
+#include <algorithm> // max
+
+//arrow/parquet
+#include <arrow/io/api.h>
+#include <parquet/exception.h>
+
+void print_usage(char* argv[]) {
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+    std::cout << " Fetch events by their id (or another integer key) from a dataset, reading only the" << std::endl;
+    std::cout << " RowGroups that its statistics and Bloom filters allow to contain them" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Usage: " << argv[0] << " [OPTIONS] <input dataset (file or directory)>" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Options:" << std::endl;
+    std::cout << "   -i|--id                Id to look up, repeat (or separate by commas) for several" << std::endl;
+    std::cout << "   --ids-file             File with ids to look up, one per line" << std::endl;
+    std::cout << "   --key                  Integer leaf column to look up [default: \"event.id\"]" << std::endl;
+    std::cout << "   -k|--keep              Column (leaf path or prefix) to fetch, repeat for several [default: all columns]" << std::endl;
+    std::cout << "   -o|--output            Write the events found to this Parquet file rather than printing them" << std::endl;
+    std::cout << "   --no-statistics        Do not prune RowGroups by their min/max statistics" << std::endl;
+    std::cout << "   --no-bloom-filters     Do not prune RowGroups by their Bloom filters" << std::endl;
+    std::cout << "   --write-bloom-filters  (Re-)build the Bloom filter sidecars of the dataset for this column," << std::endl;
+    std::cout << "                          as \"column\" or \"column:fpp\" [default fpp: 0.01], repeat for several" << std::endl;
+    std::cout << "   --no-summary           Read the footers of all files rather than the _metadata summary" << std::endl;
+    std::cout << "   -h|--help              Print this help message and exit" << std::endl;
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+}
+
+void parse_ids(const std::string& arg, std::vector<int64_t>& ids) {
+    std::stringstream ss(arg);
+    std::string item;
+    while(std::getline(ss, item, ',')) {
+        if(!item.empty()) ids.push_back(std::stoll(item));
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string input = "";
+    std::string key = "event.id";
+    std::string output = "";
+    std::vector<int64_t> ids;
+    std::vector<std::string> keep;
+    std::map<std::string, double> bloom_filters;
+    bool use_statistics = true;
+    bool use_bloom_filters = true;
+    bool use_summary = true;
+
+    for(size_t i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--id") == 0) { parse_ids(argv[++i], ids); }
+        else if (strcmp(argv[i], "--ids-file") == 0) {
+            std::ifstream infile(argv[++i]);
+            if(!infile) {
+                std::cout << argv[0] << " Could not open ids file: " << argv[i] << std::endl;
+                return 1;
+            }
+            std::string line;
+            while(std::getline(infile, line)) {
+                parse_ids(line, ids);
+            }
+        }
+        else if (strcmp(argv[i], "--key") == 0) { key = argv[++i]; }
+        else if (strcmp(argv[i], "-k") == 0 || strcmp(argv[i], "--keep") == 0) { keep.push_back(argv[++i]); }
+        else if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--output") == 0) { output = argv[++i]; }
+        else if (strcmp(argv[i], "--no-statistics") == 0) { use_statistics = false; }
+        else if (strcmp(argv[i], "--no-bloom-filters") == 0) { use_bloom_filters = false; }
+        else if (strcmp(argv[i], "--write-bloom-filters") == 0) { bloom_filters.insert(helpers::bloom_filter_option(argv[++i])); }
+        else if (strcmp(argv[i], "--no-summary") == 0) { use_summary = false; }
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { print_usage(argv); return 0; }
+        else if (argv[i][0] != '-' && input.empty()) { input = argv[i]; }
+        else {
+            std::cout << argv[0] << " Unknown command line argument provided: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if(input.empty() || (ids.empty() && bloom_filters.empty())) {
+        print_usage(argv);
+        return 1;
+    }
+
+    DatasetReader dataset(input, use_summary);
+
+    if(!bloom_filters.empty()) {
+        auto start = std::chrono::steady_clock::now();
+        helpers::write_bloom_filters(dataset, bloom_filters);
+        auto stop = std::chrono::steady_clock::now();
+        std::cout << "INFO: Wrote the Bloom filters of " << dataset.files().size() << " files in "
+            << std::chrono::duration<double>(stop - start).count() << " seconds" << std::endl;
+        if(ids.empty()) return 0;
+    }
+
+    EventLookup lookup(dataset, key);
+    lookup.set_use_statistics(use_statistics);
+    lookup.set_use_bloom_filters(use_bloom_filters);
+    std::vector<int> leaves;
+    if(!keep.empty()) {
+        leaves = dataset.leaf_indices(keep);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto events = lookup.fetch(ids, leaves);
+    auto stop = std::chrono::steady_clock::now();
+
+    const auto& stats = lookup.stats();
+    std::cout << "INFO: Found " << stats.rows_found << " of " << ids.size() << " ids in "
+        << std::chrono::duration<double>(stop - start).count() * 1e3 << " ms" << std::endl;
+    std::cout << "INFO: RowGroups: " << stats.row_groups << " in total, " << stats.pruned_by_statistics
+        << " pruned by statistics, " << stats.pruned_by_bloom_filter << " pruned by Bloom filters, "
+        << stats.row_groups_read << " read (" << stats.false_positives << " without any of the ids)" << std::endl;
+    std::cout << "INFO: Bytes read: " << stats.bytes_read() << " (" << stats.column_bytes << " of column chunks, "
+        << stats.bloom_filter_bytes << " of Bloom filters)" << std::endl;
+
+    if(!events) return 0;
+    if(!output.empty()) {
+        std::shared_ptr<arrow::io::FileOutputStream> outfile;
+        PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(output));
+        auto sink = TableSink::make(OutputFormat::PARQUET, outfile, events->schema()->WithMetadata(dataset.schema()->metadata()));
+        sink->write(*events, std::max<int64_t>(1, events->num_rows()));
+        sink->close();
+        PARQUET_THROW_NOT_OK(outfile->Close());
+        std::cout << "INFO: Events written to " << output << std::endl;
+    } else {
+        std::cout << events->ToString() << std::endl;
+    }
+
+    return 0;
+}
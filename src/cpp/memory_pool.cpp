@@ -0,0 +1,224 @@
+#include "memory_pool.h"
+
+// std/stl
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+
+// arrow/parquet
+#include <parquet/exception.h>
+
+namespace {
+
+void update_max(std::atomic<int64_t>& max, int64_t value) {
+    int64_t current = max.load(std::memory_order_relaxed);
+    while(value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+struct Counters {
+    std::atomic<int64_t> allocations{0};
+    std::atomic<int64_t> bytes_allocated{0};
+    std::atomic<int64_t> bytes_in_use{0};
+    std::atomic<int64_t> peak{0};
+
+    void add(int64_t n_bytes) {
+        int64_t in_use = bytes_in_use.fetch_add(n_bytes, std::memory_order_relaxed) + n_bytes;
+        if(n_bytes > 0) {
+            allocations.fetch_add(1, std::memory_order_relaxed);
+            bytes_allocated.fetch_add(n_bytes, std::memory_order_relaxed);
+            update_max(peak, in_use);
+        }
+    }
+
+    void reset() {
+        allocations = 0;
+        bytes_allocated = 0;
+        peak = bytes_in_use.load();
+    }
+}; // struct Counters
+
+//
+// the pool of one phase: allocations go to the backend, and are counted for
+// the phase and for all phases together
+//
+class PhasePool : public arrow::MemoryPool {
+    public:
+        PhasePool(Counters& counters, Counters& total) :
+            _counters(counters),
+            _total(total),
+            _backend(nullptr)
+        {
+        }
+
+        void set_backend(arrow::MemoryPool* backend) { _backend = backend; }
+
+        arrow::Status Allocate(int64_t size, uint8_t** out) override {
+            ARROW_RETURN_NOT_OK(_backend->Allocate(size, out));
+            count(size);
+            return arrow::Status::OK();
+        }
+
+        arrow::Status Reallocate(int64_t old_size, int64_t new_size, uint8_t** ptr) override {
+            ARROW_RETURN_NOT_OK(_backend->Reallocate(old_size, new_size, ptr));
+            count(new_size - old_size);
+            return arrow::Status::OK();
+        }
+
+        void Free(uint8_t* buffer, int64_t size) override {
+            _backend->Free(buffer, size);
+            count(-size);
+        }
+
+        int64_t bytes_allocated() const override { return _counters.bytes_in_use.load(); }
+        int64_t max_memory() const override { return _counters.peak.load(); }
+        std::string backend_name() const override { return _backend->backend_name(); }
+
+    private :
+        Counters& _counters;
+        Counters& _total;
+        arrow::MemoryPool* _backend;
+
+        void count(int64_t n_bytes) {
+            _counters.add(n_bytes);
+            _total.add(n_bytes);
+        }
+}; // class PhasePool
+
+class Tracker {
+    public:
+        Tracker() : _backend(nullptr) {
+            for(auto phase : memory::kPhases) {
+                _pools[index(phase)] = std::make_unique<PhasePool>(_counters[index(phase)], _total);
+            }
+        }
+
+        // (never destroyed, buffers of static objects may outlive it)
+        static Tracker& instance() {
+            static Tracker* tracker = new Tracker();
+            return *tracker;
+        }
+
+        void select(const std::string& name) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if(_backend.load() && name == _name) return;
+            if(_backend.load() && _total.allocations.load() > 0) {
+                throw std::runtime_error("ERROR: Cannot switch the memory pool to \"" + name
+                        + "\", \"" + _name + "\" is already in use");
+            }
+            arrow::MemoryPool* backend = nullptr;
+            if(name == "default") {
+                backend = arrow::default_memory_pool();
+            } else if(name == "system") {
+                backend = arrow::system_memory_pool();
+            } else if(name == "jemalloc") {
+                PARQUET_THROW_NOT_OK(arrow::jemalloc_memory_pool(&backend));
+            } else if(name == "mimalloc") {
+                PARQUET_THROW_NOT_OK(arrow::mimalloc_memory_pool(&backend));
+            } else {
+                throw std::runtime_error("ERROR: Unknown memory pool \"" + name
+                        + "\" (expected default, system, jemalloc or mimalloc)");
+            }
+            _name = name;
+            for(auto& pool : _pools) {
+                pool->set_backend(backend);
+            }
+            _backend = backend;
+        }
+
+        arrow::MemoryPool* pool(memory::Phase phase) {
+            if(!_backend.load()) select("default");
+            return _pools[index(phase)].get();
+        }
+
+        std::string backend() {
+            if(!_backend.load()) select("default");
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _name == "default" ? "default (" + _backend.load()->backend_name() + ")" : _name;
+        }
+
+        const Counters& counters(memory::Phase phase) const { return _counters[index(phase)]; }
+        const Counters& total() const { return _total; }
+
+        void reset() {
+            for(auto& counters : _counters) {
+                counters.reset();
+            }
+            _total.reset();
+        }
+
+    private :
+        std::mutex _mutex;
+        std::atomic<arrow::MemoryPool*> _backend;
+        std::string _name;
+        std::array<Counters, 4> _counters;
+        Counters _total;
+        std::array<std::unique_ptr<PhasePool>, 4> _pools;
+
+        static size_t index(memory::Phase phase) { return static_cast<size_t>(phase); }
+}; // class Tracker
+
+} // namespace
+
+namespace memory {
+
+std::string phase_name(Phase phase) {
+    switch(phase) {
+        case Phase::CONVERT: return "convert";
+        case Phase::WRITE: return "write";
+        case Phase::READ: return "read";
+        case Phase::DECODE: return "decode";
+    }
+    return "";
+}
+
+void select_backend(const std::string& name) {
+    Tracker::instance().select(name);
+}
+
+std::string backend_name() {
+    return Tracker::instance().backend();
+}
+
+arrow::MemoryPool* pool(Phase phase) {
+    return Tracker::instance().pool(phase);
+}
+
+PhaseStats stats(Phase phase) {
+    const auto& counters = Tracker::instance().counters(phase);
+    PhaseStats out;
+    out.allocations = counters.allocations.load();
+    out.bytes_allocated = counters.bytes_allocated.load();
+    out.bytes_in_use = counters.bytes_in_use.load();
+    out.peak = counters.peak.load();
+    return out;
+}
+
+int64_t peak() {
+    return Tracker::instance().total().peak.load();
+}
+
+void reset_stats() {
+    Tracker::instance().reset();
+}
+
+std::string report() {
+    std::stringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << "INFO: Memory pool " << backend_name() << ", peak " << peak() / 1024. / 1024. << " MB" << std::endl;
+    for(auto phase : kPhases) {
+        auto s = stats(phase);
+        if(s.allocations == 0) continue;
+        out << "INFO:    " << std::left << std::setw(8) << phase_name(phase) << std::right
+            << std::setw(10) << s.allocations << " allocations, "
+            << std::setw(10) << s.bytes_allocated / 1024. / 1024. << " MB allocated, peak "
+            << std::setw(8) << s.peak / 1024. / 1024. << " MB" << std::endl;
+    }
+    return out.str();
+}
+
+}; // namespace memory
@@ -0,0 +1,67 @@
+#pragma once
+
+//std/stl
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+//arrow/parquet
+#include <arrow/memory_pool.h>
+
+//
+// The Arrow memory pool of the generator, writers and readers: a selectable
+// backend allocator, wrapped so that the allocations are counted separately
+// for each phase of the work that makes them:
+//
+//      CONVERT     building the Arrow arrays of a RowGroup from the generator's
+//                  column buffers (event_layout.h)
+//      WRITE       the Parquet/IPC writers (encoding, compression, page buffers)
+//      READ        reading the files (I/O and decompression buffers)
+//      DECODE      the Arrow arrays of the RowGroups read
+//
+// Each phase has its own MemoryPool (all backed by the same allocator), which
+// is handed to the Arrow/Parquet objects of that phase, so that allocations
+// made on Arrow's own threads are attributed to the right phase as well.
+// Buffers remember the pool they were allocated from, so frees are counted in
+// the phase of the allocation.
+//
+namespace memory {
+
+    enum class Phase {
+        CONVERT,
+        WRITE,
+        READ,
+        DECODE
+    };
+    const std::vector<Phase> kPhases = {Phase::CONVERT, Phase::WRITE, Phase::READ, Phase::DECODE};
+    std::string phase_name(Phase phase);
+
+    struct PhaseStats {
+        int64_t allocations = 0;        // number of allocations (and reallocations)
+        int64_t bytes_allocated = 0;    // bytes requested, summed over all allocations
+        int64_t bytes_in_use = 0;       // bytes currently held
+        int64_t peak = 0;               // largest number of bytes held at any time
+    }; // struct PhaseStats
+
+    // the backend allocator: "default" (Arrow's default pool, which follows
+    // $ARROW_DEFAULT_MEMORY_POOL), "system", "jemalloc" or "mimalloc"; it must be
+    // selected before anything is allocated, and throws if Arrow was built
+    // without the backend
+    void select_backend(const std::string& name);
+    std::string backend_name();
+
+    // the pool of a phase (with the "default" backend if none was selected)
+    arrow::MemoryPool* pool(Phase phase);
+
+    // the allocation counts of a phase, and the peak of all phases together
+    PhaseStats stats(Phase phase);
+    int64_t peak();
+
+    // restart the counts (e.g. between benchmark configurations), the bytes
+    // in use are kept and become the new peaks
+    void reset_stats();
+
+    // one "INFO:" line per phase with allocations, for the tools' output
+    std::string report();
+
+}; // namespace memory
@@ -0,0 +1,199 @@
+#include "metrics.h"
+
+// std/stl
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+struct Entry {
+    std::string help;
+    double scale;
+    std::unique_ptr<metrics::Counter> counter;
+    std::unique_ptr<metrics::Gauge> gauge;
+
+    double value() const {
+        return scale * (counter ? double(counter->value()) : double(gauge->value()));
+    }
+}; // struct Entry
+
+class Registry {
+    public:
+        // (never destroyed, metrics are updated from static objects and detached threads)
+        static Registry& instance() {
+            static Registry* registry = new Registry();
+            return *registry;
+        }
+
+        Entry& entry(const std::string& name, const std::string& help, double scale, bool is_counter) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _entries.find(name);
+            if(it == _entries.end()) {
+                Entry entry;
+                entry.help = help;
+                entry.scale = scale;
+                if(is_counter) {
+                    entry.counter = std::make_unique<metrics::Counter>();
+                } else {
+                    entry.gauge = std::make_unique<metrics::Gauge>();
+                }
+                it = _entries.emplace(name, std::move(entry)).first;
+            } else if(bool(it->second.counter) != is_counter) {
+                throw std::runtime_error("ERROR: Metric \"" + name + "\" is already registered as a "
+                        + (is_counter ? "gauge" : "counter"));
+            }
+            return it->second;
+        }
+
+        std::map<std::string, double> values() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::map<std::string, double> out;
+            for(const auto& [name, entry] : _entries) {
+                out[name] = entry.value();
+            }
+            return out;
+        }
+
+        std::string text() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::stringstream out;
+            out << std::setprecision(15);
+            for(const auto& [name, entry] : _entries) {
+                out << "# HELP " << name << " " << entry.help << "\n";
+                out << "# TYPE " << name << " " << (entry.counter ? "counter" : "gauge") << "\n";
+                out << name << " " << entry.value() << "\n";
+            }
+            return out.str();
+        }
+
+    private :
+        std::mutex _mutex;
+        std::map<std::string, Entry> _entries;
+}; // class Registry
+
+} // namespace
+
+namespace metrics {
+
+Counter& counter(const std::string& name, const std::string& help, double scale) {
+    return *Registry::instance().entry(name, help, scale, true).counter;
+}
+
+Gauge& gauge(const std::string& name, const std::string& help, double scale) {
+    return *Registry::instance().entry(name, help, scale, false).gauge;
+}
+
+double value(const std::string& name) {
+    auto values = Registry::instance().values();
+    auto it = values.find(name);
+    return it == values.end() ? 0. : it->second;
+}
+
+std::string prometheus_text() {
+    return Registry::instance().text();
+}
+
+double Snapshot::value(const std::string& name) const {
+    auto it = values.find(name);
+    return it == values.end() ? 0. : it->second;
+}
+
+double Snapshot::rate(const std::string& name) const {
+    if(interval <= 0) return 0.;
+    auto it = previous.find(name);
+    return (value(name) - (it == previous.end() ? 0. : it->second)) / interval;
+}
+
+double Snapshot::average_rate(const std::string& name) const {
+    return elapsed > 0 ? value(name) / elapsed : 0.;
+}
+
+Reporter::Reporter(const std::string& path, double interval,
+        std::function<std::string(const Snapshot&)> status,
+        std::function<void()> sampler) :
+    _path(path),
+    _interval(interval),
+    _status(status),
+    _sampler(sampler),
+    _start(std::chrono::steady_clock::now()),
+    _stop(false)
+{
+    if(interval <= 0) {
+        throw std::runtime_error("ERROR: The metrics reporting interval must be positive");
+    }
+    _thread = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while(!_cv.wait_for(lock, _interval, [this]() { return _stop; })) {
+            report(false);
+        }
+    });
+}
+
+Reporter::~Reporter() {
+    stop();
+}
+
+void Reporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(_stop) return;
+        _stop = true;
+    }
+    _cv.notify_all();
+    _thread.join();
+    report(true);
+}
+
+void Reporter::report(bool final) {
+    if(_sampler) _sampler();
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+    _snapshot.previous = std::move(_snapshot.values);
+    _snapshot.values = Registry::instance().values();
+    _snapshot.interval = elapsed - _snapshot.elapsed;
+    _snapshot.elapsed = elapsed;
+    _snapshot.final = final;
+
+    if(!_path.empty()) {
+        std::string tmp = _path + ".tmp";
+        {
+            std::ofstream out(tmp);
+            out << prometheus_text();
+        }
+        if(std::rename(tmp.c_str(), _path.c_str()) != 0) {
+            std::cout << "WARNING: Could not write the metrics file " << _path << std::endl;
+        }
+    }
+    if(_status) {
+        std::cout << _status(_snapshot) << std::endl;
+    }
+}
+
+std::string si(double value) {
+    const char* prefixes[] = {"", "k", "M", "G", "T", "P"};
+    size_t i = 0;
+    while(std::fabs(value) >= 1000. && i < 5) {
+        value /= 1000.;
+        i++;
+    }
+    std::stringstream out;
+    out << std::fixed << std::setprecision(i == 0 ? 0 : (std::fabs(value) < 10. ? 2 : 1)) << value << prefixes[i];
+    return out.str();
+}
+
+std::string duration(double seconds) {
+    if(!std::isfinite(seconds) || seconds < 0) return "-";
+    uint64_t s = static_cast<uint64_t>(seconds + 0.5);
+    std::stringstream out;
+    out << s / 3600 << ":" << std::setfill('0') << std::setw(2) << (s / 60) % 60
+        << ":" << std::setw(2) << s % 60;
+    return out.str();
+}
+
+}; // namespace metrics
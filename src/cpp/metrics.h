@@ -0,0 +1,125 @@
+#pragma once
+
+//std/stl
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <stdint.h>
+
+//
+// Process-wide counters and gauges for monitoring long-running generation and
+// read jobs, exported by a background Reporter as a Prometheus text-format file
+// (e.g. for the node_exporter textfile collector) and as a one-line status.
+//
+// Metrics are registered by name once, at setup, and the references kept: an
+// update is then a single relaxed atomic operation on a cache line of its own,
+// so the instrumented code updates them per batch or RowGroup without locks,
+// and the Reporter thread only ever reads them.
+//
+namespace metrics {
+
+    // a monotonically increasing count, e.g. of events, bytes or nanoseconds
+    class alignas(64) Counter {
+        public:
+            void add(uint64_t n = 1) { _value.fetch_add(n, std::memory_order_relaxed); }
+            uint64_t value() const { return _value.load(std::memory_order_relaxed); }
+
+        private :
+            std::atomic<uint64_t> _value{0};
+    }; // class Counter
+
+    // a value that goes up and down, e.g. a queue depth
+    class alignas(64) Gauge {
+        public:
+            void set(int64_t value) { _value.store(value, std::memory_order_relaxed); }
+            void add(int64_t n) { _value.fetch_add(n, std::memory_order_relaxed); }
+            int64_t value() const { return _value.load(std::memory_order_relaxed); }
+
+        private :
+            std::atomic<int64_t> _value{0};
+    }; // class Gauge
+
+    // the counter (gauge) called "name", registered with its "help" text on the
+    // first call; "scale" converts the stored integer to the exported value,
+    // e.g. 1e-9 for nanoseconds exported as "..._seconds_total"
+    Counter& counter(const std::string& name, const std::string& help, double scale = 1.);
+    Gauge& gauge(const std::string& name, const std::string& help, double scale = 1.);
+
+    // the exported value of a registered metric (0 if there is none)
+    double value(const std::string& name);
+
+    // all registered metrics in the Prometheus text exposition format
+    std::string prometheus_text();
+
+    // adds the nanoseconds from its construction to its destruction to a counter
+    class ScopedTimer {
+        public:
+            ScopedTimer(Counter& counter) : _counter(counter), _start(std::chrono::steady_clock::now()) {}
+            ~ScopedTimer() {
+                _counter.add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - _start).count());
+            }
+
+        private :
+            Counter& _counter;
+            std::chrono::steady_clock::time_point _start;
+    }; // class ScopedTimer
+
+    // the exported values of all metrics at one report of a Reporter, and at the previous one
+    struct Snapshot {
+        double elapsed = 0;     // seconds since the Reporter started
+        double interval = 0;    // seconds since the previous report
+        bool final = false;     // the last report, when the Reporter is stopped
+        std::map<std::string, double> values;
+        std::map<std::string, double> previous;
+
+        double value(const std::string& name) const;
+        // per second, over the last interval
+        double rate(const std::string& name) const;
+        // per second, since the start
+        double average_rate(const std::string& name) const;
+    }; // struct Snapshot
+
+    //
+    // Reports the metrics every "interval" seconds on a thread of its own, and
+    // once more when stopped: runs "sampler" (e.g. to set gauges that are
+    // polled rather than updated, such as the resident memory), writes the
+    // Prometheus text file "path" (if not empty; to a temporary file that is
+    // then renamed, so that scrapers never see a partial file) and prints the
+    // line returned by "status" (if set) to std::cout.
+    //
+    class Reporter {
+        public:
+            Reporter(const std::string& path, double interval,
+                    std::function<std::string(const Snapshot&)> status = nullptr,
+                    std::function<void()> sampler = nullptr);
+            ~Reporter();
+
+            // the final report, and the end of the thread
+            void stop();
+
+        private :
+            std::string _path;
+            std::chrono::duration<double> _interval;
+            std::function<std::string(const Snapshot&)> _status;
+            std::function<void()> _sampler;
+            std::chrono::steady_clock::time_point _start;
+            Snapshot _snapshot;
+            bool _stop;
+            std::mutex _mutex;
+            std::condition_variable _cv;
+            std::thread _thread;
+
+            void report(bool final);
+    }; // class Reporter
+
+    // for status lines: 1234567 -> "1.23M", and 3725 seconds -> "1:02:05"
+    std::string si(double value);
+    std::string duration(double seconds);
+
+}; // namespace metrics
@@ -0,0 +1,252 @@
+#include "output_stream.h"
+#include "uring_file.h"
+#include "metrics.h"
+
+// std/stl
+#include <algorithm> // min
+#include <cerrno>
+#include <cstring> // memcpy, strerror
+#include <iostream>
+#include <mutex> // call_once
+#include <stdexcept>
+
+// arrow/parquet
+#include <arrow/io/file.h>
+
+// posix
+#include <fcntl.h> // open, fallocate, sync_file_range
+#include <unistd.h> // write, close, fdatasync
+
+namespace {
+
+// the output stream metrics, shared by all streams of the process
+struct OutputMetrics {
+    metrics::Counter& writes = metrics::counter("io_write_calls_total", "write(2) calls of the output streams");
+    metrics::Counter& bytes = metrics::counter("io_write_bytes_total", "Bytes written by the output streams");
+    metrics::Counter& syncs = metrics::counter("io_sync_calls_total", "fdatasync(2)/sync_file_range(2) calls of the output streams");
+    metrics::Counter& sync_ns = metrics::counter("io_sync_seconds_total", "Time spent in fdatasync(2)/sync_file_range(2)", 1e-9);
+    metrics::Counter& preallocations = metrics::counter("io_preallocate_calls_total", "fallocate(2) calls of the output streams");
+}; // struct OutputMetrics
+
+OutputMetrics& output_metrics() {
+    static OutputMetrics* m = new OutputMetrics();
+    return *m;
+}
+
+arrow::Status io_error(const std::string& what, const std::string& path) {
+    return arrow::Status::IOError(what, " \"", path, "\": ", std::strerror(errno));
+}
+
+int64_t round_up(int64_t value, int64_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+} // namespace
+
+namespace fileio {
+
+int data_sync(int fd) {
+#ifdef __APPLE__
+    return fsync(fd);
+#else
+    return fdatasync(fd);
+#endif
+}
+
+SyncPolicy sync_policy(const std::string& name) {
+    if(name == "none") return SyncPolicy::NONE;
+    if(name == "close") return SyncPolicy::CLOSE;
+    if(name == "range") return SyncPolicy::RANGE;
+    throw std::runtime_error("ERROR: Unknown sync policy \"" + name + "\" (expected none, close or range)");
+}
+
+std::string sync_policy_name(SyncPolicy policy) {
+    switch(policy) {
+        case SyncPolicy::NONE: return "none";
+        case SyncPolicy::CLOSE: return "close";
+        case SyncPolicy::RANGE: return "range";
+    }
+    return "";
+}
+
+arrow::Result<std::shared_ptr<CoalescingFileStream>> CoalescingFileStream::Open(const std::string& path,
+        const OutputOptions& options) {
+    if(options.alignment <= 0 || options.buffer_size <= 0) {
+        return arrow::Status::Invalid("The buffer size and alignment of \"", path, "\" must be positive");
+    }
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0) {
+        return io_error("Cannot open", path);
+    }
+    return std::shared_ptr<CoalescingFileStream>(new CoalescingFileStream(fd, path, options));
+}
+
+CoalescingFileStream::CoalescingFileStream(int fd, const std::string& path, const OutputOptions& options) :
+    _fd(fd),
+    _path(path),
+    _options(options),
+    _buffered(0),
+    _position(0),
+    _written(0),
+    _allocated(0),
+    _sync_start(0),
+    _synced(0)
+{
+    _options.buffer_size = round_up(_options.buffer_size, _options.alignment);
+    _buffer.resize(_options.buffer_size);
+}
+
+CoalescingFileStream::~CoalescingFileStream() {
+    auto status = Close();
+    if(!status.ok()) {
+        std::cout << "WARNING: " << status.ToString() << std::endl;
+    }
+}
+
+arrow::Status CoalescingFileStream::Write(const void* data, int64_t nbytes) {
+    if(closed()) {
+        return arrow::Status::Invalid("Write to the closed file \"", _path, "\"");
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    _position += nbytes;
+    while(nbytes > 0) {
+        // large writes go out directly, in whole multiples of the alignment
+        if(_buffered == 0 && _written % _options.alignment == 0 && nbytes >= _options.buffer_size) {
+            int64_t direct = nbytes - nbytes % _options.alignment;
+            ARROW_RETURN_NOT_OK(write_out(bytes, direct));
+            bytes += direct;
+            nbytes -= direct;
+            continue;
+        }
+        // (after a Flush() the file ends unaligned, the buffer is then filled
+        // up to the next aligned offset only)
+        int64_t capacity = _options.buffer_size - _written % _options.alignment;
+        int64_t n = std::min(nbytes, capacity - _buffered);
+        std::memcpy(_buffer.data() + _buffered, bytes, n);
+        _buffered += n;
+        bytes += n;
+        nbytes -= n;
+        if(_buffered == capacity) {
+            ARROW_RETURN_NOT_OK(write_out(_buffer.data(), _buffered));
+            _buffered = 0;
+        }
+    }
+    return arrow::Status::OK();
+}
+
+arrow::Status CoalescingFileStream::Flush() {
+    if(closed() || _buffered == 0) return arrow::Status::OK();
+    ARROW_RETURN_NOT_OK(write_out(_buffer.data(), _buffered));
+    _buffered = 0;
+    return arrow::Status::OK();
+}
+
+arrow::Status CoalescingFileStream::Close() {
+    if(closed()) return arrow::Status::OK();
+    auto status = Flush();
+    // (the space preallocated past the end of the file is released)
+    if(status.ok() && _allocated > _written && ::ftruncate(_fd, _written) != 0) {
+        status = io_error("Cannot truncate", _path);
+    }
+    if(status.ok() && _options.sync != SyncPolicy::NONE) {
+        metrics::ScopedTimer timer(output_metrics().sync_ns);
+        if(data_sync(_fd) != 0) {
+            status = io_error("Cannot sync", _path);
+        }
+        _stats.syncs++;
+        output_metrics().syncs.add();
+    }
+    if(::close(_fd) != 0 && status.ok()) {
+        status = io_error("Cannot close", _path);
+    }
+    _fd = -1;
+    _buffer = std::vector<uint8_t>();
+    return status;
+}
+
+arrow::Status CoalescingFileStream::write_out(const uint8_t* data, int64_t nbytes) {
+    ARROW_RETURN_NOT_OK(preallocate(_written + nbytes));
+    auto& m = output_metrics();
+    while(nbytes > 0) {
+        ssize_t n = ::write(_fd, data, static_cast<size_t>(nbytes));
+        _stats.writes++;
+        m.writes.add();
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            return io_error("Cannot write to", _path);
+        }
+        data += n;
+        nbytes -= n;
+        _written += n;
+        _stats.bytes += n;
+        m.bytes.add(n);
+    }
+    if(_options.sync == SyncPolicy::RANGE && _written - _synced >= _options.sync_bytes) {
+        ARROW_RETURN_NOT_OK(sync_range());
+    }
+    return arrow::Status::OK();
+}
+
+arrow::Status CoalescingFileStream::preallocate(int64_t end) {
+    if(_options.preallocate <= 0 || end <= _allocated) return arrow::Status::OK();
+#ifdef __linux__
+    int64_t allocated = round_up(end, _options.preallocate);
+    // (the file size stays at the bytes written)
+    int result = ::fallocate(_fd, FALLOC_FL_KEEP_SIZE, _allocated, allocated - _allocated);
+    _stats.preallocations++;
+    output_metrics().preallocations.add();
+    if(result != 0) {
+        if(errno != EOPNOTSUPP && errno != ENOSYS) {
+            return io_error("Cannot preallocate", _path);
+        }
+        // not supported by the file system, carry on without
+        _options.preallocate = 0;
+        return arrow::Status::OK();
+    }
+    _allocated = allocated;
+#endif
+    return arrow::Status::OK();
+}
+
+arrow::Status CoalescingFileStream::sync_range() {
+#ifdef __linux__
+    metrics::ScopedTimer timer(output_metrics().sync_ns);
+    // wait for the write-back of the previous range, started at the previous call
+    if(_synced > _sync_start && ::sync_file_range(_fd, _sync_start, _synced - _sync_start,
+                SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER) != 0) {
+        return io_error("Cannot sync", _path);
+    }
+    // and start that of the bytes written since
+    if(::sync_file_range(_fd, _synced, _written - _synced, SYNC_FILE_RANGE_WRITE) != 0) {
+        return io_error("Cannot sync", _path);
+    }
+    _stats.syncs += 2;
+    output_metrics().syncs.add(2);
+#endif
+    _sync_start = _synced;
+    _synced = _written;
+    return arrow::Status::OK();
+}
+
+arrow::Result<std::shared_ptr<arrow::io::OutputStream>> open_output_stream(const std::string& path,
+        const OutputOptions& options) {
+    if(options.uring) {
+        std::string reason;
+        if(uring_available(&reason)) {
+            UringOptions uring;
+            uring.queue_depth = options.queue_depth;
+            if(options.buffer_size > 0) uring.block_size = options.buffer_size;
+            return UringOutputStream::Open(path, uring, options.sync);
+        }
+        static std::once_flag warned;
+        std::call_once(warned, [&]() {
+            std::cout << "WARNING: io_uring is not available (" << reason << "), writing with the standard file streams" << std::endl;
+        });
+    }
+    if(options.buffer_size <= 0) {
+        return arrow::io::FileOutputStream::Open(path);
+    }
+    return CoalescingFileStream::Open(path, options);
+}
+
+}; // namespace fileio
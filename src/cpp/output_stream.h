@@ -0,0 +1,124 @@
+#pragma once
+
+//std/stl
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+//arrow/parquet
+#include <arrow/io/interfaces.h>
+#include <arrow/result.h>
+#include <arrow/status.h>
+
+//
+// Output files written in few, large writes.
+//
+// The Parquet and IPC writers issue a write per page header, page and footer
+// piece, mostly of a few bytes to a few hundred kB, and Arrow's
+// FileOutputStream passes each of them on as a write(2). CoalescingFileStream
+// gathers them in a buffer of its own and writes it out in whole buffers of
+// "buffer_size" bytes, a multiple of the alignment, so that all writes but the
+// last one of a file start and end at aligned offsets; large writes skip the
+// copy and go out directly once the buffer is empty.
+//
+// What is forced to the device, and when, is a policy rather than a side
+// effect of Flush():
+//
+//      none        nothing, the kernel writes the page cache back at its pace
+//                  [default]
+//      close       fdatasync(2) when the file is closed
+//      range       (Linux) start the write-back of every "sync_bytes" written
+//                  with sync_file_range(2), and wait for that of the previous
+//                  range, which bounds the dirty pages of a long write without
+//                  stalling on each one; fdatasync(2) on close
+//
+// and the space of the file can be preallocated (fallocate(2) on Linux, with
+// the file size kept at the bytes written) "preallocate" bytes at a time, to
+// keep the files of long jobs in few extents; what is left over is released
+// on close.
+//
+// The writes, syncs and preallocations made are counted per stream and in the
+// process-wide "io_*" metrics (see metrics.h).
+//
+namespace fileio {
+
+    enum class SyncPolicy {
+        NONE,
+        CLOSE,
+        RANGE
+    };
+    // "none", "close" or "range", throws otherwise
+    SyncPolicy sync_policy(const std::string& name);
+    std::string sync_policy_name(SyncPolicy policy);
+    // fdatasync(2), or fsync(2) where there is none (macOS)
+    int data_sync(int fd);
+
+    struct OutputOptions {
+        // bytes gathered before a write, rounded up to a multiple of the
+        // alignment; 0 selects Arrow's own (unbuffered) FileOutputStream
+        int64_t buffer_size = 8 * 1024 * 1024;
+        int64_t alignment = 4096;
+        // bytes preallocated at a time, 0 for none
+        int64_t preallocate = 0;
+        SyncPolicy sync = SyncPolicy::NONE;
+        // bytes between two sync_file_range(2) calls of the "range" policy
+        int64_t sync_bytes = 64 * 1024 * 1024;
+        // write through io_uring instead, with "queue_depth" writes of
+        // "buffer_size" bytes in flight (see uring_file.h; no preallocation)
+        bool uring = false;
+        unsigned queue_depth = 8;
+    }; // struct OutputOptions
+
+    struct OutputStats {
+        int64_t writes = 0;         // write(2) calls
+        int64_t bytes = 0;          // bytes written
+        int64_t syncs = 0;          // fdatasync(2)/sync_file_range(2) calls
+        int64_t preallocations = 0; // fallocate(2) calls
+        int64_t enters = 0;         // io_uring_enter(2) calls (UringOutputStream, see uring_file.h)
+    }; // struct OutputStats
+
+    class CoalescingFileStream : public arrow::io::OutputStream {
+        public:
+            // create (or truncate) the file "path"
+            static arrow::Result<std::shared_ptr<CoalescingFileStream>> Open(const std::string& path,
+                    const OutputOptions& options = OutputOptions());
+            ~CoalescingFileStream() override;
+
+            // writes out the buffered bytes, with a last partial (unaligned) write
+            arrow::Status Flush() override;
+            arrow::Status Close() override;
+            bool closed() const override { return _fd < 0; }
+            arrow::Result<int64_t> Tell() const override { return _position; }
+            arrow::Status Write(const void* data, int64_t nbytes) override;
+            using arrow::io::OutputStream::Write;
+
+            const OutputStats& stats() const { return _stats; }
+
+        private :
+            CoalescingFileStream(int fd, const std::string& path, const OutputOptions& options);
+
+            int _fd;
+            std::string _path;
+            OutputOptions _options;
+            std::vector<uint8_t> _buffer;
+            int64_t _buffered;      // bytes in _buffer
+            int64_t _position;      // bytes written to the stream, buffered or not
+            int64_t _written;       // bytes written to the file
+            int64_t _allocated;     // bytes of the file preallocated
+            int64_t _sync_start;    // [_sync_start, _synced) is the range whose
+            int64_t _synced;        // write-back was started last
+            OutputStats _stats;
+
+            arrow::Status write_out(const uint8_t* data, int64_t nbytes);
+            arrow::Status preallocate(int64_t end);
+            arrow::Status sync_range();
+    }; // class CoalescingFileStream
+
+    // the output stream of "path": a UringOutputStream if options.uring is set
+    // (and io_uring is available), a CoalescingFileStream, or Arrow's
+    // FileOutputStream if options.buffer_size is 0
+    arrow::Result<std::shared_ptr<arrow::io::OutputStream>> open_output_stream(const std::string& path,
+            const OutputOptions& options = OutputOptions());
+
+}; // namespace fileio
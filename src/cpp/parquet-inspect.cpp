@@ -0,0 +1,336 @@
+#include "dataset_reader.h"
+#include "sorting.h"
+
+//std/stl
+#include <iostream>
+#include <iomanip>
+#include <cstring> // strcmp
+#include <chrono>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <algorithm>
+
+//arrow/parquet
+#include <arrow/util/compression.h>
+#include <parquet/metadata.h>
+#include <parquet/statistics.h>
+#include <parquet/types.h>
+
+//nlohmann
+#include "json.hpp"
+using nlohmann::json;
+
+//
+// Where the bytes of a dataset go, from the file footers (or the _metadata
+// summary) alone, without reading any data: per leaf column and RowGroup the
+// compressed/uncompressed sizes, encodings, number of pages (from the page
+// encoding statistics of the column chunk), size of the dictionary page,
+// null count and min/max statistics, aggregated per leaf column, per
+// top-level column and over the whole dataset.
+//
+
+void print_usage(char* argv[]) {
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+    std::cout << " Inspect the sizes, encodings and statistics of the columns of a Parquet dataset" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Usage: " << argv[0] << " [OPTIONS] <input dataset (file or directory)>" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Options:" << std::endl;
+    std::cout << "   -r|--row-groups        Also list every column chunk (leaf column x RowGroup)" << std::endl;
+    std::cout << "   -j|--json              Print the results as JSON" << std::endl;
+    std::cout << "   -p|--partitions        Read only the partitions (\"key=value\" subdirectories) passing this filter," << std::endl;
+    std::cout << "                          e.g. \"campaign==mc16d && dsid>=410000\" or \"dsid=410472|410473\"" << std::endl;
+    std::cout << "   --no-summary           Read the footers of all files rather than the _metadata summary" << std::endl;
+    std::cout << "   -h|--help              Print this help message and exit" << std::endl;
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+}
+
+// sizes and statistics of one or more column chunks
+struct ColumnSummary {
+    int64_t chunks = 0;
+    int64_t values = 0;
+    int64_t compressed = 0;
+    int64_t uncompressed = 0;
+    int64_t data_pages = 0;
+    int64_t dictionary_pages = 0;
+    int64_t dictionary_bytes = 0;
+    int64_t nulls = 0;
+    bool has_nulls = true;    // all chunks had a null count
+    bool has_min_max = true;  // all chunks had min/max statistics
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    std::set<std::string> encodings;
+    std::set<std::string> codecs;
+
+    void add(const ColumnSummary& other) {
+        chunks += other.chunks;
+        values += other.values;
+        compressed += other.compressed;
+        uncompressed += other.uncompressed;
+        data_pages += other.data_pages;
+        dictionary_pages += other.dictionary_pages;
+        dictionary_bytes += other.dictionary_bytes;
+        nulls += other.nulls;
+        has_nulls = has_nulls && other.has_nulls;
+        has_min_max = has_min_max && other.has_min_max;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        encodings.insert(other.encodings.begin(), other.encodings.end());
+        codecs.insert(other.codecs.begin(), other.codecs.end());
+    }
+
+    double ratio() const { return compressed > 0 ? static_cast<double>(uncompressed) / compressed : 0.; }
+
+    json to_json() const {
+        json j;
+        j["chunks"] = chunks;
+        j["values"] = values;
+        j["compressed_bytes"] = compressed;
+        j["uncompressed_bytes"] = uncompressed;
+        j["data_pages"] = data_pages;
+        j["dictionary_pages"] = dictionary_pages;
+        j["dictionary_page_bytes"] = dictionary_bytes;
+        j["null_count"] = has_nulls ? json(nulls) : json(nullptr);
+        j["min"] = has_min_max && chunks > 0 ? json(min) : json(nullptr);
+        j["max"] = has_min_max && chunks > 0 ? json(max) : json(nullptr);
+        j["encodings"] = encodings;
+        j["codecs"] = codecs;
+        return j;
+    }
+}; // struct ColumnSummary
+
+ColumnSummary inspect_chunk(const parquet::RowGroupMetaData& row_group, int leaf) {
+    auto column = row_group.ColumnChunk(leaf);
+    ColumnSummary s;
+    s.chunks = 1;
+    s.values = column->num_values();
+    s.compressed = column->total_compressed_size();
+    s.uncompressed = column->total_uncompressed_size();
+    for(auto encoding : column->encodings()) {
+        s.encodings.insert(parquet::EncodingToString(encoding));
+    }
+    s.codecs.insert(arrow::util::Codec::GetCodecAsString(column->compression()));
+
+    // the page counts are only known if the writer stored the page encoding statistics
+    for(const auto& stats : column->encoding_stats()) {
+        if(stats.page_type == parquet::PageType::DICTIONARY_PAGE) {
+            s.dictionary_pages += stats.count;
+        } else if(stats.page_type == parquet::PageType::DATA_PAGE || stats.page_type == parquet::PageType::DATA_PAGE_V2) {
+            s.data_pages += stats.count;
+        }
+    }
+    // the dictionary page (header included) precedes the first data page
+    if(column->has_dictionary_page()) {
+        s.dictionary_bytes = column->data_page_offset() - column->dictionary_page_offset();
+        s.dictionary_pages = std::max<int64_t>(s.dictionary_pages, 1);
+    }
+
+    auto stats = column->is_stats_set() ? column->statistics() : nullptr;
+    s.has_nulls = stats && stats->HasNullCount();
+    s.nulls = s.has_nulls ? stats->null_count() : 0;
+    double min, max;
+    s.has_min_max = helpers::leaf_min_max(row_group, leaf, min, max);
+    if(s.has_min_max) {
+        s.min = min;
+        s.max = max;
+    }
+    return s;
+}
+
+std::string format_bytes(int64_t bytes) {
+    std::stringstream out;
+    out << std::fixed << std::setprecision(2);
+    if(bytes >= (1LL << 30)) out << bytes / double(1LL << 30) << " GB";
+    else if(bytes >= (1LL << 20)) out << bytes / double(1LL << 20) << " MB";
+    else if(bytes >= (1LL << 10)) out << bytes / double(1LL << 10) << " kB";
+    else out << bytes << " B";
+    return out.str();
+}
+
+std::string join(const std::set<std::string>& items) {
+    std::string out;
+    for(const auto& item : items) {
+        out += (out.empty() ? "" : ",") + item;
+    }
+    return out;
+}
+
+void print_header(std::ostream& out, const std::string& first, size_t width) {
+    out << std::left << std::setw(width) << first << std::right
+        << std::setw(12) << "compressed" << std::setw(12) << "uncompr."
+        << std::setw(7) << "ratio" << std::setw(8) << "% size"
+        << std::setw(8) << "pages" << std::setw(12) << "dict. page"
+        << std::setw(10) << "nulls" << std::setw(14) << "min" << std::setw(14) << "max"
+        << "  encodings / codecs" << std::endl;
+}
+
+void print_row(std::ostream& out, const std::string& first, size_t width, const ColumnSummary& s, int64_t total) {
+    out << std::left << std::setw(width) << first << std::right
+        << std::setw(12) << format_bytes(s.compressed) << std::setw(12) << format_bytes(s.uncompressed)
+        << std::setw(7) << std::fixed << std::setprecision(2) << s.ratio()
+        << std::setw(7) << std::setprecision(1) << (total > 0 ? 100. * s.compressed / total : 0.) << "%"
+        << std::setw(8) << (s.data_pages + s.dictionary_pages)
+        << std::setw(12) << (s.dictionary_pages > 0 ? format_bytes(s.dictionary_bytes) : "-")
+        << std::setw(10) << (s.has_nulls ? std::to_string(s.nulls) : "-") << std::defaultfloat << std::setprecision(6);
+    if(s.has_min_max && s.chunks > 0) {
+        out << std::setw(14) << s.min << std::setw(14) << s.max;
+    } else {
+        out << std::setw(14) << "-" << std::setw(14) << "-";
+    }
+    out << "  " << join(s.encodings) << " / " << join(s.codecs) << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string input = "";
+    std::string partitions = "";
+    bool row_groups = false;
+    bool as_json = false;
+    bool use_summary = true;
+
+    for(size_t i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--row-groups") == 0) { row_groups = true; }
+        else if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--json") == 0) { as_json = true; }
+        else if (strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--partitions") == 0) { partitions = argv[++i]; }
+        else if (strcmp(argv[i], "--no-summary") == 0) { use_summary = false; }
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { print_usage(argv); return 0; }
+        else if (argv[i][0] != '-' && input.empty()) { input = argv[i]; }
+        else {
+            std::cout << argv[0] << " Unknown command line argument provided: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if(input.empty()) {
+        print_usage(argv);
+        return 1;
+    }
+
+    // the footers of all files, read in parallel (or taken from the _metadata summary)
+    auto start = std::chrono::steady_clock::now();
+    DatasetReader dataset(input, use_summary, partitioning::Filter(partitions));
+    auto stop = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(stop - start).count();
+
+    const auto leaf_paths = helpers::leaf_paths(dataset.schema());
+    std::vector<ColumnSummary> leaves(leaf_paths.size());
+    std::map<std::string, ColumnSummary> top_level;
+    std::vector<std::string> top_level_order;
+    ColumnSummary total;
+    json j_chunks = json::array();
+
+    for(const auto& task : dataset.row_groups()) {
+        auto row_group = dataset.row_group_metadata(task);
+        if(row_group->num_columns() != static_cast<int>(leaf_paths.size())) {
+            throw std::runtime_error("ERROR: File \"" + dataset.files().at(task.file_index)
+                    + "\" does not have the columns of the dataset schema");
+        }
+        for(int leaf = 0; leaf < row_group->num_columns(); leaf++) {
+            auto chunk = inspect_chunk(*row_group, leaf);
+            leaves.at(leaf).add(chunk);
+            if(row_groups) {
+                json j = chunk.to_json();
+                j["file"] = dataset.files().at(task.file_index);
+                j["row_group"] = task.row_group;
+                j["column"] = leaf_paths.at(leaf);
+                j_chunks.push_back(j);
+            }
+        }
+    }
+    for(size_t leaf = 0; leaf < leaf_paths.size(); leaf++) {
+        auto column = leaf_paths.at(leaf).substr(0, leaf_paths.at(leaf).find('.'));
+        if(top_level.count(column) == 0) {
+            top_level_order.push_back(column);
+        }
+        top_level[column].add(leaves.at(leaf));
+        total.add(leaves.at(leaf));
+    }
+    // (the min/max over different leaves is meaningless)
+    for(auto& column : top_level) {
+        column.second.has_min_max = false;
+    }
+    total.has_min_max = false;
+
+    // the order the writer recorded, if any
+    int64_t sort_window = 0;
+    auto sort_keys = sorting::sort_order(dataset.schema(), &sort_window);
+
+    if(as_json) {
+        json j;
+        j["path"] = input;
+        j["files"] = dataset.files().size();
+        j["row_groups"] = dataset.row_groups().size();
+        j["rows"] = dataset.num_rows();
+        j["from_summary"] = dataset.from_summary();
+        if(!sort_keys.empty()) {
+            j["sort"] = {{"keys", sorting::to_string(sort_keys)}, {"window_rows", sort_window}};
+        }
+        j["total"] = total.to_json();
+        j["columns"] = json::object();
+        for(const auto& column : top_level_order) {
+            j["columns"][column] = top_level.at(column).to_json();
+        }
+        j["leaves"] = json::object();
+        for(size_t leaf = 0; leaf < leaf_paths.size(); leaf++) {
+            j["leaves"][leaf_paths.at(leaf)] = leaves.at(leaf).to_json();
+        }
+        if(row_groups) {
+            j["chunks"] = j_chunks;
+        }
+        std::cout << j.dump(2) << std::endl;
+        return 0;
+    }
+
+    size_t width = 12;
+    for(const auto& path : leaf_paths) {
+        width = std::max(width, path.size() + 2);
+    }
+    std::cout << "INFO: " << dataset.files().size() << " files, " << dataset.row_groups().size() << " row groups, "
+        << dataset.num_rows() << " rows, " << leaf_paths.size() << " leaf columns (metadata from "
+        << (dataset.from_summary() ? "the _metadata summary" : "the file footers") << " in " << elapsed << " seconds)" << std::endl;
+    if(!sort_keys.empty()) {
+        std::cout << "INFO: Sorted by " << sorting::to_string(sort_keys) << " within "
+            << (sort_window > 0 ? "windows of " + std::to_string(sort_window) + " rows" : "the whole dataset") << std::endl;
+    }
+    std::cout << std::endl;
+    print_header(std::cout, "leaf column", width);
+    for(size_t leaf = 0; leaf < leaf_paths.size(); leaf++) {
+        print_row(std::cout, leaf_paths.at(leaf), width, leaves.at(leaf), total.compressed);
+    }
+    std::cout << std::endl;
+    print_header(std::cout, "column", width);
+    for(const auto& column : top_level_order) {
+        print_row(std::cout, column, width, top_level.at(column), total.compressed);
+    }
+    print_row(std::cout, "total", width, total, total.compressed);
+
+    if(row_groups) {
+        std::cout << std::endl;
+        print_header(std::cout, "file:row group / leaf column", width + 12);
+        for(const auto& j : j_chunks) {
+            ColumnSummary s;
+            s.chunks = 1;
+            s.compressed = j["compressed_bytes"];
+            s.uncompressed = j["uncompressed_bytes"];
+            s.data_pages = j["data_pages"];
+            s.dictionary_pages = j["dictionary_pages"];
+            s.dictionary_bytes = j["dictionary_page_bytes"];
+            s.has_nulls = !j["null_count"].is_null();
+            s.nulls = s.has_nulls ? j["null_count"].get<int64_t>() : 0;
+            s.has_min_max = !j["min"].is_null();
+            if(s.has_min_max) {
+                s.min = j["min"];
+                s.max = j["max"];
+            }
+            s.encodings = j["encodings"].get<std::set<std::string>>();
+            s.codecs = j["codecs"].get<std::set<std::string>>();
+            auto file = j["file"].get<std::string>();
+            file = file.substr(file.find_last_of('/') + 1);
+            print_row(std::cout, file + ":" + std::to_string(j["row_group"].get<int>()) + " " + j["column"].get<std::string>(),
+                    width + 12, s, total.compressed);
+        }
+    }
+
+    return 0;
+}
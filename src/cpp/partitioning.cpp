@@ -0,0 +1,119 @@
+#include "partitioning.h"
+
+// std/stl
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <cstdlib> // strtod
+
+namespace partitioning {
+
+namespace {
+
+std::string trim(const std::string& s) {
+    auto begin = s.find_first_not_of(" \t");
+    if(begin == std::string::npos) return "";
+    auto end = s.find_last_not_of(" \t");
+    return s.substr(begin, end - begin + 1);
+}
+
+bool to_number(const std::string& s, double& value) {
+    if(s.empty()) return false;
+    char* end = nullptr;
+    value = std::strtod(s.c_str(), &end);
+    return end == s.c_str() + s.size();
+}
+
+} // namespace
+
+std::map<std::string, std::string> values(const std::string& relative_path) {
+    std::map<std::string, std::string> out;
+    for(const auto& part : std::filesystem::path(relative_path)) {
+        auto name = part.string();
+        auto eq = name.find('=');
+        if(eq == std::string::npos || eq == 0) continue;
+        out[name.substr(0, eq)] = name.substr(eq + 1);
+    }
+    return out;
+}
+
+std::string directory(const std::vector<std::pair<std::string, std::string>>& values) {
+    std::filesystem::path out;
+    for(const auto& value : values) {
+        out /= value.first + "=" + value.second;
+    }
+    return out.generic_string();
+}
+
+Filter::Filter(const std::string& expression) :
+    _expression(expression)
+{
+    // split into terms at "&&" and ","
+    std::string normalized = expression;
+    for(size_t pos = 0; (pos = normalized.find("&&", pos)) != std::string::npos; ) {
+        normalized.replace(pos, 2, ",");
+    }
+    std::stringstream ss(normalized);
+    std::string item;
+    while(std::getline(ss, item, ',')) {
+        item = trim(item);
+        if(item.empty()) continue;
+        auto pos = item.find_first_of("=!<>");
+        if(pos == std::string::npos || pos == 0) {
+            throw std::runtime_error("ERROR: Invalid partition filter term \"" + item + "\" in \"" + expression + "\"");
+        }
+        Term term;
+        term.key = trim(item.substr(0, pos));
+        size_t n = (pos + 1 < item.size() && item.at(pos + 1) == '=') ? 2 : 1;
+        term.op = item.substr(pos, n);
+        if(term.op == "=") term.op = "==";
+        if(term.op == "!") {
+            throw std::runtime_error("ERROR: Invalid partition filter term \"" + item + "\" in \"" + expression + "\"");
+        }
+        std::stringstream values(item.substr(pos + n));
+        std::string value;
+        while(std::getline(values, value, '|')) {
+            value = trim(value);
+            if(!value.empty()) term.values.push_back(value);
+        }
+        if(term.values.empty() || (term.values.size() > 1 && term.op != "==" && term.op != "!=")) {
+            throw std::runtime_error("ERROR: Invalid partition filter term \"" + item + "\" in \"" + expression + "\"");
+        }
+        _terms.push_back(term);
+    }
+}
+
+bool Filter::compare(const std::string& lhs, const std::string& op, const std::string& rhs) {
+    double a, b;
+    int cmp;
+    if(to_number(lhs, a) && to_number(rhs, b)) {
+        cmp = a < b ? -1 : (a > b ? 1 : 0);
+    } else {
+        cmp = lhs.compare(rhs);
+    }
+    if(op == "==") return cmp == 0;
+    if(op == "!=") return cmp != 0;
+    if(op == "<") return cmp < 0;
+    if(op == "<=") return cmp <= 0;
+    if(op == ">") return cmp > 0;
+    return cmp >= 0;
+}
+
+bool Filter::may_match(const std::map<std::string, std::string>& values) const {
+    for(const auto& term : _terms) {
+        auto it = values.find(term.key);
+        if(it == values.end()) continue;
+        bool pass = term.op == "!=";
+        for(const auto& value : term.values) {
+            if(term.op == "!=") {
+                pass = pass && compare(it->second, term.op, value);
+            } else {
+                pass = pass || compare(it->second, term.op, value);
+            }
+        }
+        if(!pass) return false;
+    }
+    return true;
+}
+
+}; // namespace partitioning
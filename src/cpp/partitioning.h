@@ -0,0 +1,60 @@
+#pragma once
+
+//std/stl
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+
+//
+// Hive-style partitioned datasets: the files of a dataset directory may live in
+// a tree of subdirectories named after the values of partition keys, e.g.
+//
+//      dataset_gen/campaign=mc16d/dsid=410472/dummy_0.parquet
+//
+// so that what a file holds (the sample's campaign and DSID) is known from its
+// path alone, and a reader selects partitions by pruning whole directories
+// with a Filter, without opening any footer (see DatasetReader).
+//
+namespace partitioning {
+
+    // the "key=value" directories of a path (relative to the dataset
+    // directory), e.g. {{"campaign", "mc16d"}, {"dsid", "410472"}} for the path above
+    std::map<std::string, std::string> values(const std::string& relative_path);
+
+    // the directory of the partition with these (ordered) values, e.g. "campaign=mc16d/dsid=410472"
+    std::string directory(const std::vector<std::pair<std::string, std::string>>& values);
+
+    class Filter {
+        public:
+            // an empty filter, matching all partitions
+            Filter() = default;
+
+            //
+            // terms on the partition keys, separated by "&&" or ",", all of
+            // which must hold, e.g. "campaign==mc16d && dsid>=410000" or
+            // "campaign=mc16a|mc16d" ("=" and "==" match any of the values
+            // separated by '|'); the comparisons are numeric if both sides are
+            // numbers, else lexicographic
+            //
+            explicit Filter(const std::string& expression);
+
+            bool empty() const { return _terms.empty(); }
+            const std::string& expression() const { return _expression; }
+
+            // false if a partition value in "values" fails a term; keys that are not
+            // (yet) in "values", e.g. for a directory above the level of the key, pass
+            bool may_match(const std::map<std::string, std::string>& values) const;
+
+        private :
+            struct Term {
+                std::string key;
+                std::string op;
+                std::vector<std::string> values;
+            };
+            std::string _expression;
+            std::vector<Term> _terms;
+
+            static bool compare(const std::string& lhs, const std::string& op, const std::string& rhs);
+    }; // class Filter
+}; // namespace partitioning
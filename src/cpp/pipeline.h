@@ -0,0 +1,115 @@
+#pragma once
+
+#include "metrics.h"
+
+//std/stl
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <stddef.h>
+
+//
+// Building blocks for multi-threaded, streaming read -> process -> write
+// pipelines whose memory use does not grow with the size of the dataset.
+//
+namespace pipeline {
+
+    //
+    // Hand-off between a pool of workers that produce items numbered 0, 1, 2, ...
+    // in any order and a single consumer that takes them in sequence order.
+    //
+    // At most "capacity" items are in flight (being produced or waiting to be
+    // consumed) at any time: a worker first waits for its item's slot, so a
+    // slow consumer throttles the producers instead of letting results pile up.
+    // abort() wakes up everyone, e.g. after an error in one of the stages.
+    //
+    // With set_metrics(), the number of items waiting to be consumed and the
+    // time spent blocked on either side are reported (see metrics.h); waits
+    // are only timed when they actually block.
+    //
+    template<typename T>
+    class OrderedQueue {
+        public:
+            OrderedQueue(size_t capacity) :
+                _capacity(capacity > 0 ? capacity : 1),
+                _next(0),
+                _aborted(false),
+                _depth(nullptr),
+                _producer_stall_ns(nullptr),
+                _consumer_stall_ns(nullptr)
+            {
+            }
+
+            // report the queue depth and the nanoseconds producers (the consumer) are blocked
+            void set_metrics(metrics::Gauge* depth, metrics::Counter* producer_stall_ns, metrics::Counter* consumer_stall_ns) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _depth = depth;
+                _producer_stall_ns = producer_stall_ns;
+                _consumer_stall_ns = consumer_stall_ns;
+            }
+
+            // block until item "seq" may be produced, false if aborted
+            bool wait_for_slot(size_t seq) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                wait(lock, _producer_stall_ns, [&] { return _aborted || seq < _next + _capacity; });
+                return !_aborted;
+            }
+
+            void push(size_t seq, T item) {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _items.emplace(seq, std::move(item));
+                    if(_depth) _depth->set(static_cast<int64_t>(_items.size()));
+                }
+                _cv.notify_all();
+            }
+
+            // block until the next item in sequence is available, false if aborted
+            bool pop(T& item) {
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    wait(lock, _consumer_stall_ns, [&] { return _aborted || _items.count(_next); });
+                    if(_aborted) return false;
+                    auto it = _items.find(_next);
+                    item = std::move(it->second);
+                    _items.erase(it);
+                    _next++;
+                    if(_depth) _depth->set(static_cast<int64_t>(_items.size()));
+                }
+                _cv.notify_all();
+                return true;
+            }
+
+            void abort() {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _aborted = true;
+                }
+                _cv.notify_all();
+            }
+
+        private :
+            const size_t _capacity;
+            size_t _next;
+            bool _aborted;
+            std::map<size_t, T> _items;
+            std::mutex _mutex;
+            std::condition_variable _cv;
+            metrics::Gauge* _depth;
+            metrics::Counter* _producer_stall_ns;
+            metrics::Counter* _consumer_stall_ns;
+
+            template<typename Predicate>
+            void wait(std::unique_lock<std::mutex>& lock, metrics::Counter* stall_ns, Predicate ready) {
+                if(ready()) return;
+                auto start = std::chrono::steady_clock::now();
+                _cv.wait(lock, ready);
+                if(stall_ns) {
+                    stall_ns->add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - start).count());
+                }
+            }
+    }; // class OrderedQueue
+
+}; // namespace pipeline
@@ -0,0 +1,167 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "dataset_stream.h"
+#include "footer_cache.h"
+
+//std/stl
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <stdexcept>
+
+//arrow/parquet
+#include <arrow/c/abi.h>
+
+//
+// Python extension module "pydataset": the RowGroups of a dataset read by the
+// C++ DatasetReader, handed to Python as an Arrow C stream (see
+// dataset_stream.h), e.g.
+//
+//      import pyarrow as pa, pydataset
+//      reader = pa.RecordBatchReader._import_from_c_capsule(pydataset.stream("dataset_gen", columns = ["jets"]))
+//      for batch in reader : events = ak.from_arrow(batch)
+//
+// The stream is exchanged as a PyCapsule named "arrow_array_stream" (the Arrow
+// PyCapsule interface), which owns the ArrowArrayStream struct: a consumer
+// importing it moves the stream out (leaving a released struct behind), and the
+// capsule destructor releases a stream that was never imported. The batches
+// reference the buffers read by the C++ reader, which stay alive until the
+// last Python object using them is gone, so nothing is copied.
+//
+// (the C interface is ABI-stable, so the Arrow libraries of this module and of
+// pyarrow need not be the same build or even the same version)
+//
+
+namespace {
+
+const char* kStreamCapsuleName = "arrow_array_stream";
+
+void release_stream_capsule(PyObject* capsule) {
+    auto stream = static_cast<ArrowArrayStream*>(PyCapsule_GetPointer(capsule, kStreamCapsuleName));
+    if(!stream) {
+        PyErr_WriteUnraisable(capsule);
+        return;
+    }
+    if(stream->release) {
+        stream->release(stream);
+    }
+    delete stream;
+}
+
+bool to_strings(PyObject* list, std::vector<std::string>& out) {
+    if(!list || list == Py_None) return true;
+    if(PyUnicode_Check(list)) {
+        out.push_back(PyUnicode_AsUTF8(list));
+        return true;
+    }
+    PyObject* seq = PySequence_Fast(list, "columns must be a sequence of strings");
+    if(!seq) return false;
+    for(Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); i++) {
+        const char* item = PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(seq, i));
+        if(!item) {
+            Py_DECREF(seq);
+            return false;
+        }
+        out.push_back(item);
+    }
+    Py_DECREF(seq);
+    return true;
+}
+
+PyObject* stream(PyObject* /*self*/, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"path", "columns", "partitions", "threads", "queue_size", "use_summary",
+        "footer_cache", nullptr};
+    const char* path = nullptr;
+    PyObject* columns_arg = nullptr;
+    const char* partitions = "";
+    Py_ssize_t n_threads = 0;
+    Py_ssize_t queue_size = 0;
+    int use_summary = 1;
+    const char* footer_cache_dir = "";
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "s|Osnnps", const_cast<char**>(keywords), &path, &columns_arg,
+                &partitions, &n_threads, &queue_size, &use_summary, &footer_cache_dir)) {
+        return nullptr;
+    }
+    std::vector<std::string> columns;
+    if(!to_strings(columns_arg, columns)) return nullptr;
+    if(n_threads <= 0) {
+        n_threads = std::max<Py_ssize_t>(1, std::thread::hardware_concurrency());
+    }
+
+    // planned, and the first RowGroup read, without holding the GIL
+    auto out = new ArrowArrayStream();
+    out->release = nullptr;
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        std::shared_ptr<FooterCache> footer_cache;
+        if(footer_cache_dir[0] != '\0') {
+            footer_cache = std::make_shared<FooterCache>(footer_cache_dir);
+        }
+        auto dataset = std::make_shared<DatasetReader>(path, use_summary != 0, partitioning::Filter(partitions),
+                footer_cache);
+        std::vector<int> leaves;
+        if(!columns.empty()) {
+            leaves = dataset->leaf_indices(columns);
+        }
+        auto reader = std::make_shared<DatasetBatchReader>(dataset, leaves, n_threads, queue_size);
+        helpers::export_stream(reader, out);
+        if(footer_cache) {
+            footer_cache->save();
+        }
+    } catch(const std::exception& e) {
+        error = e.what();
+    }
+    Py_END_ALLOW_THREADS
+
+    if(!error.empty()) {
+        delete out;
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    PyObject* capsule = PyCapsule_New(out, kStreamCapsuleName, release_stream_capsule);
+    if(!capsule) {
+        out->release(out);
+        delete out;
+    }
+    return capsule;
+}
+
+PyObject* stream_address(PyObject* /*self*/, PyObject* capsule) {
+    void* stream = PyCapsule_GetPointer(capsule, kStreamCapsuleName);
+    if(!stream) return nullptr;
+    return PyLong_FromVoidPtr(stream);
+}
+
+PyMethodDef methods[] = {
+    {"stream", reinterpret_cast<PyCFunction>(reinterpret_cast<void(*)(void)>(stream)), METH_VARARGS | METH_KEYWORDS,
+        "stream(path, columns=None, partitions=\"\", threads=0, queue_size=0, use_summary=True, footer_cache=\"\")\n"
+        "--\n\n"
+        "The RowGroups of the dataset (a Parquet file or directory) at \"path\", one RecordBatch\n"
+        "each and in dataset order, as an Arrow C stream in an \"arrow_array_stream\" PyCapsule.\n"
+        "\"columns\" are dotted column paths (e.g. \"jets.jets.pt\" or \"met\"), all columns if None,\n"
+        "\"partitions\" a partition filter (e.g. \"campaign==mc16d\"), and the RowGroups are read\n"
+        "ahead on \"threads\" threads (0: all hardware threads)."},
+    {"stream_address", stream_address, METH_O,
+        "stream_address(capsule)\n"
+        "--\n\n"
+        "The address of the ArrowArrayStream of a stream() capsule, for\n"
+        "pyarrow.RecordBatchReader._import_from_c(); the capsule must outlive the import."},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+PyModuleDef module = {
+    PyModuleDef_HEAD_INIT,
+    "pydataset",
+    "Datasets read by the C++ DatasetReader, exported through the Arrow C stream interface",
+    -1,
+    methods
+};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit_pydataset() {
+    return PyModule_Create(&module);
+}
@@ -0,0 +1,47 @@
+#include "resource_usage.h"
+
+// std/stl
+#include <fstream>
+
+// posix
+#include <sys/resource.h> // getrusage
+#include <unistd.h> // sysconf
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+namespace helpers {
+
+int64_t current_rss() {
+#ifdef __APPLE__
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if(task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return static_cast<int64_t>(info.resident_size);
+#else
+    // total program size and resident set size, in pages
+    std::ifstream statm("/proc/self/statm");
+    int64_t size = 0, resident = 0;
+    if(!(statm >> size >> resident)) {
+        return 0;
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+int64_t peak_rss() {
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<int64_t>(usage.ru_maxrss); // bytes
+#else
+    return static_cast<int64_t>(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+}
+
+}; // namespace helpers
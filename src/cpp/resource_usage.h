@@ -0,0 +1,13 @@
+#pragma once
+
+//std/stl
+#include <stdint.h>
+
+namespace helpers {
+
+    // resident set size of this process right now, in bytes (0 if unknown)
+    int64_t current_rss();
+
+    // the largest resident set size of this process so far, in bytes
+    int64_t peak_rss();
+}; // namespace helpers
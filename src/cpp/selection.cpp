@@ -0,0 +1,631 @@
+#include "selection.h"
+
+// std/stl
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstring> // memcpy
+#include <algorithm>
+#include <stdexcept>
+
+// arrow/parquet
+#include <parquet/exception.h>
+
+using nlohmann::json;
+
+namespace selection {
+
+namespace {
+
+std::string op_string(Op op) {
+    switch(op) {
+        case Op::GT: return ">";
+        case Op::GE: return ">=";
+        case Op::LT: return "<";
+        case Op::LE: return "<=";
+        case Op::EQ: return "==";
+        case Op::NE: return "!=";
+    }
+    return "?";
+}
+
+std::string format_value(double value) {
+    std::stringstream ss;
+    ss << value;
+    return ss.str();
+}
+
+template<Op op>
+inline bool compare(double x, double value) {
+    if constexpr (op == Op::GT) return x > value;
+    if constexpr (op == Op::GE) return x >= value;
+    if constexpr (op == Op::LT) return x < value;
+    if constexpr (op == Op::LE) return x <= value;
+    if constexpr (op == Op::EQ) return x == value;
+    if constexpr (op == Op::NE) return x != value;
+}
+
+//
+// Compare n contiguous values to "value", packing the results 64 at a time
+// into the mask words. The inner loop has a fixed trip count and no branches,
+// so that it is vectorized into compares, shifts and an OR-reduction.
+//
+template<typename T, Op op>
+void compare_into(const T* values, int64_t n, double value, uint64_t* words) {
+    const int64_t n_full = n / 64;
+    for(int64_t w = 0; w < n_full; w++) {
+        const T* block = values + 64 * w;
+        uint64_t word = 0;
+        #pragma omp simd reduction(|:word)
+        for(int j = 0; j < 64; j++) {
+            word |= static_cast<uint64_t>(compare<op>(static_cast<double>(block[j]), value)) << j;
+        }
+        words[w] = word;
+    } // w
+    if(n % 64) {
+        const T* block = values + 64 * n_full;
+        uint64_t word = 0;
+        for(int j = 0; j < n % 64; j++) {
+            word |= static_cast<uint64_t>(compare<op>(static_cast<double>(block[j]), value)) << j;
+        }
+        words[n_full] = word;
+    }
+}
+
+template<typename T>
+void compare_into(const T* values, int64_t n, Op op, double value, uint64_t* words) {
+    switch(op) {
+        case Op::GT: compare_into<T, Op::GT>(values, n, value, words); break;
+        case Op::GE: compare_into<T, Op::GE>(values, n, value, words); break;
+        case Op::LT: compare_into<T, Op::LT>(values, n, value, words); break;
+        case Op::LE: compare_into<T, Op::LE>(values, n, value, words); break;
+        case Op::EQ: compare_into<T, Op::EQ>(values, n, value, words); break;
+        case Op::NE: compare_into<T, Op::NE>(values, n, value, words); break;
+    }
+}
+
+template<typename ArrowType>
+void compare_array(const arrow::Array& array, Op op, double value, uint64_t* words) {
+    const auto* values = static_cast<const arrow::NumericArray<ArrowType>&>(array).raw_values();
+    compare_into(values, array.length(), op, value, words);
+}
+
+// the single leaf column index of "path", which must not be a struct or list
+int single_leaf(const DatasetReader& dataset, const std::string& path) {
+    auto leaves = dataset.leaf_indices({path});
+    if(leaves.size() != 1) {
+        throw std::runtime_error("ERROR: Cut column \"" + path + "\" is not a single leaf column");
+    }
+    return leaves.at(0);
+}
+
+//
+// cuts
+//
+
+class Threshold : public Cut {
+    public:
+        Threshold(const std::string& path, Op op, double value, const std::string& name) :
+            Cut(name), _path(path), _op(op), _value(value) {}
+
+        std::vector<std::string> columns() const override { return {_path}; }
+
+        EventMask evaluate(const std::shared_ptr<arrow::Table>& table) const override {
+            auto array = helpers::leaf_array(table, _path);
+            EventMask mask(array->length());
+            uint64_t* words = mask.words();
+            switch(array->type_id()) {
+                case arrow::Type::FLOAT: compare_array<arrow::FloatType>(*array, _op, _value, words); break;
+                case arrow::Type::DOUBLE: compare_array<arrow::DoubleType>(*array, _op, _value, words); break;
+                case arrow::Type::UINT8: compare_array<arrow::UInt8Type>(*array, _op, _value, words); break;
+                case arrow::Type::INT8: compare_array<arrow::Int8Type>(*array, _op, _value, words); break;
+                case arrow::Type::UINT16: compare_array<arrow::UInt16Type>(*array, _op, _value, words); break;
+                case arrow::Type::INT16: compare_array<arrow::Int16Type>(*array, _op, _value, words); break;
+                case arrow::Type::UINT32: compare_array<arrow::UInt32Type>(*array, _op, _value, words); break;
+                case arrow::Type::INT32: compare_array<arrow::Int32Type>(*array, _op, _value, words); break;
+                case arrow::Type::UINT64: compare_array<arrow::UInt64Type>(*array, _op, _value, words); break;
+                case arrow::Type::INT64: compare_array<arrow::Int64Type>(*array, _op, _value, words); break;
+                default:
+                    throw std::runtime_error("ERROR: Cannot apply cut \"" + _name + "\" to column \"" + _path
+                            + "\" of type " + array->type()->ToString() + ", a per-event numeric column is required");
+            }
+            if(array->null_count() > 0) {
+                for(int64_t i = 0; i < array->length(); i++) {
+                    if(array->IsNull(i)) mask.set(i, false);
+                }
+            }
+            return mask;
+        }
+
+        bool may_pass(const parquet::RowGroupMetaData& row_group, const DatasetReader& dataset) const override {
+            double min, max;
+            if(!helpers::leaf_min_max(row_group, single_leaf(dataset, _path), min, max)) return true;
+            switch(_op) {
+                case Op::GT: return max > _value;
+                case Op::GE: return max >= _value;
+                case Op::LT: return min < _value;
+                case Op::LE: return min <= _value;
+                case Op::EQ: return min <= _value && _value <= max;
+                case Op::NE: return !(min == _value && max == _value);
+            }
+            return true;
+        }
+
+    private :
+        std::string _path;
+        Op _op;
+        double _value;
+}; // class Threshold
+
+class TriggerBits : public Cut {
+    public:
+        TriggerBits(const std::string& path, const std::vector<int>& bits, bool require_all,
+                const std::string& name) :
+            Cut(name), _path(path), _bits(bits), _require_all(require_all) {}
+
+        std::vector<std::string> columns() const override { return {_path}; }
+
+        EventMask evaluate(const std::shared_ptr<arrow::Table>& table) const override {
+            auto array = helpers::leaf_array(table, _path);
+            if(array->type_id() != arrow::Type::LIST
+                    || static_cast<const arrow::ListArray&>(*array).values()->type_id() != arrow::Type::BOOL) {
+                throw std::runtime_error("ERROR: Cannot apply cut \"" + _name + "\" to column \"" + _path
+                        + "\" of type " + array->type()->ToString() + ", a list<bool> column is required");
+            }
+            const auto& list = static_cast<const arrow::ListArray&>(*array);
+            const auto& values = static_cast<const arrow::BooleanArray&>(*list.values());
+            const int32_t* offsets = list.raw_value_offsets();
+
+            const int64_t n = list.length();
+            EventMask mask(n);
+            uint64_t* words = mask.words();
+            for(int64_t i = 0; i < n; i++) {
+                const int32_t start = offsets[i];
+                const int32_t length = offsets[i + 1] - start;
+                bool pass = _require_all;
+                for(int bit : _bits) {
+                    bool set = bit < length && values.Value(start + bit);
+                    pass = _require_all ? (pass && set) : (pass || set);
+                }
+                pass = pass && !list.IsNull(i);
+                words[i >> 6] |= static_cast<uint64_t>(pass) << (i & 63);
+            } // i
+            return mask;
+        }
+
+        bool may_pass(const parquet::RowGroupMetaData& row_group, const DatasetReader& dataset) const override {
+            // either way at least one bit must be set somewhere in the RowGroup
+            double min, max;
+            if(!helpers::leaf_min_max(row_group, single_leaf(dataset, _path), min, max)) return true;
+            return max > 0.;
+        }
+
+    private :
+        std::string _path;
+        std::vector<int> _bits;
+        bool _require_all;
+}; // class TriggerBits
+
+class Composite : public Cut {
+    public:
+        Composite(const std::vector<std::shared_ptr<Cut>>& cuts, bool require_all, const std::string& name) :
+            Cut(name), _cuts(cuts), _require_all(require_all)
+        {
+            if(_cuts.empty()) {
+                throw std::runtime_error("ERROR: Cannot combine an empty list of cuts");
+            }
+        }
+
+        std::vector<std::string> columns() const override {
+            std::vector<std::string> out;
+            for(const auto& cut : _cuts) {
+                for(const auto& column : cut->columns()) {
+                    if(std::find(out.begin(), out.end(), column) == out.end()) {
+                        out.push_back(column);
+                    }
+                }
+            }
+            return out;
+        }
+
+        EventMask evaluate(const std::shared_ptr<arrow::Table>& table) const override {
+            EventMask mask = _cuts.at(0)->evaluate(table);
+            for(size_t i = 1; i < _cuts.size(); i++) {
+                if(_require_all) {
+                    if(mask.none()) break;
+                    mask &= _cuts.at(i)->evaluate(table);
+                } else {
+                    mask |= _cuts.at(i)->evaluate(table);
+                }
+            }
+            return mask;
+        }
+
+        bool may_pass(const parquet::RowGroupMetaData& row_group, const DatasetReader& dataset) const override {
+            for(const auto& cut : _cuts) {
+                bool pass = cut->may_pass(row_group, dataset);
+                if(_require_all && !pass) return false;
+                if(!_require_all && pass) return true;
+            }
+            return _require_all;
+        }
+
+    private :
+        std::vector<std::shared_ptr<Cut>> _cuts;
+        bool _require_all;
+}; // class Composite
+
+std::string join_names(const std::vector<std::shared_ptr<Cut>>& cuts, const std::string& separator) {
+    std::string out;
+    for(size_t i = 0; i < cuts.size(); i++) {
+        out += (i ? separator : "") + cuts.at(i)->name();
+    }
+    return out;
+}
+
+//
+// parsing
+//
+
+std::string trim(const std::string& s) {
+    auto begin = s.find_first_not_of(" \t");
+    if(begin == std::string::npos) return "";
+    auto end = s.find_last_not_of(" \t");
+    return s.substr(begin, end - begin + 1);
+}
+
+std::vector<std::string> split(const std::string& s, const std::string& separator) {
+    std::vector<std::string> out;
+    size_t start = 0, pos;
+    while((pos = s.find(separator, start)) != std::string::npos) {
+        out.push_back(s.substr(start, pos - start));
+        start = pos + separator.size();
+    }
+    out.push_back(s.substr(start));
+    return out;
+}
+
+std::shared_ptr<Cut> parse_atom(const std::string& expression) {
+    auto expr = trim(expression);
+    if(expr.empty()) {
+        throw std::runtime_error("ERROR: Empty term in cut expression");
+    }
+
+    // trigger bits, e.g. "event.trigMask[0|3]"
+    auto open = expr.find('[');
+    if(open != std::string::npos) {
+        if(expr.back() != ']') {
+            throw std::runtime_error("ERROR: Malformed bit selection in cut expression \"" + expr + "\"");
+        }
+        auto path = trim(expr.substr(0, open));
+        auto inside = expr.substr(open + 1, expr.size() - open - 2);
+        bool has_and = inside.find('&') != std::string::npos;
+        bool has_or = inside.find('|') != std::string::npos;
+        if(has_and && has_or) {
+            throw std::runtime_error("ERROR: Cannot mix '&' and '|' in bit selection \"" + expr + "\"");
+        }
+        std::vector<int> bits;
+        for(const auto& bit : split(inside, has_and ? "&" : "|")) {
+            try {
+                bits.push_back(std::stoi(trim(bit)));
+            } catch(std::exception& e) {
+                throw std::runtime_error("ERROR: Invalid bit \"" + bit + "\" in cut expression \"" + expr + "\"");
+            }
+        }
+        return trigger_bits(path, bits, has_and, expr);
+    }
+
+    // comparison, e.g. "jets.n>=2"
+    auto pos = expr.find_first_of("<>=!");
+    if(pos == std::string::npos) {
+        throw std::runtime_error("ERROR: No comparison found in cut expression \"" + expr + "\"");
+    }
+    bool two_char = pos + 1 < expr.size() && expr[pos + 1] == '=';
+    auto op_str = expr.substr(pos, two_char ? 2 : 1);
+    Op op;
+    if     (op_str == ">")  { op = Op::GT; }
+    else if(op_str == ">=") { op = Op::GE; }
+    else if(op_str == "<")  { op = Op::LT; }
+    else if(op_str == "<=") { op = Op::LE; }
+    else if(op_str == "==") { op = Op::EQ; }
+    else if(op_str == "!=") { op = Op::NE; }
+    else {
+        throw std::runtime_error("ERROR: Unknown comparison \"" + op_str + "\" in cut expression \"" + expr + "\"");
+    }
+    auto path = trim(expr.substr(0, pos));
+    auto value_str = trim(expr.substr(pos + op_str.size()));
+    double value;
+    try {
+        size_t n_parsed = 0;
+        value = std::stod(value_str, &n_parsed);
+        if(n_parsed != value_str.size()) throw std::invalid_argument(value_str);
+    } catch(std::exception& e) {
+        throw std::runtime_error("ERROR: Invalid value \"" + value_str + "\" in cut expression \"" + expr + "\"");
+    }
+    if(path.empty()) {
+        throw std::runtime_error("ERROR: No column given in cut expression \"" + expr + "\"");
+    }
+    return threshold(path, op, value, expr);
+}
+
+} // namespace
+
+//
+// EventMask
+//
+
+EventMask::EventMask(int64_t size, bool value) :
+    _size(size),
+    _words((size + 63) / 64, value ? ~uint64_t(0) : uint64_t(0))
+{
+    clear_tail();
+}
+
+void EventMask::clear_tail() {
+    if(_size % 64) {
+        _words.back() &= (uint64_t(1) << (_size % 64)) - 1;
+    }
+}
+
+EventMask& EventMask::operator&=(const EventMask& other) {
+    if(other._size != _size) {
+        throw std::runtime_error("ERROR: Cannot combine event masks of different sizes");
+    }
+    for(size_t i = 0; i < _words.size(); i++) {
+        _words[i] &= other._words[i];
+    }
+    return *this;
+}
+
+EventMask& EventMask::operator|=(const EventMask& other) {
+    if(other._size != _size) {
+        throw std::runtime_error("ERROR: Cannot combine event masks of different sizes");
+    }
+    for(size_t i = 0; i < _words.size(); i++) {
+        _words[i] |= other._words[i];
+    }
+    return *this;
+}
+
+EventMask EventMask::operator~() const {
+    EventMask out(*this);
+    for(auto& word : out._words) {
+        word = ~word;
+    }
+    out.clear_tail();
+    return out;
+}
+
+int64_t EventMask::count() const {
+    int64_t n = 0;
+    for(auto word : _words) {
+        n += __builtin_popcountll(word);
+    }
+    return n;
+}
+
+bool EventMask::none() const {
+    for(auto word : _words) {
+        if(word) return false;
+    }
+    return true;
+}
+
+double EventMask::weighted_sum(const arrow::Array& weights) const {
+    if(weights.length() != _size) {
+        throw std::runtime_error("ERROR: Weight array length (" + std::to_string(weights.length())
+                + ") does not match the event mask size (" + std::to_string(_size) + ")");
+    }
+    auto sum = [this](const auto* w) {
+        double total = 0.;
+        for(size_t i = 0; i < _words.size(); i++) {
+            uint64_t word = _words[i];
+            while(word) {
+                total += w[64 * i + __builtin_ctzll(word)];
+                word &= word - 1;
+            }
+        }
+        return total;
+    };
+    switch(weights.type_id()) {
+        case arrow::Type::DOUBLE: return sum(static_cast<const arrow::DoubleArray&>(weights).raw_values());
+        case arrow::Type::FLOAT: return sum(static_cast<const arrow::FloatArray&>(weights).raw_values());
+        default:
+            throw std::runtime_error("ERROR: Cannot sum weights of type " + weights.type()->ToString());
+    }
+}
+
+std::shared_ptr<arrow::BooleanArray> EventMask::to_array(arrow::MemoryPool* pool) const {
+    const int64_t n_bytes = (_size + 7) / 8;
+    std::shared_ptr<arrow::Buffer> buffer;
+    PARQUET_ASSIGN_OR_THROW(buffer, arrow::AllocateBuffer(n_bytes, pool));
+    std::memcpy(buffer->mutable_data(), data(), n_bytes);
+    return std::make_shared<arrow::BooleanArray>(_size, buffer);
+}
+
+//
+// cut factories
+//
+
+std::shared_ptr<Cut> threshold(const std::string& path, Op op, double value, const std::string& name) {
+    return std::make_shared<Threshold>(path, op, value,
+            name.empty() ? path + op_string(op) + format_value(value) : name);
+}
+
+std::shared_ptr<Cut> trigger_bits(const std::string& path, const std::vector<int>& bits,
+        bool require_all, const std::string& name) {
+    if(bits.empty()) {
+        throw std::runtime_error("ERROR: No bits given for cut on \"" + path + "\"");
+    }
+    for(int bit : bits) {
+        if(bit < 0) {
+            throw std::runtime_error("ERROR: Invalid bit " + std::to_string(bit) + " for cut on \"" + path + "\"");
+        }
+    }
+    std::string default_name = path + "[";
+    for(size_t i = 0; i < bits.size(); i++) {
+        default_name += (i ? (require_all ? "&" : "|") : "") + std::to_string(bits.at(i));
+    }
+    default_name += "]";
+    return std::make_shared<TriggerBits>(path, bits, require_all, name.empty() ? default_name : name);
+}
+
+std::shared_ptr<Cut> all_of(const std::vector<std::shared_ptr<Cut>>& cuts, const std::string& name) {
+    if(cuts.size() == 1 && name.empty()) return cuts.at(0);
+    return std::make_shared<Composite>(cuts, true, name.empty() ? join_names(cuts, " && ") : name);
+}
+
+std::shared_ptr<Cut> any_of(const std::vector<std::shared_ptr<Cut>>& cuts, const std::string& name) {
+    if(cuts.size() == 1 && name.empty()) return cuts.at(0);
+    return std::make_shared<Composite>(cuts, false, name.empty() ? join_names(cuts, " || ") : name);
+}
+
+std::shared_ptr<Cut> parse_cut(const std::string& expression) {
+    std::vector<std::shared_ptr<Cut>> any;
+    for(const auto& or_term : split(expression, "||")) {
+        std::vector<std::shared_ptr<Cut>> all;
+        for(const auto& and_term : split(or_term, "&&")) {
+            all.push_back(parse_atom(and_term));
+        }
+        any.push_back(all_of(all));
+    }
+    return any_of(any);
+}
+
+//
+// Selection
+//
+
+Selection::Selection(const std::string& weight_path) :
+    _weight_path(weight_path),
+    _n_rejected(0),
+    _n_rejected_by_stats(0)
+{
+    _cutflow.push_back({"all", 0, 0.});
+}
+
+Selection& Selection::add(std::shared_ptr<Cut> cut) {
+    _cutflow.push_back({cut->name(), 0, 0.});
+    _cuts.push_back(cut);
+    return *this;
+}
+
+std::vector<std::string> Selection::columns() const {
+    std::vector<std::string> out = {_weight_path};
+    for(const auto& cut : _cuts) {
+        for(const auto& column : cut->columns()) {
+            if(std::find(out.begin(), out.end(), column) == out.end()) {
+                out.push_back(column);
+            }
+        }
+    }
+    return out;
+}
+
+void Selection::count(size_t step, const EventMask& mask, const arrow::Array& weights) {
+    auto& s = _cutflow.at(step);
+    s.raw += mask.count();
+    s.weighted += mask.weighted_sum(weights);
+}
+
+EventMask Selection::apply(const std::shared_ptr<arrow::Table>& table) {
+    auto weights = helpers::leaf_array(table, _weight_path);
+    EventMask mask(table->num_rows(), true);
+    count(0, mask, *weights);
+    for(size_t i = 0; i < _cuts.size(); i++) {
+        if(mask.none()) break;
+        mask &= _cuts.at(i)->evaluate(table);
+        count(i + 1, mask, *weights);
+    }
+    if(mask.none()) _n_rejected++;
+    return mask;
+}
+
+EventMask Selection::apply(RowGroupReader& reader, const DatasetReader& dataset, const RowGroupTask& task) {
+    auto weights = helpers::leaf_array(reader.read(task, dataset.leaf_indices({_weight_path})), _weight_path);
+    EventMask mask(task.num_rows, true);
+    count(0, mask, *weights);
+
+    std::unique_ptr<parquet::RowGroupMetaData> row_group;
+    for(size_t i = 0; i < _cuts.size(); i++) {
+        // the counts are cumulative, so once nothing is left the remaining steps add nothing
+        if(mask.none()) break;
+        const auto& cut = _cuts.at(i);
+        if(!row_group) {
+            row_group = dataset.row_group_metadata(task);
+        }
+        if(!cut->may_pass(*row_group, dataset)) {
+            mask = EventMask(task.num_rows, false);
+            _n_rejected_by_stats++;
+            break;
+        }
+        auto table = reader.read(task, dataset.leaf_indices(cut->columns()));
+        mask &= cut->evaluate(table);
+        count(i + 1, mask, *weights);
+    } // i
+    if(mask.none()) _n_rejected++;
+    return mask;
+}
+
+Selection Selection::clone_empty() const {
+    Selection out(_weight_path);
+    for(const auto& cut : _cuts) {
+        out.add(cut);
+    }
+    return out;
+}
+
+void Selection::merge(const Selection& other) {
+    if(other._cutflow.size() != _cutflow.size()) {
+        throw std::runtime_error("ERROR: Cannot merge selections with different numbers of cuts");
+    }
+    for(size_t i = 0; i < _cutflow.size(); i++) {
+        if(_cutflow.at(i).name != other._cutflow.at(i).name) {
+            throw std::runtime_error("ERROR: Cannot merge selections with different cuts");
+        }
+        _cutflow.at(i).raw += other._cutflow.at(i).raw;
+        _cutflow.at(i).weighted += other._cutflow.at(i).weighted;
+    }
+    _n_rejected += other._n_rejected;
+    _n_rejected_by_stats += other._n_rejected_by_stats;
+}
+
+void Selection::print(std::ostream& os) const {
+    size_t width = 10;
+    for(const auto& step : _cutflow) {
+        width = std::max(width, step.name.size() + 2);
+    }
+    os << "---------------------------------------------------------------------------" << std::endl;
+    os << " Cutflow (weighted by " << _weight_path << ")" << std::endl;
+    os << "   " << std::left << std::setw(width) << "cut" << std::right
+        << std::setw(14) << "raw" << std::setw(18) << "weighted" << std::setw(12) << "eff [%]" << std::endl;
+    for(size_t i = 0; i < _cutflow.size(); i++) {
+        const auto& step = _cutflow.at(i);
+        const auto& previous = _cutflow.at(i ? i - 1 : 0);
+        double eff = previous.raw ? 100. * step.raw / previous.raw : 0.;
+        os << "   " << std::left << std::setw(width) << step.name << std::right
+            << std::setw(14) << step.raw << std::setw(18) << std::fixed << std::setprecision(3) << step.weighted
+            << std::setw(12) << std::setprecision(2) << eff << std::defaultfloat << std::endl;
+    }
+    os << " RowGroups with no selected events: " << _n_rejected
+        << " (" << _n_rejected_by_stats << " from column statistics)" << std::endl;
+    os << "---------------------------------------------------------------------------" << std::endl;
+}
+
+json Selection::to_json() const {
+    json j;
+    j["weight"] = _weight_path;
+    j["cutflow"] = json::array();
+    for(const auto& step : _cutflow) {
+        json s;
+        s["name"] = step.name;
+        s["raw"] = step.raw;
+        s["weighted"] = step.weighted;
+        j["cutflow"].push_back(s);
+    }
+    j["row_groups_rejected"] = _n_rejected;
+    j["row_groups_rejected_by_stats"] = _n_rejected_by_stats;
+    return j;
+}
+
+}; // namespace selection
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "dataset_reader.h"
+
+//std/stl
+#include <string>
+#include <vector>
+#include <memory>
+#include <ostream>
+#include <stdint.h>
+
+//arrow/parquet
+#include <arrow/api.h>
+#include <parquet/metadata.h>
+
+//nlohmann
+#include "json.hpp"
+
+//
+// Event selection evaluated column-wise into packed bitmaps.
+//
+// Each Cut reads only the columns it needs and produces an EventMask with one
+// bit per event of the batch (RowGroup). Masks are combined with bitwise
+// AND/OR over 64-bit words and are handed as-is to the downstream kernels
+// (e.g. the histogram batch fills), so that no filtered copy of the data is
+// ever materialized.
+//
+// A Selection is an ordered list of cuts that are ANDed together and keeps the
+// cumulative cutflow, raw and weighted by the event weight, after each step.
+// When reading a dataset, the cuts are evaluated one at a time: a cut is
+// skipped from the RowGroup column statistics alone if no event can pass it,
+// and once no event is left the columns of the remaining cuts (and of the
+// payload) are never read.
+//
+namespace selection {
+
+    // one bit per event, Arrow-style (LSB-first) so that data() can be used
+    // directly as a validity-like bitmap (on little-endian hosts); the bits
+    // past size() are always zero
+    class EventMask {
+        public:
+            EventMask(int64_t size = 0, bool value = false);
+
+            int64_t size() const { return _size; }
+            int64_t n_words() const { return static_cast<int64_t>(_words.size()); }
+            uint64_t* words() { return _words.data(); }
+            const uint64_t* words() const { return _words.data(); }
+            const uint8_t* data() const { return reinterpret_cast<const uint8_t*>(_words.data()); }
+
+            bool get(int64_t i) const { return (_words[i >> 6] >> (i & 63)) & 1; }
+            void set(int64_t i, bool value) {
+                const uint64_t bit = uint64_t(1) << (i & 63);
+                _words[i >> 6] = value ? (_words[i >> 6] | bit) : (_words[i >> 6] & ~bit);
+            }
+
+            EventMask& operator&=(const EventMask& other);
+            EventMask& operator|=(const EventMask& other);
+            EventMask operator~() const;
+
+            // number of selected events
+            int64_t count() const;
+            bool none() const;
+            // sum of the (numeric) per-event "weights" over the selected events
+            double weighted_sum(const arrow::Array& weights) const;
+
+            // as a BooleanArray, e.g. for arrow::compute::Filter
+            std::shared_ptr<arrow::BooleanArray> to_array(arrow::MemoryPool* pool = arrow::default_memory_pool()) const;
+
+        private :
+            int64_t _size;
+            std::vector<uint64_t> _words;
+
+            void clear_tail();
+    }; // class EventMask
+
+    class Cut {
+        public:
+            Cut(const std::string& name) : _name(name) {}
+            virtual ~Cut() = default;
+
+            const std::string& name() const { return _name; }
+
+            // dotted leaf paths (see helpers::leaf_paths) needed to evaluate the cut
+            virtual std::vector<std::string> columns() const = 0;
+            // evaluate on a table read with (at least) the columns()
+            virtual EventMask evaluate(const std::shared_ptr<arrow::Table>& table) const = 0;
+            // false if the column statistics of "row_group" show that no event can pass
+            virtual bool may_pass(const parquet::RowGroupMetaData& /*row_group*/, const DatasetReader& /*dataset*/) const {
+                return true;
+            }
+
+        protected :
+            std::string _name;
+    }; // class Cut
+
+    enum class Op { GT, GE, LT, LE, EQ, NE };
+
+    //
+    // cut factories
+    //
+
+    // per-event numeric column compared to a value, e.g. threshold("met.met", Op::GT, 50)
+    // or threshold("jets.n", Op::GE, 2); null entries fail
+    std::shared_ptr<Cut> threshold(const std::string& path, Op op, double value, const std::string& name = "");
+
+    // bits of a per-event list<bool> column, e.g. trigger_bits("event.trigMask", {0, 3}),
+    // passing if any (or, with require_all, every) one of the given bits is set
+    std::shared_ptr<Cut> trigger_bits(const std::string& path, const std::vector<int>& bits,
+            bool require_all = false, const std::string& name = "");
+
+    // logical AND/OR of other cuts
+    std::shared_ptr<Cut> all_of(const std::vector<std::shared_ptr<Cut>>& cuts, const std::string& name = "");
+    std::shared_ptr<Cut> any_of(const std::vector<std::shared_ptr<Cut>>& cuts, const std::string& name = "");
+
+    // Parse a cut expression such as
+    //      "jets.n>=2", "met.met>50", "leptons.n==2 || met.met>100",
+    //      "event.trigMask[0|3]" (any of bits 0 and 3), "event.trigMask[0&3]" (both)
+    // where "&&" binds tighter than "||"; the cut is named after its terms
+    std::shared_ptr<Cut> parse_cut(const std::string& expression);
+
+    struct CutflowStep {
+        std::string name;
+        int64_t raw;
+        double weighted;
+    };
+
+    class Selection {
+        public:
+            Selection(const std::string& weight_path = "event.w");
+
+            Selection& add(std::shared_ptr<Cut> cut);
+            size_t size() const { return _cuts.size(); }
+            bool empty() const { return _cuts.empty(); }
+
+            // all columns needed by the cuts and the weights
+            std::vector<std::string> columns() const;
+
+            // evaluate all cuts on a table read with (at least) the columns(),
+            // accumulating the cutflow
+            EventMask apply(const std::shared_ptr<arrow::Table>& table);
+
+            // evaluate all cuts on a RowGroup, reading each cut's columns only
+            // if some event may still pass it, accumulating the cutflow
+            EventMask apply(RowGroupReader& reader, const DatasetReader& dataset, const RowGroupTask& task);
+
+            // cumulative counts, the first step ("all") being before any cut
+            const std::vector<CutflowStep>& cutflow() const { return _cutflow; }
+            // RowGroups in which no event passed, and how many of them were
+            // rejected from the column statistics alone
+            int64_t row_groups_rejected() const { return _n_rejected; }
+            int64_t row_groups_rejected_by_stats() const { return _n_rejected_by_stats; }
+
+            // a selection with the same cuts and a zeroed cutflow, e.g. for each thread
+            Selection clone_empty() const;
+            void merge(const Selection& other);
+
+            void print(std::ostream& os) const;
+            nlohmann::json to_json() const;
+
+        private :
+            std::string _weight_path;
+            std::vector<std::shared_ptr<Cut>> _cuts;
+            std::vector<CutflowStep> _cutflow;
+            int64_t _n_rejected;
+            int64_t _n_rejected_by_stats;
+
+            void count(size_t step, const EventMask& mask, const arrow::Array& weights);
+    }; // class Selection
+
+}; // namespace selection
@@ -0,0 +1,275 @@
+#include "dataset_reader.h"
+#include "memory_pool.h"
+#include "dataset_writer.h"
+#include "selection.h"
+#include "pipeline.h"
+#include "metrics.h"
+#include "sorting.h"
+#include "summary_metadata.h"
+
+//std/stl
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cstring> // strcmp
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+
+//arrow
+#include <arrow/compute/api.h>
+#include <parquet/exception.h>
+
+void print_usage(char* argv[]) {
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+    std::cout << " Skim (select events) and slim (select columns) a generated dataset" << std::endl;
+    std::cout << " into a new dataset, streaming RowGroup by RowGroup" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Usage: " << argv[0] << " [OPTIONS] <input dataset (file or directory)>" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Options:" << std::endl;
+    std::cout << "   --name                 Name of output dataset [default: \"skim\"]" << std::endl;
+    std::cout << "   -o|--outdir            Output directory to store files in [default: \"./dataset_skim\"]" << std::endl;
+    std::cout << "   -s|--cut               Cut that events must pass, repeat for several (see fill-histograms)" << std::endl;
+    std::cout << "   -k|--keep              Column (leaf path or prefix, e.g. \"jets.jets.pt\" or \"met\") to keep," << std::endl;
+    std::cout << "                          repeat for several [default: all columns]" << std::endl;
+    std::cout << "   -c|--compression       Compression setting (Options: UNCOMPRESSED, SNAPPY, GZIP, ZSTD, LZ4) [default: UNCOMPRESSED]" << std::endl;
+    std::cout << "   -r|--row-group-size    Number of events per output RowGroup [default: mean of the input]" << std::endl;
+    std::cout << "   -f|--file-size         Start a new output file once a file has this many events [default: 0, a single file]" << std::endl;
+    std::cout << "   --sort                 Sort the output events by these comma-separated leaf columns, each prefixed" << std::endl;
+    std::cout << "                          by '-' for a descending order (e.g. \"jets.n,met.met\")" << std::endl;
+    std::cout << "   --sort-window          Number of output RowGroups sorted together, held in memory (0 for the" << std::endl;
+    std::cout << "                          whole output) [default: 1]" << std::endl;
+    std::cout << "   -t|--threads           Number of reading/filtering threads [default: # of hardware threads]" << std::endl;
+    std::cout << "   -q|--queue-size        Maximum number of RowGroups in flight between the stages [default: 2 x threads]" << std::endl;
+    std::cout << "   -p|--partitions        Read only the partitions (\"key=value\" subdirectories) passing this filter," << std::endl;
+    std::cout << "                          e.g. \"campaign==mc16d && dsid>=410000\" or \"dsid=410472|410473\"" << std::endl;
+    std::cout << "   --memory-pool          Arrow memory pool backend (Options: default, system, jemalloc, mimalloc);" << std::endl;
+    std::cout << "                          the allocations of each phase are reported at the end [default: default]" << std::endl;
+    std::cout << "   --status-interval      Seconds between the one-line progress reports [default: 10]" << std::endl;
+    std::cout << "   --metrics-file         Also write the counters and gauges (e.g. the queue depth and the time each" << std::endl;
+    std::cout << "                          stage waits for the other) to this file in the Prometheus text format" << std::endl;
+    std::cout << "   -h|--help              Print this help message and exit" << std::endl;
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+}
+
+// the events of "table" selected by "mask", without a copy if all (or none) are selected
+std::shared_ptr<arrow::Table> filter(const std::shared_ptr<arrow::Table>& table, const selection::EventMask& mask) {
+    int64_t n_selected = mask.count();
+    if(n_selected == table->num_rows()) return table;
+    if(n_selected == 0) return table->Slice(0, 0);
+    arrow::Datum filtered;
+    PARQUET_ASSIGN_OR_THROW(filtered, arrow::compute::Filter(table, mask.to_array()));
+    return filtered.table();
+}
+
+// the one-line progress report of a metrics::Reporter
+std::string status_line(const metrics::Snapshot& s) {
+    uint64_t row_groups = s.value("skim_row_groups_read_total");
+    uint64_t target = s.value("skim_row_groups_target");
+    double rate = s.final ? s.average_rate("skim_events_read_total") : s.rate("skim_events_read_total");
+    std::stringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << "STATUS: " << metrics::duration(s.elapsed)
+        << " | " << row_groups << " / " << target << " row groups ("
+        << (target > 0 ? 100. * row_groups / target : 0.) << " %)"
+        << " | " << metrics::si(rate) << " evt/s"
+        << " | " << metrics::si(s.value("skim_events_written_total")) << " events written"
+        << " | queue " << static_cast<int64_t>(s.value("skim_queue_depth"))
+        << " | workers waiting " << (s.final ? s.average_rate("skim_producer_stall_seconds_total") : s.rate("skim_producer_stall_seconds_total")) * 100. << " %"
+        << ", writer waiting " << (s.final ? s.average_rate("skim_consumer_stall_seconds_total") : s.rate("skim_consumer_stall_seconds_total")) * 100. << " %";
+    return out.str();
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string input = "";
+    std::string partitions = "";
+    std::string outdir = "./dataset_skim";
+    std::string dataset_name = "skim";
+    std::string compression = "UNCOMPRESSED";
+    std::vector<std::string> cuts;
+    std::vector<std::string> keep;
+    int64_t row_group_size = -1;
+    int64_t file_size = 0;
+    std::vector<sorting::SortKey> sort_keys;
+    int64_t sort_window = 1;
+    size_t n_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    size_t queue_size = 0;
+    double status_interval = 10;
+    std::string metrics_file = "";
+
+    for(size_t i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "--name") == 0) { dataset_name = argv[++i]; }
+        else if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--outdir") == 0) { outdir = argv[++i]; }
+        else if (strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--cut") == 0) { cuts.push_back(argv[++i]); }
+        else if (strcmp(argv[i], "-k") == 0 || strcmp(argv[i], "--keep") == 0) { keep.push_back(argv[++i]); }
+        else if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--compression") == 0) { compression = argv[++i]; }
+        else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--row-group-size") == 0) { row_group_size = std::stoll(argv[++i]); }
+        else if (strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--file-size") == 0) { file_size = std::stoll(argv[++i]); }
+        else if (strcmp(argv[i], "--sort") == 0) { sort_keys = sorting::parse_sort_keys(argv[++i]); }
+        else if (strcmp(argv[i], "--sort-window") == 0) { sort_window = std::stoll(argv[++i]); }
+        else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--threads") == 0) { n_threads = std::stoul(argv[++i]); }
+        else if (strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--queue-size") == 0) { queue_size = std::stoul(argv[++i]); }
+        else if (strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--partitions") == 0) { partitions = argv[++i]; }
+        else if (strcmp(argv[i], "--memory-pool") == 0) { memory::select_backend(argv[++i]); }
+        else if (strcmp(argv[i], "--status-interval") == 0) { status_interval = std::stod(argv[++i]); }
+        else if (strcmp(argv[i], "--metrics-file") == 0) { metrics_file = argv[++i]; }
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { print_usage(argv); return 0; }
+        else if (argv[i][0] != '-' && input.empty()) { input = argv[i]; }
+        else {
+            std::cout << argv[0] << " Unknown command line argument provided: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if(input.empty()) {
+        print_usage(argv);
+        return 1;
+    }
+
+    selection::Selection cutflow;
+    for(const auto& cut : cuts) {
+        cutflow.add(selection::parse_cut(cut));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    DatasetReader dataset(input, true, partitioning::Filter(partitions));
+    const auto& tasks = dataset.row_groups();
+    if(tasks.empty()) {
+        std::cout << "WARNING: Input dataset has no RowGroups, nothing to do" << std::endl;
+        return 0;
+    }
+    // an empty list of leaves reads all columns
+    std::vector<int> leaves;
+    if(!keep.empty()) {
+        leaves = dataset.leaf_indices(keep);
+    }
+    if(row_group_size <= 0) {
+        row_group_size = std::max<int64_t>(1, dataset.num_rows() / tasks.size());
+    }
+    n_threads = std::max<size_t>(1, std::min(n_threads, tasks.size()));
+    if(queue_size == 0) {
+        queue_size = 2 * n_threads;
+    }
+
+    //
+    // stage 1 (n_threads workers): evaluate the selection on a RowGroup, reading
+    // only the columns of the cuts, then read the kept columns of the RowGroup
+    // (if any event passed) and filter them; at most queue_size RowGroups are
+    // held in memory between here and the writer
+    //
+    // stage 2 (this thread): re-group the filtered batches into output RowGroups
+    // of row_group_size events and encode/compress/write them, in input order
+    //
+    // (a sort of the input does not survive the re-grouping into output RowGroups)
+    DatasetWriter writer(outdir, dataset_name, row_group_size, file_size, compression,
+            sorting::with_sort_metadata(dataset.schema()->metadata(), {}, 0));
+    if(!sort_keys.empty()) {
+        writer.set_sort(sort_keys, sort_window);
+    }
+    pipeline::OrderedQueue<std::shared_ptr<arrow::Table>> queue(queue_size);
+    queue.set_metrics(&metrics::gauge("skim_queue_depth", "RowGroups read and waiting to be written"),
+            &metrics::counter("skim_producer_stall_seconds_total", "Time the reading threads waited for a slot in the queue", 1e-9),
+            &metrics::counter("skim_consumer_stall_seconds_total", "Time the writer waited for the next RowGroup", 1e-9));
+    metrics::gauge("skim_row_groups_target", "Input RowGroups to read").set(tasks.size());
+    auto& row_groups_read = metrics::counter("skim_row_groups_read_total", "Input RowGroups read and filtered");
+    auto& events_read = metrics::counter("skim_events_read_total", "Input events read");
+    auto& events_written = metrics::counter("skim_events_written_total", "Events passing the selection, written");
+    metrics::Reporter reporter(metrics_file, status_interval, status_line);
+    std::vector<selection::Selection> selections;
+    for(size_t i = 0; i < n_threads; i++) {
+        selections.push_back(cutflow.clone_empty());
+    }
+    std::atomic<size_t> next_task(0);
+    std::vector<std::exception_ptr> errors(n_threads + 1);
+
+    std::vector<std::thread> workers;
+    for(size_t ithread = 0; ithread < n_threads; ithread++) {
+        workers.emplace_back([&, ithread]() {
+            try {
+                RowGroupReader reader(dataset);
+                auto& sel = selections.at(ithread);
+                size_t itask;
+                while((itask = next_task.fetch_add(1)) < tasks.size()) {
+                    if(!queue.wait_for_slot(itask)) return;
+                    const auto& task = tasks.at(itask);
+                    std::shared_ptr<arrow::Table> out;
+                    if(sel.empty()) {
+                        out = reader.read(task, leaves);
+                    } else {
+                        auto mask = sel.apply(reader, dataset, task);
+                        if(!mask.none()) {
+                            out = filter(reader.read(task, leaves), mask);
+                        }
+                    }
+                    queue.push(itask, out);
+                    row_groups_read.add();
+                    events_read.add(task.num_rows);
+                }
+            } catch(...) {
+                errors.at(ithread) = std::current_exception();
+                queue.abort();
+            }
+        });
+    }
+
+    size_t n_popped = 0;
+    try {
+        for(; n_popped < tasks.size(); n_popped++) {
+            std::shared_ptr<arrow::Table> table;
+            if(!queue.pop(table)) break;
+            if(table) {
+                writer.write(table);
+                events_written.add(table->num_rows());
+            }
+        }
+        // (after an abort the output is truncated, and is not given a _metadata summary)
+        if(n_popped == tasks.size()) {
+            writer.close();
+        }
+    } catch(...) {
+        errors.at(n_threads) = std::current_exception();
+        queue.abort();
+    }
+    for(auto& w : workers) {
+        w.join();
+    }
+    reporter.stop();
+    for(auto& e : errors) {
+        if(!e) continue;
+        // the partial output is removed, so that it cannot be mistaken for a complete skim
+        std::error_code ec;
+        for(const auto& file : writer.files()) {
+            std::filesystem::remove(file, ec);
+        }
+        std::filesystem::remove(std::filesystem::path(outdir) / helpers::kSummaryMetadataFile, ec);
+        std::filesystem::remove(std::filesystem::path(outdir) / helpers::kCommonMetadataFile, ec);
+        std::cout << "WARNING: Skim failed, removed the " << writer.files().size() << " files written to " << outdir << std::endl;
+        std::rethrow_exception(e);
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(stop - start).count();
+
+    for(const auto& s : selections) {
+        cutflow.merge(s);
+    }
+    if(!cutflow.empty()) {
+        cutflow.print(std::cout);
+    }
+    if(writer.files().empty()) {
+        std::cout << "WARNING: No events passed the selection, no output written" << std::endl;
+    }
+    std::cout << "INFO: Skimmed " << dataset.num_rows() << " events (" << tasks.size() << " row groups, "
+        << dataset.files().size() << " files) to " << writer.num_rows() << " events (" << writer.num_row_groups()
+        << " row groups, " << writer.files().size() << " files) in " << elapsed << " seconds" << std::endl;
+    std::cout << "INFO: " << dataset.num_rows() / elapsed << " events/s (" << n_threads << " threads)" << std::endl;
+    std::cout << "INFO: Output dataset written to " << outdir << std::endl;
+
+    std::cout << memory::report();
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "sorting.h"
+#include "dataset_reader.h"
+
+// std/stl
+#include <sstream>
+#include <stdexcept>
+
+// arrow/parquet
+#include <arrow/compute/api.h>
+#include <parquet/exception.h>
+
+// json
+#include "json.hpp"
+using nlohmann::json;
+
+namespace sorting {
+
+std::string SortKey::to_string() const {
+    return (descending ? "-" : "") + path;
+}
+
+std::vector<SortKey> parse_sort_keys(const std::string& keys) {
+    std::vector<SortKey> out;
+    std::stringstream ss(keys);
+    std::string item;
+    while(std::getline(ss, item, ',')) {
+        if(item.empty()) continue;
+        SortKey key;
+        if(item.at(0) == '-' || item.at(0) == '+') {
+            key.descending = item.at(0) == '-';
+            item = item.substr(1);
+        }
+        if(item.empty()) {
+            throw std::runtime_error("ERROR: Invalid sort key list \"" + keys + "\"");
+        }
+        key.path = item;
+        out.push_back(key);
+    }
+    return out;
+}
+
+std::string to_string(const std::vector<SortKey>& keys) {
+    std::string out;
+    for(const auto& key : keys) {
+        out += (out.empty() ? "" : ",") + key.to_string();
+    }
+    return out;
+}
+
+void check_sort_keys(const std::shared_ptr<arrow::Schema>& schema, const std::vector<SortKey>& keys) {
+    for(const auto& key : keys) {
+        // follow the path through the structs, a list on the way means several values per event
+        std::stringstream ss(key.path);
+        std::string name;
+        std::shared_ptr<arrow::DataType> type;
+        bool found = true;
+        while(found && std::getline(ss, name, '.')) {
+            if(type && (type->id() == arrow::Type::LIST || type->id() == arrow::Type::FIXED_SIZE_LIST)) break;
+            std::shared_ptr<arrow::Field> field;
+            if(!type) {
+                field = schema->GetFieldByName(name);
+            } else if(type->id() == arrow::Type::STRUCT) {
+                field = std::static_pointer_cast<arrow::StructType>(type)->GetFieldByName(name);
+            }
+            found = field != nullptr;
+            if(found) type = field->type();
+        }
+        if(!found || !type || type->id() == arrow::Type::STRUCT) {
+            throw std::runtime_error("ERROR: Sort key \"" + key.path + "\" is not a leaf column");
+        }
+        if(type->id() == arrow::Type::LIST || type->id() == arrow::Type::FIXED_SIZE_LIST) {
+            throw std::runtime_error("ERROR: Sort key \"" + key.path + "\" does not have one value per event");
+        }
+    }
+}
+
+std::shared_ptr<arrow::Table> sort_table(const std::shared_ptr<arrow::Table>& table,
+        const std::vector<SortKey>& keys) {
+    if(keys.empty() || table->num_rows() < 2) return table;
+
+    // the key columns as a flat table, the nested paths are not valid field references
+    std::vector<std::shared_ptr<arrow::Field>> fields;
+    std::vector<std::shared_ptr<arrow::Array>> arrays;
+    std::vector<arrow::compute::SortKey> sort_keys;
+    for(size_t i = 0; i < keys.size(); i++) {
+        auto values = helpers::leaf_array(table, keys.at(i).path);
+        if(values->type_id() == arrow::Type::LIST) {
+            throw std::runtime_error("ERROR: Sort key \"" + keys.at(i).path + "\" does not have one value per event");
+        }
+        auto name = "key" + std::to_string(i);
+        fields.push_back(arrow::field(name, values->type()));
+        arrays.push_back(values);
+        sort_keys.emplace_back(name, keys.at(i).descending ? arrow::compute::SortOrder::Descending
+                : arrow::compute::SortOrder::Ascending);
+    }
+    auto key_table = arrow::Table::Make(arrow::schema(fields), arrays);
+
+    std::shared_ptr<arrow::Array> indices;
+    PARQUET_ASSIGN_OR_THROW(indices, arrow::compute::SortIndices(arrow::Datum(key_table),
+                arrow::compute::SortOptions(sort_keys)));
+    arrow::Datum sorted;
+    PARQUET_ASSIGN_OR_THROW(sorted, arrow::compute::Take(table, indices));
+    return sorted.table();
+}
+
+std::shared_ptr<const arrow::KeyValueMetadata> with_sort_metadata(
+        const std::shared_ptr<const arrow::KeyValueMetadata>& metadata,
+        const std::vector<SortKey>& keys, int64_t window_rows) {
+    std::shared_ptr<arrow::KeyValueMetadata> out = metadata ? metadata->Copy()
+        : std::make_shared<arrow::KeyValueMetadata>();
+    json j_metadata = json::object();
+    int index = out->FindKey("metadata");
+    if(index >= 0) {
+        j_metadata = json::parse(out->value(index));
+    }
+    if(keys.empty()) {
+        if(index < 0 || !j_metadata.contains("sort")) return metadata;
+        j_metadata.erase("sort");
+    } else {
+        std::vector<std::string> names;
+        for(const auto& key : keys) {
+            names.push_back(key.to_string());
+        }
+        j_metadata["sort"] = {{"keys", names}, {"window_rows", window_rows}};
+    }
+    PARQUET_THROW_NOT_OK(out->Set("metadata", j_metadata.dump()));
+    return out;
+}
+
+std::vector<SortKey> sort_order(const std::shared_ptr<arrow::Schema>& schema, int64_t* window_rows) {
+    std::vector<SortKey> keys;
+    if(window_rows) *window_rows = 0;
+    auto metadata = schema->metadata();
+    int index = metadata ? metadata->FindKey("metadata") : -1;
+    if(index < 0) return keys;
+    auto j_metadata = json::parse(metadata->value(index), nullptr, false);
+    if(j_metadata.is_discarded() || !j_metadata.contains("sort")) return keys;
+    const auto& j_sort = j_metadata.at("sort");
+    for(const auto& name : j_sort.value("keys", std::vector<std::string>{})) {
+        auto parsed = parse_sort_keys(name);
+        keys.insert(keys.end(), parsed.begin(), parsed.end());
+    }
+    if(window_rows) *window_rows = j_sort.value("window_rows", int64_t(0));
+    return keys;
+}
+
+}; // namespace sorting
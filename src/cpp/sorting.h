@@ -0,0 +1,60 @@
+#pragma once
+
+//std/stl
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+//arrow/parquet
+#include <arrow/api.h>
+
+//
+// Clustering of events by a sort key (e.g. "jets.n" then "met.met") before
+// they are written: rows with similar values end up next to each other, which
+// gives longer runs for the RLE/dictionary encodings and better compression of
+// the key columns (and those correlated with them), and, once the sort spans
+// several RowGroups, narrower RowGroup min/max statistics that let cuts on the
+// key skip whole RowGroups (see selection::Cut::may_pass).
+//
+// Events are sorted within windows of a fixed number of rows, so that the
+// memory needed is bounded: with a window of one RowGroup only the order
+// within each RowGroup changes, with a window of N RowGroups each run of N
+// RowGroups is sorted. The sort is recorded in the "metadata" JSON of the
+// schema, as "sort": {"keys": ["jets.n", "-met.met"], "window_rows": N}
+// (window_rows = 0 for a sort of the whole dataset), for readers to rely on.
+//
+namespace sorting {
+
+    struct SortKey {
+        std::string path;       // dotted path of a leaf column with one value per event
+        bool descending = false;
+
+        // "path", or "-path" if descending
+        std::string to_string() const;
+    };
+
+    // a comma-separated list of leaf paths, each prefixed by '-' for a descending
+    // order (e.g. "jets.n,-met.met")
+    std::vector<SortKey> parse_sort_keys(const std::string& keys);
+    std::string to_string(const std::vector<SortKey>& keys);
+
+    // throws if a key is not a leaf column of "schema" with one value per event
+    void check_sort_keys(const std::shared_ptr<arrow::Schema>& schema, const std::vector<SortKey>& keys);
+
+    // the rows of "table" (stably) sorted by "keys"
+    std::shared_ptr<arrow::Table> sort_table(const std::shared_ptr<arrow::Table>& table,
+            const std::vector<SortKey>& keys);
+
+    //
+    // "metadata" with the sort recorded in its "metadata" JSON, or with any sort
+    // removed from it if "keys" is empty (e.g. for a dataset derived from a
+    // sorted one in a way that does not keep the order)
+    //
+    std::shared_ptr<const arrow::KeyValueMetadata> with_sort_metadata(
+            const std::shared_ptr<const arrow::KeyValueMetadata>& metadata,
+            const std::vector<SortKey>& keys, int64_t window_rows);
+
+    // the sort recorded in the metadata of "schema", empty if the data are not sorted
+    std::vector<SortKey> sort_order(const std::shared_ptr<arrow::Schema>& schema, int64_t* window_rows = nullptr);
+}; // namespace sorting
@@ -0,0 +1,91 @@
+#include "summary_metadata.h"
+
+// std/stl
+#include <filesystem>
+#include <stdexcept>
+#include <map>
+
+// arrow/parquet
+#include <arrow/io/api.h>
+#include <parquet/file_reader.h>
+#include <parquet/file_writer.h>
+#include <parquet/exception.h>
+
+namespace helpers {
+
+std::shared_ptr<parquet::FileMetaData> summary_metadata(const std::vector<std::string>& relative_paths,
+        const std::vector<std::shared_ptr<parquet::FileMetaData>>& footers) {
+    if(footers.empty() || footers.size() != relative_paths.size()) {
+        throw std::runtime_error("ERROR: Invalid list of footers provided for the summary metadata");
+    }
+    for(size_t i = 0; i < footers.size(); i++) {
+        footers.at(i)->set_file_path(relative_paths.at(i));
+    }
+
+    // "AppendRowGroups" throws if the schemas differ
+    auto summary = footers.at(0)->Subset({});
+    for(const auto& footer : footers) {
+        summary->AppendRowGroups(*footer);
+    }
+    return summary;
+}
+
+void write_summary_metadata(const std::string& dataset_dir, const std::vector<std::string>& relative_paths,
+        const std::vector<std::shared_ptr<parquet::FileMetaData>>& footers) {
+    auto summary = summary_metadata(relative_paths, footers);
+    auto dir = std::filesystem::path(dataset_dir);
+
+    std::shared_ptr<arrow::io::FileOutputStream> outfile;
+    PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open((dir / kSummaryMetadataFile).string()));
+    parquet::WriteMetaDataFile(*summary, outfile.get());
+    PARQUET_THROW_NOT_OK(outfile->Close());
+
+    PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open((dir / kCommonMetadataFile).string()));
+    parquet::WriteMetaDataFile(*summary->Subset({}), outfile.get());
+    PARQUET_THROW_NOT_OK(outfile->Close());
+}
+
+void merge_summary_metadata(const std::string& dataset_dir, const std::vector<std::string>& subdirs) {
+    std::vector<std::string> relative_paths;
+    std::vector<std::shared_ptr<parquet::FileMetaData>> footers;
+    for(const auto& subdir : subdirs) {
+        auto dir = std::filesystem::path(dataset_dir) / subdir;
+        auto summary = read_summary_metadata(dir.string());
+        if(!summary) {
+            throw std::runtime_error("ERROR: No " + kSummaryMetadataFile + " in \"" + dir.string() + "\" to merge");
+        }
+        // the RowGroups of each file of the subdirectory, in order
+        std::vector<std::string> paths;
+        std::map<std::string, std::vector<int>> row_groups;
+        for(int irg = 0; irg < summary->num_row_groups(); irg++) {
+            auto row_group = summary->RowGroup(irg);
+            auto path = row_group->num_columns() ? row_group->ColumnChunk(0)->file_path() : "";
+            if(row_groups.count(path) == 0) paths.push_back(path);
+            row_groups[path].push_back(irg);
+        }
+        for(const auto& path : paths) {
+            relative_paths.push_back((std::filesystem::path(subdir) / path).generic_string());
+            footers.push_back(summary->Subset(row_groups.at(path)));
+        }
+    }
+    write_summary_metadata(dataset_dir, relative_paths, footers);
+}
+
+std::shared_ptr<parquet::FileMetaData> read_summary_metadata(const std::string& dataset_dir) {
+    auto path = std::filesystem::path(dataset_dir) / kSummaryMetadataFile;
+    if(!std::filesystem::is_regular_file(path)) {
+        return nullptr;
+    }
+    std::shared_ptr<arrow::io::ReadableFile> infile;
+    PARQUET_ASSIGN_OR_THROW(infile, arrow::io::ReadableFile::Open(path.string()));
+    return parquet::ReadMetaData(infile);
+}
+
+bool remove_summary_metadata(const std::string& dataset_dir) {
+    std::error_code ec;
+    bool removed = std::filesystem::remove(std::filesystem::path(dataset_dir) / kSummaryMetadataFile, ec);
+    removed |= std::filesystem::remove(std::filesystem::path(dataset_dir) / kCommonMetadataFile, ec);
+    return removed;
+}
+
+}; // namespace helpers
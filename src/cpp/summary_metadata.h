@@ -0,0 +1,51 @@
+#pragma once
+
+//std/stl
+#include <string>
+#include <vector>
+#include <memory>
+
+//arrow/parquet
+#include <parquet/metadata.h>
+
+//
+// Dataset-level summary files, as written by e.g. Spark, Dask and
+// pyarrow.parquet.write_metadata:
+//
+//      _metadata           the footers of all files of the dataset concatenated into one
+//                          (all RowGroups with their column chunk statistics, each column
+//                          chunk carrying the path of its file relative to the dataset directory)
+//      _common_metadata    the schema and KeyValueMetadata only, without RowGroups
+//
+// With these a reader plans (and prunes) the whole dataset from one small
+// file instead of opening the footer of every file.
+//
+namespace helpers {
+
+    const std::string kSummaryMetadataFile = "_metadata";
+    const std::string kCommonMetadataFile = "_common_metadata";
+
+    // merge the "footers" of the files at "relative_paths" (relative to the dataset
+    // directory, in dataset order) into one summary; the file paths of the footers'
+    // column chunks are set in place, and all footers must have the same schema
+    std::shared_ptr<parquet::FileMetaData> summary_metadata(const std::vector<std::string>& relative_paths,
+            const std::vector<std::shared_ptr<parquet::FileMetaData>>& footers);
+
+    // write the _metadata and _common_metadata files for the footers into "dataset_dir"
+    void write_summary_metadata(const std::string& dataset_dir, const std::vector<std::string>& relative_paths,
+            const std::vector<std::shared_ptr<parquet::FileMetaData>>& footers);
+
+    //
+    // write the _metadata and _common_metadata files of "dataset_dir" from the
+    // _metadata summaries of its subdirectories "subdirs" (e.g. the partitions
+    // of a Hive-style partitioned dataset), without opening any data file
+    //
+    void merge_summary_metadata(const std::string& dataset_dir, const std::vector<std::string>& subdirs);
+
+    // the _metadata of "dataset_dir", or nullptr if there is none
+    std::shared_ptr<parquet::FileMetaData> read_summary_metadata(const std::string& dataset_dir);
+
+    // remove the _metadata and _common_metadata files of "dataset_dir", e.g. those
+    // of an earlier run that no longer describe the files; true if there were any
+    bool remove_summary_metadata(const std::string& dataset_dir);
+}; // namespace helpers
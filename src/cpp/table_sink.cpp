@@ -0,0 +1,147 @@
+#include "table_sink.h"
+#include "memory_pool.h"
+
+// std/stl
+#include <iostream>
+#include <algorithm>
+#include <cctype> // tolower
+#include <stdexcept>
+
+// arrow/parquet
+#include <arrow/ipc/api.h>
+#include <arrow/util/compression.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/exception.h>
+
+namespace helpers {
+
+arrow::Compression::type compression_type(const std::string& name) {
+    if(name == "UNCOMPRESSED") return arrow::Compression::UNCOMPRESSED;
+    if(name == "SNAPPY") return arrow::Compression::SNAPPY;
+    if(name == "GZIP") return arrow::Compression::GZIP;
+    if(name == "ZSTD") return arrow::Compression::ZSTD;
+    if(name == "LZ4") return arrow::Compression::LZ4;
+    std::cout << "WARNING: Unhandled compression type \"" << name << "\" specified, falling back to Compression::UNCOMPRESSED" << std::endl;
+    return arrow::Compression::UNCOMPRESSED;
+}
+
+OutputFormat output_format(const std::string& name) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    if(lower == "parquet") return OutputFormat::PARQUET;
+    if(lower == "ipc" || lower == "arrow") return OutputFormat::IPC;
+    if(lower == "feather") return OutputFormat::FEATHER;
+    throw std::runtime_error("ERROR: Unknown output format \"" + name + "\" (options: parquet, ipc, feather)");
+}
+
+std::string format_name(OutputFormat format) {
+    switch(format) {
+        case OutputFormat::PARQUET: return "parquet";
+        case OutputFormat::IPC: return "ipc";
+        case OutputFormat::FEATHER: return "feather";
+    }
+    return "";
+}
+
+std::string format_extension(OutputFormat format) {
+    switch(format) {
+        case OutputFormat::PARQUET: return ".parquet";
+        case OutputFormat::IPC: return ".arrow";
+        case OutputFormat::FEATHER: return ".feather";
+    }
+    return "";
+}
+
+}; // namespace helpers
+
+namespace {
+
+class ParquetSink : public TableSink {
+    public:
+        ParquetSink(const std::shared_ptr<arrow::io::OutputStream>& outfile,
+                const std::shared_ptr<arrow::Schema>& schema, const std::string& compression) {
+            auto writer_props = parquet::WriterProperties::Builder()
+                .compression(helpers::compression_type(compression.empty() ? "UNCOMPRESSED" : compression))
+                ->data_pagesize(1024*1024*10)
+                ->memory_pool(memory::pool(memory::Phase::WRITE))
+                ->build();
+
+            // we must call "store_schema" in order for the KeyvalueMetadata to be persistifed in the output Parquet file
+            auto arrow_props = parquet::ArrowWriterProperties::Builder().store_schema()->build();
+            PARQUET_THROW_NOT_OK(parquet::arrow::FileWriter::Open(*schema,
+                        memory::pool(memory::Phase::WRITE),
+                        outfile,
+                        writer_props,
+                        arrow_props,
+                        &_writer
+            ));
+        }
+
+        void write(const arrow::Table& table, int64_t chunk_size) override {
+            PARQUET_THROW_NOT_OK(_writer->WriteTable(table, chunk_size));
+        }
+
+        void close() override {
+            PARQUET_THROW_NOT_OK(_writer->Close());
+        }
+
+        std::shared_ptr<parquet::FileMetaData> parquet_metadata() const override {
+            return _writer->metadata();
+        }
+
+    private :
+        std::unique_ptr<parquet::arrow::FileWriter> _writer;
+}; // class ParquetSink
+
+class IpcFileSink : public TableSink {
+    public:
+        IpcFileSink(const std::shared_ptr<arrow::io::OutputStream>& outfile,
+                const std::shared_ptr<arrow::Schema>& schema, arrow::Compression::type compression) {
+            auto options = arrow::ipc::IpcWriteOptions::Defaults();
+            options.memory_pool = memory::pool(memory::Phase::WRITE);
+            if(compression != arrow::Compression::UNCOMPRESSED) {
+                PARQUET_ASSIGN_OR_THROW(options.codec, arrow::util::Codec::Create(compression));
+            }
+            PARQUET_ASSIGN_OR_THROW(_writer, arrow::ipc::MakeFileWriter(outfile, schema, options));
+        }
+
+        void write(const arrow::Table& table, int64_t chunk_size) override {
+            PARQUET_THROW_NOT_OK(_writer->WriteTable(table, chunk_size));
+        }
+
+        void close() override {
+            PARQUET_THROW_NOT_OK(_writer->Close());
+        }
+
+    private :
+        std::shared_ptr<arrow::ipc::RecordBatchWriter> _writer;
+}; // class IpcFileSink
+
+// IPC buffers can only be LZ4 (frame) or ZSTD compressed
+arrow::Compression::type ipc_compression(const std::string& compression, OutputFormat format) {
+    if(compression.empty()) {
+        return format == OutputFormat::FEATHER ? arrow::Compression::LZ4_FRAME : arrow::Compression::UNCOMPRESSED;
+    }
+    auto type = helpers::compression_type(compression);
+    if(type == arrow::Compression::LZ4) return arrow::Compression::LZ4_FRAME;
+    if(type == arrow::Compression::ZSTD || type == arrow::Compression::UNCOMPRESSED) return type;
+    std::cout << "WARNING: Compression type \"" << compression << "\" is not supported by the "
+        << helpers::format_name(format) << " format, falling back to Compression::UNCOMPRESSED" << std::endl;
+    return arrow::Compression::UNCOMPRESSED;
+}
+
+} // namespace
+
+std::unique_ptr<TableSink> TableSink::make(OutputFormat format,
+        const std::shared_ptr<arrow::io::OutputStream>& outfile,
+        const std::shared_ptr<arrow::Schema>& schema,
+        const std::string& compression) {
+    switch(format) {
+        case OutputFormat::PARQUET:
+            return std::make_unique<ParquetSink>(outfile, schema, compression);
+        case OutputFormat::IPC:
+        case OutputFormat::FEATHER:
+            return std::make_unique<IpcFileSink>(outfile, schema, ipc_compression(compression, format));
+    }
+    throw std::runtime_error("ERROR: Unhandled output format");
+}
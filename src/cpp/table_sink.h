@@ -0,0 +1,67 @@
+#pragma once
+
+//std/stl
+#include <string>
+#include <memory>
+#include <stdint.h>
+
+//arrow/parquet
+#include <arrow/api.h>
+#include <arrow/io/api.h>
+#include <parquet/metadata.h>
+
+namespace helpers {
+
+    // "UNCOMPRESSED", "SNAPPY", "GZIP", "ZSTD" or "LZ4"
+    arrow::Compression::type compression_type(const std::string& name);
+}; // namespace helpers
+
+//
+// Output file formats that a stream of tables (e.g. the RowGroups produced by
+// DatasetGenerator) can be written to:
+//
+//      PARQUET     parquet::arrow::FileWriter, one RowGroup per "chunk_size" rows
+//      IPC         Arrow IPC file format ("random access" format, ".arrow"), one
+//                  record batch per "chunk_size" rows, optionally LZ4 or ZSTD
+//                  compressed buffers
+//      FEATHER     Feather v2, which is the Arrow IPC file format under its own
+//                  extension (".feather"); as with pyarrow.feather it is LZ4
+//                  compressed unless another compression is requested
+//
+// IPC and Feather only support LZ4 (frame) and ZSTD buffer compression, other
+// settings fall back to uncompressed with a warning.
+//
+enum class OutputFormat {
+    PARQUET,
+    IPC,
+    FEATHER
+};
+
+namespace helpers {
+
+    // "parquet", "ipc"/"arrow" or "feather" (case insensitive)
+    OutputFormat output_format(const std::string& name);
+    std::string format_name(OutputFormat format);
+    // file extension, including the leading "."
+    std::string format_extension(OutputFormat format);
+}; // namespace helpers
+
+class TableSink {
+    public:
+        virtual ~TableSink() = default;
+
+        // write "table" as RowGroups/record batches of at most "chunk_size" rows
+        virtual void write(const arrow::Table& table, int64_t chunk_size) = 0;
+        // finish the file (footer), without closing the underlying stream
+        virtual void close() = 0;
+
+        // the Parquet footer of the closed file, nullptr for other formats
+        virtual std::shared_ptr<parquet::FileMetaData> parquet_metadata() const { return nullptr; }
+
+        // "compression" is the generator setting, e.g. "SNAPPY", see helpers::compression_type;
+        // an empty setting selects the default of the format
+        static std::unique_ptr<TableSink> make(OutputFormat format,
+                const std::shared_ptr<arrow::io::OutputStream>& outfile,
+                const std::shared_ptr<arrow::Schema>& schema,
+                const std::string& compression = "");
+}; // class TableSink
@@ -0,0 +1,644 @@
+#include "uring_file.h"
+#include "metrics.h"
+
+// std/stl
+#include <algorithm> // min
+#include <cerrno>
+#include <cstdlib> // posix_memalign, free, abort
+#include <cstring> // memcpy, memset, strerror
+#include <iostream>
+#include <new> // bad_alloc
+
+// arrow/parquet
+#include <arrow/buffer.h>
+#include <arrow/io/file.h>
+
+// posix
+#include <fcntl.h> // open
+#include <sys/stat.h> // fstat
+#include <sys/uio.h> // iovec
+#include <unistd.h> // pread, pwrite, close
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define URING_SUPPORTED 1
+#include <linux/io_uring.h>
+#include <sys/mman.h> // mmap
+#include <sys/syscall.h> // __NR_io_uring_*
+#endif
+#endif
+
+namespace {
+
+// the io_uring metrics, shared by all files of the process (the write counters are those of output_stream.cpp)
+struct UringMetrics {
+    metrics::Counter& writes = metrics::counter("io_write_calls_total", "write(2) calls of the output streams");
+    metrics::Counter& bytes_written = metrics::counter("io_write_bytes_total", "Bytes written by the output streams");
+    metrics::Counter& reads = metrics::counter("io_uring_reads_total", "Reads queued to io_uring");
+    metrics::Counter& bytes_read = metrics::counter("io_uring_read_bytes_total", "Bytes read through io_uring");
+    metrics::Counter& enters = metrics::counter("io_uring_enter_calls_total", "io_uring_enter(2) calls");
+}; // struct UringMetrics
+
+UringMetrics& uring_metrics() {
+    static UringMetrics* m = new UringMetrics();
+    return *m;
+}
+
+arrow::Status io_error(const std::string& what, const std::string& path, int error = errno) {
+    return arrow::Status::IOError(what, " \"", path, "\": ", std::strerror(error));
+}
+
+int64_t round_up(int64_t value, int64_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+} // namespace
+
+namespace fileio {
+
+//
+// A submission/completion queue pair, set up and driven with the raw system
+// calls. Not thread safe, each file has its own.
+//
+class Ring {
+    public:
+        struct Completion {
+            uint64_t user_data;
+            int32_t result;
+        }; // struct Completion
+
+#ifdef URING_SUPPORTED
+        // nullptr if the kernel refuses, with the reason in "error"
+        static std::unique_ptr<Ring> create(unsigned entries, std::string& error) {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+            if(fd < 0) {
+                error = std::string("io_uring_setup: ") + std::strerror(errno);
+                return nullptr;
+            }
+            // (IORING_OP_READ/WRITE come with the same kernel release, 5.6)
+            if(!(params.features & IORING_FEAT_RW_CUR_POS)) {
+                close(fd);
+                error = "the kernel is too old (5.6 is needed)";
+                return nullptr;
+            }
+            std::unique_ptr<Ring> ring(new Ring(fd, params));
+            if(!ring->map()) {
+                error = std::string("mmap: ") + std::strerror(errno);
+                return nullptr;
+            }
+            return ring;
+        }
+
+        ~Ring() {
+            if(_sqes) munmap(_sqes, _params.sq_entries * sizeof(io_uring_sqe));
+            if(_cq_ptr && _cq_ptr != _sq_ptr) munmap(_cq_ptr, _cq_size);
+            if(_sq_ptr) munmap(_sq_ptr, _sq_size);
+            close(_fd);
+        }
+
+        unsigned entries() const { return _params.sq_entries; }
+
+        bool register_buffers(const std::vector<iovec>& buffers) {
+            return syscall(__NR_io_uring_register, _fd, IORING_REGISTER_BUFFERS,
+                    buffers.data(), static_cast<unsigned>(buffers.size())) == 0;
+        }
+
+        // queue a read or write, "buffer_index" >= 0 for a registered buffer
+        void queue(bool write, int fd, void* data, uint32_t nbytes, uint64_t offset,
+                uint64_t user_data, int buffer_index = -1) {
+            unsigned tail = *_sq_tail;
+            unsigned index = tail & *_sq_mask;
+            io_uring_sqe* sqe = &_sqes[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+            if(buffer_index >= 0) {
+                sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+                sqe->buf_index = static_cast<uint16_t>(buffer_index);
+            } else {
+                sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+            }
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<uint64_t>(data);
+            sqe->len = nbytes;
+            sqe->off = offset;
+            sqe->user_data = user_data;
+            _sq_array[index] = index;
+            // (the kernel may only see the entry once it is written)
+            __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+            _queued++;
+        }
+
+        // submit the queued entries, and wait for at least "min_complete" completions
+        int enter(unsigned min_complete) {
+            int result;
+            do {
+                result = static_cast<int>(syscall(__NR_io_uring_enter, _fd, _queued, min_complete,
+                            min_complete > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+            } while(result < 0 && errno == EINTR);
+            int error = result < 0 ? errno : 0;
+            if(result >= 0) {
+                _queued -= std::min<unsigned>(_queued, result);
+            }
+            uring_metrics().enters.add();
+            return -error;
+        }
+
+        bool pop(Completion& completion) {
+            unsigned head = *_cq_head;
+            if(head == __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE)) return false;
+            const io_uring_cqe& cqe = _cqes[head & *_cq_mask];
+            completion.user_data = cqe.user_data;
+            completion.result = cqe.res;
+            __atomic_store_n(_cq_head, head + 1, __ATOMIC_RELEASE);
+            return true;
+        }
+
+        // wait for the "in_flight" I/Os left and drop their completions, before
+        // their buffers are freed (closing the ring does not wait for them);
+        // false if the ring cannot be waited on
+        bool drain(unsigned in_flight) {
+            Completion completion;
+            while(in_flight > 0) {
+                while(in_flight > 0 && pop(completion)) {
+                    in_flight--;
+                }
+                if(in_flight == 0) break;
+                int result = enter(in_flight);
+                if(result < 0 && result != -EAGAIN && result != -EBUSY) return false;
+            }
+            return true;
+        }
+
+    private :
+        int _fd;
+        io_uring_params _params;
+        size_t _sq_size = 0;
+        size_t _cq_size = 0;
+        void* _sq_ptr = nullptr;
+        void* _cq_ptr = nullptr;
+        io_uring_sqe* _sqes = nullptr;
+        unsigned* _sq_tail = nullptr;
+        unsigned* _sq_mask = nullptr;
+        unsigned* _sq_array = nullptr;
+        unsigned* _cq_head = nullptr;
+        unsigned* _cq_tail = nullptr;
+        unsigned* _cq_mask = nullptr;
+        io_uring_cqe* _cqes = nullptr;
+        unsigned _queued = 0;
+
+        Ring(int fd, const io_uring_params& params) : _fd(fd), _params(params) {}
+
+        bool map() {
+            _sq_size = _params.sq_off.array + _params.sq_entries * sizeof(unsigned);
+            _cq_size = _params.cq_off.cqes + _params.cq_entries * sizeof(io_uring_cqe);
+            bool single = _params.features & IORING_FEAT_SINGLE_MMAP;
+            if(single) {
+                _sq_size = _cq_size = std::max(_sq_size, _cq_size);
+            }
+            _sq_ptr = mmap(nullptr, _sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+            if(_sq_ptr == MAP_FAILED) { _sq_ptr = nullptr; return false; }
+            if(single) {
+                _cq_ptr = _sq_ptr;
+            } else {
+                _cq_ptr = mmap(nullptr, _cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+                if(_cq_ptr == MAP_FAILED) { _cq_ptr = nullptr; return false; }
+            }
+            void* sqes = mmap(nullptr, _params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+            if(sqes == MAP_FAILED) return false;
+            _sqes = static_cast<io_uring_sqe*>(sqes);
+
+            auto sq = static_cast<uint8_t*>(_sq_ptr);
+            auto cq = static_cast<uint8_t*>(_cq_ptr);
+            _sq_tail = reinterpret_cast<unsigned*>(sq + _params.sq_off.tail);
+            _sq_mask = reinterpret_cast<unsigned*>(sq + _params.sq_off.ring_mask);
+            _sq_array = reinterpret_cast<unsigned*>(sq + _params.sq_off.array);
+            _cq_head = reinterpret_cast<unsigned*>(cq + _params.cq_off.head);
+            _cq_tail = reinterpret_cast<unsigned*>(cq + _params.cq_off.tail);
+            _cq_mask = reinterpret_cast<unsigned*>(cq + _params.cq_off.ring_mask);
+            _cqes = reinterpret_cast<io_uring_cqe*>(cq + _params.cq_off.cqes);
+            return true;
+        }
+#else
+        static std::unique_ptr<Ring> create(unsigned, std::string& error) {
+            error = "not built with io_uring (Linux only)";
+            return nullptr;
+        }
+        unsigned entries() const { return 0; }
+        bool register_buffers(const std::vector<iovec>&) { return false; }
+        void queue(bool, int, void*, uint32_t, uint64_t, uint64_t, int = -1) {}
+        int enter(unsigned) { return -ENOSYS; }
+        bool pop(Completion&) { return false; }
+        bool drain(unsigned in_flight) { return in_flight == 0; }
+#endif
+}; // class Ring
+
+bool uring_available(std::string* reason) {
+    static std::string error;
+    static bool available = Ring::create(2, error) != nullptr;
+    if(reason) *reason = error;
+    return available;
+}
+
+//
+// UringOutputStream
+//
+
+arrow::Result<std::shared_ptr<UringOutputStream>> UringOutputStream::Open(const std::string& path,
+        const UringOptions& options, SyncPolicy sync) {
+    if(options.queue_depth == 0 || options.block_size <= 0) {
+        return arrow::Status::Invalid("The queue depth and block size of \"", path, "\" must be positive");
+    }
+    std::string error;
+    auto ring = Ring::create(options.queue_depth, error);
+    if(!ring) {
+        return arrow::Status::IOError("Cannot use io_uring for \"", path, "\": ", error);
+    }
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0) {
+        return io_error("Cannot open", path);
+    }
+    return std::shared_ptr<UringOutputStream>(new UringOutputStream(fd, path, options, sync, std::move(ring)));
+}
+
+UringOutputStream::UringOutputStream(int fd, const std::string& path, const UringOptions& options,
+        SyncPolicy sync, std::unique_ptr<Ring> ring) :
+    _fd(fd),
+    _path(path),
+    _options(options),
+    _sync(sync),
+    _ring(std::move(ring)),
+    _memory(nullptr, std::free),
+    _fixed(false),
+    _current(-1),
+    _filled(0),
+    _position(0),
+    _offset(0),
+    _in_flight(0)
+{
+    // (never more buffers than ring entries, so that a free buffer always has an entry)
+    _options.queue_depth = std::min(_options.queue_depth, _ring->entries());
+    _options.block_size = round_up(_options.block_size, 4096);
+    void* memory = nullptr;
+    if(posix_memalign(&memory, 4096, _options.queue_depth * _options.block_size) != 0) {
+        throw std::bad_alloc();
+    }
+    _memory.reset(static_cast<uint8_t*>(memory));
+    std::vector<iovec> iovecs;
+    for(unsigned i = 0; i < _options.queue_depth; i++) {
+        _buffers.push_back(_memory.get() + i * _options.block_size);
+        _free.push_back(i);
+        iovecs.push_back({_buffers.back(), static_cast<size_t>(_options.block_size)});
+    }
+    _lengths.resize(_options.queue_depth);
+    _offsets.resize(_options.queue_depth);
+    // (fails with ENOMEM when the buffers exceed RLIMIT_MEMLOCK, plain writes are used then)
+    _fixed = _options.register_buffers && _ring->register_buffers(iovecs);
+}
+
+UringOutputStream::~UringOutputStream() {
+    auto status = Close();
+    if(!status.ok()) {
+        std::cout << "WARNING: " << status.ToString() << std::endl;
+    }
+}
+
+arrow::Status UringOutputStream::Write(const void* data, int64_t nbytes) {
+    if(closed()) {
+        return arrow::Status::Invalid("Write to the closed file \"", _path, "\"");
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    _position += nbytes;
+    while(nbytes > 0) {
+        if(_current < 0) {
+            // wait for a write to complete if all buffers are in flight
+            if(_free.empty()) {
+                ARROW_RETURN_NOT_OK(complete(1));
+            }
+            _current = static_cast<int>(_free.back());
+            _free.pop_back();
+            _filled = 0;
+        }
+        int64_t n = std::min(nbytes, _options.block_size - _filled);
+        std::memcpy(_buffers[_current] + _filled, bytes, n);
+        _filled += n;
+        bytes += n;
+        nbytes -= n;
+        if(_filled == _options.block_size) {
+            ARROW_RETURN_NOT_OK(submit_current());
+        }
+    }
+    return arrow::Status::OK();
+}
+
+arrow::Status UringOutputStream::submit_current() {
+    if(_current < 0) return arrow::Status::OK();
+    if(_filled == 0) {
+        _free.push_back(_current);
+        _current = -1;
+        return arrow::Status::OK();
+    }
+    unsigned index = static_cast<unsigned>(_current);
+    _lengths[index] = _filled;
+    _offsets[index] = _offset;
+    _ring->queue(true, _fd, _buffers[index], static_cast<uint32_t>(_filled), _offset, index, _fixed ? index : -1);
+    _offset += _filled;
+    _in_flight++;
+    _current = -1;
+    _filled = 0;
+    _stats.writes++;
+    _stats.enters++;
+    uring_metrics().writes.add();
+    int result = _ring->enter(0);
+    if(result < 0) {
+        return fail(io_error("Cannot submit a write to", _path, -result));
+    }
+    return arrow::Status::OK();
+}
+
+arrow::Status UringOutputStream::fail(const arrow::Status& status) {
+    release();
+    _ring.reset();
+    ::close(_fd);
+    _fd = -1;
+    _memory.reset();
+    return status;
+}
+
+void UringOutputStream::release() {
+    // the buffers are leaked rather than freed under writes still in flight
+    if(_in_flight > 0 && !_ring->drain(_in_flight)) {
+        std::cout << "WARNING: Cannot wait for the writes in flight to \"" << _path
+            << "\", leaking their buffers" << std::endl;
+        _memory.release();
+    }
+    _in_flight = 0;
+}
+
+arrow::Status UringOutputStream::complete(unsigned min_complete) {
+    arrow::Status status;
+    Ring::Completion completion;
+    if(min_complete > 0) {
+        _stats.enters++;
+        int result = _ring->enter(min_complete);
+        if(result < 0) {
+            return fail(io_error("Cannot wait for the writes to", _path, -result));
+        }
+    }
+    while(_ring->pop(completion)) {
+        unsigned index = static_cast<unsigned>(completion.user_data);
+        _in_flight--;
+        _free.push_back(index);
+        if(completion.result < 0) {
+            if(status.ok()) status = io_error("Cannot write to", _path, -completion.result);
+            continue;
+        }
+        // the rest of a short write (rare for regular files) is written here
+        int64_t done = completion.result;
+        while(done < _lengths[index]) {
+            ssize_t n = ::pwrite(_fd, _buffers[index] + done, _lengths[index] - done, _offsets[index] + done);
+            if(n < 0 && errno == EINTR) continue;
+            if(n <= 0) {
+                if(status.ok()) status = io_error("Cannot write to", _path);
+                break;
+            }
+            done += n;
+        }
+        _stats.bytes += done;
+        uring_metrics().bytes_written.add(done);
+    }
+    return status;
+}
+
+arrow::Status UringOutputStream::Flush() {
+    if(closed()) return arrow::Status::OK();
+    ARROW_RETURN_NOT_OK(submit_current());
+    while(_in_flight > 0) {
+        ARROW_RETURN_NOT_OK(complete(_in_flight));
+    }
+    return arrow::Status::OK();
+}
+
+arrow::Status UringOutputStream::Close() {
+    if(closed()) return arrow::Status::OK();
+    auto status = Flush();
+    if(closed()) return status;
+    // (the writes left after an error of Flush())
+    release();
+    if(status.ok() && _sync != SyncPolicy::NONE) {
+        if(data_sync(_fd) != 0) {
+            status = io_error("Cannot sync", _path);
+        }
+        _stats.syncs++;
+    }
+    if(::close(_fd) != 0 && status.ok()) {
+        status = io_error("Cannot close", _path);
+    }
+    _fd = -1;
+    _ring.reset();
+    _memory.reset();
+    return status;
+}
+
+//
+// UringReadableFile
+//
+
+arrow::Result<std::shared_ptr<UringReadableFile>> UringReadableFile::Open(const std::string& path,
+        const UringOptions& options, arrow::MemoryPool* pool) {
+    if(options.queue_depth == 0 || options.block_size <= 0) {
+        return arrow::Status::Invalid("The queue depth and block size of \"", path, "\" must be positive");
+    }
+    std::string error;
+    auto ring = Ring::create(options.queue_depth, error);
+    if(!ring) {
+        return arrow::Status::IOError("Cannot use io_uring for \"", path, "\": ", error);
+    }
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return io_error("Cannot open", path);
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        auto status = io_error("Cannot stat", path);
+        close(fd);
+        return status;
+    }
+    return std::shared_ptr<UringReadableFile>(new UringReadableFile(fd, path, st.st_size, options, pool, std::move(ring)));
+}
+
+UringReadableFile::UringReadableFile(int fd, const std::string& path, int64_t size, const UringOptions& options,
+        arrow::MemoryPool* pool, std::unique_ptr<Ring> ring) :
+    _fd(fd),
+    _path(path),
+    _size(size),
+    _options(options),
+    _pool(pool),
+    _ring(std::move(ring)),
+    _position(0)
+{
+    _options.queue_depth = std::min(_options.queue_depth, _ring->entries());
+}
+
+UringReadableFile::~UringReadableFile() {
+    auto status = Close();
+    if(!status.ok()) {
+        std::cout << "WARNING: " << status.ToString() << std::endl;
+    }
+}
+
+arrow::Status UringReadableFile::Close() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(_fd < 0) return arrow::Status::OK();
+    int result = ::close(_fd);
+    _fd = -1;
+    _ring.reset();
+    return result == 0 ? arrow::Status::OK() : io_error("Cannot close", _path);
+}
+
+arrow::Result<int64_t> UringReadableFile::Tell() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _position;
+}
+
+arrow::Status UringReadableFile::Seek(int64_t position) {
+    if(position < 0) {
+        return arrow::Status::Invalid("Negative position in \"", _path, "\"");
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    _position = position;
+    return arrow::Status::OK();
+}
+
+UringReadableFile::Stats UringReadableFile::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+arrow::Result<int64_t> UringReadableFile::read_at(int64_t position, int64_t nbytes, uint8_t* out) {
+    if(_fd < 0) {
+        return arrow::Status::Invalid("Read from the closed file \"", _path, "\"");
+    }
+    if(position < 0 || nbytes < 0) {
+        return arrow::Status::Invalid("Negative read position or size in \"", _path, "\"");
+    }
+    // (the files read are not expected to change, reads stop at the size they were opened with)
+    nbytes = std::max<int64_t>(0, std::min(nbytes, _size - position));
+
+    // blocks of up to block_size bytes, at most queue_depth of them in flight;
+    // the user data of a read is its offset in "out"
+    arrow::Status status;
+    int64_t issued = 0;
+    int64_t done = 0;
+    unsigned in_flight = 0;
+    Ring::Completion completion;
+    auto& m = uring_metrics();
+    while(done < nbytes) {
+        while(status.ok() && issued < nbytes && in_flight < _options.queue_depth) {
+            int64_t n = std::min(_options.block_size, nbytes - issued);
+            _ring->queue(false, _fd, out + issued, static_cast<uint32_t>(n), position + issued, issued);
+            issued += n;
+            in_flight++;
+            _stats.reads++;
+            m.reads.add();
+        }
+        if(in_flight == 0) break;
+        _stats.enters++;
+        int result = _ring->enter(1);
+        if(result < 0) {
+            // the reads in flight write to "out", which the caller frees once
+            // this returns: they have to complete first
+            if(!_ring->drain(in_flight)) {
+                std::cout << "ERROR: Cannot wait for the reads in flight from \"" << _path << "\"" << std::endl;
+                std::abort();
+            }
+            _ring.reset();
+            ::close(_fd);
+            _fd = -1;
+            return io_error("Cannot read from", _path, -result);
+        }
+        while(_ring->pop(completion)) {
+            in_flight--;
+            int64_t offset = static_cast<int64_t>(completion.user_data);
+            int64_t expected = std::min(_options.block_size, nbytes - offset);
+            if(completion.result < 0) {
+                if(status.ok()) status = io_error("Cannot read from", _path, -completion.result);
+                continue;
+            }
+            // the rest of a short read is read here
+            int64_t got = completion.result;
+            while(got < expected) {
+                ssize_t n = ::pread(_fd, out + offset + got, expected - got, position + offset + got);
+                if(n < 0 && errno == EINTR) continue;
+                if(n < 0) {
+                    if(status.ok()) status = io_error("Cannot read from", _path);
+                    break;
+                }
+                if(n == 0) {
+                    if(status.ok()) status = arrow::Status::IOError("Unexpected end of \"", _path, "\"");
+                    break;
+                }
+                got += n;
+            }
+            done += got;
+            _stats.bytes += got;
+            m.bytes_read.add(got);
+        }
+        if(!status.ok() && in_flight == 0) break;
+    }
+    ARROW_RETURN_NOT_OK(status);
+    return nbytes;
+}
+
+arrow::Result<int64_t> UringReadableFile::ReadAt(int64_t position, int64_t nbytes, void* out) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return read_at(position, nbytes, static_cast<uint8_t*>(out));
+}
+
+arrow::Result<std::shared_ptr<arrow::Buffer>> UringReadableFile::ReadAt(int64_t position, int64_t nbytes) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    nbytes = std::max<int64_t>(0, std::min(nbytes, _size - position));
+    ARROW_ASSIGN_OR_RAISE(auto buffer, arrow::AllocateResizableBuffer(nbytes, _pool));
+    ARROW_ASSIGN_OR_RAISE(int64_t n, read_at(position, nbytes, buffer->mutable_data()));
+    if(n < nbytes) {
+        ARROW_RETURN_NOT_OK(buffer->Resize(n));
+    }
+    return std::shared_ptr<arrow::Buffer>(std::move(buffer));
+}
+
+arrow::Result<int64_t> UringReadableFile::Read(int64_t nbytes, void* out) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ARROW_ASSIGN_OR_RAISE(int64_t n, read_at(_position, nbytes, static_cast<uint8_t*>(out)));
+    _position += n;
+    return n;
+}
+
+arrow::Result<std::shared_ptr<arrow::Buffer>> UringReadableFile::Read(int64_t nbytes) {
+    int64_t position;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        position = _position;
+    }
+    ARROW_ASSIGN_OR_RAISE(auto buffer, ReadAt(position, nbytes));
+    std::lock_guard<std::mutex> lock(_mutex);
+    _position = position + buffer->size();
+    return buffer;
+}
+
+arrow::Result<std::shared_ptr<arrow::io::RandomAccessFile>> open_readable_file(const std::string& path,
+        arrow::MemoryPool* pool, const UringOptions* uring) {
+    if(uring) {
+        std::string reason;
+        if(uring_available(&reason)) {
+            return UringReadableFile::Open(path, *uring, pool);
+        }
+        static std::once_flag warned;
+        std::call_once(warned, [&]() {
+            std::cout << "WARNING: io_uring is not available (" << reason << "), reading with the standard file streams" << std::endl;
+        });
+    }
+    return arrow::io::ReadableFile::Open(path, pool);
+}
+
+}; // namespace fileio
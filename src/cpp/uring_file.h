@@ -0,0 +1,154 @@
+#pragma once
+
+#include "output_stream.h"
+
+//std/stl
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+//arrow/parquet
+#include <arrow/io/interfaces.h>
+#include <arrow/memory_pool.h>
+#include <arrow/result.h>
+#include <arrow/status.h>
+
+//
+// Files read and written through io_uring (Linux >= 5.6), with several I/Os in
+// flight instead of the single blocking write(2)/pread(2) of Arrow's streams:
+//
+//      UringOutputStream   an arrow::io::OutputStream that gathers the writes
+//                          in "queue_depth" buffers of "block_size" bytes and
+//                          hands each full buffer to the ring, continuing in
+//                          the next one while it is being written; the buffers
+//                          are registered with the ring (fixed buffers, no
+//                          page pinning per write) if the memlock limit allows
+//      UringReadableFile   an arrow::io::RandomAccessFile whose ReadAt() splits
+//                          a read (e.g. a column chunk of parquet::arrow::
+//                          FileReader) into reads of "block_size" bytes, up to
+//                          "queue_depth" of them in flight, straight into the
+//                          destination buffer
+//
+// The ring is driven by the io_uring system calls directly (with the kernel's
+// linux/io_uring.h), so there is no library to depend on. When the build has
+// no io_uring, or the kernel refuses it (too old, io_uring_disabled, seccomp),
+// open_output_stream() (OutputOptions::uring) and open_readable_file() fall
+// back to the standard streams, with a warning.
+//
+namespace fileio {
+
+    struct UringOptions {
+        unsigned queue_depth = 8;           // I/Os in flight
+        int64_t block_size = 1024 * 1024;   // bytes per I/O, a multiple of 4 kB
+        bool register_buffers = true;       // fixed buffers of UringOutputStream
+    }; // struct UringOptions
+
+    // true if io_uring can be used in this process, "reason" says why not
+    bool uring_available(std::string* reason = nullptr);
+
+    class Ring;
+
+    class UringOutputStream : public arrow::io::OutputStream {
+        public:
+            // create (or truncate) the file "path"; fails if io_uring is not available
+            static arrow::Result<std::shared_ptr<UringOutputStream>> Open(const std::string& path,
+                    const UringOptions& options = UringOptions(), SyncPolicy sync = SyncPolicy::NONE);
+            ~UringOutputStream() override;
+
+            // hands the partial buffer to the ring, and waits for all writes
+            arrow::Status Flush() override;
+            // (the "close" and "range" sync policies both fdatasync(2) on close)
+            arrow::Status Close() override;
+            bool closed() const override { return _fd < 0; }
+            arrow::Result<int64_t> Tell() const override { return _position; }
+            arrow::Status Write(const void* data, int64_t nbytes) override;
+            using arrow::io::OutputStream::Write;
+
+            bool registered_buffers() const { return _fixed; }
+            // "writes" counts the writes queued, "enters" the io_uring_enter(2) calls
+            const OutputStats& stats() const { return _stats; }
+
+        private :
+            UringOutputStream(int fd, const std::string& path, const UringOptions& options,
+                    SyncPolicy sync, std::unique_ptr<Ring> ring);
+
+            int _fd;
+            std::string _path;
+            UringOptions _options;
+            SyncPolicy _sync;
+            std::unique_ptr<Ring> _ring;
+            std::unique_ptr<uint8_t, void(*)(void*)> _memory;
+            std::vector<uint8_t*> _buffers;
+            std::vector<int64_t> _lengths;      // bytes being written from each buffer
+            std::vector<int64_t> _offsets;      // and where to
+            std::vector<unsigned> _free;
+            bool _fixed;
+            int _current;                       // buffer being filled, -1 if none
+            int64_t _filled;
+            int64_t _position;                  // bytes written to the stream
+            int64_t _offset;                    // bytes handed to the ring
+            unsigned _in_flight;
+            OutputStats _stats;
+
+            arrow::Status submit_current();
+            arrow::Status complete(unsigned min_complete);
+            // wait for the writes in flight, before the buffers are freed
+            void release();
+            // close the file after an error of the ring
+            arrow::Status fail(const arrow::Status& status);
+    }; // class UringOutputStream
+
+    class UringReadableFile : public arrow::io::RandomAccessFile {
+        public:
+            // open "path" for reading, with buffers from "pool"; fails if io_uring is not available
+            static arrow::Result<std::shared_ptr<UringReadableFile>> Open(const std::string& path,
+                    const UringOptions& options = UringOptions(),
+                    arrow::MemoryPool* pool = arrow::default_memory_pool());
+            ~UringReadableFile() override;
+
+            arrow::Status Close() override;
+            bool closed() const override { return _fd < 0; }
+            arrow::Result<int64_t> Tell() const override;
+            arrow::Status Seek(int64_t position) override;
+            arrow::Result<int64_t> GetSize() override { return _size; }
+
+            arrow::Result<int64_t> Read(int64_t nbytes, void* out) override;
+            arrow::Result<std::shared_ptr<arrow::Buffer>> Read(int64_t nbytes) override;
+            // thread safe, reads of several threads are queued one after the other
+            arrow::Result<int64_t> ReadAt(int64_t position, int64_t nbytes, void* out) override;
+            arrow::Result<std::shared_ptr<arrow::Buffer>> ReadAt(int64_t position, int64_t nbytes) override;
+            using arrow::io::RandomAccessFile::ReadAt;
+
+            // "reads" and "bytes" of the reads made, "enters" the io_uring_enter(2) calls
+            struct Stats {
+                int64_t reads = 0;
+                int64_t bytes = 0;
+                int64_t enters = 0;
+            }; // struct Stats
+            Stats stats() const;
+
+        private :
+            UringReadableFile(int fd, const std::string& path, int64_t size, const UringOptions& options,
+                    arrow::MemoryPool* pool, std::unique_ptr<Ring> ring);
+
+            int _fd;
+            std::string _path;
+            int64_t _size;
+            UringOptions _options;
+            arrow::MemoryPool* _pool;
+            std::unique_ptr<Ring> _ring;
+            int64_t _position;
+            Stats _stats;
+            mutable std::mutex _mutex;
+
+            arrow::Result<int64_t> read_at(int64_t position, int64_t nbytes, uint8_t* out);
+    }; // class UringReadableFile
+
+    // a UringReadableFile of "path" if "uring" is set and io_uring is
+    // available, Arrow's ReadableFile otherwise
+    arrow::Result<std::shared_ptr<arrow::io::RandomAccessFile>> open_readable_file(const std::string& path,
+            arrow::MemoryPool* pool, const UringOptions* uring = nullptr);
+
+}; // namespace fileio
@@ -0,0 +1,62 @@
+#include "dataset_reader.h"
+#include "summary_metadata.h"
+
+//std/stl
+#include <iostream>
+#include <cstring> // strcmp
+#include <chrono>
+#include <filesystem>
+
+void print_usage(char* argv[]) {
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+    std::cout << " Write the _metadata and _common_metadata summary files of a dataset," << std::endl;
+    std::cout << " aggregating the footers (RowGroups and statistics) of all of its files" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Usage: " << argv[0] << " [OPTIONS] <input dataset directory>" << std::endl;
+    std::cout << std::endl;
+    std::cout << " Options:" << std::endl;
+    std::cout << "   -h|--help              Print this help message and exit" << std::endl;
+    std::cout << "---------------------------------------------------------------------------" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string input = "";
+
+    for(size_t i = 1; i < argc; i++) {
+        if      (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { print_usage(argv); return 0; }
+        else if (argv[i][0] != '-' && input.empty()) { input = argv[i]; }
+        else {
+            std::cout << argv[0] << " Unknown command line argument provided: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if(input.empty()) {
+        print_usage(argv);
+        return 1;
+    }
+    if(!std::filesystem::is_directory(input)) {
+        std::cout << argv[0] << " ERROR: Input \"" << input << "\" is not a directory" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // read the footers of all of the files (and not an existing, possibly stale, summary)
+    DatasetReader dataset(input, false);
+    std::vector<std::string> relative_paths;
+    std::vector<std::shared_ptr<parquet::FileMetaData>> footers;
+    for(size_t i = 0; i < dataset.files().size(); i++) {
+        relative_paths.push_back(dataset.relative_path(i));
+        footers.push_back(dataset.footer(i));
+    }
+    helpers::write_summary_metadata(input, relative_paths, footers);
+
+    auto stop = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(stop - start).count();
+    std::cout << "INFO: Summary of " << dataset.files().size() << " files (" << dataset.row_groups().size()
+        << " row groups, " << dataset.num_rows() << " events) written to "
+        << (std::filesystem::path(input) / helpers::kSummaryMetadataFile).string() << " in " << elapsed << " seconds" << std::endl;
+
+    return 0;
+}
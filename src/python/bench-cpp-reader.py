@@ -0,0 +1,92 @@
+#!/usr/bin/env python
+
+"""
+Compare reading a dataset into Python with `ak.from_parquet` (as in
+test-parquet.py) to reading it with the C++ DatasetReader and importing its
+RecordBatches through the Arrow C stream interface (see cpp_dataset.py).
+Without awkward, only the pyarrow-level reads are timed.
+"""
+
+from argparse import ArgumentParser
+from pathlib import Path
+import glob
+import timeit
+
+import numpy as np
+import pyarrow as pa
+import pyarrow.parquet as pq
+
+import cpp_dataset
+
+try :
+    import awkward as ak
+except ImportError :
+    ak = None
+
+def dataset_files(path) :
+    if Path(path).is_dir() :
+        return sorted(glob.glob(f"{path}/**/*.parquet", recursive = True))
+    return [path]
+
+def top_level(columns) :
+    # (ak.from_parquet and pyarrow select whole top-level columns, and all
+    # readers are given these so that they read the same data)
+    if columns is None :
+        return None
+    return list(dict.fromkeys([c.split(".")[0] for c in columns]))
+
+def read_ak_from_parquet(path, columns, threads) :
+    n_total = 0
+    for file in dataset_files(path) :
+        for irg in range(pq.ParquetFile(file).num_row_groups) :
+            n_total += len(ak.from_parquet(file, columns = top_level(columns), row_groups = [irg], use_threads = threads))
+    return n_total
+
+def read_cpp_ak(path, columns, threads) :
+    n_total = 0
+    for events in cpp_dataset.events(path, columns = top_level(columns), threads = threads) :
+        n_total += len(events)
+    return n_total
+
+def read_pyarrow(path, columns, threads) :
+    n_total = 0
+    for file in dataset_files(path) :
+        pf = pq.ParquetFile(file)
+        for irg in range(pf.num_row_groups) :
+            n_total += pf.read_row_group(irg, columns = top_level(columns), use_threads = threads).num_rows
+    return n_total
+
+def read_cpp(path, columns, threads) :
+    n_total = 0
+    for batch in cpp_dataset.record_batch_reader(path, columns = top_level(columns), threads = threads) :
+        n_total += batch.num_rows
+    return n_total
+
+def main() :
+
+    parser = ArgumentParser(description = "Compare ak.from_parquet to C++ reads exported through the Arrow C stream interface")
+    parser.add_argument("input", help = "Input dataset (file or directory)")
+    parser.add_argument("--columns", nargs = "+", default = None, help = "Dotted column paths, whose whole top-level columns are read [default: all]")
+    parser.add_argument("-t", "--threads", type = int, default = 1, help = "Number of C++ reader threads (pyarrow/awkward use threads if > 1)")
+    parser.add_argument("--repeats", type = int, default = 5)
+    args = parser.parse_args()
+
+    if not Path(args.input).exists() :
+        raise Exception(f"ERROR Input dataset {args.input} not found")
+
+    readers = [("pyarrow read_row_group", lambda : read_pyarrow(args.input, args.columns, args.threads > 1)),
+               ("C++ stream", lambda : read_cpp(args.input, args.columns, args.threads))]
+    if ak is not None :
+        readers = [("ak.from_parquet", lambda : read_ak_from_parquet(args.input, args.columns, args.threads > 1)),
+                   ("C++ stream + ak.from_arrow", lambda : read_cpp_ak(args.input, args.columns, args.threads))] + readers
+    else :
+        print("WARNING awkward not found, timing the pyarrow-level reads only")
+
+    for name, read in readers :
+        n_events = read()
+        repeats = np.array(timeit.repeat(read, number = 1, repeat = args.repeats))
+        print(f"{name:<28}: {n_events} events, average of {args.repeats} trials: {np.mean(repeats):.5f} +/- {np.std(repeats):.5f} seconds"
+              f" ({n_events / np.mean(repeats):.3g} events/s)")
+
+if __name__ == "__main__" :
+    main()
@@ -0,0 +1,390 @@
+#!/usr/bin/env python
+
+"""
+Keep the results of benchmark runs (gen-dataset, test-parquet.py, the
+micro-benchmarks, ...) in a local results directory, keyed by the git revision,
+the machine and the settings of the run, and compare two runs of the same
+benchmark for regressions.
+
+    # time 5 runs of a command (wall time, plus any numbers parsed from its output)
+    bench-history.py run gen-10M -n 5 --metric "peak_rss=peak RSS ([0-9.]+) MB" -- ./gen-dataset -n 10000000 --discard
+    # store the repeats written by test-parquet.py --timings-out, or Google Benchmark JSON output
+    bench-history.py record read-1M timings.json
+    # list the stored runs, compare the latest one to the latest one of another revision
+    bench-history.py list gen-10M
+    bench-history.py compare gen-10M --threshold 5
+
+`compare` tests every metric for a change between the two runs (a two-sided
+Mann-Whitney U test over the repeats, or a bootstrap confidence interval of the
+ratio of the medians) and exits with status 1 if any of them got significantly
+worse by more than the threshold. Only the Python standard library is needed.
+"""
+
+from argparse import ArgumentParser
+from datetime import datetime, timezone
+from pathlib import Path
+import hashlib
+import itertools
+import json
+import math
+import os
+import platform
+import random
+import re
+import socket
+import statistics
+import subprocess
+import sys
+import time
+
+DEFAULT_RESULTS_DIR = "bench-results"
+
+##
+## keys of the runs
+##
+
+def git_revision(repo) :
+    try :
+        rev = subprocess.run(["git", "-C", repo, "rev-parse", "HEAD"], capture_output = True, text = True, check = True).stdout.strip()
+        status = subprocess.run(["git", "-C", repo, "status", "--porcelain", "--untracked-files=no"],
+                    capture_output = True, text = True, check = True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError) :
+        return {"rev" : "unknown", "dirty" : False}
+    return {"rev" : rev, "dirty" : len(status) > 0}
+
+def cpu_model() :
+    try :
+        with open("/proc/cpuinfo") as f :
+            for line in f :
+                if line.startswith("model name") :
+                    return line.split(":", 1)[1].strip()
+    except OSError :
+        pass
+    return platform.processor() or platform.machine()
+
+def machine_info() :
+    machine = {
+        "hostname" : socket.gethostname(),
+        "system" : f"{platform.system()} {platform.release()}",
+        "cpu" : cpu_model(),
+        "n_cpus" : os.cpu_count(),
+    }
+    # (the id ignores the kernel release, so that runs before and after an update still compare)
+    machine["id"] = key_hash({k : machine[k] for k in ["hostname", "cpu", "n_cpus"]})
+    return machine
+
+def key_hash(obj) :
+    return hashlib.sha1(json.dumps(obj, sort_keys = True).encode()).hexdigest()[:10]
+
+def parse_settings(settings) :
+    out = {}
+    for setting in settings :
+        if "=" not in setting :
+            raise Exception(f"ERROR Invalid setting \"{setting}\" (expected key=value)")
+        key, value = setting.split("=", 1)
+        out[key] = value
+    return out
+
+##
+## storage: <results dir>/<benchmark>/<timestamp>_<rev>_<machine id>.json
+##
+
+def save_run(results_dir, name, metrics, settings, repo) :
+    if not metrics :
+        raise Exception("ERROR No metrics to store")
+    now = datetime.now(timezone.utc)
+    run = {
+        "name" : name,
+        "timestamp" : now.isoformat(timespec = "seconds"),
+        "git" : git_revision(repo),
+        "machine" : machine_info(),
+        "settings" : settings,
+        "settings_id" : key_hash(settings),
+        "metrics" : metrics,
+    }
+    outdir = Path(results_dir) / name
+    outdir.mkdir(parents = True, exist_ok = True)
+    run_id = f"{now.strftime('%Y%m%dT%H%M%S')}_{run['git']['rev'][:12]}{'-dirty' if run['git']['dirty'] else ''}_{run['machine']['id']}"
+    path = outdir / f"{run_id}.json"
+    for i in itertools.count(1) :
+        if not path.exists() :
+            break
+        path = outdir / f"{run_id}-{i}.json"
+    run_id = path.stem
+    with open(path, "w") as f :
+        json.dump(run, f, indent = 1)
+    print(f"INFO Stored run {run_id} of {name} ({len(metrics)} metrics) in {path}")
+    return path
+
+def load_runs(results_dir, name) :
+    runs = []
+    # (in the order they were stored)
+    for path in sorted((Path(results_dir) / name).glob("*.json"), key = lambda p : p.stat().st_mtime_ns) :
+        with open(path) as f :
+            run = json.load(f)
+        run["id"] = path.stem
+        runs.append(run)
+    return runs
+
+def metric(samples, unit = "", better = "lower") :
+    return {"unit" : unit, "better" : better, "samples" : [float(x) for x in samples]}
+
+##
+## statistics
+##
+
+def ranks(values) :
+    # (midranks for ties)
+    order = sorted(range(len(values)), key = lambda i : values[i])
+    out = [0.] * len(values)
+    i = 0
+    while i < len(order) :
+        j = i
+        while j + 1 < len(order) and values[order[j + 1]] == values[order[i]] :
+            j += 1
+        for k in range(i, j + 1) :
+            out[order[k]] = (i + j) / 2. + 1.
+        i = j + 1
+    return out
+
+def mann_whitney(a, b) :
+    """
+    Two-sided p-value of the Mann-Whitney U test of a against b: exact (over all
+    splits of the pooled samples) for small samples, from the tie-corrected
+    normal approximation otherwise.
+    """
+    n1, n2 = len(a), len(b)
+    pooled = list(a) + list(b)
+    r = ranks(pooled)
+    u = sum(r[:n1]) - n1 * (n1 + 1) / 2.
+    mean_u = n1 * n2 / 2.
+    if math.comb(n1 + n2, n1) <= 200000 :
+        deviation = abs(u - mean_u)
+        n_extreme, n_total = 0, 0
+        for split in itertools.combinations(range(n1 + n2), n1) :
+            u_split = sum(r[i] for i in split) - n1 * (n1 + 1) / 2.
+            n_extreme += abs(u_split - mean_u) >= deviation - 1e-9
+            n_total += 1
+        return n_extreme / n_total
+    n = n1 + n2
+    ties = {}
+    for x in pooled :
+        ties[x] = ties.get(x, 0) + 1
+    tie_term = sum(t**3 - t for t in ties.values()) / (n * (n - 1))
+    sigma = math.sqrt(n1 * n2 / 12. * ((n + 1) - tie_term))
+    if sigma == 0 :
+        return 1.
+    z = (abs(u - mean_u) - 0.5) / sigma
+    return math.erfc(max(z, 0.) / math.sqrt(2.))
+
+def bootstrap_ratio_ci(a, b, confidence, n_resamples = 10000, seed = 12345) :
+    """
+    Percentile bootstrap confidence interval of median(b) / median(a).
+    """
+    rng = random.Random(seed)
+    ratios = []
+    for _ in range(n_resamples) :
+        median_a = statistics.median(rng.choices(a, k = len(a)))
+        median_b = statistics.median(rng.choices(b, k = len(b)))
+        ratios.append(median_b / median_a if median_a != 0 else math.inf)
+    ratios.sort()
+    low = ratios[int((1. - confidence) / 2. * n_resamples)]
+    high = ratios[min(n_resamples - 1, int((1. + confidence) / 2. * n_resamples))]
+    return low, high
+
+def compare_metric(baseline, candidate, test, alpha, threshold) :
+    """
+    The relative change of the median of a metric from baseline to candidate
+    (positive: worse) and whether it is significant, and a regression beyond
+    the threshold (a fraction).
+    """
+    a, b = baseline["samples"], candidate["samples"]
+    sign = 1. if baseline.get("better", "lower") == "lower" else -1.
+    median_a, median_b = statistics.median(a), statistics.median(b)
+    change = sign * (median_b / median_a - 1.) if median_a != 0 else 0.
+    if test == "bootstrap" :
+        low, high = bootstrap_ratio_ci(a, b, 1. - alpha)
+        significant = low > 1. or high < 1.
+        detail = f"CI [{low:.3f}, {high:.3f}]"
+    else :
+        p = mann_whitney(a, b)
+        significant = p < alpha
+        detail = f"p = {p:.3g}"
+    if min(len(a), len(b)) < 2 :
+        significant = False
+        detail = "too few repeats"
+    return change, significant, significant and change > threshold, detail
+
+##
+## commands
+##
+
+def run_command(args, command) :
+    if not command :
+        raise Exception("ERROR No command to run given (after --)")
+    parsers = []
+    for spec in args.metric :
+        # name=regex, with the value as the first group
+        if "=" not in spec :
+            raise Exception(f"ERROR Invalid metric \"{spec}\" (expected name=regex)")
+        name, regex = spec.split("=", 1)
+        parsers.append((name, re.compile(regex), "higher" if name in args.higher else "lower"))
+
+    wall_times = []
+    parsed = {name : [] for name, _, _ in parsers}
+    for irun in range(args.repeats) :
+        start = time.perf_counter()
+        result = subprocess.run(command, capture_output = True, text = True)
+        wall_times.append(time.perf_counter() - start)
+        if result.returncode != 0 :
+            sys.stdout.write(result.stdout)
+            sys.stderr.write(result.stderr)
+            raise Exception(f"ERROR Command failed with status {result.returncode}: {' '.join(command)}")
+        for name, regex, _ in parsers :
+            match = regex.search(result.stdout)
+            if match is None :
+                raise Exception(f"ERROR No match for metric {name} in the output of run {irun}")
+            parsed[name].append(float(match.group(1)))
+        print(f"INFO Run {irun + 1}/{args.repeats}: {wall_times[-1]:.3f} s")
+
+    metrics = {"wall_time" : metric(wall_times, "s")}
+    for name, _, better in parsers :
+        metrics[name] = metric(parsed[name], better = better)
+    settings = parse_settings(args.setting)
+    settings["command"] = " ".join(command)
+    save_run(args.results_dir, args.name, metrics, settings, args.repo)
+
+def gbench_metrics(data) :
+    # the repetitions of each benchmark (the aggregates are computed again here)
+    samples, units = {}, {}
+    for bm in data["benchmarks"] :
+        if bm.get("run_type", "iteration") != "iteration" or "error_occurred" in bm :
+            continue
+        name = bm.get("run_name", bm["name"])
+        samples.setdefault(name, []).append(bm["real_time"])
+        units[name] = bm.get("time_unit", "ns")
+    return {name : metric(values, units[name]) for name, values in samples.items()}
+
+def record_command(args) :
+    settings = parse_settings(args.setting)
+    with open(args.input) as f :
+        data = json.load(f)
+    if "benchmarks" in data :
+        metrics = gbench_metrics(data)
+        settings.setdefault("executable", data.get("context", {}).get("executable", ""))
+    elif "metrics" in data :
+        # {"metrics": {name: {"samples": [...], "unit": ..., "better": ...}}, "settings": {...}}
+        metrics = {name : metric(m["samples"], m.get("unit", ""), m.get("better", "lower")) for name, m in data["metrics"].items()}
+        settings = {**{k : str(v) for k, v in data.get("settings", {}).items()}, **settings}
+    else :
+        raise Exception(f"ERROR Unknown results format in {args.input}")
+    save_run(args.results_dir, args.name, metrics, settings, args.repo)
+
+def list_command(args) :
+    names = [args.name] if args.name else sorted(p.name for p in Path(args.results_dir).iterdir() if p.is_dir())
+    for name in names :
+        print(f"{name}:")
+        for run in load_runs(args.results_dir, name) :
+            print(f"   {run['id']:<48} {run['machine']['hostname']:<16} settings {run['settings_id']}  "
+                  f"{len(run['metrics'])} metrics, {' '.join(f'{k}={v}' for k, v in run['settings'].items())}")
+
+def find_run(runs, ref) :
+    matches = [r for r in runs if r["id"] == ref or r["git"]["rev"].startswith(ref)]
+    if not matches :
+        raise Exception(f"ERROR No stored run matches \"{ref}\"")
+    # (the latest run of a revision)
+    return matches[-1]
+
+def compare_command(args) :
+    runs = load_runs(args.results_dir, args.name)
+    if not runs :
+        raise Exception(f"ERROR No stored runs of {args.name} in {args.results_dir}")
+    candidate = find_run(runs, args.candidate) if args.candidate else runs[-1]
+
+    def comparable(run) :
+        return (run["settings_id"] == candidate["settings_id"] and
+                    (args.any_machine or run["machine"]["id"] == candidate["machine"]["id"]))
+
+    if args.baseline :
+        baseline = find_run(runs, args.baseline)
+    else :
+        # the latest comparable run of another revision (or the previous one of the same revision)
+        others = [r for r in runs if comparable(r) and r["id"] != candidate["id"]]
+        other_revs = [r for r in others if r["git"]["rev"] != candidate["git"]["rev"]]
+        if not others :
+            raise Exception(f"ERROR No run of {args.name} to compare {candidate['id']} to (same settings and machine)")
+        baseline = (other_revs or others)[-1]
+    if not comparable(baseline) :
+        print(f"WARNING The runs differ in {'settings' if baseline['settings_id'] != candidate['settings_id'] else 'machine'}")
+
+    print(f"baseline : {baseline['id']}")
+    print(f"candidate: {candidate['id']}")
+    print(f"test: {args.test}, alpha = {args.alpha}, slowdown threshold = {args.threshold:.1f}%")
+    regressions = []
+    for name in sorted(set(baseline["metrics"]) & set(candidate["metrics"])) :
+        a, b = baseline["metrics"][name], candidate["metrics"][name]
+        change, significant, regression, detail = compare_metric(a, b, args.test, args.alpha, args.threshold / 100.)
+        status = "REGRESSION" if regression else ("worse" if significant and change > 0 else "better" if significant else "")
+        print(f"   {name:<60} {statistics.median(a['samples']):>12.4g} -> {statistics.median(b['samples']):<12.4g} {a['unit']:<3}"
+              f" {100. * change:+7.2f}%  ({detail}) {status}")
+        if regression :
+            regressions.append(name)
+    missing = set(baseline["metrics"]) ^ set(candidate["metrics"])
+    if missing :
+        print(f"WARNING {len(missing)} metrics are only in one of the runs")
+    if regressions :
+        print(f"ERROR {len(regressions)} metrics are significantly worse by more than {args.threshold:.1f}%")
+        return 1
+    print("INFO No regressions")
+    return 0
+
+def main() :
+
+    parser = ArgumentParser(description = "Store benchmark results and compare runs for regressions")
+    parser.add_argument("--results-dir", default = os.environ.get("BENCH_RESULTS_DIR", DEFAULT_RESULTS_DIR),
+                help = f"Directory of the stored results [default: $BENCH_RESULTS_DIR or {DEFAULT_RESULTS_DIR}]")
+    parser.add_argument("--repo", default = ".", help = "Git repository whose revision the runs are stored under [default: .]")
+    commands = parser.add_subparsers(dest = "action", required = True)
+
+    run = commands.add_parser("run", help = "Time repeated runs of a command and store them")
+    run.add_argument("name", help = "Name of the benchmark")
+    run.add_argument("-n", "--repeats", type = int, default = 5)
+    run.add_argument("--metric", action = "append", default = [],
+                help = "Metric parsed from the output of every run, as name=regex with the value as the first group")
+    run.add_argument("--higher", action = "append", default = [], help = "Name of a parsed metric for which higher is better (e.g. a rate)")
+    run.add_argument("--setting", action = "append", default = [], help = "Additional setting of the run, as key=value")
+    run.epilog = "The command to time follows a \"--\"."
+
+    record = commands.add_parser("record", help = "Store results written by a benchmark (Google Benchmark JSON or --timings-out)")
+    record.add_argument("name", help = "Name of the benchmark")
+    record.add_argument("input", help = "JSON results file")
+    record.add_argument("--setting", action = "append", default = [], help = "Additional setting of the run, as key=value")
+
+    ls = commands.add_parser("list", help = "List the stored runs")
+    ls.add_argument("name", nargs = "?", default = None)
+
+    compare = commands.add_parser("compare", help = "Compare two runs, exit with status 1 on regressions")
+    compare.add_argument("name", help = "Name of the benchmark")
+    compare.add_argument("baseline", nargs = "?", default = None,
+                help = "Run id or git revision (prefix) of the baseline [default: the latest comparable run of another revision]")
+    compare.add_argument("candidate", nargs = "?", default = None, help = "Run id or git revision of the candidate [default: the latest run]")
+    compare.add_argument("--test", choices = ["mann-whitney", "bootstrap"], default = "mann-whitney")
+    compare.add_argument("--alpha", type = float, default = 0.05, help = "Significance level [default: 0.05]")
+    compare.add_argument("--threshold", type = float, default = 5., help = "Allowed slowdown in percent [default: 5]")
+    compare.add_argument("--any-machine", action = "store_true", default = False, help = "Also compare to runs of other machines")
+    # (everything after "--" is the command of "run")
+    argv = sys.argv[1:]
+    command = argv[argv.index("--") + 1:] if "--" in argv else []
+    args = parser.parse_args(argv[:argv.index("--")] if "--" in argv else argv)
+
+    if args.action == "run" :
+        run_command(args, command)
+    elif args.action == "record" :
+        record_command(args)
+    elif args.action == "list" :
+        list_command(args)
+    elif args.action == "compare" :
+        sys.exit(compare_command(args))
+
+if __name__ == "__main__" :
+    main()
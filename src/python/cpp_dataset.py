@@ -0,0 +1,49 @@
+#!/usr/bin/env python
+
+"""
+Datasets read by the C++ DatasetReader (see src/cpp/dataset_stream.h), handed
+over to pyarrow (and from there to awkward) through the Arrow C stream
+interface, without copying: the extension module `pydataset` (built next to
+the C++ tools) needs to be importable, e.g. with PYTHONPATH=/path/to/build.
+"""
+
+import pyarrow as pa
+
+import pydataset
+
+def record_batch_reader(path, columns = None, **kwargs) :
+    """
+    A pyarrow.RecordBatchReader over the RowGroups of the dataset at `path`, one
+    RecordBatch per RowGroup in dataset order. `columns` are dotted column paths
+    (e.g. "jets.jets.pt" or "met"), the other keyword arguments (partitions,
+    threads, queue_size, use_summary, footer_cache) are those of pydataset.stream.
+    """
+    capsule = pydataset.stream(path, columns = columns, **kwargs)
+    if hasattr(pa.RecordBatchReader, "_import_from_c_capsule") :
+        return pa.RecordBatchReader._import_from_c_capsule(capsule)
+    # older pyarrow imports from the address, moving the stream out of the
+    # capsule, which only frees the (released) struct when it goes away
+    return pa.RecordBatchReader._import_from_c(pydataset.stream_address(capsule))
+
+class DatasetStream :
+    """
+    The dataset at `path` as an object of the Arrow PyCapsule interface, e.g. for
+    pyarrow.RecordBatchReader.from_stream(DatasetStream("dataset_gen")); every
+    export reads the dataset anew.
+    """
+    def __init__(self, path, columns = None, **kwargs) :
+        self.path = str(path)
+        self.columns = columns
+        self.kwargs = kwargs
+
+    def __arrow_c_stream__(self, requested_schema = None) :
+        # (the requested schema is a hint that producers may ignore)
+        return pydataset.stream(self.path, columns = self.columns, **self.kwargs)
+
+def events(path, columns = None, **kwargs) :
+    """
+    The RowGroups of the dataset at `path` as awkward arrays.
+    """
+    import awkward as ak
+    for batch in record_batch_reader(path, columns = columns, **kwargs) :
+        yield ak.from_arrow(batch)
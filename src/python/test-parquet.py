@@ -62,6 +62,7 @@ def main() :
     parser.add_argument("-t", "--threads", action = "store_true", default = False)
     parser.add_argument("--n-columns", default = -1, type = int)
     parser.add_argument("--repeats", default = 5, type = int)
+    parser.add_argument("--timings-out", default = None, help = "Write the time of every trial to this JSON file (see bench-history.py)")
     args = parser.parse_args()
 
     if not Path(args.input_file).exists() :
@@ -84,5 +85,13 @@ job_loop('{args.input_file}', chunk_size = {args.chunk_size}, use_threads = {arg
     repeats = np.array(timeit.repeat(CODE_TO_RUN, setup=SETUP, number = 1, repeat = args.repeats))
     print(f"Average of {args.repeats} trials: {np.mean(repeats):.5f} +/- {np.std(repeats):.5f} seconds")
 
+    if args.timings_out :
+        timings = {
+            "metrics" : {"read_time" : {"samples" : repeats.tolist(), "unit" : "s", "better" : "lower"}},
+            "settings" : {"input" : args.input_file, "chunk_size" : args.chunk_size, "threads" : args.threads, "n_columns" : args.n_columns}
+        }
+        with open(args.timings_out, "w") as f :
+            json.dump(timings, f, indent = 1)
+
 if __name__ == "__main__" :
     main()